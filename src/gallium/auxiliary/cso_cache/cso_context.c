@@ -36,6 +36,8 @@
   */
 
 #include "pipe/p_state.h"
+#include "os/os_thread.h"
+#include "util/u_double_list.h"
 #include "util/u_draw.h"
 #include "util/u_framebuffer.h"
 #include "util/u_inlines.h"
@@ -81,6 +83,9 @@ struct cso_context {
    struct cso_cache *cache;
    struct u_vbuf *vbuf;
 
+   /** Cache of the screen the states in the cache above come from, if any */
+   struct cso_shared_cache *shared;
+
    boolean has_geometry_shader;
    boolean has_streamout;
 
@@ -124,15 +129,471 @@ struct cso_context {
 };
 
 
+/**
+ * Blend, depth/stencil/alpha, rasterizer, sampler and vertex elements
+ * states shared by all the CSO contexts of a screen created with
+ * cso_create_context_shared(), so that identical states are created only
+ * once per screen.  The driver objects are created and deleted with a
+ * context of the cache's own.
+ *
+ * Each CSO context still looks its states up in its own cso_cache, without
+ * locking, and only goes to the shared cache on a miss.  The entries of its
+ * cache hold a reference to the shared state, which is dropped when the
+ * context evicts the entry or is released.  The lock only guards the shared
+ * tables, so lookups never depend on other contexts' bindings.  States that
+ * no context references are kept in LRU order, and trimmed from the front
+ * once the cache goes over its memory limit.
+ */
+struct cso_shared_cache {
+   pipe_mutex mutex;
+
+   struct pipe_context *pipe;
+   struct cso_hash *hashes[CSO_CACHE_MAX];
+
+   /** Unreferenced cso_shared_node, least recently released first */
+   struct list_head lru;
+
+   size_t memory;
+   size_t max_memory;
+};
+
+/**
+ * Header of the states in the shared cache.  The hashes point to the
+ * cso_blend, cso_sampler, etc. right after it, for the template lookups.
+ */
+struct cso_shared_node {
+   struct list_head lru;
+   enum cso_cache_type type;
+   unsigned hash_key;
+   unsigned size;
+   /** Number of CSO context caches holding the state */
+   unsigned refcount;
+};
+
+#define CSO_SHARED_MAX_MEMORY (4 * 1024 * 1024)
+
+
+static void *
+shared_state_data(void *cso, enum cso_cache_type type)
+{
+   switch (type) {
+   case CSO_BLEND:
+      return ((struct cso_blend *)cso)->data;
+   case CSO_SAMPLER:
+      return ((struct cso_sampler *)cso)->data;
+   case CSO_DEPTH_STENCIL_ALPHA:
+      return ((struct cso_depth_stencil_alpha *)cso)->data;
+   case CSO_RASTERIZER:
+      return ((struct cso_rasterizer *)cso)->data;
+   case CSO_VELEMENTS:
+      return ((struct cso_velements *)cso)->data;
+   default:
+      assert(0);
+      return NULL;
+   }
+}
+
+
+/**
+ * Size of the part of a state which is hashed, as in the cso_set_*()
+ * functions.
+ */
+static unsigned
+shared_state_key_size(const void *cso, enum cso_cache_type type)
+{
+   switch (type) {
+   case CSO_BLEND:
+      {
+         const struct pipe_blend_state *blend =
+            &((const struct cso_blend *)cso)->state;
+         return blend->independent_blend_enable ?
+            sizeof(struct pipe_blend_state) :
+            (char *)&(blend->rt[1]) - (char *)blend;
+      }
+   case CSO_SAMPLER:
+      return sizeof(struct pipe_sampler_state);
+   case CSO_DEPTH_STENCIL_ALPHA:
+      return sizeof(struct pipe_depth_stencil_alpha_state);
+   case CSO_RASTERIZER:
+      return sizeof(struct pipe_rasterizer_state);
+   case CSO_VELEMENTS:
+      return sizeof(struct pipe_vertex_element) *
+         ((const struct cso_velements *)cso)->state.count + sizeof(unsigned);
+   default:
+      assert(0);
+      return 0;
+   }
+}
+
+
+/**
+ * Create the driver object for a template, with the lock held.
+ */
+static void *
+shared_state_create(struct cso_shared_cache *shared,
+                    enum cso_cache_type type,
+                    const void *templ, unsigned key_size)
+{
+   struct pipe_context *pipe = shared->pipe;
+   struct cso_shared_node *node;
+   unsigned cso_size;
+   void *cso;
+
+   switch (type) {
+   case CSO_BLEND:
+      cso_size = sizeof(struct cso_blend);
+      break;
+   case CSO_SAMPLER:
+      cso_size = sizeof(struct cso_sampler);
+      break;
+   case CSO_DEPTH_STENCIL_ALPHA:
+      cso_size = sizeof(struct cso_depth_stencil_alpha);
+      break;
+   case CSO_RASTERIZER:
+      cso_size = sizeof(struct cso_rasterizer);
+      break;
+   case CSO_VELEMENTS:
+      cso_size = sizeof(struct cso_velements);
+      break;
+   default:
+      assert(0);
+      return NULL;
+   }
+
+   node = CALLOC(1, sizeof *node + cso_size);
+   if (!node)
+      return NULL;
+
+   node->type = type;
+   node->size = sizeof *node + cso_size;
+   cso = node + 1;
+
+   /* the states are zeroed past the key, as in the per-context caches */
+   memcpy(cso, templ, key_size);
+
+   switch (type) {
+   case CSO_BLEND:
+      {
+         struct cso_blend *blend = cso;
+         blend->data = pipe->create_blend_state(pipe, &blend->state);
+         blend->delete_state = (cso_state_callback)pipe->delete_blend_state;
+         blend->context = pipe;
+      }
+      break;
+   case CSO_SAMPLER:
+      {
+         struct cso_sampler *sampler = cso;
+         sampler->data = pipe->create_sampler_state(pipe, &sampler->state);
+         sampler->delete_state =
+            (cso_state_callback)pipe->delete_sampler_state;
+         sampler->context = pipe;
+      }
+      break;
+   case CSO_DEPTH_STENCIL_ALPHA:
+      {
+         struct cso_depth_stencil_alpha *dsa = cso;
+         dsa->data = pipe->create_depth_stencil_alpha_state(pipe,
+                                                            &dsa->state);
+         dsa->delete_state =
+            (cso_state_callback)pipe->delete_depth_stencil_alpha_state;
+         dsa->context = pipe;
+      }
+      break;
+   case CSO_RASTERIZER:
+      {
+         struct cso_rasterizer *rasterizer = cso;
+         rasterizer->data = pipe->create_rasterizer_state(pipe,
+                                                          &rasterizer->state);
+         rasterizer->delete_state =
+            (cso_state_callback)pipe->delete_rasterizer_state;
+         rasterizer->context = pipe;
+      }
+      break;
+   case CSO_VELEMENTS:
+      {
+         struct cso_velements *velements = cso;
+         velements->data =
+            pipe->create_vertex_elements_state(pipe, velements->state.count,
+                                               &velements->state.velems[0]);
+         velements->delete_state =
+            (cso_state_callback)pipe->delete_vertex_elements_state;
+         velements->context = pipe;
+      }
+      break;
+   default:
+      break;
+   }
+
+   return cso;
+}
+
+
+static void
+shared_state_destroy(struct cso_shared_cache *shared,
+                     struct cso_shared_node *node)
+{
+   struct pipe_context *pipe = shared->pipe;
+   void *data = shared_state_data(node + 1, node->type);
+
+   switch (node->type) {
+   case CSO_BLEND:
+      pipe->delete_blend_state(pipe, data);
+      break;
+   case CSO_SAMPLER:
+      pipe->delete_sampler_state(pipe, data);
+      break;
+   case CSO_DEPTH_STENCIL_ALPHA:
+      pipe->delete_depth_stencil_alpha_state(pipe, data);
+      break;
+   case CSO_RASTERIZER:
+      pipe->delete_rasterizer_state(pipe, data);
+      break;
+   case CSO_VELEMENTS:
+      pipe->delete_vertex_elements_state(pipe, data);
+      break;
+   default:
+      assert(0);
+   }
+
+   FREE(node);
+}
+
+
+/**
+ * Delete an unreferenced state, with the lock held.
+ */
+static void
+shared_state_delete(struct cso_shared_cache *shared,
+                    struct cso_shared_node *node)
+{
+   struct cso_hash *hash = shared->hashes[node->type];
+   struct cso_hash_iter iter = cso_hash_find(hash, node->hash_key);
+
+   assert(node->refcount == 0);
+
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_data(iter) != (void *)(node + 1))
+      iter = cso_hash_iter_next(iter);
+
+   assert(!cso_hash_iter_is_null(iter));
+   if (!cso_hash_iter_is_null(iter))
+      cso_hash_erase(hash, iter);
+
+   shared->memory -= node->size;
+   LIST_DEL(&node->lru);
+   shared_state_destroy(shared, node);
+}
+
+
+/**
+ * Counterpart of sanitize_hash() for the shared cache, which removes the
+ * least recently released states rather than random ones.  Only the
+ * unreferenced states are on the LRU list, so this never looks at more
+ * states than it removes.
+ */
+static void
+sanitize_shared_cache(struct cso_shared_cache *shared)
+{
+   size_t target;
+
+   if (shared->memory <= shared->max_memory)
+      return;
+
+   /* remove a fourth more than needed, so that the next insertions don't
+    * go through the same */
+   target = shared->max_memory - shared->max_memory / 4;
+
+   while (shared->memory > target && !LIST_IS_EMPTY(&shared->lru))
+      shared_state_delete(shared, LIST_ENTRY(struct cso_shared_node,
+                                             shared->lru.next, lru));
+}
+
+
+/**
+ * Find or create the state of a template in the shared cache, and take a
+ * reference to it for a CSO context cache entry.
+ */
+static enum pipe_error
+shared_state_get(struct cso_shared_cache *shared, enum cso_cache_type type,
+                 const void *templ, unsigned key_size, unsigned hash_key,
+                 void **data)
+{
+   struct cso_shared_node *node;
+   void *cso;
+
+   pipe_mutex_lock(shared->mutex);
+
+   cso = cso_hash_find_data_from_template(shared->hashes[type], hash_key,
+                                          (void *)templ, key_size);
+   if (cso) {
+      node = (struct cso_shared_node *)cso - 1;
+      if (node->refcount++ == 0)
+         LIST_DEL(&node->lru);
+   }
+   else {
+      cso = shared_state_create(shared, type, templ, key_size);
+      if (!cso) {
+         pipe_mutex_unlock(shared->mutex);
+         return PIPE_ERROR_OUT_OF_MEMORY;
+      }
+
+      node = (struct cso_shared_node *)cso - 1;
+      node->hash_key = hash_key;
+      if (cso_hash_iter_is_null(cso_hash_insert(shared->hashes[type],
+                                                hash_key, cso))) {
+         shared_state_destroy(shared, node);
+         pipe_mutex_unlock(shared->mutex);
+         return PIPE_ERROR_OUT_OF_MEMORY;
+      }
+      node->refcount = 1;
+      shared->memory += node->size;
+
+      sanitize_shared_cache(shared);
+   }
+
+   *data = shared_state_data(cso, type);
+
+   pipe_mutex_unlock(shared->mutex);
+
+   return PIPE_OK;
+}
+
+
+/**
+ * Drop the reference of a CSO context cache entry to a shared state.
+ */
+static void
+shared_state_release(struct cso_shared_cache *shared,
+                     enum cso_cache_type type, void *state)
+{
+   unsigned key_size = shared_state_key_size(state, type);
+   unsigned hash_key = cso_construct_key(state, key_size);
+   struct cso_shared_node *node;
+   void *cso;
+
+   pipe_mutex_lock(shared->mutex);
+
+   cso = cso_hash_find_data_from_template(shared->hashes[type], hash_key,
+                                          state, key_size);
+   assert(cso);
+   if (cso) {
+      node = (struct cso_shared_node *)cso - 1;
+      assert(node->refcount);
+      if (--node->refcount == 0) {
+         LIST_ADDTAIL(&node->lru, &shared->lru);
+         sanitize_shared_cache(shared);
+      }
+   }
+
+   pipe_mutex_unlock(shared->mutex);
+}
+
+
+struct cso_shared_cache *
+cso_shared_cache_create(struct pipe_screen *screen)
+{
+   struct cso_shared_cache *shared = CALLOC_STRUCT(cso_shared_cache);
+   int i;
+
+   if (!shared)
+      return NULL;
+
+   pipe_mutex_init(shared->mutex);
+   LIST_INITHEAD(&shared->lru);
+   shared->max_memory = CSO_SHARED_MAX_MEMORY;
+
+   shared->pipe = screen->context_create(screen, NULL);
+   if (!shared->pipe)
+      goto fail;
+
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      shared->hashes[i] = cso_hash_create();
+      if (!shared->hashes[i])
+         goto fail;
+   }
+
+   return shared;
+
+fail:
+   cso_shared_cache_destroy(shared);
+   return NULL;
+}
+
+
+/**
+ * Free the shared cache.  NOTE: the CSO contexts using it should have
+ * previously been released with cso_release_all().
+ */
+void
+cso_shared_cache_destroy(struct cso_shared_cache *shared)
+{
+   int i;
+
+   if (!shared)
+      return;
+
+   while (!LIST_IS_EMPTY(&shared->lru))
+      shared_state_delete(shared, LIST_ENTRY(struct cso_shared_node,
+                                             shared->lru.next, lru));
+   assert(shared->memory == 0);
+
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      if (shared->hashes[i])
+         cso_hash_delete(shared->hashes[i]);
+   }
+
+   if (shared->pipe)
+      shared->pipe->destroy(shared->pipe);
+   pipe_mutex_destroy(shared->mutex);
+   FREE(shared);
+}
+
+
+/**
+ * Set the memory the shared cache may use for its states, not counting
+ * what the driver allocates for them.  States still cached by a context
+ * count towards it, but are only trimmed once no context caches them.
+ */
+void
+cso_shared_cache_set_max_memory(struct cso_shared_cache *shared,
+                                size_t max_memory)
+{
+   pipe_mutex_lock(shared->mutex);
+   shared->max_memory = max_memory;
+   sanitize_shared_cache(shared);
+   pipe_mutex_unlock(shared->mutex);
+}
+
+
+static boolean sampler_bound(const struct cso_context *ctx, void *data)
+{
+   unsigned shader, i;
+
+   for (shader = 0; shader < PIPE_SHADER_TYPES; shader++) {
+      const struct sampler_info *info = &ctx->samplers[shader];
+      for (i = 0; i < PIPE_MAX_SAMPLERS; i++) {
+         if (info->hw.samplers[i] == data ||
+             info->samplers[i] == data ||
+             info->samplers_saved[i] == data)
+            return TRUE;
+      }
+   }
+
+   return FALSE;
+}
+
+
 static boolean delete_blend_state(struct cso_context *ctx, void *state)
 {
    struct cso_blend *cso = (struct cso_blend *)state;
 
-   if (ctx->blend == cso->data)
+   if (ctx->blend == cso->data || ctx->blend_saved == cso->data)
       return FALSE;
 
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
+   else if (ctx->shared)
+      shared_state_release(ctx->shared, CSO_BLEND, cso);
    FREE(state);
    return TRUE;
 }
@@ -142,11 +603,14 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
    struct cso_depth_stencil_alpha *cso =
       (struct cso_depth_stencil_alpha *)state;
 
-   if (ctx->depth_stencil == cso->data)
+   if (ctx->depth_stencil == cso->data ||
+       ctx->depth_stencil_saved == cso->data)
       return FALSE;
 
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
+   else if (ctx->shared)
+      shared_state_release(ctx->shared, CSO_DEPTH_STENCIL_ALPHA, cso);
    FREE(state);
 
    return TRUE;
@@ -155,8 +619,14 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
 static boolean delete_sampler_state(struct cso_context *ctx, void *state)
 {
    struct cso_sampler *cso = (struct cso_sampler *)state;
+
+   if (sampler_bound(ctx, cso->data))
+      return FALSE;
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
+   else if (ctx->shared)
+      shared_state_release(ctx->shared, CSO_SAMPLER, cso);
    FREE(state);
    return TRUE;
 }
@@ -165,10 +635,12 @@ static boolean delete_rasterizer_state(struct cso_context *ctx, void *state)
 {
    struct cso_rasterizer *cso = (struct cso_rasterizer *)state;
 
-   if (ctx->rasterizer == cso->data)
+   if (ctx->rasterizer == cso->data || ctx->rasterizer_saved == cso->data)
       return FALSE;
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
+   else if (ctx->shared)
+      shared_state_release(ctx->shared, CSO_RASTERIZER, cso);
    FREE(state);
    return TRUE;
 }
@@ -178,11 +650,13 @@ static boolean delete_vertex_elements(struct cso_context *ctx,
 {
    struct cso_velements *cso = (struct cso_velements *)state;
 
-   if (ctx->velements == cso->data)
+   if (ctx->velements == cso->data || ctx->velements_saved == cso->data)
       return FALSE;
 
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
+   else if (ctx->shared)
+      shared_state_release(ctx->shared, CSO_VELEMENTS, cso);
    FREE(state);
    return TRUE;
 }
@@ -256,11 +730,25 @@ static void cso_init_vbuf(struct cso_context *cso)
 }
 
 struct cso_context *cso_create_context( struct pipe_context *pipe )
+{
+   return cso_create_context_shared(pipe, NULL);
+}
+
+/**
+ * Create a CSO context which takes the states missing from its cache from
+ * a cache shared with the other contexts of the screen, if not NULL.
+ */
+struct cso_context *
+cso_create_context_shared(struct pipe_context *pipe,
+                          struct cso_shared_cache *shared)
 {
    struct cso_context *ctx = CALLOC_STRUCT(cso_context);
    if (ctx == NULL)
       goto out;
 
+   assert(!shared || shared->pipe->screen == pipe->screen);
+   ctx->shared = shared;
+
    ctx->cache = cso_cache_create();
    if (ctx->cache == NULL)
       goto out;
@@ -294,6 +782,18 @@ out:
    return NULL;
 }
 
+struct shared_release_data {
+   struct cso_shared_cache *shared;
+   enum cso_cache_type type;
+};
+
+static void release_shared_state(void *state, void *user_data)
+{
+   struct shared_release_data *data = (struct shared_release_data *)user_data;
+
+   shared_state_release(data->shared, data->type, state);
+}
+
 /**
  * Prior to context destruction, this function unbinds all state objects.
  */
@@ -361,6 +861,13 @@ void cso_release_all( struct cso_context *ctx )
    }
 
    if (ctx->cache) {
+      if (ctx->shared) {
+         enum cso_cache_type type;
+         for (type = 0; type < CSO_CACHE_MAX; type++) {
+            struct shared_release_data data = { ctx->shared, type };
+            cso_for_each_state(ctx->cache, type, release_shared_state, &data);
+         }
+      }
       cso_cache_delete( ctx->cache );
       ctx->cache = NULL;
    }
@@ -412,12 +919,29 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 
       memset(&cso->state, 0, sizeof cso->state);
       memcpy(&cso->state, templ, key_size);
-      cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
-      cso->delete_state = (cso_state_callback)ctx->pipe->delete_blend_state;
+      if (ctx->shared) {
+         enum pipe_error ret = shared_state_get(ctx->shared, CSO_BLEND,
+                                                &cso->state, key_size,
+                                                hash_key, &cso->data);
+         if (ret != PIPE_OK) {
+            FREE(cso);
+            return ret;
+         }
+         cso->delete_state = NULL;
+      }
+      else {
+         cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_blend_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
       if (cso_hash_iter_is_null(iter)) {
+         if (ctx->shared)
+            shared_state_release(ctx->shared, CSO_BLEND, cso);
+         else
+            cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -471,15 +995,32 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
-                                                              &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+      if (ctx->shared) {
+         enum pipe_error ret = shared_state_get(ctx->shared,
+                                                CSO_DEPTH_STENCIL_ALPHA,
+                                                &cso->state, key_size,
+                                                hash_key, &cso->data);
+         if (ret != PIPE_OK) {
+            FREE(cso);
+            return ret;
+         }
+         cso->delete_state = NULL;
+      }
+      else {
+         cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
+                                                                 &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key,
                               CSO_DEPTH_STENCIL_ALPHA, cso);
       if (cso_hash_iter_is_null(iter)) {
+         if (ctx->shared)
+            shared_state_release(ctx->shared, CSO_DEPTH_STENCIL_ALPHA, cso);
+         else
+            cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -533,13 +1074,30 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe, &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+      if (ctx->shared) {
+         enum pipe_error ret = shared_state_get(ctx->shared, CSO_RASTERIZER,
+                                                &cso->state, key_size,
+                                                hash_key, &cso->data);
+         if (ret != PIPE_OK) {
+            FREE(cso);
+            return ret;
+         }
+         cso->delete_state = NULL;
+      }
+      else {
+         cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe,
+                                                        &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
       if (cso_hash_iter_is_null(iter)) {
+         if (ctx->shared)
+            shared_state_release(ctx->shared, CSO_RASTERIZER, cso);
+         else
+            cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -889,14 +1447,31 @@ cso_set_vertex_elements(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, &velems_state, key_size);
-      cso->data = ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
-                                                      &cso->state.velems[0]);
-      cso->delete_state =
-         (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
+      if (ctx->shared) {
+         enum pipe_error ret = shared_state_get(ctx->shared, CSO_VELEMENTS,
+                                                &cso->state, key_size,
+                                                hash_key, &cso->data);
+         if (ret != PIPE_OK) {
+            FREE(cso);
+            return ret;
+         }
+         cso->delete_state = NULL;
+      }
+      else {
+         cso->data =
+            ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
+                                                    &cso->state.velems[0]);
+         cso->delete_state =
+            (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
       if (cso_hash_iter_is_null(iter)) {
+         if (ctx->shared)
+            shared_state_release(ctx->shared, CSO_VELEMENTS, cso);
+         else
+            cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -1038,13 +1613,30 @@ single_sampler(struct cso_context *ctx,
             return PIPE_ERROR_OUT_OF_MEMORY;
 
          memcpy(&cso->state, templ, sizeof(*templ));
-         cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
-         cso->delete_state =
-            (cso_state_callback) ctx->pipe->delete_sampler_state;
+         if (ctx->shared) {
+            enum pipe_error ret = shared_state_get(ctx->shared, CSO_SAMPLER,
+                                                   &cso->state, key_size,
+                                                   hash_key, &cso->data);
+            if (ret != PIPE_OK) {
+               FREE(cso);
+               return ret;
+            }
+            cso->delete_state = NULL;
+         }
+         else {
+            cso->data = ctx->pipe->create_sampler_state(ctx->pipe,
+                                                        &cso->state);
+            cso->delete_state =
+               (cso_state_callback) ctx->pipe->delete_sampler_state;
+         }
          cso->context = ctx->pipe;
 
          iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
          if (cso_hash_iter_is_null(iter)) {
+            if (ctx->shared)
+               shared_state_release(ctx->shared, CSO_SAMPLER, cso);
+            else
+               cso->delete_state(cso->context, cso->data);
             FREE(cso);
             return PIPE_ERROR_OUT_OF_MEMORY;
          }
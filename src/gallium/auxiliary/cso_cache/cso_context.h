@@ -39,10 +39,27 @@ extern "C" {
 #endif
 
 struct cso_context;
+struct cso_shared_cache;
 struct u_vbuf;
 
 struct cso_context *cso_create_context( struct pipe_context *pipe );
 
+/**
+ * A cache of states shared by the contexts of a screen.  The states are
+ * created with a context of the cache and bound in the others, so this is
+ * only for drivers with PIPE_CAP_SHARED_STATE_OBJECTS.
+ */
+struct cso_shared_cache *cso_shared_cache_create(struct pipe_screen *screen);
+
+void cso_shared_cache_destroy(struct cso_shared_cache *shared);
+
+void cso_shared_cache_set_max_memory(struct cso_shared_cache *shared,
+                                     size_t max_memory);
+
+struct cso_context *
+cso_create_context_shared(struct pipe_context *pipe,
+                          struct cso_shared_cache *shared);
+
 void cso_release_all( struct cso_context *ctx );
 
 void cso_destroy_context( struct cso_context *cso );
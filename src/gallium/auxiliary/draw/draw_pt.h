@@ -242,6 +242,21 @@ struct pt_post_vs *draw_pt_post_vs_create( struct draw_context *draw );
 void draw_pt_post_vs_destroy( struct pt_post_vs *pvs );
 
 
+/*******************************************************************************
+ * Batched triangle cliptest and culling, ahead of the pipeline:
+ */
+struct pt_clip_tris;
+
+boolean draw_pt_clip_tris_run( struct pt_clip_tris *ct,
+                               struct pt_emit *emit,
+                               const struct draw_vertex_info *vert_info,
+                               const struct draw_prim_info *prim_info );
+
+struct pt_clip_tris *draw_pt_clip_tris_create( struct draw_context *draw );
+
+void draw_pt_clip_tris_destroy( struct pt_clip_tris *ct );
+
+
 /*******************************************************************************
  * Utils: 
  */
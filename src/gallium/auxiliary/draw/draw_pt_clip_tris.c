@@ -0,0 +1,363 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Batched triangle cliptest and culling.
+ *
+ * When some vertices of a batch are outside the clip volume, the whole
+ * batch used to go through the pipeline one primitive at a time, although
+ * most triangles are usually either completely inside or trivially
+ * rejected.  Here the triangles are decomposed into a list and classified
+ * four at a time: the rejected and culled ones are dropped, and only if
+ * some of the others really need clipping does the list go through the
+ * pipeline.  Otherwise it is emitted directly.
+ */
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_prim.h"
+#include "util/u_sse.h"
+#include "pipe/p_defines.h"
+#include "draw/draw_context.h"
+#include "draw/draw_private.h"
+#include "draw/draw_pt.h"
+
+
+struct pt_clip_tris {
+   struct draw_context *draw;
+
+   /* clipmask and window position of each vertex */
+   unsigned *clipmask;
+   float *x, *y;
+   unsigned max_verts;
+
+   /* triangle list, padded to a multiple of four triangles */
+   ushort *elts;
+   unsigned num_tris;
+   unsigned max_tris;
+
+   /* the pipeline clamps the elts the same way */
+   unsigned max_index;
+
+   /* culling state, only used if some face is culled */
+   unsigned cull_face;
+   boolean front_ccw;
+};
+
+
+/*
+ * Decompose the primitives into the triangle list.
+ */
+
+#define FUNC_VARS                               \
+   struct pt_clip_tris *ct,                     \
+   const struct draw_prim_info *input_prims,    \
+   unsigned start,                              \
+   unsigned count
+
+#define FUNC_ENTER                                                \
+   /* declare more local vars */                                  \
+   struct draw_context *draw = ct->draw;                          \
+   const unsigned prim = input_prims->prim;                       \
+   const unsigned prim_flags = input_prims->flags;                \
+   const boolean quads_flatshade_last =                           \
+      draw->quads_always_flatshade_last;                          \
+   const boolean last_vertex_last =                               \
+      !(draw->rasterizer->flatshade &&                            \
+        draw->rasterizer->flatshade_first)
+
+#define POINT(i0)                debug_assert(0)
+#define LINE(flags,i0,i1)        debug_assert(0)
+#define TRIANGLE(flags,i0,i1,i2)                                  \
+   do {                                                           \
+      ushort *tri = &ct->elts[ct->num_tris++ * 3];                \
+      tri[0] = (ushort) (i0);                                     \
+      tri[1] = (ushort) (i1);                                     \
+      tri[2] = (ushort) (i2);                                     \
+   } while (0)
+
+#define FUNC         clip_tris_decompose
+#define LOCAL_VARS                                                \
+   const ushort *elts = input_prims->linear ? NULL : input_prims->elts;
+#define GET_ELT(idx) (elts ? MIN2(elts[start + (idx)], ct->max_index) : \
+                             start + (idx))
+#include "draw_decompose_tmp.h"
+
+
+/*
+ * Classify four triangles, returning in the low four bits of *keep the ones
+ * which aren't rejected or culled, and in *clip the ones of those which
+ * need clipping.  The culling is the same as in the cull stage, and only
+ * applies to triangles with all their vertices inside, since the window
+ * coordinates of the others aren't known yet.
+ */
+#if defined(PIPE_ARCH_SSE)
+
+static INLINE void
+classify_tris4(const struct pt_clip_tris *ct, const ushort *e,
+               unsigned *keep, unsigned *clip)
+{
+   const unsigned *m = ct->clipmask;
+   const float *x = ct->x, *y = ct->y;
+   const __m128i zero = _mm_setzero_si128();
+   __m128i m0, m1, m2, any, all, out;
+
+   m0 = _mm_setr_epi32(m[e[0]], m[e[3]], m[e[6]], m[e[9]]);
+   m1 = _mm_setr_epi32(m[e[1]], m[e[4]], m[e[7]], m[e[10]]);
+   m2 = _mm_setr_epi32(m[e[2]], m[e[5]], m[e[8]], m[e[11]]);
+
+   any = _mm_or_si128(_mm_or_si128(m0, m1), m2);
+   all = _mm_and_si128(_mm_and_si128(m0, m1), m2);
+
+   /* all three vertices outside the same plane */
+   out = _mm_cmpeq_epi32(_mm_cmpeq_epi32(all, zero), zero);
+
+   *clip = _mm_movemask_ps(_mm_castsi128_ps(
+              _mm_cmpeq_epi32(_mm_cmpeq_epi32(any, zero), zero)));
+
+   if (ct->cull_face != PIPE_FACE_NONE) {
+      const __m128 x2 = _mm_setr_ps(x[e[2]], x[e[5]], x[e[8]], x[e[11]]);
+      const __m128 y2 = _mm_setr_ps(y[e[2]], y[e[5]], y[e[8]], y[e[11]]);
+      const __m128 ex = _mm_sub_ps(_mm_setr_ps(x[e[0]], x[e[3]],
+                                               x[e[6]], x[e[9]]), x2);
+      const __m128 ey = _mm_sub_ps(_mm_setr_ps(y[e[0]], y[e[3]],
+                                               y[e[6]], y[e[9]]), y2);
+      const __m128 fx = _mm_sub_ps(_mm_setr_ps(x[e[1]], x[e[4]],
+                                               x[e[7]], x[e[10]]), x2);
+      const __m128 fy = _mm_sub_ps(_mm_setr_ps(y[e[1]], y[e[4]],
+                                               y[e[7]], y[e[10]]), y2);
+      const __m128 det = _mm_sub_ps(_mm_mul_ps(ex, fy), _mm_mul_ps(ey, fx));
+      const unsigned ccw = _mm_movemask_ps(_mm_cmplt_ps(det, _mm_setzero_ps()));
+      const unsigned nonzero =
+         _mm_movemask_ps(_mm_cmpneq_ps(det, _mm_setzero_ps()));
+      const unsigned front = ct->front_ccw ? ccw : nonzero & ~ccw;
+      const unsigned back = nonzero & ~front;
+      unsigned visible = 0;
+
+      if (!(ct->cull_face & PIPE_FACE_FRONT))
+         visible |= front;
+      if (!(ct->cull_face & PIPE_FACE_BACK))
+         visible |= back;
+
+      *keep = (visible | *clip) &
+              ~_mm_movemask_ps(_mm_castsi128_ps(out));
+   }
+   else {
+      *keep = 0xf & ~_mm_movemask_ps(_mm_castsi128_ps(out));
+   }
+}
+
+#else /* !PIPE_ARCH_SSE */
+
+static INLINE void
+classify_tris4(const struct pt_clip_tris *ct, const ushort *e,
+               unsigned *keep, unsigned *clip)
+{
+   const unsigned *m = ct->clipmask;
+   const float *x = ct->x, *y = ct->y;
+   unsigned i;
+
+   *keep = 0;
+   *clip = 0;
+
+   for (i = 0; i < 4; i++, e += 3) {
+      const unsigned any = m[e[0]] | m[e[1]] | m[e[2]];
+      const unsigned all = m[e[0]] & m[e[1]] & m[e[2]];
+
+      if (all)
+         continue;
+
+      if (any) {
+         *clip |= 1 << i;
+      }
+      else if (ct->cull_face != PIPE_FACE_NONE) {
+         const float det = (x[e[0]] - x[e[2]]) * (y[e[1]] - y[e[2]]) -
+                           (y[e[0]] - y[e[2]]) * (x[e[1]] - x[e[2]]);
+         unsigned face;
+
+         if (det == 0)
+            continue;
+
+         face = ((det < 0) == ct->front_ccw) ? PIPE_FACE_FRONT :
+                                                PIPE_FACE_BACK;
+         if (face & ct->cull_face)
+            continue;
+      }
+
+      *keep |= 1 << i;
+   }
+}
+
+#endif /* !PIPE_ARCH_SSE */
+
+
+static boolean
+clip_tris_reserve(struct pt_clip_tris *ct, unsigned num_verts,
+                  unsigned max_tris)
+{
+   if (num_verts > ct->max_verts) {
+      FREE(ct->clipmask);
+      FREE(ct->x);
+      FREE(ct->y);
+      ct->clipmask = MALLOC(num_verts * sizeof(unsigned));
+      ct->x = MALLOC(num_verts * sizeof(float));
+      ct->y = MALLOC(num_verts * sizeof(float));
+      if (!ct->clipmask || !ct->x || !ct->y) {
+         ct->max_verts = 0;
+         return FALSE;
+      }
+      ct->max_verts = num_verts;
+   }
+
+   /* room for the padding to four triangles */
+   max_tris = align(max_tris, 4);
+   if (max_tris > ct->max_tris) {
+      FREE(ct->elts);
+      ct->elts = MALLOC(max_tris * 3 * sizeof(ushort));
+      if (!ct->elts) {
+         ct->max_tris = 0;
+         return FALSE;
+      }
+      ct->max_tris = max_tris;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Run a batch of vertices which needs the pipeline only because some of
+ * them are outside the clip volume.
+ *
+ * \return FALSE if the batch isn't made of triangles, in which case the
+ *         caller has to run the pipeline as usual
+ */
+boolean
+draw_pt_clip_tris_run(struct pt_clip_tris *ct,
+                      struct pt_emit *emit,
+                      const struct draw_vertex_info *vert_info,
+                      const struct draw_prim_info *prim_info)
+{
+   struct draw_context *draw = ct->draw;
+   const int pos = draw_current_shader_position_output(draw);
+   const struct vertex_header *v = vert_info->verts;
+   struct draw_prim_info tri_info;
+   unsigned num_tris, num_kept = 0, need_clip = 0;
+   unsigned start, i, j;
+
+   /* edge flags need the pipeline anyway */
+   if (u_reduced_prim(prim_info->prim) != PIPE_PRIM_TRIANGLES ||
+       draw->vs.edgeflag_output)
+      return FALSE;
+
+   /* no primitive makes more triangles than it has vertices */
+   if (!clip_tris_reserve(ct, vert_info->count, prim_info->count))
+      return FALSE;
+
+   ct->cull_face = draw->rasterizer->cull_face;
+   ct->front_ccw = draw->rasterizer->front_ccw;
+
+   for (i = 0; i < vert_info->count; i++) {
+      ct->clipmask[i] = v->clipmask;
+      ct->x[i] = v->data[pos][0];
+      ct->y[i] = v->data[pos][1];
+      v = (const struct vertex_header *)((const char *)v + vert_info->stride);
+   }
+
+   ct->num_tris = 0;
+   ct->max_index = vert_info->count - 1;
+   for (start = i = 0; i < prim_info->primitive_count;
+        start += prim_info->primitive_lengths[i], i++)
+   {
+      clip_tris_decompose(ct, prim_info, start,
+                          prim_info->primitive_lengths[i]);
+   }
+
+   num_tris = ct->num_tris;
+   assert(num_tris <= ct->max_tris);
+   memset(&ct->elts[num_tris * 3], 0,
+          (align(num_tris, 4) - num_tris) * 3 * sizeof(ushort));
+
+   /* Compact the list in place, the kept triangles never move up. */
+   for (i = 0; i < num_tris; i += 4) {
+      const ushort *e = &ct->elts[i * 3];
+      unsigned keep, clip;
+
+      classify_tris4(ct, e, &keep, &clip);
+      if (num_tris - i < 4)
+         keep &= (1 << (num_tris - i)) - 1;
+      need_clip |= keep & clip;
+
+      while (keep) {
+         j = u_bit_scan(&keep);
+         memmove(&ct->elts[num_kept++ * 3], &e[j * 3], 3 * sizeof(ushort));
+      }
+   }
+
+   if (num_kept == 0)
+      return TRUE;
+
+   tri_info.linear = FALSE;
+   tri_info.start = 0;
+   tri_info.elts = ct->elts;
+   tri_info.count = num_kept * 3;
+   tri_info.prim = PIPE_PRIM_TRIANGLES;
+   tri_info.flags = 0;
+   tri_info.primitive_lengths = &tri_info.count;
+   tri_info.primitive_count = 1;
+
+   if (need_clip)
+      draw_pipeline_run(draw, vert_info, &tri_info);
+   else
+      draw_pt_emit(emit, vert_info, &tri_info);
+
+   return TRUE;
+}
+
+
+struct pt_clip_tris *
+draw_pt_clip_tris_create(struct draw_context *draw)
+{
+   struct pt_clip_tris *ct = CALLOC_STRUCT(pt_clip_tris);
+   if (!ct)
+      return NULL;
+
+   ct->draw = draw;
+
+   return ct;
+}
+
+
+void
+draw_pt_clip_tris_destroy(struct pt_clip_tris *ct)
+{
+   FREE(ct->clipmask);
+   FREE(ct->x);
+   FREE(ct->y);
+   FREE(ct->elts);
+   FREE(ct);
+}
@@ -130,7 +130,7 @@ draw_pt_emit(struct pt_emit *emit,
    struct draw_context *draw = emit->draw;
    struct translate *translate = emit->translate;
    struct vbuf_render *render = draw->render;
-   unsigned start, i;
+   unsigned prim, start, i;
    void *hw_verts;
 
    /* XXX: need to flush to get prim_vbuf.c to release its allocation??
@@ -142,8 +142,13 @@ draw_pt_emit(struct pt_emit *emit,
 
    /* XXX: and work out some way to coordinate the render primitive
     * between vbuf.c and here...
+    *
+    * The elts may also be a list of the triangles the primitive was
+    * decomposed into, when clipping was done ahead of the pipeline.
     */
-   draw->render->set_primitive(draw->render, emit->prim);
+   prim = u_assembled_prim(prim_info->prim);
+   assert(u_reduced_prim(prim) == u_reduced_prim(emit->prim));
+   draw->render->set_primitive(draw->render, prim);
 
    render->allocate_vertices(render,
                              (ushort)translate->key.output_stride,
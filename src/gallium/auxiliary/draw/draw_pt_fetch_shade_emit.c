@@ -33,6 +33,7 @@
 
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_prim.h"
 #include "draw/draw_context.h"
 #include "draw/draw_private.h"
 #include "draw/draw_vbuf.h"
@@ -82,6 +83,8 @@ fse_prepare(struct draw_pt_middle_end *middle,
     */
    assert(!draw->gs.geometry_shader);
 
+   fse->prim = prim;
+
    draw->render->set_primitive(draw->render, prim);
 
    /* Must do this after set_primitive() above:
@@ -185,6 +188,26 @@ fse_bind_parameters(struct draw_pt_middle_end *middle)
 }
 
 
+/**
+ * Update the pipeline statistics for draw_count vertices, shading
+ * shade_count of them.
+ */
+static INLINE void
+fse_count_vertices(struct fetch_shade_emit *fse,
+                   unsigned draw_count,
+                   unsigned shade_count)
+{
+   struct draw_context *draw = fse->draw;
+
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += draw_count;
+      draw->statistics.ia_primitives +=
+         u_decomposed_prims_for_vertices(fse->prim, draw_count);
+      draw->statistics.vs_invocations += shade_count;
+   }
+}
+
+
 static void
 fse_run_linear(struct draw_pt_middle_end *middle,
                unsigned start,
@@ -215,6 +238,7 @@ fse_run_linear(struct draw_pt_middle_end *middle,
    fse->active->run_linear( fse->active,
                             start, count,
                             hw_verts );
+   fse_count_vertices(fse, count, count);
 
    if (0) {
       unsigned i;
@@ -278,6 +302,7 @@ fse_run(struct draw_pt_middle_end *middle,
                           fetch_elts,
                           fetch_count,
                           hw_verts );
+   fse_count_vertices(fse, draw_count, fetch_count);
 
    if (0) {
       unsigned i;
@@ -337,6 +362,7 @@ fse_run_linear_elts(struct draw_pt_middle_end *middle,
    fse->active->run_linear( fse->active,
                             start, count,
                             hw_verts );
+   fse_count_vertices(fse, draw_count, count);
 
    draw->render->draw_elements( draw->render,
                                 draw_elts,
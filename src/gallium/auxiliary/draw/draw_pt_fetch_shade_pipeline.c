@@ -45,6 +45,7 @@ struct fetch_pipeline_middle_end {
    struct pt_so_emit *so_emit;
    struct pt_fetch *fetch;
    struct pt_post_vs *post_vs;
+   struct pt_clip_tris *clip_tris;
 
    unsigned vertex_data_offset;
    unsigned vertex_size;
@@ -259,7 +260,7 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
    if (draw->collect_statistics) {
       draw->statistics.ia_vertices += prim_info->count;
       draw->statistics.ia_primitives +=
-         u_decomposed_prims_for_vertices(prim_info->prim, fetch_info->count);
+         u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
@@ -346,7 +347,13 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
       /* Do we need to run the pipeline?
        */
       if (opt & PT_PIPELINE) {
-         pipeline( fpme, vert_info, prim_info );
+         /* If it's only for clipping, the triangles which don't need it
+          * can skip it.
+          */
+         if ((fpme->opt & PT_PIPELINE) ||
+             !draw_pt_clip_tris_run( fpme->clip_tris, fpme->emit,
+                                     vert_info, prim_info ))
+            pipeline( fpme, vert_info, prim_info );
       }
       else {
          emit( fpme->emit, vert_info, prim_info );
@@ -474,6 +481,9 @@ fetch_pipeline_destroy( struct draw_pt_middle_end *middle )
    if (fpme->post_vs)
       draw_pt_post_vs_destroy( fpme->post_vs );
 
+   if (fpme->clip_tris)
+      draw_pt_clip_tris_destroy( fpme->clip_tris );
+
    FREE(middle);
 }
 
@@ -512,6 +522,10 @@ draw_pt_fetch_pipeline_or_emit(struct draw_context *draw)
    if (!fpme->so_emit)
       goto fail;
 
+   fpme->clip_tris = draw_pt_clip_tris_create( draw );
+   if (!fpme->clip_tris)
+      goto fail;
+
    return &fpme->base;
 
  fail:
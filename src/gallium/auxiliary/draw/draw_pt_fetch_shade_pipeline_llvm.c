@@ -47,6 +47,7 @@ struct llvm_middle_end {
    struct pt_so_emit *so_emit;
    struct pt_fetch *fetch;
    struct pt_post_vs *post_vs;
+   struct pt_clip_tris *clip_tris;
 
 
    unsigned vertex_data_offset;
@@ -462,7 +463,13 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       /* Do we need to run the pipeline? Now will come here if clipped
        */
       if (opt & PT_PIPELINE) {
-         pipeline( fpme, vert_info, prim_info );
+         /* If it's only for clipping, the triangles which don't need it
+          * can skip it.
+          */
+         if ((fpme->opt & PT_PIPELINE) ||
+             !draw_pt_clip_tris_run( fpme->clip_tris, fpme->emit,
+                                     vert_info, prim_info ))
+            pipeline( fpme, vert_info, prim_info );
       }
       else {
          emit( fpme->emit, vert_info, prim_info );
@@ -589,6 +596,9 @@ llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
    if (fpme->post_vs)
       draw_pt_post_vs_destroy( fpme->post_vs );
 
+   if (fpme->clip_tris)
+      draw_pt_clip_tris_destroy( fpme->clip_tris );
+
    FREE(middle);
 }
 
@@ -631,6 +641,10 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
    if (!fpme->so_emit)
       goto fail;
 
+   fpme->clip_tris = draw_pt_clip_tris_create( draw );
+   if (!fpme->clip_tris)
+      goto fail;
+
    fpme->llvm = draw->llvm;
    if (!fpme->llvm)
       goto fail;
@@ -31,7 +31,15 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/*
+ * The cache which maps fetch elements to draw elements is set associative.
+ * Its number of sets is picked for each segment, so that it can hold about
+ * twice as many elements as the segment has.
+ */
+#define CACHE_WAYS     4
+#define MIN_CACHE_SETS 16
+#define MAX_CACHE_SETS (2 * SEGMENT_SIZE / CACHE_WAYS)
 
 /* The largest possible index withing an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -54,9 +62,11 @@ struct vsplit_frontend {
 
    struct {
       /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      unsigned fetches[MAX_CACHE_SETS][CACHE_WAYS];
+      ushort draws[MAX_CACHE_SETS][CACHE_WAYS];
+      /* number of fetch elements which were put in each set */
+      ushort fills[MAX_CACHE_SETS];
+      unsigned set_mask;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -64,11 +74,18 @@ struct vsplit_frontend {
 };
 
 
+/**
+ * Empty the cache, and size it for a segment of count elements.
+ */
 static void
-vsplit_clear_cache(struct vsplit_frontend *vsplit)
+vsplit_clear_cache(struct vsplit_frontend *vsplit, unsigned count)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   const unsigned num_sets =
+      CLAMP(util_next_power_of_two(2 * count / CACHE_WAYS),
+            MIN_CACHE_SETS, MAX_CACHE_SETS);
+
+   memset(vsplit->cache.fills, 0, num_sets * sizeof(vsplit->cache.fills[0]));
+   vsplit->cache.set_mask = num_sets - 1;
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -87,23 +104,35 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static INLINE void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch, unsigned ofbias)
 {
-   unsigned hash;
-
-   hash = fetch % MAP_SIZE;
+   const unsigned set = fetch & vsplit->cache.set_mask;
+   const unsigned fill = vsplit->cache.fills[set];
+   unsigned way;
+
+   /* Look the value up, unless it's an overflow due to the element bias */
+   if (!ofbias) {
+      const unsigned num_ways = MIN2(fill, CACHE_WAYS);
+
+      for (way = 0; way < num_ways; way++) {
+         if (vsplit->cache.fetches[set][way] == fetch) {
+            vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+               vsplit->cache.draws[set][way];
+            return;
+         }
+      }
+   }
 
-   /* If the value isn't in the cache of it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch || ofbias) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   /* update cache, replacing the oldest value of the set */
+   way = fill % CACHE_WAYS;
+   vsplit->cache.fills[set] = fill + 1;
+   vsplit->cache.fetches[set][way] = fetch;
+   vsplit->cache.draws[set][way] = vsplit->cache.num_fetch_elts;
 
-      /* add fetch */
-      assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
-      vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
-   }
+   /* add fetch */
+   assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
+   vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+      vsplit->cache.draws[set][way];
 }
 
 /**
@@ -198,16 +227,7 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
                       unsigned start, unsigned fetch, int elt_bias)
 {
    struct draw_context *draw = vsplit->draw;
-   unsigned raw_elem_idx = start + fetch + elt_bias;
    VSPLIT_CREATE_IDX(elts, start, fetch, elt_bias);
-
-   /* special care for DRAW_MAX_FETCH_IDX */
-   if (raw_elem_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = fetch % MAP_SIZE;
-      vsplit->cache.fetches[hash] = raw_elem_idx - 1; /* force update */
-      vsplit->cache.has_max_fetch = TRUE;
-   }
-
    vsplit_add_cache(vsplit, elt_idx, ofbias);
 }
 
@@ -143,7 +143,7 @@ CONCAT(vsplit_segment_cache_, ELT_TYPE)(struct vsplit_frontend *vsplit,
 
    assert(icount + !!close <= vsplit->segment_size);
 
-   vsplit_clear_cache(vsplit);
+   vsplit_clear_cache(vsplit, icount + !!close);
 
    spoken = !!spoken;
    if (ibias == 0) {
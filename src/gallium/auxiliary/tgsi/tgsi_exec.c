@@ -58,8 +58,10 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_util.h"
 #include "tgsi_exec.h"
+#include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/u_sse.h"
 
 
 #define DEBUG_EXECUTION 0
@@ -632,6 +634,10 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 }
 
 
+static void
+decode_instructions(struct tgsi_exec_machine *mach);
+
+
 /**
  * Initialize machine state by expanding tokens to full instructions,
  * allocating temporary storage, setting up constants, etc.
@@ -670,6 +676,9 @@ tgsi_exec_machine_bind_shader(
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
+      FREE(mach->Decoded);
+      mach->Decoded = NULL;
+
       return;
    }
 
@@ -804,9 +813,17 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   FREE(mach->Decoded);
+   mach->Decoded = NULL;
+   if (mach->Predecode)
+      decode_instructions(mach);
 }
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(predecode, "TGSI_EXEC_PREDECODE", TRUE)
+
+
 struct tgsi_exec_machine *
 tgsi_exec_machine_create( void )
 {
@@ -822,6 +839,7 @@ tgsi_exec_machine_create( void )
    mach->Addrs = &mach->Temps[TGSI_EXEC_TEMP_ADDR];
    mach->MaxGeometryShaderOutputs = TGSI_MAX_TOTAL_VERTICES;
    mach->Predicates = &mach->Temps[TGSI_EXEC_TEMP_P0];
+   mach->Predecode = debug_get_option_predecode();
 
    mach->Inputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_ATTRIBS, 16);
    mach->Outputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_ATTRIBS, 16);
@@ -865,6 +883,7 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
       FREE(mach->Instructions);
+      FREE(mach->Decoded);
       FREE(mach->Declarations);
 
       align_free(mach->Inputs);
@@ -4423,6 +4442,584 @@ exec_instruction(
 }
 
 
+/*
+ * Pre-decoded instructions.
+ *
+ * tgsi_exec_machine_bind_shader() translates the instructions once into an
+ * array of tgsi_exec_decoded, each holding the function which executes it,
+ * and tgsi_exec_machine_run() calls those one after the other.  The common
+ * float arithmetic instructions with directly addressed operands get
+ * functions of their own.  Those have the register files, indices and
+ * swizzles decoded up front and work on whole channels at a time, with SSE
+ * where available, instead of going through exec_instruction(),
+ * fetch_source() and store_dest().  Everything else runs through
+ * exec_instruction() as before.
+ */
+
+struct tgsi_exec_decoded_src
+{
+   ubyte file;         /**< TGSI_FILE_TEMPORARY, INPUT, IMMEDIATE or CONSTANT */
+   ubyte swizzle[TGSI_NUM_CHANNELS];
+   ubyte absolute;
+   ubyte negate;
+   uint index;
+   uint dimension;     /**< constant buffer */
+};
+
+struct tgsi_exec_decoded_dst
+{
+   ubyte file;         /**< TGSI_FILE_TEMPORARY or OUTPUT */
+   ubyte write_mask;
+   ubyte saturate;     /**< TGSI_SAT_ZERO_ONE, the only one handled */
+   uint index;
+};
+
+typedef void (* decoded_func)(struct tgsi_exec_machine *mach,
+                              const struct tgsi_exec_decoded *d,
+                              int *pc);
+
+struct tgsi_exec_decoded
+{
+   decoded_func func;
+   const struct tgsi_full_instruction *inst;
+   struct tgsi_exec_decoded_dst dst;
+   struct tgsi_exec_decoded_src src[3];
+};
+
+
+/*
+ * One channel of a quad: __m128 with SSE, a plain tgsi_exec_channel
+ * otherwise.  The operations give the same results as the micro_*()
+ * functions above, bit for bit except for which NaN comes out of an
+ * operation on two of them, which depends on the compiler anyway.
+ */
+#if defined(PIPE_ARCH_SSE)
+
+typedef __m128 quad_chan;
+
+static const union {
+   uint u[4];
+   __m128 v;
+} lane_masks[16] = {
+#define LANE(m, i) (((m) >> (i)) & 1 ? ~0u : 0)
+#define LANES(m) { { LANE(m, 0), LANE(m, 1), LANE(m, 2), LANE(m, 3) } }
+   LANES(0), LANES(1), LANES(2), LANES(3),
+   LANES(4), LANES(5), LANES(6), LANES(7),
+   LANES(8), LANES(9), LANES(10), LANES(11),
+   LANES(12), LANES(13), LANES(14), LANES(15)
+#undef LANES
+#undef LANE
+};
+
+static INLINE quad_chan
+quad_load(const union tgsi_exec_channel *c)
+{
+   return _mm_load_ps(c->f);
+}
+
+static INLINE quad_chan
+quad_splat(float f)
+{
+   return _mm_set1_ps(f);
+}
+
+static INLINE quad_chan
+quad_abs(quad_chan a)
+{
+   return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+static INLINE quad_chan
+quad_neg(quad_chan a)
+{
+   return _mm_xor_ps(_mm_set1_ps(-0.0f), a);
+}
+
+static INLINE quad_chan
+quad_add(quad_chan a, quad_chan b)
+{
+   return _mm_add_ps(a, b);
+}
+
+static INLINE quad_chan
+quad_sub(quad_chan a, quad_chan b)
+{
+   return _mm_sub_ps(a, b);
+}
+
+static INLINE quad_chan
+quad_mul(quad_chan a, quad_chan b)
+{
+   return _mm_mul_ps(a, b);
+}
+
+/** a < b ? a : b */
+static INLINE quad_chan
+quad_min(quad_chan a, quad_chan b)
+{
+   return _mm_min_ps(a, b);
+}
+
+/** a > b ? a : b */
+static INLINE quad_chan
+quad_max(quad_chan a, quad_chan b)
+{
+   return _mm_max_ps(a, b);
+}
+
+static INLINE quad_chan
+quad_slt(quad_chan a, quad_chan b)
+{
+   return _mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.0f));
+}
+
+static INLINE quad_chan
+quad_sge(quad_chan a, quad_chan b)
+{
+   return _mm_and_ps(_mm_cmpge_ps(a, b), _mm_set1_ps(1.0f));
+}
+
+/** a < 0 ? b : c */
+static INLINE quad_chan
+quad_cmp(quad_chan a, quad_chan b, quad_chan c)
+{
+   __m128 m = _mm_cmplt_ps(a, _mm_setzero_ps());
+   return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, c));
+}
+
+/** Clamp to [0,1], leaving NaNs alone like store_dest() */
+static INLINE quad_chan
+quad_sat(quad_chan a)
+{
+   return _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_setzero_ps(), a));
+}
+
+static INLINE void
+quad_store(union tgsi_exec_channel *dst, quad_chan v, uint execmask)
+{
+   if (execmask == 0xf) {
+      _mm_store_ps(dst->f, v);
+   }
+   else {
+      __m128 m = lane_masks[execmask].v;
+      _mm_store_ps(dst->f, _mm_or_ps(_mm_and_ps(m, v),
+                                     _mm_andnot_ps(m, _mm_load_ps(dst->f))));
+   }
+}
+
+#else /* !PIPE_ARCH_SSE */
+
+typedef union tgsi_exec_channel quad_chan;
+
+static INLINE quad_chan
+quad_load(const union tgsi_exec_channel *c)
+{
+   return *c;
+}
+
+static INLINE quad_chan
+quad_splat(float f)
+{
+   quad_chan r;
+   r.f[0] = r.f[1] = r.f[2] = r.f[3] = f;
+   return r;
+}
+
+#define QUAD_UNARY(name, expr)                  \
+static INLINE quad_chan                         \
+name(quad_chan a)                               \
+{                                               \
+   quad_chan r;                                 \
+   uint i;                                      \
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)         \
+      r.f[i] = expr;                            \
+   return r;                                    \
+}
+
+#define QUAD_BINARY(name, expr)                 \
+static INLINE quad_chan                         \
+name(quad_chan a, quad_chan b)                  \
+{                                               \
+   quad_chan r;                                 \
+   uint i;                                      \
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)         \
+      r.f[i] = expr;                            \
+   return r;                                    \
+}
+
+QUAD_UNARY(quad_abs, fabsf(a.f[i]))
+QUAD_UNARY(quad_neg, -a.f[i])
+QUAD_UNARY(quad_sat, a.f[i] < 0.0f ? 0.0f : a.f[i] > 1.0f ? 1.0f : a.f[i])
+QUAD_BINARY(quad_add, a.f[i] + b.f[i])
+QUAD_BINARY(quad_sub, a.f[i] - b.f[i])
+QUAD_BINARY(quad_mul, a.f[i] * b.f[i])
+QUAD_BINARY(quad_min, a.f[i] < b.f[i] ? a.f[i] : b.f[i])
+QUAD_BINARY(quad_max, a.f[i] > b.f[i] ? a.f[i] : b.f[i])
+QUAD_BINARY(quad_slt, a.f[i] < b.f[i] ? 1.0f : 0.0f)
+QUAD_BINARY(quad_sge, a.f[i] >= b.f[i] ? 1.0f : 0.0f)
+
+#undef QUAD_UNARY
+#undef QUAD_BINARY
+
+static INLINE quad_chan
+quad_cmp(quad_chan a, quad_chan b, quad_chan c)
+{
+   quad_chan r;
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      r.u[i] = a.f[i] < 0.0f ? b.u[i] : c.u[i];
+   return r;
+}
+
+static INLINE void
+quad_store(union tgsi_exec_channel *dst, quad_chan v, uint execmask)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      if (execmask & (1 << i))
+         dst->u[i] = v.u[i];
+}
+
+#endif /* !PIPE_ARCH_SSE */
+
+
+/**
+ * Like fetch_source() for a pre-decoded, directly addressed source.
+ */
+static INLINE quad_chan
+fetch_decoded(const struct tgsi_exec_machine *mach,
+              const struct tgsi_exec_decoded_src *src,
+              uint chan)
+{
+   const uint swizzle = src->swizzle[chan];
+   quad_chan r;
+
+   switch (src->file) {
+   case TGSI_FILE_TEMPORARY:
+      r = quad_load(&mach->Temps[src->index].xyzw[swizzle]);
+      break;
+   case TGSI_FILE_INPUT:
+      r = quad_load(&mach->Inputs[src->index].xyzw[swizzle]);
+      break;
+   case TGSI_FILE_IMMEDIATE:
+      r = quad_splat(mach->Imms[src->index][swizzle]);
+      break;
+   default:
+      {
+         /* constants are copied as uints, and out of bounds ones read
+          * zero, see fetch_src_file_channel()
+          */
+         const int pos = src->index * 4 + swizzle;
+         union fi value;
+
+         assert(src->file == TGSI_FILE_CONSTANT);
+         assert(mach->Consts[src->dimension]);
+
+         value.ui = pos < (int) mach->ConstsSize[src->dimension] ?
+            ((const uint *) mach->Consts[src->dimension])[pos] : 0;
+         r = quad_splat(value.f);
+      }
+      break;
+   }
+
+   if (src->absolute)
+      r = quad_abs(r);
+   if (src->negate)
+      r = quad_neg(r);
+
+   return r;
+}
+
+
+/**
+ * Like store_dest() for all the enabled channels of a pre-decoded,
+ * directly addressed destination.
+ */
+static INLINE void
+store_decoded(struct tgsi_exec_machine *mach,
+              const struct tgsi_exec_decoded_dst *dst,
+              const quad_chan *result)
+{
+   const uint execmask = mach->ExecMask;
+   struct tgsi_exec_vector *reg;
+   uint chan;
+
+   if (dst->file == TGSI_FILE_OUTPUT)
+      reg = &mach->Outputs[mach->Temps[TEMP_OUTPUT_I].xyzw[TEMP_OUTPUT_C].u[0]
+                           + dst->index];
+   else
+      reg = &mach->Temps[dst->index];
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (dst->write_mask & (1 << chan)) {
+         quad_store(&reg->xyzw[chan],
+                    dst->saturate ? quad_sat(result[chan]) : result[chan],
+                    execmask);
+      }
+   }
+}
+
+
+static void
+exec_decoded_instruction(struct tgsi_exec_machine *mach,
+                         const struct tgsi_exec_decoded *d,
+                         int *pc)
+{
+   exec_instruction(mach, d->inst, pc);
+}
+
+
+/*
+ * All the channels are computed before any is stored, so that the
+ * destination may also be a source.
+ */
+#define DECODED_VECTOR_OP(name, nr_srcs, expr)                  \
+static void                                                     \
+name(struct tgsi_exec_machine *mach,                            \
+     const struct tgsi_exec_decoded *d,                         \
+     int *pc)                                                   \
+{                                                               \
+   quad_chan result[TGSI_NUM_CHANNELS];                         \
+   uint chan;                                                   \
+                                                                \
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {           \
+      if (d->dst.write_mask & (1 << chan)) {                    \
+         quad_chan a, b, c;                                     \
+         a = fetch_decoded(mach, &d->src[0], chan);             \
+         b = nr_srcs > 1 ? fetch_decoded(mach, &d->src[1], chan) : a; \
+         c = nr_srcs > 2 ? fetch_decoded(mach, &d->src[2], chan) : a; \
+         (void) b;                                              \
+         (void) c;                                              \
+         result[chan] = expr;                                   \
+      }                                                         \
+   }                                                            \
+   store_decoded(mach, &d->dst, result);                        \
+   (*pc)++;                                                     \
+}
+
+DECODED_VECTOR_OP(exec_decoded_mov, 1, a)
+DECODED_VECTOR_OP(exec_decoded_add, 2, quad_add(a, b))
+DECODED_VECTOR_OP(exec_decoded_sub, 2, quad_sub(a, b))
+DECODED_VECTOR_OP(exec_decoded_mul, 2, quad_mul(a, b))
+DECODED_VECTOR_OP(exec_decoded_min, 2, quad_min(a, b))
+DECODED_VECTOR_OP(exec_decoded_max, 2, quad_max(a, b))
+DECODED_VECTOR_OP(exec_decoded_slt, 2, quad_slt(a, b))
+DECODED_VECTOR_OP(exec_decoded_sge, 2, quad_sge(a, b))
+DECODED_VECTOR_OP(exec_decoded_mad, 3, quad_add(quad_mul(a, b), c))
+DECODED_VECTOR_OP(exec_decoded_lrp, 3, quad_add(quad_mul(a, quad_sub(b, c)), c))
+DECODED_VECTOR_OP(exec_decoded_cmp, 3, quad_cmp(a, b, c))
+
+#undef DECODED_VECTOR_OP
+
+
+/**
+ * DP3 and DP4, summed in the same order as exec_dp3() and exec_dp4().
+ */
+static INLINE void
+exec_decoded_dp(struct tgsi_exec_machine *mach,
+                const struct tgsi_exec_decoded *d,
+                uint nr_chans)
+{
+   quad_chan result[TGSI_NUM_CHANNELS];
+   quad_chan sum;
+   uint chan;
+
+   sum = quad_mul(fetch_decoded(mach, &d->src[0], TGSI_CHAN_X),
+                  fetch_decoded(mach, &d->src[1], TGSI_CHAN_X));
+   for (chan = TGSI_CHAN_Y; chan < nr_chans; chan++) {
+      sum = quad_add(quad_mul(fetch_decoded(mach, &d->src[0], chan),
+                              fetch_decoded(mach, &d->src[1], chan)),
+                     sum);
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      result[chan] = sum;
+   store_decoded(mach, &d->dst, result);
+}
+
+static void
+exec_decoded_dp3(struct tgsi_exec_machine *mach,
+                 const struct tgsi_exec_decoded *d,
+                 int *pc)
+{
+   exec_decoded_dp(mach, d, 3);
+   (*pc)++;
+}
+
+static void
+exec_decoded_dp4(struct tgsi_exec_machine *mach,
+                 const struct tgsi_exec_decoded *d,
+                 int *pc)
+{
+   exec_decoded_dp(mach, d, 4);
+   (*pc)++;
+}
+
+
+static boolean
+decode_src(const struct tgsi_full_src_register *reg,
+           struct tgsi_exec_decoded_src *src)
+{
+   uint chan;
+
+   if (reg->Register.Indirect)
+      return FALSE;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+   case TGSI_FILE_INPUT:
+   case TGSI_FILE_IMMEDIATE:
+      if (reg->Register.Dimension)
+         return FALSE;
+      src->dimension = 0;
+      break;
+   case TGSI_FILE_CONSTANT:
+      if (reg->Register.Dimension) {
+         if (reg->Dimension.Indirect)
+            return FALSE;
+         src->dimension = reg->Dimension.Index;
+      }
+      else {
+         src->dimension = 0;
+      }
+      break;
+   default:
+      return FALSE;
+   }
+
+   src->file = reg->Register.File;
+   src->index = reg->Register.Index;
+   src->absolute = reg->Register.Absolute;
+   src->negate = reg->Register.Negate;
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      src->swizzle[chan] = tgsi_util_get_full_src_register_swizzle(reg, chan);
+
+   return TRUE;
+}
+
+
+static boolean
+decode_dst(const struct tgsi_full_instruction *inst,
+           struct tgsi_exec_decoded_dst *dst)
+{
+   const struct tgsi_full_dst_register *reg = &inst->Dst[0];
+
+   if (inst->Instruction.NumDstRegs != 1 ||
+       inst->Instruction.Predicate ||
+       reg->Register.Indirect ||
+       reg->Register.Dimension)
+      return FALSE;
+
+   if (reg->Register.File != TGSI_FILE_TEMPORARY &&
+       reg->Register.File != TGSI_FILE_OUTPUT)
+      return FALSE;
+
+   if (inst->Instruction.Saturate != TGSI_SAT_NONE &&
+       inst->Instruction.Saturate != TGSI_SAT_ZERO_ONE)
+      return FALSE;
+
+   dst->file = reg->Register.File;
+   dst->index = reg->Register.Index;
+   dst->write_mask = reg->Register.WriteMask;
+   dst->saturate = inst->Instruction.Saturate == TGSI_SAT_ZERO_ONE;
+
+   return TRUE;
+}
+
+
+/**
+ * The function executing the instruction if it has one of its own, else
+ * NULL.
+ */
+static decoded_func
+decode_instruction(const struct tgsi_full_instruction *inst,
+                   struct tgsi_exec_decoded *d)
+{
+   decoded_func func;
+   uint i;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_MOV:
+      func = exec_decoded_mov;
+      break;
+   case TGSI_OPCODE_ADD:
+      func = exec_decoded_add;
+      break;
+   case TGSI_OPCODE_SUB:
+      func = exec_decoded_sub;
+      break;
+   case TGSI_OPCODE_MUL:
+      func = exec_decoded_mul;
+      break;
+   case TGSI_OPCODE_MIN:
+      func = exec_decoded_min;
+      break;
+   case TGSI_OPCODE_MAX:
+      func = exec_decoded_max;
+      break;
+   case TGSI_OPCODE_SLT:
+      func = exec_decoded_slt;
+      break;
+   case TGSI_OPCODE_SGE:
+      func = exec_decoded_sge;
+      break;
+   case TGSI_OPCODE_MAD:
+      func = exec_decoded_mad;
+      break;
+   case TGSI_OPCODE_LRP:
+      func = exec_decoded_lrp;
+      break;
+   case TGSI_OPCODE_CMP:
+      func = exec_decoded_cmp;
+      break;
+   case TGSI_OPCODE_DP3:
+      func = exec_decoded_dp3;
+      break;
+   case TGSI_OPCODE_DP4:
+      func = exec_decoded_dp4;
+      break;
+   default:
+      return NULL;
+   }
+
+   if (!decode_dst(inst, &d->dst))
+      return NULL;
+
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      if (!decode_src(&inst->Src[i], &d->src[i]))
+         return NULL;
+   }
+
+   /* MOV fetches its source as integers, so modifiers are integer ones */
+   if (func == exec_decoded_mov &&
+       (d->src[0].absolute || d->src[0].negate))
+      return NULL;
+
+   return func;
+}
+
+
+static void
+decode_instructions(struct tgsi_exec_machine *mach)
+{
+   uint i;
+
+   mach->Decoded = (struct tgsi_exec_decoded *)
+      MALLOC(mach->NumInstructions * sizeof(struct tgsi_exec_decoded));
+   if (!mach->Decoded)
+      return;
+
+   for (i = 0; i < mach->NumInstructions; i++) {
+      struct tgsi_exec_decoded *d = &mach->Decoded[i];
+
+      d->inst = &mach->Instructions[i];
+      d->func = decode_instruction(d->inst, d);
+      if (!d->func)
+         d->func = exec_decoded_instruction;
+   }
+}
+
+
 /**
  * Run TGSI interpreter.
  * \return bitmask of "alive" quad components
@@ -4430,6 +5027,7 @@ exec_instruction(
 uint
 tgsi_exec_machine_run( struct tgsi_exec_machine *mach )
 {
+   const struct tgsi_exec_decoded *decoded = mach->Decoded;
    uint i;
    int pc = 0;
    uint default_mask = 0xf;
@@ -4487,7 +5085,10 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach )
 #endif
 
          assert(pc < (int) mach->NumInstructions);
-         exec_instruction(mach, mach->Instructions + pc, &pc);
+         if (decoded)
+            decoded[pc].func(mach, &decoded[pc], &pc);
+         else
+            exec_instruction(mach, mach->Instructions + pc, &pc);
 
 #if DEBUG_EXECUTION
          for (i = 0; i < TGSI_EXEC_NUM_TEMPS + TGSI_EXEC_NUM_TEMP_EXTRAS; i++) {
@@ -259,6 +259,10 @@ enum tgsi_break_type {
 #define TGSI_EXEC_MAX_BREAK_STACK (TGSI_EXEC_MAX_LOOP_NESTING + TGSI_EXEC_MAX_SWITCH_NESTING)
 
 
+/** A pre-decoded instruction, see tgsi_exec.c */
+struct tgsi_exec_decoded;
+
+
 /**
  * Run-time virtual machine state for executing TGSI shader.
  */
@@ -348,6 +352,7 @@ struct tgsi_exec_machine
    int CallStackTop;
 
    struct tgsi_full_instruction *Instructions;
+   struct tgsi_exec_decoded *Decoded;  /**< Instructions, pre-decoded */
    uint NumInstructions;
 
    struct tgsi_full_declaration *Declarations;
@@ -357,6 +362,14 @@ struct tgsi_exec_machine
       SamplerViews[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
    boolean UsedGeometryShader;
+
+   /**
+    * Whether tgsi_exec_machine_bind_shader() pre-decodes the instructions
+    * for faster execution.  TRUE unless the TGSI_EXEC_PREDECODE environment
+    * variable is false; only useful to turn off for debugging and for
+    * comparing against the plain interpreter.
+    */
+   boolean Predecode;
 };
 
 struct tgsi_exec_machine *
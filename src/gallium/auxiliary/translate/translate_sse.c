@@ -455,6 +455,19 @@ emit_memcpy(struct translate_sse *p, struct x86_reg dst, struct x86_reg src,
    }
 }
 
+/**
+ * Whether two channels are stored the same way, wherever they are.
+ */
+static INLINE boolean
+channels_match(const struct util_format_channel_description *a,
+               const struct util_format_channel_description *b)
+{
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
 static boolean
 translate_attr_convert(struct translate_sse *p,
                        const struct translate_element *a,
@@ -483,18 +496,13 @@ translate_attr_convert(struct translate_sse *p,
       return FALSE;
 
    for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+      if (!channels_match(&input_desc->channel[i], &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!channels_match(&output_desc->channel[i], &output_desc->channel[0]))
          return FALSE;
-      }
    }
 
    for (i = 0; i < output_desc->nr_channels; ++i) {
@@ -883,8 +891,7 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
-   else if (!memcmp(&output_desc->channel[0], &input_desc->channel[0],
-                    sizeof(output_desc->channel[0]))) {
+   else if (channels_match(&output_desc->channel[0], &input_desc->channel[0])) {
       struct x86_reg tmp = p->tmp_EAX;
       unsigned i;
 
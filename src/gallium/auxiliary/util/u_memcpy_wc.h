@@ -0,0 +1,88 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Copying from uncached and write-combined mappings, e.g. of resources the
+ * GPU just rendered to.
+ *
+ * Plain loads from write-combined memory are uncached and so read one word
+ * at a time.  The SSE 4.1 MOVNTDQA and AVX2 VMOVNTDQA streaming loads read
+ * whole cachelines into a streaming buffer instead, which is many times
+ * faster.  The streaming load versions are built with their own compiler
+ * flags (USE_SSE41, USE_AVX2) and picked at runtime with util_cpu_caps.
+ */
+
+#ifndef U_MEMCPY_WC_H
+#define U_MEMCPY_WC_H
+
+#include <string.h>
+
+#include "pipe/p_compiler.h"
+#include "util/u_cpu_detect.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void
+util_streaming_load_memcpy_sse41(void *dst, const void *src, size_t len);
+
+void
+util_streaming_load_memcpy_avx2(void *dst, const void *src, size_t len);
+
+
+/**
+ * Copy len bytes from a mapping that may be uncached or write-combined to
+ * cached memory.  Falls back to memcpy() when the CPU has no streaming
+ * loads, so it is also fine to use on cached memory.  util_cpu_detect()
+ * must have been called for the streaming loads to be used.
+ */
+static INLINE void
+util_memcpy_from_wc(void *dst, const void *src, size_t len)
+{
+#ifdef USE_AVX2
+   if (util_cpu_caps.has_avx2 && len >= 128) {
+      util_streaming_load_memcpy_avx2(dst, src, len);
+      return;
+   }
+#endif
+#ifdef USE_SSE41
+   if (util_cpu_caps.has_sse4_1 && len >= 64) {
+      util_streaming_load_memcpy_sse41(dst, src, len);
+      return;
+   }
+#endif
+   memcpy(dst, src, len);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_MEMCPY_WC_H */
@@ -0,0 +1,109 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * AVX2 VMOVNTDQA streaming load copy, see u_memcpy_wc.h.  Built with -mavx2.
+ */
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+#include "util/u_math.h"
+#include "util/u_memcpy_wc.h"
+
+
+void
+util_streaming_load_memcpy_avx2(void *dst, const void *src, size_t len)
+{
+   ubyte *d = (ubyte *) dst;
+   ubyte *s = (ubyte *) src;
+   const unsigned block = 4 * sizeof(__m256i);
+
+   /* The loads must be aligned, so copy up to the next 32-byte boundary of
+    * the source first.
+    */
+   if ((uintptr_t) s & 31) {
+      size_t head = MIN2(32 - ((uintptr_t) s & 31), len);
+
+      memcpy(d, s, head);
+      d += head;
+      s += head;
+      len -= head;
+   }
+
+   if (((uintptr_t) d & 31) == 0) {
+      while (len >= block) {
+         __m256i *dv = (__m256i *) d;
+         __m256i *sv = (__m256i *) s;
+         __m256i t0 = _mm256_stream_load_si256(sv + 0);
+         __m256i t1 = _mm256_stream_load_si256(sv + 1);
+         __m256i t2 = _mm256_stream_load_si256(sv + 2);
+         __m256i t3 = _mm256_stream_load_si256(sv + 3);
+
+         _mm256_store_si256(dv + 0, t0);
+         _mm256_store_si256(dv + 1, t1);
+         _mm256_store_si256(dv + 2, t2);
+         _mm256_store_si256(dv + 3, t3);
+
+         d += block;
+         s += block;
+         len -= block;
+      }
+   }
+   else {
+      while (len >= block) {
+         __m256i *dv = (__m256i *) d;
+         __m256i *sv = (__m256i *) s;
+         __m256i t0 = _mm256_stream_load_si256(sv + 0);
+         __m256i t1 = _mm256_stream_load_si256(sv + 1);
+         __m256i t2 = _mm256_stream_load_si256(sv + 2);
+         __m256i t3 = _mm256_stream_load_si256(sv + 3);
+
+         _mm256_storeu_si256(dv + 0, t0);
+         _mm256_storeu_si256(dv + 1, t1);
+         _mm256_storeu_si256(dv + 2, t2);
+         _mm256_storeu_si256(dv + 3, t3);
+
+         d += block;
+         s += block;
+         len -= block;
+      }
+   }
+
+   while (len >= sizeof(__m256i)) {
+      _mm256_storeu_si256((__m256i *) d, _mm256_stream_load_si256((__m256i *) s));
+      d += sizeof(__m256i);
+      s += sizeof(__m256i);
+      len -= sizeof(__m256i);
+   }
+
+   if (len)
+      memcpy(d, s, len);
+}
+
+#endif /* __AVX2__ */
@@ -0,0 +1,109 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * SSE 4.1 MOVNTDQA streaming load copy, see u_memcpy_wc.h.  Built with -msse4.1.
+ */
+
+#ifdef __SSE4_1__
+
+#include <smmintrin.h>
+
+#include "util/u_math.h"
+#include "util/u_memcpy_wc.h"
+
+
+void
+util_streaming_load_memcpy_sse41(void *dst, const void *src, size_t len)
+{
+   ubyte *d = (ubyte *) dst;
+   ubyte *s = (ubyte *) src;
+   const unsigned block = 4 * sizeof(__m128i);
+
+   /* The loads must be aligned, so copy up to the next 16-byte boundary of
+    * the source first.
+    */
+   if ((uintptr_t) s & 15) {
+      size_t head = MIN2(16 - ((uintptr_t) s & 15), len);
+
+      memcpy(d, s, head);
+      d += head;
+      s += head;
+      len -= head;
+   }
+
+   if (((uintptr_t) d & 15) == 0) {
+      while (len >= block) {
+         __m128i *dv = (__m128i *) d;
+         __m128i *sv = (__m128i *) s;
+         __m128i t0 = _mm_stream_load_si128(sv + 0);
+         __m128i t1 = _mm_stream_load_si128(sv + 1);
+         __m128i t2 = _mm_stream_load_si128(sv + 2);
+         __m128i t3 = _mm_stream_load_si128(sv + 3);
+
+         _mm_store_si128(dv + 0, t0);
+         _mm_store_si128(dv + 1, t1);
+         _mm_store_si128(dv + 2, t2);
+         _mm_store_si128(dv + 3, t3);
+
+         d += block;
+         s += block;
+         len -= block;
+      }
+   }
+   else {
+      while (len >= block) {
+         __m128i *dv = (__m128i *) d;
+         __m128i *sv = (__m128i *) s;
+         __m128i t0 = _mm_stream_load_si128(sv + 0);
+         __m128i t1 = _mm_stream_load_si128(sv + 1);
+         __m128i t2 = _mm_stream_load_si128(sv + 2);
+         __m128i t3 = _mm_stream_load_si128(sv + 3);
+
+         _mm_storeu_si128(dv + 0, t0);
+         _mm_storeu_si128(dv + 1, t1);
+         _mm_storeu_si128(dv + 2, t2);
+         _mm_storeu_si128(dv + 3, t3);
+
+         d += block;
+         s += block;
+         len -= block;
+      }
+   }
+
+   while (len >= sizeof(__m128i)) {
+      _mm_storeu_si128((__m128i *) d, _mm_stream_load_si128((__m128i *) s));
+      d += sizeof(__m128i);
+      s += sizeof(__m128i);
+      len -= sizeof(__m128i);
+   }
+
+   if (len)
+      memcpy(d, s, len);
+}
+
+#endif /* __SSE4_1__ */
@@ -38,6 +38,7 @@
 
 #include "util/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_memcpy_wc.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
@@ -61,6 +62,7 @@ u_surface_default_template(struct pipe_surface *surf,
  * Copy 2D rect from one place to another.
  * Position and sizes are in pixels.
  * src_stride may be negative to do vertical flip of pixels from source.
+ * src may be an uncached or write-combined transfer mapping.
  */
 void
 util_copy_rect(ubyte * dst,
@@ -99,10 +101,10 @@ util_copy_rect(ubyte * dst,
    width *= blocksize;
 
    if (width == dst_stride && width == src_stride)
-      memcpy(dst, src, height * width);
+      util_memcpy_from_wc(dst, src, height * width);
    else {
       for (i = 0; i < height; i++) {
-         memcpy(dst, src, width);
+         util_memcpy_from_wc(dst, src, width);
          dst += dst_stride;
          src += src_stride;
       }
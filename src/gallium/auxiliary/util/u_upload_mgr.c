@@ -32,12 +32,22 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
 #include "u_upload_mgr.h"
 
 
+/** Number of segments the buffer is split into in ring mode */
+#define U_UPLOAD_RING_SEGMENTS 4
+
+struct u_upload_segment {
+   struct pipe_fence_handle *fence; /* Signalled once the GPU is done. */
+   unsigned last_use;  /* Value of unmap_count when last allocated from. */
+   boolean pending;    /* Left for the next segment, but not fenced yet. */
+};
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -52,6 +62,13 @@ struct u_upload_mgr {
    uint8_t *map;    /* Pointer to the mapped upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Ring mode, see u_upload_create_ring(). */
+   boolean ring;
+   unsigned segment_size;
+   unsigned segment;       /* Segment being allocated from, ~0 if none. */
+   unsigned unmap_count;   /* Number of u_upload_unmap() calls. */
+   struct u_upload_segment segments[U_UPLOAD_RING_SEGMENTS];
 };
 
 
@@ -88,6 +105,114 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
 }
 
 
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned size,
+                                           unsigned alignment,
+                                           unsigned bind )
+{
+   struct u_upload_mgr *upload = u_upload_create(pipe, size, alignment, bind);
+
+   if (upload)
+      upload->ring = upload->map_persistent;
+
+   return upload;
+}
+
+
+static void upload_ring_reset(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i;
+
+   for (i = 0; i < U_UPLOAD_RING_SEGMENTS; i++) {
+      screen->fence_reference(screen, &upload->segments[i].fence, NULL);
+      upload->segments[i].pending = FALSE;
+   }
+   upload->segment = 0;
+}
+
+
+/* Fence the segments which were left behind, once all the draws using
+ * them have been issued.  Callers unmap before the draws which use their
+ * allocations, so by the second u_upload_unmap() after the last
+ * allocation from a segment, those draws have been issued.
+ */
+static void upload_ring_fence_segments(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct pipe_fence_handle *fence = NULL;
+   unsigned i;
+
+   for (i = 0; i < U_UPLOAD_RING_SEGMENTS; i++) {
+      struct u_upload_segment *seg = &upload->segments[i];
+
+      if (seg->pending && upload->unmap_count - seg->last_use >= 2) {
+         if (!fence) {
+            upload->pipe->flush(upload->pipe, &fence, 0);
+            if (!fence)
+               return;
+         }
+         screen->fence_reference(screen, &seg->fence, fence);
+         seg->pending = FALSE;
+      }
+   }
+
+   screen->fence_reference(screen, &fence, NULL);
+}
+
+
+static boolean upload_ring_segment_idle(struct u_upload_mgr *upload,
+                                        unsigned index)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct u_upload_segment *seg = &upload->segments[index];
+
+   if (seg->pending)
+      return FALSE;
+
+   if (seg->fence) {
+      if (!screen->fence_signalled(screen, seg->fence))
+         return FALSE;
+      screen->fence_reference(screen, &seg->fence, NULL);
+   }
+
+   return TRUE;
+}
+
+
+/* Claim the segments covering [offset, end) of the ring, unless the GPU
+ * may still be reading any of them.
+ */
+static boolean upload_ring_reserve(struct u_upload_mgr *upload,
+                                   unsigned offset, unsigned end,
+                                   boolean wrap)
+{
+   unsigned first = offset / upload->segment_size;
+   unsigned last = (end - 1) / upload->segment_size;
+   unsigned i;
+
+   if (wrap && upload->segment != ~0u) {
+      upload->segments[upload->segment].pending = TRUE;
+      upload->segment = ~0u;
+   }
+
+   for (i = first; i <= last; i++) {
+      if (i != upload->segment && !upload_ring_segment_idle(upload, i))
+         return FALSE;
+   }
+
+   if (upload->segment != ~0u && upload->segment != last)
+      upload->segments[upload->segment].pending = TRUE;
+
+   for (i = first; i <= last; i++) {
+      upload->segments[i].last_use = upload->unmap_count;
+      upload->segments[i].pending = i != last;
+   }
+   upload->segment = last;
+   return TRUE;
+}
+
+
 static void upload_unmap_internal(struct u_upload_mgr *upload, boolean destroying)
 {
    if (!destroying && upload->map_persistent)
@@ -110,6 +235,11 @@ static void upload_unmap_internal(struct u_upload_mgr *upload, boolean destroyin
 
 void u_upload_unmap( struct u_upload_mgr *upload )
 {
+   if (upload->ring) {
+      upload->unmap_count++;
+      upload_ring_fence_segments(upload);
+   }
+
    upload_unmap_internal(upload, FALSE);
 }
 
@@ -119,6 +249,9 @@ static void u_upload_release_buffer(struct u_upload_mgr *upload)
    /* Unmap and unreference the upload buffer. */
    upload_unmap_internal(upload, TRUE);
    pipe_resource_reference( &upload->buffer, NULL );
+
+   if (upload->ring)
+      upload_ring_reset(upload);
 }
 
 
@@ -176,6 +309,7 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
    }
 
    upload->offset = 0;
+   upload->segment_size = size / U_UPLOAD_RING_SEGMENTS; /* size is 4K aligned */
    return PIPE_OK;
 }
 
@@ -198,13 +332,39 @@ enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
    *ptr = NULL;
 
    /* Make sure we have enough space in the upload buffer
-    * for the sub-allocation. */
+    * for the sub-allocation.  In ring mode, wrap around to the start if
+    * the GPU is done with it, and just move on otherwise. */
    if (!upload->buffer ||
        MAX2(upload->offset, alloc_offset) + alloc_size > upload->buffer->width0) {
+      if (upload->ring && upload->buffer &&
+          alloc_offset + alloc_size <= upload->buffer->width0 &&
+          upload_ring_reserve(upload, alloc_offset,
+                              alloc_offset + alloc_size, TRUE)) {
+         upload->offset = 0;
+      }
+      else {
+         enum pipe_error ret = u_upload_alloc_buffer(upload,
+                                                     alloc_offset + alloc_size);
+         if (ret != PIPE_OK)
+            return ret;
+
+         if (upload->ring)
+            upload_ring_reserve(upload, alloc_offset,
+                                alloc_offset + alloc_size, FALSE);
+      }
+   }
+   else if (upload->ring &&
+            !upload_ring_reserve(upload,
+                                 MAX2(upload->offset, alloc_offset),
+                                 MAX2(upload->offset, alloc_offset) +
+                                 alloc_size, FALSE)) {
       enum pipe_error ret = u_upload_alloc_buffer(upload,
                                                   alloc_offset + alloc_size);
       if (ret != PIPE_OK)
          return ret;
+
+      upload_ring_reserve(upload, alloc_offset,
+                          alloc_offset + alloc_size, FALSE);
    }
 
    offset = MAX2(upload->offset, alloc_offset);
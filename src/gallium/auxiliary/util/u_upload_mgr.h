@@ -51,6 +51,23 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
                                       unsigned alignment,
                                       unsigned bind );
 
+/**
+ * Create an upload manager which streams into a persistently mapped ring
+ * buffer, if the driver supports that.
+ *
+ * The buffer is mapped once and reused: space is reclaimed with fences
+ * instead of allocating a new buffer whenever the current one is full.
+ * This requires that u_upload_unmap() is called before the draws which use
+ * the allocations are issued, and that those are the only draws using them,
+ * i.e. the allocations don't stay bound for later draws.
+ *
+ * \param size  Size of the ring buffer, in bytes.
+ */
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned size,
+                                           unsigned alignment,
+                                           unsigned bind );
+
 /**
  * Destroy the upload manager.
  */
@@ -247,8 +247,8 @@ u_vbuf_create(struct pipe_context *pipe,
    mgr->translate_cache = translate_cache_create();
    memset(mgr->fallback_vbs, ~0, sizeof(mgr->fallback_vbs));
 
-   mgr->uploader = u_upload_create(pipe, 1024 * 1024, 4,
-                                   PIPE_BIND_VERTEX_BUFFER);
+   mgr->uploader = u_upload_create_ring(pipe, 1024 * 1024, 4,
+                                        PIPE_BIND_VERTEX_BUFFER);
 
    return mgr;
 }
@@ -0,0 +1,345 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Vertex cache optimization of triangle lists.
+ *
+ * The triangles are emitted greedily.  Each vertex gets a score from its
+ * position in a modelled LRU cache and from the number of triangles still
+ * using it, and the next triangle is the one with the highest sum of
+ * vertex scores among those using a cached vertex.
+ */
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_vertex_cache.h"
+
+
+/** Size of the LRU cache modelled while ordering the triangles */
+#define CACHE_SIZE 32
+
+/* Scoring parameters from Forsyth's paper */
+#define CACHE_DECAY_POWER   1.5f
+#define LAST_TRI_SCORE      0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+
+/** Valence boosts below this are looked up in a table */
+#define VALENCE_TABLE_SIZE 32
+
+/** Largest cache util_vertex_cache_acmr() simulates */
+#define MAX_ACMR_CACHE_SIZE 256
+
+
+struct vcache_scores {
+   float cache[CACHE_SIZE];
+   float valence[VALENCE_TABLE_SIZE];
+};
+
+
+static INLINE unsigned
+get_index(const void *indices, unsigned index_size, unsigned i)
+{
+   switch (index_size) {
+   case 1:
+      return ((const ubyte *) indices)[i];
+   case 2:
+      return ((const ushort *) indices)[i];
+   default:
+      assert(index_size == 4);
+      return ((const uint *) indices)[i];
+   }
+}
+
+
+static INLINE void
+set_index(void *indices, unsigned index_size, unsigned i, unsigned value)
+{
+   switch (index_size) {
+   case 1:
+      ((ubyte *) indices)[i] = (ubyte) value;
+      break;
+   case 2:
+      ((ushort *) indices)[i] = (ushort) value;
+      break;
+   default:
+      ((uint *) indices)[i] = value;
+      break;
+   }
+}
+
+
+static void
+init_scores(struct vcache_scores *scores)
+{
+   unsigned i;
+
+   for (i = 0; i < CACHE_SIZE; i++) {
+      if (i < 3) {
+         /* the vertices of the last triangle get a fixed score, so that
+          * the next triangle isn't always a neighbour of it
+          */
+         scores->cache[i] = LAST_TRI_SCORE;
+      }
+      else {
+         scores->cache[i] =
+            powf(1.0f - (float) (i - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+      }
+   }
+
+   scores->valence[0] = 0.0f;
+   for (i = 1; i < VALENCE_TABLE_SIZE; i++)
+      scores->valence[i] = VALENCE_BOOST_SCALE *
+                           powf((float) i, -VALENCE_BOOST_POWER);
+}
+
+
+static INLINE float
+vertex_score(const struct vcache_scores *scores,
+             int cache_pos, unsigned num_active_tris)
+{
+   float score;
+
+   /* no triangle left to use it */
+   if (!num_active_tris)
+      return -1.0f;
+
+   score = cache_pos < 0 ? 0.0f : scores->cache[cache_pos];
+
+   /* boost vertices with few triangles left, to get rid of them */
+   if (num_active_tris < VALENCE_TABLE_SIZE)
+      score += scores->valence[num_active_tris];
+   else
+      score += VALENCE_BOOST_SCALE *
+               powf((float) num_active_tris, -VALENCE_BOOST_POWER);
+
+   return score;
+}
+
+
+boolean
+util_optimize_vertex_cache(void *indices, unsigned index_size,
+                           unsigned num_indices)
+{
+   const unsigned num_tris = num_indices / 3;
+   struct vcache_scores scores;
+   unsigned *tri_verts = NULL, *out = NULL;
+   unsigned *vert_first = NULL, *vert_active = NULL, *vert_tris = NULL;
+   float *vert_score = NULL, *tri_score = NULL;
+   boolean *tri_added = NULL;
+   boolean ret = FALSE;
+   unsigned cache[CACHE_SIZE + 3];
+   unsigned cache_len = 0;
+   unsigned max_index = 0, num_verts, sum, cursor = 0;
+   int best = -1;
+   unsigned i, j, k, n;
+
+   if (num_tris < 2)
+      return TRUE;
+
+   tri_verts = MALLOC(num_tris * 3 * sizeof(unsigned));
+   if (!tri_verts)
+      return FALSE;
+
+   for (i = 0; i < num_tris * 3; i++) {
+      tri_verts[i] = get_index(indices, index_size, i);
+      max_index = MAX2(max_index, tri_verts[i]);
+   }
+
+   /* Can't count the vertices, likely a primitive restart index */
+   if (max_index == ~0u) {
+      ret = TRUE;
+      goto out;
+   }
+   num_verts = max_index + 1;
+
+   out = MALLOC(num_tris * 3 * sizeof(unsigned));
+   vert_first = MALLOC(num_verts * sizeof(unsigned));
+   vert_active = CALLOC(num_verts, sizeof(unsigned));
+   vert_tris = MALLOC(num_tris * 3 * sizeof(unsigned));
+   vert_score = MALLOC(num_verts * sizeof(float));
+   tri_score = MALLOC(num_tris * sizeof(float));
+   tri_added = CALLOC(num_tris, sizeof(boolean));
+   if (!out || !vert_first || !vert_active || !vert_tris ||
+       !vert_score || !tri_score || !tri_added)
+      goto out;
+
+   init_scores(&scores);
+
+   /* list the triangles using each vertex */
+   for (i = 0; i < num_tris * 3; i++)
+      vert_active[tri_verts[i]]++;
+
+   sum = 0;
+   for (i = 0; i < num_verts; i++) {
+      vert_first[i] = sum;
+      sum += vert_active[i];
+      vert_active[i] = 0;
+   }
+
+   for (i = 0; i < num_tris * 3; i++) {
+      const unsigned v = tri_verts[i];
+      vert_tris[vert_first[v] + vert_active[v]++] = i / 3;
+   }
+
+   for (i = 0; i < num_verts; i++)
+      vert_score[i] = vertex_score(&scores, -1, vert_active[i]);
+
+   for (i = 0; i < num_tris; i++) {
+      tri_score[i] = vert_score[tri_verts[i * 3 + 0]] +
+                     vert_score[tri_verts[i * 3 + 1]] +
+                     vert_score[tri_verts[i * 3 + 2]];
+      if (best < 0 || tri_score[i] > tri_score[best])
+         best = i;
+   }
+
+   for (n = 0; n < num_tris; n++) {
+      const unsigned *tri;
+      unsigned new_cache[CACHE_SIZE + 3];
+      unsigned new_len = 0;
+      float best_score = -1.0f;
+
+      if (best < 0) {
+         /* none of the cached vertices is used by a triangle left */
+         while (tri_added[cursor])
+            cursor++;
+         best = cursor;
+      }
+
+      tri = &tri_verts[best * 3];
+      tri_added[best] = TRUE;
+      out[n * 3 + 0] = tri[0];
+      out[n * 3 + 1] = tri[1];
+      out[n * 3 + 2] = tri[2];
+
+      for (k = 0; k < 3; k++) {
+         unsigned *list = &vert_tris[vert_first[tri[k]]];
+
+         /* remove the triangle from the vertex' list */
+         for (j = 0; j < vert_active[tri[k]]; j++) {
+            if (list[j] == (unsigned) best) {
+               list[j] = list[--vert_active[tri[k]]];
+               break;
+            }
+         }
+
+         /* and move the vertex to the front of the cache */
+         if ((k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+            new_cache[new_len++] = tri[k];
+      }
+
+      for (i = 0; i < cache_len; i++) {
+         if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+            new_cache[new_len++] = cache[i];
+      }
+
+      /* rescore the vertices which moved, including the ones which fell out
+       * of the cache, and their triangles
+       */
+      for (i = 0; i < new_len; i++) {
+         const unsigned v = new_cache[i];
+         const int pos = i < CACHE_SIZE ? (int) i : -1;
+         const unsigned *list = &vert_tris[vert_first[v]];
+         const float score = vertex_score(&scores, pos, vert_active[v]);
+         const float delta = score - vert_score[v];
+
+         vert_score[v] = score;
+         for (j = 0; j < vert_active[v]; j++)
+            tri_score[list[j]] += delta;
+      }
+
+      /* the next triangle is the best one using a cached vertex */
+      best = -1;
+      cache_len = MIN2(new_len, CACHE_SIZE);
+      for (i = 0; i < cache_len; i++) {
+         const unsigned v = new_cache[i];
+         const unsigned *list = &vert_tris[vert_first[v]];
+
+         cache[i] = v;
+         for (j = 0; j < vert_active[v]; j++) {
+            if (tri_score[list[j]] > best_score) {
+               best_score = tri_score[list[j]];
+               best = list[j];
+            }
+         }
+      }
+   }
+
+   for (i = 0; i < num_tris * 3; i++)
+      set_index(indices, index_size, i, out[i]);
+
+   ret = TRUE;
+
+out:
+   FREE(tri_verts);
+   FREE(out);
+   FREE(vert_first);
+   FREE(vert_active);
+   FREE(vert_tris);
+   FREE(vert_score);
+   FREE(tri_score);
+   FREE(tri_added);
+   return ret;
+}
+
+
+float
+util_vertex_cache_acmr(const void *indices, unsigned index_size,
+                       unsigned num_indices, unsigned cache_size)
+{
+   const unsigned num_tris = num_indices / 3;
+   unsigned fifo[MAX_ACMR_CACHE_SIZE];
+   unsigned fifo_len = 0, fifo_next = 0;
+   unsigned misses = 0;
+   unsigned i, j;
+
+   if (!num_tris)
+      return 0.0f;
+
+   cache_size = MIN2(cache_size, MAX_ACMR_CACHE_SIZE);
+
+   for (i = 0; i < num_tris * 3; i++) {
+      const unsigned index = get_index(indices, index_size, i);
+
+      for (j = 0; j < fifo_len; j++) {
+         if (fifo[j] == index)
+            break;
+      }
+
+      if (j == fifo_len) {
+         misses++;
+         if (cache_size) {
+            /* replace the oldest vertex */
+            fifo[fifo_next] = index;
+            fifo_next = (fifo_next + 1) % cache_size;
+            fifo_len = MAX2(fifo_len, fifo_next == 0 ? cache_size : fifo_next);
+         }
+      }
+   }
+
+   return (float) misses / num_tris;
+}
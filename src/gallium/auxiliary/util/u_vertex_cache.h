@@ -0,0 +1,76 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Offline helpers for static meshes: reordering triangle lists so that
+ * post-transform vertex caches reuse more vertices, and measuring how
+ * well they do.
+ */
+
+#ifndef U_VERTEX_CACHE_H
+#define U_VERTEX_CACHE_H
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Reorder the triangles of a triangle list in place for vertex reuse,
+ * using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+ * The triangles keep their winding.  Trailing indices which don't make up
+ * a whole triangle are left alone, and so are index buffers using index
+ * 0xffffffff.
+ *
+ * \param indices       the index buffer contents
+ * \param index_size    size of an index in bytes: 1, 2 or 4
+ * \param num_indices   number of indices
+ * \return FALSE if out of memory, in which case indices is unchanged
+ */
+boolean
+util_optimize_vertex_cache(void *indices, unsigned index_size,
+                           unsigned num_indices);
+
+
+/**
+ * Return the average number of vertices a FIFO post-transform cache of the
+ * given size shades per triangle (the ACMR) for a triangle list.
+ * It ranges from 3 for no reuse down to about 0.5 for big regular meshes.
+ */
+float
+util_vertex_cache_acmr(const void *indices, unsigned index_size,
+                       unsigned num_indices, unsigned cache_size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_VERTEX_CACHE_H */
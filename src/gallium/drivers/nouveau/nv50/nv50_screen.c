@@ -203,6 +203,8 @@ nv50_screen_get_param(struct pipe_screen *pscreen, enum pipe_cap param)
       return (class_3d >= NVA3_3D_CLASS) ? 4 : 0;
    case PIPE_CAP_TEXTURE_QUERY_LOD:
       return class_3d >= NVA3_3D_CLASS;
+   case PIPE_CAP_SHARED_STATE_OBJECTS:
+      return 0;
    default:
       NOUVEAU_ERR("unknown PIPE_CAP %d\n", param);
       return 0;
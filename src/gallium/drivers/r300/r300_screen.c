@@ -170,6 +170,7 @@ static int r300_get_param(struct pipe_screen* pscreen, enum pipe_cap param)
         case PIPE_CAP_MAX_TEXTURE_GATHER_COMPONENTS:
         case PIPE_CAP_TEXTURE_GATHER_SM5:
         case PIPE_CAP_TEXTURE_QUERY_LOD:
+        case PIPE_CAP_SHARED_STATE_OBJECTS:
             return 0;
 
         /* SWTCL-only features. */
@@ -0,0 +1,796 @@
+/**************************************************************************
+ * 
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+
+/**
+ * Binned fragment processing: sorting quads into screen tiles and shading
+ * the tiles with a pool of threads.
+ *
+ * The tiles are shaded in waves.  The tiles of a wave map to different
+ * slots of the color and depth tile caches, so the
+ * context's thread can look all of them up before the wave starts and the
+ * threads never touch the tile caches themselves.  The waves only depend
+ * on which tiles are covered, so the tile caches end up in the same state
+ * whatever the number of threads.
+ */
+
+#include "pipe/p_defines.h"
+#include "os/os_thread.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_inlines.h"
+#include "tgsi/tgsi_exec.h"
+#include "sp_bin.h"
+#include "sp_context.h"
+#include "sp_state.h"
+#include "sp_texture.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_tile_cache.h"
+
+
+/** Size of the memory blocks the bins are allocated from */
+#define BIN_BLOCK_SIZE (256 * 1024)
+
+/** Shade the binned quads once they use this many blocks */
+#define BIN_MAX_BLOCKS 64
+
+
+struct bin_block {
+   struct bin_block *next;
+   unsigned used;       /**< bytes used, including this header */
+};
+
+#define BIN_BLOCK_HEADER align(sizeof(struct bin_block), 16)
+
+
+/** The per-quad state that setup passes down the quad pipeline */
+struct bin_quad {
+   struct quad_header_input input;
+   struct quad_header_inout inout;
+};
+
+
+/**
+ * A batch of quads of one primitive, as passed to quad_stage::run().
+ * Allocated with room for 'nr' quads only.
+ */
+struct bin_batch {
+   struct bin_batch *next;
+   const struct tgsi_interp_coef *coefs;  /**< position, then the inputs */
+   unsigned nr;
+   struct bin_quad quad[SP_BIN_MAX_QUADS];
+};
+
+
+struct bin_tile {
+   struct bin_batch *head;
+   struct bin_batch *tail;
+};
+
+
+/** A screen tile to shade, with its color and depth tiles */
+struct bin_job {
+   unsigned tile;
+   struct softpipe_cached_tile *cbuf_tile[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_cached_tile *zsbuf_tile;
+};
+
+
+struct sp_binner {
+   struct softpipe_context *softpipe;
+
+   /** Bins, one per screen tile, in row-major order */
+   struct bin_tile *tiles;
+   unsigned tiles_x, tiles_y;
+   unsigned num_batches;
+
+   struct bin_block *blocks;  /**< all blocks allocated */
+   struct bin_block *block;   /**< block being allocated from */
+   unsigned num_blocks_used;
+
+   /** Coefficients of the current primitive, owned by setup */
+   const struct tgsi_interp_coef *coef;
+   const struct tgsi_interp_coef *posCoef;
+   /** Binned copy of the above, NULL until the first quad is binned */
+   const struct tgsi_interp_coef *coefs;
+
+   /**
+    * Shade quads right away, because a color buffer's results depend on
+    * when its tiles get evicted (see softpipe_tile_cache::quantize).
+    */
+   boolean immediate;
+
+   /** Covered tiles which haven't been shaded yet */
+   unsigned *pending;
+
+   /** The wave of tiles being shaded */
+   struct bin_job *jobs;
+   unsigned num_jobs;
+   unsigned next_job;
+   pipe_mutex job_mutex;
+   unsigned fpstate;
+
+   /** Thread 0 is the context's thread, the others are workers */
+   unsigned num_threads;
+   unsigned num_workers;  /**< number of worker threads started */
+   struct sp_bin_thread *threads[SP_MAX_THREADS];
+   pipe_thread workers[SP_MAX_THREADS];
+   pipe_semaphore work_ready[SP_MAX_THREADS];
+   pipe_semaphore work_done[SP_MAX_THREADS];
+   boolean exit_flag;
+};
+
+
+static void *
+bin_alloc(struct sp_binner *binner, unsigned size)
+{
+   struct bin_block *block = binner->block;
+   void *ptr;
+
+   size = align(size, 16);
+   assert(BIN_BLOCK_HEADER + size <= BIN_BLOCK_SIZE);
+
+   if (!block || block->used + size > BIN_BLOCK_SIZE) {
+      /* move on to the next block, reusing the ones from earlier flushes */
+      struct bin_block *next = block ? block->next : binner->blocks;
+
+      if (!next) {
+         next = MALLOC(BIN_BLOCK_SIZE);
+         if (!next)
+            return NULL;
+         next->next = NULL;
+         if (block)
+            block->next = next;
+         else
+            binner->blocks = next;
+      }
+
+      next->used = BIN_BLOCK_HEADER;
+      binner->block = block = next;
+      binner->num_blocks_used++;
+   }
+
+   ptr = (ubyte *) block + block->used;
+   block->used += size;
+   return ptr;
+}
+
+
+static void
+reset_bins(struct sp_binner *binner)
+{
+   if (binner->tiles)
+      memset(binner->tiles, 0,
+             binner->tiles_x * binner->tiles_y * sizeof(binner->tiles[0]));
+
+   binner->num_batches = 0;
+   binner->block = NULL;
+   binner->num_blocks_used = 0;
+   binner->coefs = NULL;
+}
+
+
+/**
+ * Shade the quads of one screen tile, in the order they were binned.
+ */
+static void
+shade_tile(struct sp_bin_thread *thread, const struct bin_job *job)
+{
+   const struct bin_batch *batch;
+   struct quad_stage *first = thread->quad.first;
+
+   memcpy(thread->cbuf_tile, job->cbuf_tile, sizeof(thread->cbuf_tile));
+   thread->zsbuf_tile = job->zsbuf_tile;
+
+   for (batch = thread->binner->tiles[job->tile].head;
+        batch;
+        batch = batch->next) {
+      unsigned i;
+
+      for (i = 0; i < batch->nr; i++) {
+         struct quad_header *quad = &thread->quads[i];
+
+         quad->input = batch->quad[i].input;
+         quad->inout = batch->quad[i].inout;
+         quad->posCoef = &batch->coefs[0];
+         quad->coef = &batch->coefs[1];
+         thread->quad_ptrs[i] = quad;
+      }
+
+      first->run(first, thread->quad_ptrs, batch->nr);
+   }
+}
+
+
+static void
+shade_jobs(struct sp_bin_thread *thread)
+{
+   struct sp_binner *binner = thread->binner;
+
+   while (1) {
+      unsigned job;
+
+      pipe_mutex_lock(binner->job_mutex);
+      job = binner->next_job++;
+      pipe_mutex_unlock(binner->job_mutex);
+
+      if (job >= binner->num_jobs)
+         break;
+
+      shade_tile(thread, &binner->jobs[job]);
+   }
+}
+
+
+static PIPE_THREAD_ROUTINE( bin_thread_function, init_data )
+{
+   struct sp_bin_thread *thread = (struct sp_bin_thread *) init_data;
+   struct sp_binner *binner = thread->binner;
+   const unsigned index = thread->index;
+
+   while (1) {
+      pipe_semaphore_wait(&binner->work_ready[index]);
+
+      if (binner->exit_flag)
+         break;
+
+      /* shade with the same rounding and denormal modes as the context */
+      util_fpstate_set(binner->fpstate);
+
+      shade_jobs(thread);
+
+      pipe_semaphore_signal(&binner->work_done[index]);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Bring a worker's shader, samplers and texture caches up to date with the
+ * context.  The context's thread uses the context's own.
+ */
+static boolean
+update_worker(struct sp_bin_thread *thread)
+{
+   struct softpipe_context *sp = thread->binner->softpipe;
+   const struct sp_tgsi_sampler *sampler =
+      sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   if (thread->fs_variant != sp->fs_variant) {
+      sp->fs_variant->prepare(sp->fs_variant, thread->machine,
+                              (struct tgsi_sampler *) thread->sampler);
+      thread->fs_variant = sp->fs_variant;
+   }
+
+   memcpy(thread->sampler->sp_sampler, sampler->sp_sampler,
+          sizeof(sampler->sp_sampler));
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc = thread->tex_cache[i];
+
+      if (view && !tc) {
+         tc = sp_create_tex_tile_cache(&sp->pipe);
+         if (!tc)
+            return FALSE;
+         thread->tex_cache[i] = tc;
+      }
+
+      if (!tc)
+         continue;
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+
+      if (view) {
+         struct softpipe_resource *spr = softpipe_resource(view->texture);
+
+         if (spr->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spr->timestamp;
+         }
+
+         thread->sampler->sp_sview[i] = sampler->sp_sview[i];
+         thread->sampler->sp_sview[i].cache = tc;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static INLINE boolean
+uses_zsbuf(const struct softpipe_context *sp)
+{
+   return sp->framebuffer.zsbuf &&
+          (sp->depth_stencil->depth.enabled ||
+           sp->depth_stencil->stencil[0].enabled);
+}
+
+
+/**
+ * Look up the color and depth tiles of a screen tile.
+ */
+static void
+get_job_tiles(struct sp_binner *binner, struct bin_job *job,
+              unsigned tile, unsigned tx, unsigned ty)
+{
+   struct softpipe_context *sp = binner->softpipe;
+   const int x = tx * TILE_SIZE, y = ty * TILE_SIZE;
+   unsigned i;
+
+   job->tile = tile;
+
+   memset(job->cbuf_tile, 0, sizeof(job->cbuf_tile));
+   for (i = 0; i < sp->framebuffer.nr_cbufs; i++) {
+      if (sp->framebuffer.cbufs[i])
+         job->cbuf_tile[i] = sp_get_cached_tile(sp->cbuf_cache[i], x, y);
+   }
+
+   job->zsbuf_tile = NULL;
+   if (uses_zsbuf(sp))
+      job->zsbuf_tile = sp_get_cached_tile(sp->zsbuf_cache, x, y);
+}
+
+
+/**
+ * Shade all binned quads.
+ */
+void
+sp_bin_flush(struct sp_binner *binner)
+{
+   struct softpipe_context *sp = binner->softpipe;
+   const unsigned num_tiles = binner->tiles_x * binner->tiles_y;
+   struct softpipe_tile_cache *caches[PIPE_MAX_COLOR_BUFS + 1];
+   unsigned num_caches = 0;
+   unsigned num_threads = binner->num_threads;
+   unsigned num_pending = 0;
+   unsigned i, t;
+
+   if (!binner->num_batches)
+      return;
+
+   for (t = 0; t < num_threads; t++) {
+      struct sp_bin_thread *thread = binner->threads[t];
+
+      if (t > 0 && !update_worker(thread)) {
+         /* out of memory, do without the remaining workers */
+         num_threads = t;
+         break;
+      }
+
+      sp_link_quad_pipe(sp, &thread->quad);
+      thread->quad.first->begin(thread->quad.first);
+      thread->occlusion_count = 0;
+      thread->ps_invocations = 0;
+   }
+
+   binner->fpstate = util_fpstate_get();
+
+   for (i = 0; i < num_tiles; i++) {
+      if (binner->tiles[i].head)
+         binner->pending[num_pending++] = i;
+   }
+
+   for (i = 0; i < sp->framebuffer.nr_cbufs; i++) {
+      if (sp->framebuffer.cbufs[i])
+         caches[num_caches++] = sp->cbuf_cache[i];
+   }
+   if (uses_zsbuf(sp))
+      caches[num_caches++] = sp->zsbuf_cache;
+
+   while (num_pending) {
+      uint used[PIPE_MAX_COLOR_BUFS + 1][MAX_CACHE_ENTRIES / 32];
+      unsigned num_left = 0, num_workers;
+
+      /* take the pending tiles which don't share a tile cache slot */
+      memset(used, 0, num_caches * sizeof(used[0]));
+      binner->num_jobs = 0;
+      for (i = 0; i < num_pending; i++) {
+         const unsigned tile = binner->pending[i];
+         const unsigned tx = tile % binner->tiles_x;
+         const unsigned ty = tile / binner->tiles_x;
+         const union tile_address addr =
+            tile_address(tx * TILE_SIZE, ty * TILE_SIZE);
+         unsigned pos[PIPE_MAX_COLOR_BUFS + 1];
+         boolean conflict = FALSE;
+         unsigned c;
+
+         for (c = 0; c < num_caches; c++) {
+            pos[c] = sp_tile_cache_pos(caches[c], addr);
+            if (used[c][pos[c] / 32] & (1u << (pos[c] % 32)))
+               conflict = TRUE;
+         }
+
+         if (conflict) {
+            binner->pending[num_left++] = tile;
+         }
+         else {
+            for (c = 0; c < num_caches; c++)
+               used[c][pos[c] / 32] |= 1u << (pos[c] % 32);
+            get_job_tiles(binner, &binner->jobs[binner->num_jobs++],
+                          tile, tx, ty);
+         }
+      }
+      num_pending = num_left;
+
+      binner->next_job = 0;
+      num_workers = MIN2(num_threads, binner->num_jobs) - 1;
+
+      for (t = 1; t <= num_workers; t++)
+         pipe_semaphore_signal(&binner->work_ready[t]);
+
+      shade_jobs(binner->threads[0]);
+
+      for (t = 1; t <= num_workers; t++)
+         pipe_semaphore_wait(&binner->work_done[t]);
+   }
+
+   for (t = 0; t < num_threads; t++) {
+      sp->occlusion_count += binner->threads[t]->occlusion_count;
+      sp->pipeline_statistics.ps_invocations +=
+         binner->threads[t]->ps_invocations;
+   }
+
+   reset_bins(binner);
+}
+
+
+/**
+ * Size the bins for the current framebuffer.
+ */
+static void
+resize_bins(struct sp_binner *binner, unsigned tiles_x, unsigned tiles_y)
+{
+   sp_bin_flush(binner);
+
+   FREE(binner->tiles);
+   FREE(binner->pending);
+   FREE(binner->jobs);
+
+   binner->tiles = CALLOC(tiles_x * tiles_y, sizeof(binner->tiles[0]));
+   binner->pending = MALLOC(tiles_x * tiles_y * sizeof(binner->pending[0]));
+   binner->jobs = MALLOC(tiles_x * tiles_y * sizeof(binner->jobs[0]));
+   if (!binner->tiles || !binner->pending || !binner->jobs) {
+      FREE(binner->tiles);
+      FREE(binner->pending);
+      FREE(binner->jobs);
+      binner->tiles = NULL;
+      binner->pending = NULL;
+      binner->jobs = NULL;
+      tiles_x = tiles_y = 0;
+   }
+
+   binner->tiles_x = tiles_x;
+   binner->tiles_y = tiles_y;
+}
+
+
+/**
+ * Called by setup once the coefficients of a primitive are computed.
+ * They're copied along with the first quad that gets binned.
+ */
+void
+sp_bin_begin_primitive(struct sp_binner *binner,
+                       const struct tgsi_interp_coef *coef,
+                       const struct tgsi_interp_coef *posCoef)
+{
+   const struct pipe_framebuffer_state *fb = &binner->softpipe->framebuffer;
+   const unsigned tiles_x = (fb->width + TILE_SIZE - 1) / TILE_SIZE;
+   const unsigned tiles_y = (fb->height + TILE_SIZE - 1) / TILE_SIZE;
+   unsigned i;
+
+   if (tiles_x != binner->tiles_x || tiles_y != binner->tiles_y)
+      resize_bins(binner, tiles_x, tiles_y);
+
+   binner->immediate = FALSE;
+   for (i = 0; i < fb->nr_cbufs; i++) {
+      if (fb->cbufs[i] && !binner->softpipe->cbuf_cache[i]->stable)
+         binner->immediate = TRUE;
+   }
+
+   binner->coef = coef;
+   binner->posCoef = posCoef;
+   binner->coefs = NULL;
+}
+
+
+static struct tgsi_interp_coef *
+bin_coefs(struct sp_binner *binner)
+{
+   const unsigned num_inputs =
+      binner->softpipe->fs_variant->info.num_inputs;
+   struct tgsi_interp_coef *coefs =
+      bin_alloc(binner, (1 + num_inputs) * sizeof(coefs[0]));
+
+   if (coefs) {
+      coefs[0] = *binner->posCoef;
+      memcpy(&coefs[1], binner->coef, num_inputs * sizeof(coefs[0]));
+   }
+
+   return coefs;
+}
+
+
+/**
+ * Bin a batch of quads from setup.  The quads all lie in the same screen
+ * tile: setup emits spans of up to 16 pixels, aligned to 16, in pairs of
+ * rows, and single quads otherwise.
+ */
+void
+sp_bin_quads(struct sp_binner *binner,
+             struct quad_header *quads[], unsigned nr)
+{
+   const unsigned tx = quads[0]->input.x0 / TILE_SIZE;
+   const unsigned ty = quads[0]->input.y0 / TILE_SIZE;
+   struct bin_tile *tile;
+   struct bin_batch *batch = NULL;
+   unsigned i;
+
+   assert(nr <= SP_BIN_MAX_QUADS);
+
+   if (binner->num_blocks_used >= BIN_MAX_BLOCKS)
+      sp_bin_flush(binner);
+
+   if (binner->tiles && !binner->immediate) {
+      if (!binner->coefs)
+         binner->coefs = bin_coefs(binner);
+      if (binner->coefs)
+         batch = bin_alloc(binner, Offset(struct bin_batch, quad) +
+                                   nr * sizeof(batch->quad[0]));
+   }
+
+   if (!batch) {
+      /* out of memory or not binning, shade the quads right away */
+      struct softpipe_context *sp = binner->softpipe;
+
+      sp_bin_flush(binner);
+      sp->quad.first->run(sp->quad.first, quads, nr);
+      return;
+   }
+
+   assert(tx < binner->tiles_x && ty < binner->tiles_y);
+
+   batch->next = NULL;
+   batch->coefs = binner->coefs;
+   batch->nr = nr;
+   for (i = 0; i < nr; i++) {
+      assert(quads[i]->input.x0 / TILE_SIZE == tx);
+      assert(quads[i]->input.y0 / TILE_SIZE == ty);
+      batch->quad[i].input = quads[i]->input;
+      batch->quad[i].inout = quads[i]->inout;
+   }
+
+   tile = &binner->tiles[ty * binner->tiles_x + tx];
+   if (tile->tail)
+      tile->tail->next = batch;
+   else
+      tile->head = batch;
+   tile->tail = batch;
+
+   binner->num_batches++;
+}
+
+
+/**
+ * Unbind a fragment shader variant which is about to be deleted from the
+ * workers' interpreters.
+ */
+void
+sp_bin_delete_fs_variant(struct sp_binner *binner,
+                         const struct sp_fragment_shader_variant *var)
+{
+   unsigned t;
+
+   for (t = 1; t < binner->num_threads; t++) {
+      struct sp_bin_thread *thread = binner->threads[t];
+
+      if (thread->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(thread->machine, NULL, NULL);
+         thread->fs_variant = NULL;
+      }
+   }
+}
+
+
+/**
+ * Invalidate the workers' texture caches, see sp_flush_tex_tile_cache().
+ */
+void
+sp_bin_flush_tex_caches(struct sp_binner *binner)
+{
+   unsigned t, i;
+
+   for (t = 1; t < binner->num_threads; t++) {
+      struct sp_bin_thread *thread = binner->threads[t];
+
+      for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+         if (thread->tex_cache[i])
+            sp_flush_tex_tile_cache(thread->tex_cache[i]);
+      }
+   }
+}
+
+
+static void
+destroy_thread(struct sp_bin_thread *thread)
+{
+   unsigned i;
+
+   if (thread->quad.shade)
+      thread->quad.shade->destroy(thread->quad.shade);
+   if (thread->quad.depth_test)
+      thread->quad.depth_test->destroy(thread->quad.depth_test);
+   if (thread->quad.blend)
+      thread->quad.blend->destroy(thread->quad.blend);
+   if (thread->quad.pstipple)
+      thread->quad.pstipple->destroy(thread->quad.pstipple);
+
+   if (thread->index > 0) {
+      if (thread->machine)
+         tgsi_exec_machine_destroy(thread->machine);
+      FREE(thread->sampler);
+
+      for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+         if (thread->tex_cache[i]) {
+            sp_tex_tile_cache_set_sampler_view(thread->tex_cache[i], NULL);
+            sp_destroy_tex_tile_cache(thread->tex_cache[i]);
+         }
+      }
+   }
+
+   FREE(thread);
+}
+
+
+static struct sp_bin_thread *
+create_thread(struct sp_binner *binner, unsigned index)
+{
+   struct softpipe_context *sp = binner->softpipe;
+   struct sp_bin_thread *thread = CALLOC_STRUCT(sp_bin_thread);
+
+   if (!thread)
+      return NULL;
+
+   thread->binner = binner;
+   thread->index = index;
+
+   thread->quad.shade = sp_quad_shade_stage(sp);
+   thread->quad.depth_test = sp_quad_depth_test_stage(sp);
+   thread->quad.blend = sp_quad_blend_stage(sp);
+   thread->quad.pstipple = sp_quad_polygon_stipple_stage(sp);
+
+   if (index == 0) {
+      thread->machine = sp->fs_machine;
+      thread->sampler = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   }
+   else {
+      thread->machine = tgsi_exec_machine_create();
+      thread->sampler = sp_create_tgsi_sampler();
+   }
+
+   if (!thread->quad.shade || !thread->quad.depth_test ||
+       !thread->quad.blend || !thread->quad.pstipple ||
+       !thread->machine || !thread->sampler) {
+      destroy_thread(thread);
+      return NULL;
+   }
+
+   thread->quad.shade->thread = thread;
+   thread->quad.depth_test->thread = thread;
+   thread->quad.blend->thread = thread;
+   thread->quad.pstipple->thread = thread;
+
+   return thread;
+}
+
+
+/**
+ * Create the binner and num_threads - 1 worker threads.  The context's
+ * thread shades tiles too.
+ */
+struct sp_binner *
+sp_bin_create(struct softpipe_context *sp, unsigned num_threads)
+{
+   struct sp_binner *binner;
+   unsigned t;
+
+   assert(num_threads >= 1 && num_threads <= SP_MAX_THREADS);
+
+   binner = CALLOC_STRUCT(sp_binner);
+   if (!binner)
+      return NULL;
+
+   binner->softpipe = sp;
+   pipe_mutex_init(binner->job_mutex);
+
+   for (t = 0; t < num_threads; t++) {
+      binner->threads[t] = create_thread(binner, t);
+      if (!binner->threads[t]) {
+         sp_bin_destroy(binner);
+         return NULL;
+      }
+      binner->num_threads++;
+   }
+
+   for (t = 1; t < num_threads; t++) {
+      pipe_semaphore_init(&binner->work_ready[t], 0);
+      pipe_semaphore_init(&binner->work_done[t], 0);
+      binner->workers[t] = pipe_thread_create(bin_thread_function,
+                                              binner->threads[t]);
+      if (!binner->workers[t]) {
+         pipe_semaphore_destroy(&binner->work_ready[t]);
+         pipe_semaphore_destroy(&binner->work_done[t]);
+         break;
+      }
+      binner->num_workers++;
+   }
+
+   /* do with the workers which did start */
+   while (binner->num_threads > binner->num_workers + 1) {
+      t = --binner->num_threads;
+      destroy_thread(binner->threads[t]);
+      binner->threads[t] = NULL;
+   }
+
+   return binner;
+}
+
+
+void
+sp_bin_destroy(struct sp_binner *binner)
+{
+   struct bin_block *block, *next;
+   unsigned t;
+
+   binner->exit_flag = TRUE;
+   for (t = 1; t <= binner->num_workers; t++)
+      pipe_semaphore_signal(&binner->work_ready[t]);
+
+   for (t = 1; t <= binner->num_workers; t++) {
+      pipe_thread_wait(binner->workers[t]);
+      pipe_semaphore_destroy(&binner->work_ready[t]);
+      pipe_semaphore_destroy(&binner->work_done[t]);
+   }
+
+   for (t = 0; t < binner->num_threads; t++)
+      destroy_thread(binner->threads[t]);
+
+   for (block = binner->blocks; block; block = next) {
+      next = block->next;
+      FREE(block);
+   }
+
+   FREE(binner->tiles);
+   FREE(binner->pending);
+   FREE(binner->jobs);
+   pipe_mutex_destroy(binner->job_mutex);
+   FREE(binner);
+}
@@ -0,0 +1,170 @@
+/**************************************************************************
+ * 
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+
+/**
+ * Binned fragment processing.
+ *
+ * Instead of running the quad pipeline as setup produces quads, the quads
+ * are sorted into lists per 64x64 screen tile (the tile size of the color
+ * and depth tile caches).  When the bins are flushed, the tiles are shaded
+ * by a pool of threads, each with its own quad pipeline, TGSI interpreter
+ * and texture caches.  A tile is only ever shaded by one thread at a time
+ * and its quads are processed in submission order, so the results don't
+ * depend on the number of threads.
+ */
+
+#ifndef SP_BIN_H
+#define SP_BIN_H
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_state.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of threads shading tiles, including the context's thread */
+#define SP_MAX_THREADS 8
+
+/** Max number of quads in a binned batch */
+#define SP_BIN_MAX_QUADS 16
+
+
+struct sp_binner;
+struct sp_tgsi_sampler;
+struct sp_fragment_shader_variant;
+struct softpipe_tex_tile_cache;
+struct tgsi_exec_machine;
+
+
+/**
+ * State of one tile shading thread.  The color and depth tiles of the
+ * screen tile being shaded are looked up by the context's thread, since
+ * the tile caches aren't thread safe.
+ */
+struct sp_bin_thread {
+   struct sp_binner *binner;
+   unsigned index;  /**< 0 for the context's thread */
+
+   struct sp_quad_pipe quad;
+   struct tgsi_exec_machine *machine;
+   struct sp_tgsi_sampler *sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   const struct sp_fragment_shader_variant *fs_variant;
+
+   struct softpipe_cached_tile *cbuf_tile[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_cached_tile *zsbuf_tile;
+
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   struct quad_header quads[SP_BIN_MAX_QUADS];
+   struct quad_header *quad_ptrs[SP_BIN_MAX_QUADS];
+};
+
+
+struct sp_binner *
+sp_bin_create(struct softpipe_context *sp, unsigned num_threads);
+
+void
+sp_bin_destroy(struct sp_binner *binner);
+
+void
+sp_bin_begin_primitive(struct sp_binner *binner,
+                       const struct tgsi_interp_coef *coef,
+                       const struct tgsi_interp_coef *posCoef);
+
+void
+sp_bin_quads(struct sp_binner *binner,
+             struct quad_header *quads[], unsigned nr);
+
+void
+sp_bin_flush(struct sp_binner *binner);
+
+void
+sp_bin_delete_fs_variant(struct sp_binner *binner,
+                         const struct sp_fragment_shader_variant *var);
+
+void
+sp_bin_flush_tex_caches(struct sp_binner *binner);
+
+
+/*
+ * Accessors for the quad stages, which either run for a binning thread or
+ * directly on the context.
+ */
+
+static INLINE struct tgsi_exec_machine *
+sp_quad_fs_machine(const struct quad_stage *qs)
+{
+   return qs->thread ? qs->thread->machine : qs->softpipe->fs_machine;
+}
+
+
+static INLINE struct softpipe_cached_tile *
+sp_quad_cbuf_tile(const struct quad_stage *qs, unsigned cbuf,
+                  const struct quad_header *quad)
+{
+   if (qs->thread)
+      return qs->thread->cbuf_tile[cbuf];
+
+   return sp_get_cached_tile(qs->softpipe->cbuf_cache[cbuf],
+                             quad->input.x0, quad->input.y0);
+}
+
+
+static INLINE struct softpipe_cached_tile *
+sp_quad_zsbuf_tile(const struct quad_stage *qs,
+                   const struct quad_header *quad)
+{
+   if (qs->thread)
+      return qs->thread->zsbuf_tile;
+
+   return sp_get_cached_tile(qs->softpipe->zsbuf_cache,
+                             quad->input.x0, quad->input.y0);
+}
+
+
+static INLINE uint64_t *
+sp_quad_occlusion_count(const struct quad_stage *qs)
+{
+   return qs->thread ? &qs->thread->occlusion_count :
+                       &qs->softpipe->occlusion_count;
+}
+
+
+static INLINE uint64_t *
+sp_quad_ps_invocations(const struct quad_stage *qs)
+{
+   return qs->thread ? &qs->thread->ps_invocations :
+                       &qs->softpipe->pipeline_statistics.ps_invocations;
+}
+
+
+#endif /* SP_BIN_H */
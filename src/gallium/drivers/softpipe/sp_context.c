@@ -33,11 +33,13 @@
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "pipe/p_defines.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_pstipple.h"
 #include "util/u_inlines.h"
 #include "tgsi/tgsi_exec.h"
+#include "sp_bin.h"
 #include "sp_clear.h"
 #include "sp_context.h"
 #include "sp_flush.h"
@@ -73,6 +75,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   if (softpipe->binner)
+      sp_bin_destroy( softpipe->binner );
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -191,9 +196,10 @@ softpipe_create_context( struct pipe_screen *screen,
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
-   uint i, sh;
+   uint i, sh, num_threads;
 
    util_init_math();
+   util_cpu_detect();
 
    for (i = 0; i < PIPE_SHADER_TYPES; i++) {
       softpipe->tgsi.sampler[i] = sp_create_tgsi_sampler();
@@ -251,6 +257,16 @@ softpipe_create_context( struct pipe_screen *screen,
    softpipe->quad.blend = sp_quad_blend_stage(softpipe);
    softpipe->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
 
+   /*
+    * Bin quads per screen tile and shade the tiles with this many threads.
+    * The result is the same for any number of threads.  Zero shades the
+    * quads as they're rasterized instead.
+    */
+   num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS",
+                                      util_cpu_caps.nr_cpus);
+   num_threads = MIN2(num_threads, SP_MAX_THREADS);
+   if (num_threads)
+      softpipe->binner = sp_bin_create(softpipe, num_threads);
 
    /*
     * Create drawing context and plug our rendering stage into it.
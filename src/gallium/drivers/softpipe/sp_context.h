@@ -47,6 +47,7 @@
 
 
 struct softpipe_vbuf_render;
+struct sp_binner;
 struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
@@ -152,13 +153,7 @@ struct softpipe_context {
    } pstipple;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct sp_quad_pipe quad;
 
    /** TGSI exec things */
    struct {
@@ -167,6 +162,9 @@ struct softpipe_context {
 
    struct tgsi_exec_machine *fs_machine;
 
+   /** Tile binning and shading threads, NULL to shade immediately */
+   struct sp_binner *binner;
+
    /** The primitive drawing context */
    struct draw_context *draw;
 
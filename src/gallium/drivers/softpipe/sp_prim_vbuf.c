@@ -36,6 +36,7 @@
  */
 
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_setup.h"
 #include "sp_state.h"
@@ -108,7 +109,13 @@ sp_vbuf_allocate_vertices(struct vbuf_render *vbr,
 static void
 sp_vbuf_release_vertices(struct vbuf_render *vbr)
 {
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+
    /* keep the old allocation for next time */
+
+   /* shade the binned quads before the state they depend on changes */
+   if (cvbr->softpipe->binner)
+      sp_bin_flush(cvbr->softpipe->binner);
 }
 
 
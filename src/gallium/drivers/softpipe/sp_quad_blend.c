@@ -35,6 +35,7 @@
 #include "util/u_memory.h"
 #include "util/u_format.h"
 #include "util/u_dual_blend.h"
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_state.h"
 #include "sp_quad.h"
@@ -914,6 +915,91 @@ rebase_colors(enum format base_format, float (*quadColor)[4])
    }
 }
 
+/**
+ * Get the colors of the 2x2 pixels at (itx, ity) of a color tile.
+ */
+static INLINE void
+get_dest_colors(const struct softpipe_tile_cache *tc,
+                const struct softpipe_cached_tile *tile,
+                int itx, int ity, float (*dest)[4])
+{
+   uint i, j;
+
+   if (tc->native) {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         const uint value = tile->data.color32[ity + (j >> 1)][itx + (j & 1)];
+         for (i = 0; i < 4; i++) {
+            if (tc->native_shift[i] >= 0)
+               dest[i][j] = ubyte_to_float((value >> tc->native_shift[i]) & 0xff);
+            else
+               dest[i][j] = tc->native_fill[i];
+         }
+      }
+   }
+   else {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         int x = itx + (j & 1);
+         int y = ity + (j >> 1);
+         for (i = 0; i < 4; i++) {
+            dest[i][j] = tile->data.color[y][x][i];
+         }
+      }
+   }
+}
+
+
+/**
+ * Write the colors of the pixels of a quad in the mask to a color tile.
+ * Tiles kept in the surface's format are packed right away, like
+ * hardware does, rather than when the tile is written back.  Float tiles
+ * get the values packing them would leave, for the same results no matter
+ * when the tile is written back.
+ */
+static INLINE void
+put_quad_colors(const struct softpipe_tile_cache *tc,
+                struct softpipe_cached_tile *tile,
+                int itx, int ity, unsigned mask, float (*quadColor)[4])
+{
+   float rgba[TGSI_QUAD_SIZE][4];
+   uint i, j;
+
+   if (tc->quantize) {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         for (i = 0; i < 4; i++) {
+            rgba[j][i] = quadColor[i][j];
+         }
+      }
+      sp_tile_cache_quantize(tc, rgba, TGSI_QUAD_SIZE);
+   }
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      if (mask & (1 << j)) {
+         int x = itx + (j & 1);
+         int y = ity + (j >> 1);
+         if (tc->native) {
+            uint value = 0;
+            for (i = 0; i < 4; i++) {
+               if (tc->native_shift[i] >= 0)
+                  value |= (uint) float_to_ubyte(quadColor[i][j]) <<
+                           tc->native_shift[i];
+            }
+            tile->data.color32[y][x] = value;
+         }
+         else if (tc->quantize) {
+            for (i = 0; i < 4; i++) {
+               tile->data.color[y][x][i] = rgba[j][i];
+            }
+         }
+         else {
+            for (i = 0; i < 4; i++) { /* loop over color chans */
+               tile->data.color[y][x][i] = quadColor[i][j];
+            }
+         }
+      }
+   }
+}
+
+
 static void
 blend_fallback(struct quad_stage *qs, 
                struct quad_header *quads[],
@@ -932,10 +1018,9 @@ blend_fallback(struct quad_stage *qs,
          /* which blend/mask state index to use: */
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
+         const struct softpipe_tile_cache *tc = softpipe->cbuf_cache[cbuf];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
-                                 quads[0]->input.x0, 
-                                 quads[0]->input.y0);
+            = sp_quad_cbuf_tile(qs, cbuf, quads[0]);
          const boolean clamp = bqs->clamp[cbuf];
          const float *blend_color;
          const boolean dual_source_blend = util_blend_state_is_dual(blend, cbuf);
@@ -976,13 +1061,7 @@ blend_fallback(struct quad_stage *qs,
 
             /* get/swizzle dest colors
              */
-            for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-               int x = itx + (j & 1);
-               int y = ity + (j >> 1);
-               for (i = 0; i < 4; i++) {
-                  dest[i][j] = tile->data.color[y][x][i];
-               }
-            }
+            get_dest_colors(tc, tile, itx, ity, dest);
 
 
             if (blend->logicop_enable) {
@@ -1008,15 +1087,7 @@ blend_fallback(struct quad_stage *qs,
 
             /* Output color values
              */
-            for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-               if (quad->inout.mask & (1 << j)) {
-                  int x = itx + (j & 1);
-                  int y = ity + (j >> 1);
-                  for (i = 0; i < 4; i++) { /* loop over color chans */
-                     tile->data.color[y][x][i] = quadColor[i][j];
-                  }
-               }
-            }
+            put_quad_colors(tc, tile, itx, ity, quad->inout.mask, quadColor);
          }
       }
    }
@@ -1033,12 +1104,10 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    float one_minus_alpha[TGSI_QUAD_SIZE];
    float dest[4][TGSI_QUAD_SIZE];
    float source[4][TGSI_QUAD_SIZE];
-   uint i, j, q;
+   uint q;
 
-   struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0);
+   const struct softpipe_tile_cache *tc = qs->softpipe->cbuf_cache[0];
+   struct softpipe_cached_tile *tile = sp_quad_cbuf_tile(qs, 0, quads[0]);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1048,13 +1117,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
       const int ity = (quad->input.y0 & (TILE_SIZE-1));
       
       /* get/swizzle dest colors */
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         int x = itx + (j & 1);
-         int y = ity + (j >> 1);
-         for (i = 0; i < 4; i++) {
-            dest[i][j] = tile->data.color[y][x][i];
-         }
-      }
+      get_dest_colors(tc, tile, itx, ity, dest);
 
       /* If fixed-point dest color buffer, need to clamp the incoming
        * fragment colors now.
@@ -1088,15 +1151,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         if (quad->inout.mask & (1 << j)) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) { /* loop over color chans */
-               tile->data.color[y][x][i] = quadColor[i][j];
-            }
-         }
-      }
+      put_quad_colors(tc, tile, itx, ity, quad->inout.mask, quadColor);
    }
 }
 
@@ -1107,12 +1162,10 @@ blend_single_add_one_one(struct quad_stage *qs,
 {
    const struct blend_quad_stage *bqs = blend_quad_stage(qs);
    float dest[4][TGSI_QUAD_SIZE];
-   uint i, j, q;
+   uint q;
 
-   struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0);
+   const struct softpipe_tile_cache *tc = qs->softpipe->cbuf_cache[0];
+   struct softpipe_cached_tile *tile = sp_quad_cbuf_tile(qs, 0, quads[0]);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1121,13 +1174,7 @@ blend_single_add_one_one(struct quad_stage *qs,
       const int ity = (quad->input.y0 & (TILE_SIZE-1));
       
       /* get/swizzle dest colors */
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         int x = itx + (j & 1);
-         int y = ity + (j >> 1);
-         for (i = 0; i < 4; i++) {
-            dest[i][j] = tile->data.color[y][x][i];
-         }
-      }
+      get_dest_colors(tc, tile, itx, ity, dest);
      
       /* If fixed-point dest color buffer, need to clamp the incoming
        * fragment colors now.
@@ -1150,15 +1197,7 @@ blend_single_add_one_one(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         if (quad->inout.mask & (1 << j)) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) { /* loop over color chans */
-               tile->data.color[y][x][i] = quadColor[i][j];
-            }
-         }
-      }
+      put_quad_colors(tc, tile, itx, ity, quad->inout.mask, quadColor);
    }
 }
 
@@ -1175,12 +1214,10 @@ single_output_color(struct quad_stage *qs,
                     unsigned nr)
 {
    const struct blend_quad_stage *bqs = blend_quad_stage(qs);
-   uint i, j, q;
+   uint q;
 
-   struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0);
+   const struct softpipe_tile_cache *tc = qs->softpipe->cbuf_cache[0];
+   struct softpipe_cached_tile *tile = sp_quad_cbuf_tile(qs, 0, quads[0]);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1193,15 +1230,7 @@ single_output_color(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
-      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
-         if (quad->inout.mask & (1 << j)) {
-            int x = itx + (j & 1);
-            int y = ity + (j >> 1);
-            for (i = 0; i < 4; i++) { /* loop over color chans */
-               tile->data.color[y][x][i] = quadColor[i][j];
-            }
-         }
-      }
+      put_quad_colors(tc, tile, itx, ity, quad->inout.mask, quadColor);
    }
 }
 
@@ -33,6 +33,7 @@
 
 
 struct softpipe_context;
+struct sp_bin_thread;
 struct quad_header;
 
 
@@ -44,6 +45,9 @@ struct quad_header;
 struct quad_stage {
    struct softpipe_context *softpipe;
 
+   /** Binned rendering thread this stage belongs to, or NULL */
+   struct sp_bin_thread *thread;
+
    struct quad_stage *next;
 
    void (*begin)(struct quad_stage *qs);
@@ -55,6 +59,18 @@ struct quad_stage {
 };
 
 
+/**
+ * The quad stages of a pipeline and the one at its head.
+ */
+struct sp_quad_pipe {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *first; /**< points to one of the above stages */
+};
+
+
 struct quad_stage *sp_quad_polygon_stipple_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_earlyz_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_shade_stage( struct softpipe_context *softpipe );
@@ -67,6 +83,7 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
+void sp_link_quad_pipe(struct softpipe_context *sp, struct sp_quad_pipe *quad);
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
 #endif /* SP_QUAD_PIPE_H */
@@ -36,6 +36,7 @@
 #include "sp_context.h"
 #include "sp_query.h"
 #include "sp_state.h"
+#include "sp_tile_cache.h"
 
 struct softpipe_query {
    unsigned type;
@@ -51,6 +52,28 @@ static struct softpipe_query *softpipe_query( struct pipe_query *p )
    return (struct softpipe_query *)p;
 }
 
+
+/**
+ * Sum up the hit or miss counters of the color and depth tile caches.
+ */
+static uint64_t
+tile_cache_count(const struct softpipe_context *softpipe, boolean misses)
+{
+   uint64_t count = 0;
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      if (softpipe->cbuf_cache[i])
+         count += misses ? softpipe->cbuf_cache[i]->misses :
+                           softpipe->cbuf_cache[i]->hits;
+   }
+   if (softpipe->zsbuf_cache)
+      count += misses ? softpipe->zsbuf_cache->misses :
+                        softpipe->zsbuf_cache->hits;
+
+   return count;
+}
+
 static struct pipe_query *
 softpipe_create_query(struct pipe_context *pipe, 
 		      unsigned type)
@@ -67,7 +90,9 @@ softpipe_create_query(struct pipe_context *pipe,
           type == PIPE_QUERY_PIPELINE_STATISTICS ||
           type == PIPE_QUERY_GPU_FINISHED ||
           type == PIPE_QUERY_TIMESTAMP ||
-          type == PIPE_QUERY_TIMESTAMP_DISJOINT);
+          type == PIPE_QUERY_TIMESTAMP_DISJOINT ||
+          type == SP_QUERY_TILE_CACHE_HITS ||
+          type == SP_QUERY_TILE_CACHE_MISSES);
    sq = CALLOC_STRUCT( softpipe_query );
    sq->type = type;
 
@@ -123,6 +148,11 @@ softpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
              sizeof(sq->stats));
       softpipe->active_statistics_queries++;
       break;
+   case SP_QUERY_TILE_CACHE_HITS:
+   case SP_QUERY_TILE_CACHE_MISSES:
+      sq->start = tile_cache_count(softpipe,
+                                   sq->type == SP_QUERY_TILE_CACHE_MISSES);
+      break;
    default:
       assert(0);
       break;
@@ -194,6 +224,11 @@ softpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
 
       softpipe->active_statistics_queries--;
       break;
+   case SP_QUERY_TILE_CACHE_HITS:
+   case SP_QUERY_TILE_CACHE_MISSES:
+      sq->end = tile_cache_count(softpipe,
+                                 sq->type == SP_QUERY_TILE_CACHE_MISSES);
+      break;
    default:
       assert(0);
       break;
@@ -281,6 +316,27 @@ softpipe_check_render_cond(struct softpipe_context *sp)
 }
 
 
+int
+softpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info list[] = {
+      {"tile-cache-hits", SP_QUERY_TILE_CACHE_HITS, 0, FALSE},
+      {"tile-cache-misses", SP_QUERY_TILE_CACHE_MISSES, 0, FALSE},
+   };
+
+   if (!info)
+      return Elements(list);
+
+   if (index >= Elements(list))
+      return 0;
+
+   *info = list[index];
+   return 1;
+}
+
+
 void softpipe_init_query_funcs(struct softpipe_context *softpipe )
 {
    softpipe->pipe.create_query = softpipe_create_query;
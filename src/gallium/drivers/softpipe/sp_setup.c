@@ -32,6 +32,7 @@
  * \author  Brian Paul
  */
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
@@ -152,6 +153,34 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
 }
 
 
+/**
+ * Let the binner know that a new primitive's coefficients are set up.
+ */
+static INLINE void
+begin_primitive(struct setup_context *setup)
+{
+   if (setup->softpipe->binner)
+      sp_bin_begin_primitive(setup->softpipe->binner,
+                             setup->coef, &setup->posCoef);
+}
+
+
+/**
+ * Pass quads to the quad pipeline, or bin them for the tile threads.
+ */
+static INLINE void
+emit_quads(struct setup_context *setup, struct quad_header *quads[],
+           unsigned nr)
+{
+   struct softpipe_context *sp = setup->softpipe;
+
+   if (sp->binner)
+      sp_bin_quads(sp->binner, quads, nr);
+   else
+      sp->quad.first->run( sp->quad.first, quads, nr );
+}
+
+
 /**
  * Emit a quad (pass to next stage) with clipping.
  */
@@ -161,13 +190,11 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip( setup, quad );
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
-
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      emit_quads( setup, &quad, 1 );
    }
 }
 
@@ -202,7 +229,6 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -247,7 +273,7 @@ flush_spans(struct setup_context *setup)
             lx += 2;
          } while (mask0 | mask1);
 
-         pipe->run( pipe, setup->quad_ptrs, q );
+         emit_quads( setup, setup->quad_ptrs, q );
       }
    }
 
@@ -827,6 +853,7 @@ sp_setup_tri(struct setup_context *setup,
 
    setup_tri_coefficients( setup );
    setup_tri_edges( setup );
+   begin_primitive( setup );
 
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_TRIANGLES);
 
@@ -1088,6 +1115,8 @@ sp_setup_line(struct setup_context *setup,
    if (!setup_line_coefficients(setup, v0, v1))
       return;
 
+   begin_primitive( setup );
+
    assert(v0[0][0] < 1.0e9);
    assert(v0[0][1] < 1.0e9);
    assert(v1[0][0] < 1.0e9);
@@ -1270,6 +1299,7 @@ sp_setup_point(struct setup_context *setup,
       }
    }
 
+   begin_primitive( setup );
 
    if (halfSize <= 0.5 && !round) {
       /* special case for 1-pixel points */
@@ -1402,6 +1432,10 @@ sp_setup_prepare(struct setup_context *setup)
 {
    struct softpipe_context *sp = setup->softpipe;
 
+   /* binned quads must be shaded with the state they were binned with */
+   if (sp->binner)
+      sp_bin_flush(sp->binner);
+
    if (sp->dirty) {
       softpipe_update_derived(sp, sp->reduced_api_prim);
    }
@@ -42,17 +42,6 @@ static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
-/**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
- */
-#define CACHE_POS(x, y) \
-   (((x) + (y) * 5) % NUM_ENTRIES)
-
-
-
 /**
  * Is the tile at (x,y) in cleared state?
  */
@@ -149,6 +138,131 @@ sp_destroy_tile_cache(struct softpipe_tile_cache *tc)
 }
 
 
+/**
+ * Can color tiles of the given format be kept in that format?  That's the
+ * case for 8-bit unorm formats with R, G, B and optionally A channels, whose
+ * pixels the blend stage can pack and unpack itself.
+ */
+static boolean
+init_native_format(struct softpipe_tile_cache *tc, enum pipe_format format)
+{
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   const struct util_format_description *desc = util_format_description(format);
+   unsigned used = 0;
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->block.bits != 32 ||
+       desc->nr_channels != 4)
+      return FALSE;
+
+   for (i = 0; i < 4; i++) {
+      const struct util_format_channel_description *chan = &desc->channel[i];
+
+      if (chan->size != 8)
+         return FALSE;
+      if (chan->type != UTIL_FORMAT_TYPE_VOID &&
+          (chan->type != UTIL_FORMAT_TYPE_UNSIGNED || !chan->normalized))
+         return FALSE;
+   }
+
+   for (i = 0; i < 4; i++) {
+      const unsigned swz = desc->swizzle[i];
+
+      if (swz <= UTIL_FORMAT_SWIZZLE_W &&
+          desc->channel[swz].type != UTIL_FORMAT_TYPE_VOID &&
+          !(used & (1 << swz))) {
+         used |= 1 << swz;
+         tc->native_shift[i] = desc->channel[swz].shift;
+         tc->native_fill[i] = 0.0f;
+      }
+      else if (i == 3 && swz == UTIL_FORMAT_SWIZZLE_1) {
+         tc->native_shift[i] = -1;
+         tc->native_fill[i] = 1.0f;
+      }
+      else {
+         return FALSE;
+      }
+   }
+
+   /* all the channels which are stored must be written */
+   for (i = 0; i < 4; i++) {
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_VOID && !(used & (1 << i)))
+         return FALSE;
+   }
+
+   return TRUE;
+#else
+   return FALSE;
+#endif
+}
+
+
+/**
+ * Do colors rounded to the given format round to themselves?  Not so for
+ * 32-bit normalized channels, whose values floats can't all represent, nor
+ * for R8G8Bx_SNORM, which truncates when packing.
+ */
+static boolean
+is_stable_format(enum pipe_format format)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   unsigned i;
+
+   if (format == PIPE_FORMAT_R8G8Bx_SNORM)
+      return FALSE;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].normalized && desc->channel[i].size > 24)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Size the cache for a new surface: a slot for each of its tiles, up to
+ * MAX_CACHE_ENTRIES, and tiles just big enough for its format.
+ * The cache must have been flushed.
+ */
+static void
+resize_cache(struct softpipe_tile_cache *tc, const struct pipe_surface *ps)
+{
+   const unsigned tiles_x = (ps->width + TILE_SIZE - 1) / TILE_SIZE;
+   const unsigned tiles_y = (ps->height + TILE_SIZE - 1) / TILE_SIZE;
+   unsigned tile_size, pos;
+
+   if (tc->depth_stencil)
+      tile_size = util_format_get_blocksize(ps->format) * TILE_SIZE * TILE_SIZE;
+   else if (tc->native)
+      tile_size = sizeof(tc->tile->data.color32);
+   else
+      tile_size = sizeof(tc->tile->data.color);
+
+   tc->tiles_x = tiles_x;
+   tc->num_entries = MAX2(MIN2(tiles_x * tiles_y, MAX_CACHE_ENTRIES), 1);
+
+   for (pos = 0; pos < Elements(tc->entries); pos++) {
+      assert(tc->tile_addrs[pos].bits.invalid);
+      if (tile_size != tc->tile_size || pos >= tc->num_entries) {
+         FREE(tc->entries[pos]);
+         tc->entries[pos] = NULL;
+      }
+   }
+
+   if (tile_size != tc->tile_size) {
+      /* the scratch tile may have been taken from the entries */
+      FREE(tc->tile);
+      tc->tile = MALLOC_STRUCT(softpipe_cached_tile);
+      tc->tile_size = tile_size;
+   }
+
+   tc->last_tile_addr.bits.invalid = 1;
+}
+
+
 /**
  * Specify the surface to cache.
  */
@@ -184,6 +298,19 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
       }
 
       tc->depth_stencil = util_format_is_depth_or_stencil(ps->format);
+      tc->native = !tc->depth_stencil && init_native_format(tc, ps->format);
+      if (tc->depth_stencil || tc->native ||
+          util_format_is_pure_integer(ps->format) ||
+          ps->format == PIPE_FORMAT_R32G32B32A32_FLOAT) {
+         tc->stable = TRUE;
+         tc->quantize = FALSE;
+      }
+      else {
+         tc->stable = is_stable_format(ps->format);
+         tc->quantize = tc->stable;
+      }
+
+      resize_cache(tc, ps);
    }
 }
 
@@ -198,15 +325,59 @@ sp_tile_cache_get_surface(struct softpipe_tile_cache *tc)
 }
 
 
+/**
+ * Round RGBA colors to the values they read back as after storing them in
+ * the surface, the same way store_tile() and load_tile() do.
+ */
+void
+sp_tile_cache_quantize(const struct softpipe_tile_cache *tc,
+                       float (*rgba)[4], unsigned count)
+{
+   const enum pipe_format format = tc->surface->format;
+   uint64_t packed[4 * 4];
+   unsigned n;
+
+   assert(tc->quantize);
+   assert(util_format_get_blocksize(format) * 4 <= sizeof packed);
+
+   while (count) {
+      n = MIN2(count, 4);
+      util_format_write_4f(format, rgba[0], sizeof rgba[0], packed,
+                           sizeof packed, 0, 0, n, 1);
+      util_format_read_4f(format, rgba[0], sizeof rgba[0], packed,
+                          sizeof packed, 0, 0, n, 1);
+      rgba += n;
+      count -= n;
+   }
+}
+
+
 /**
  * Set pixels in a tile to the given clear color/value, float.
  */
 static void
-clear_tile_rgba(struct softpipe_cached_tile *tile,
+clear_tile_rgba(const struct softpipe_tile_cache *tc,
+                struct softpipe_cached_tile *tile,
                 enum pipe_format format,
                 const union pipe_color_union *clear_value)
 {
-   if (clear_value->f[0] == 0.0 &&
+   if (tc->native) {
+      uint value = 0;
+      uint i, j;
+
+      for (i = 0; i < 4; i++) {
+         if (tc->native_shift[i] >= 0)
+            value |= (uint) float_to_ubyte(clear_value->f[i]) <<
+                     tc->native_shift[i];
+      }
+
+      for (i = 0; i < TILE_SIZE; i++) {
+         for (j = 0; j < TILE_SIZE; j++) {
+            tile->data.color32[i][j] = value;
+         }
+      }
+   }
+   else if (clear_value->f[0] == 0.0 &&
        clear_value->f[1] == 0.0 &&
        clear_value->f[2] == 0.0 &&
        clear_value->f[3] == 0.0) {
@@ -323,7 +494,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
    if (tc->depth_stencil) {
       clear_tile(tc->tile, pt->resource->format, tc->clear_val);
    } else {
-      clear_tile_rgba(tc->tile, pt->resource->format, &tc->clear_color);
+      clear_tile_rgba(tc, tc->tile, pt->resource->format, &tc->clear_color);
    }
 
    /* push the tile to all positions marked as clear */
@@ -333,7 +504,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 
          if (is_clear_flag_set(tc->clear_flags, addr)) {
             /* write the scratch tile to the surface */
-            if (tc->depth_stencil) {
+            if (tc->depth_stencil || tc->native) {
                pipe_put_tile_raw(pt, tc->transfer_map,
                                  x, y, TILE_SIZE, TILE_SIZE,
                                  tc->tile->data.any, 0/*STRIDE*/);
@@ -368,41 +539,87 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 #endif
 }
 
+/**
+ * Write a cached tile back to the surface.
+ */
+static void
+store_tile(struct softpipe_tile_cache *tc,
+           struct softpipe_cached_tile *tile,
+           union tile_address addr)
+{
+   struct pipe_transfer *pt = tc->transfer;
+   const uint x = addr.bits.x * TILE_SIZE;
+   const uint y = addr.bits.y * TILE_SIZE;
+
+   if (tc->depth_stencil || tc->native) {
+      pipe_put_tile_raw(pt, tc->transfer_map,
+                        x, y, TILE_SIZE, TILE_SIZE,
+                        tile->data.any, 0/*STRIDE*/);
+   }
+   else if (util_format_is_pure_uint(tc->surface->format)) {
+      pipe_put_tile_ui_format(pt, tc->transfer_map,
+                              x, y, TILE_SIZE, TILE_SIZE,
+                              tc->surface->format,
+                              (unsigned *) tile->data.colorui128);
+   }
+   else if (util_format_is_pure_sint(tc->surface->format)) {
+      pipe_put_tile_i_format(pt, tc->transfer_map,
+                             x, y, TILE_SIZE, TILE_SIZE,
+                             tc->surface->format,
+                             (int *) tile->data.colori128);
+   }
+   else {
+      pipe_put_tile_rgba_format(pt, tc->transfer_map,
+                                x, y, TILE_SIZE, TILE_SIZE,
+                                tc->surface->format,
+                                (float *) tile->data.color);
+   }
+}
+
+
+/**
+ * Read a tile from the surface into the cache.
+ */
+static void
+load_tile(struct softpipe_tile_cache *tc,
+          struct softpipe_cached_tile *tile,
+          union tile_address addr)
+{
+   struct pipe_transfer *pt = tc->transfer;
+   const uint x = addr.bits.x * TILE_SIZE;
+   const uint y = addr.bits.y * TILE_SIZE;
+
+   if (tc->depth_stencil || tc->native) {
+      pipe_get_tile_raw(pt, tc->transfer_map,
+                        x, y, TILE_SIZE, TILE_SIZE,
+                        tile->data.any, 0/*STRIDE*/);
+   }
+   else if (util_format_is_pure_uint(tc->surface->format)) {
+      pipe_get_tile_ui_format(pt, tc->transfer_map,
+                              x, y, TILE_SIZE, TILE_SIZE,
+                              tc->surface->format,
+                              (unsigned *) tile->data.colorui128);
+   }
+   else if (util_format_is_pure_sint(tc->surface->format)) {
+      pipe_get_tile_i_format(pt, tc->transfer_map,
+                             x, y, TILE_SIZE, TILE_SIZE,
+                             tc->surface->format,
+                             (int *) tile->data.colori128);
+   }
+   else {
+      pipe_get_tile_rgba_format(pt, tc->transfer_map,
+                                x, y, TILE_SIZE, TILE_SIZE,
+                                tc->surface->format,
+                                (float *) tile->data.color);
+   }
+}
+
+
 static void
 sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 {
    if (!tc->tile_addrs[pos].bits.invalid) {
-      if (tc->depth_stencil) {
-         pipe_put_tile_raw(tc->transfer, tc->transfer_map,
-                           tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                           tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                           TILE_SIZE, TILE_SIZE,
-                           tc->entries[pos]->data.depth32, 0/*STRIDE*/);
-      }
-      else {
-         if (util_format_is_pure_uint(tc->surface->format)) {
-            pipe_put_tile_ui_format(tc->transfer, tc->transfer_map,
-                                    tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                    tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                    TILE_SIZE, TILE_SIZE,
-                                    tc->surface->format,
-                                    (unsigned *) tc->entries[pos]->data.colorui128);
-         } else if (util_format_is_pure_sint(tc->surface->format)) {
-            pipe_put_tile_i_format(tc->transfer, tc->transfer_map,
-                                   tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                   tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                   TILE_SIZE, TILE_SIZE,
-                                   tc->surface->format,
-                                   (int *) tc->entries[pos]->data.colori128);
-         } else {
-            pipe_put_tile_rgba_format(tc->transfer, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (float *) tc->entries[pos]->data.color);
-         }
-      }
+      store_tile(tc, tc->entries[pos], tc->tile_addrs[pos]);
       tc->tile_addrs[pos].bits.invalid = 1;  /* mark as empty */
    }
 }
@@ -415,11 +632,11 @@ void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 {
    struct pipe_transfer *pt = tc->transfer;
-   int inuse = 0, pos;
+   uint inuse = 0, pos;
 
    if (pt) {
       /* caching a drawing transfer */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
+      for (pos = 0; pos < tc->num_entries; pos++) {
          struct softpipe_cached_tile *tile = tc->entries[pos];
          if (!tile)
          {
@@ -438,14 +655,14 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
    }
 
 #if 0
-   debug_printf("flushed tiles in use: %d\n", inuse);
+   debug_printf("flushed tiles in use: %u\n", inuse);
 #endif
 }
 
 static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc)
 {
-   struct softpipe_cached_tile * tile = MALLOC_STRUCT(softpipe_cached_tile);
+   struct softpipe_cached_tile * tile = MALLOC(tc->tile_size);
    if (!tile)
    {
       /* in this case, steal an existing tile */
@@ -485,8 +702,7 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 {
    struct pipe_transfer *pt = tc->transfer;
    /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y);
+   const unsigned pos = sp_tile_cache_pos(tc, addr);
    struct softpipe_cached_tile *tile = tc->entries[pos];
 
    if (!tile) {
@@ -499,37 +715,7 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       assert(pt->resource);
       if (tc->tile_addrs[pos].bits.invalid == 0) {
          /* put dirty tile back in framebuffer */
-         if (tc->depth_stencil) {
-            pipe_put_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_put_tile_ui_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_put_tile_i_format(pt, tc->transfer_map,
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (int *) tile->data.colori128);
-            } else {
-               pipe_put_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         store_tile(tc, tile, tc->tile_addrs[pos]);
       }
 
       tc->tile_addrs[pos] = addr;
@@ -540,44 +726,19 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
             clear_tile(tile, pt->resource->format, tc->clear_val);
          }
          else {
-            clear_tile_rgba(tile, pt->resource->format, &tc->clear_color);
+            clear_tile_rgba(tc, tile, pt->resource->format, &tc->clear_color);
          }
          clear_clear_flag(tc->clear_flags, addr);
       }
       else {
          /* get new tile data from transfer */
-         if (tc->depth_stencil) {
-            pipe_get_tile_raw(pt, tc->transfer_map,
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_get_tile_ui_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_get_tile_i_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (int *) tile->data.colori128);
-            } else {
-               pipe_get_tile_rgba_format(pt, tc->transfer_map,
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         load_tile(tc, tile, addr);
       }
+
+      tc->misses++;
+   }
+   else {
+      tc->hits++;
    }
 
    tc->last_tile = tile;
@@ -602,6 +763,8 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
    uint pos;
 
    tc->clear_color = *color;
+   if (tc->quantize)
+      sp_tile_cache_quantize(tc, &tc->clear_color.f, 1);
 
    tc->clear_val = clearValue;
 
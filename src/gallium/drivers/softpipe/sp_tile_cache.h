@@ -75,7 +75,11 @@ struct softpipe_cached_tile
    } data;
 };
 
-#define NUM_ENTRIES 50
+/**
+ * Max number of tiles in the cache.  Surfaces with up to this many tiles
+ * get a cache slot per tile, bigger ones are direct mapped.
+ */
+#define MAX_CACHE_ENTRIES 1024
 
 
 struct softpipe_tile_cache
@@ -85,8 +89,33 @@ struct softpipe_tile_cache
    struct pipe_transfer *transfer;
    void *transfer_map;
 
-   union tile_address tile_addrs[NUM_ENTRIES];
-   struct softpipe_cached_tile *entries[NUM_ENTRIES];
+   unsigned num_entries;  /**< cache slots in use for this surface */
+   unsigned tiles_x;      /**< surface width in tiles */
+   unsigned tile_size;    /**< bytes allocated for each cached tile */
+
+   /**
+    * Tiles of 8-bit unorm RGBA-like color formats are kept in the
+    * surface's format (in data.color32) instead of as floats.  The shift
+    * of the byte holding each of R, G, B, A, or -1 if that component isn't
+    * stored, in which case it reads as native_fill.
+    */
+   boolean native;
+   int native_shift[4];
+   float native_fill[4];
+
+   /**
+    * Float color tiles of formats which can't hold any float are rounded
+    * to the surface's format whenever pixels are written, so they don't
+    * change when written back and loaded again.  Otherwise the results
+    * would depend on when tiles get evicted.  That doesn't work for the
+    * few formats whose rounded values may change when rounded again, for
+    * which 'stable' is false.
+    */
+   boolean quantize;
+   boolean stable;
+
+   union tile_address tile_addrs[MAX_CACHE_ENTRIES];
+   struct softpipe_cached_tile *entries[MAX_CACHE_ENTRIES];
    uint clear_flags[(MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE) / 32];
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
@@ -96,6 +125,13 @@ struct softpipe_tile_cache
 
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   /**
+    * Lookups which found/didn't find the tile in the cache, for the HUD.
+    * Those of the last tile aren't counted.
+    */
+   uint64_t hits;
+   uint64_t misses;
 };
 
 
@@ -120,6 +156,10 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
                     const union pipe_color_union *color,
                     uint64_t clearValue);
 
+extern void
+sp_tile_cache_quantize(const struct softpipe_tile_cache *tc,
+                       float (*rgba)[4], unsigned count);
+
 extern struct softpipe_cached_tile *
 sp_find_cached_tile(struct softpipe_tile_cache *tc, 
                     union tile_address addr );
@@ -138,6 +178,18 @@ tile_address( unsigned x,
    return addr;
 }
 
+/**
+ * Return the position in the cache for the tile at the given address.
+ */
+static INLINE unsigned
+sp_tile_cache_pos(const struct softpipe_tile_cache *tc,
+                  union tile_address addr)
+{
+   const unsigned pos = addr.bits.x + addr.bits.y * tc->tiles_x;
+
+   return pos < tc->num_entries ? pos : pos % tc->num_entries;
+}
+
 /* Quickly retrieve tile if it matches last lookup.
  */
 static INLINE struct softpipe_cached_tile *
@@ -25,7 +25,9 @@
  *
  **************************************************************************/
 
+#include "util/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
 
@@ -66,6 +68,32 @@ trace_query_unwrap(struct pipe_query *query)
 }
 
 
+struct trace_vertex_elements
+{
+   void *state;
+
+   unsigned num_elements;
+   struct pipe_vertex_element elements[PIPE_MAX_ATTRIBS];
+};
+
+
+static INLINE struct trace_vertex_elements *
+trace_vertex_elements(void *state) {
+   return (struct trace_vertex_elements *)state;
+}
+
+
+static INLINE void *
+trace_vertex_elements_unwrap(void *state)
+{
+   if (state) {
+      return trace_vertex_elements(state)->state;
+   } else {
+      return NULL;
+   }
+}
+
+
 static INLINE struct pipe_resource *
 trace_resource_unwrap(struct trace_context *tr_ctx,
                      struct pipe_resource *resource)
@@ -105,18 +133,124 @@ trace_surface_unwrap(struct trace_context *tr_ctx,
 }
 
 
+/**
+ * Dump the range of each user vertex buffer the draw reads, as a
+ * "user_buffers" array of offsets and bytes, one element per slot, null
+ * for the slots it doesn't read.  Nothing is dumped if a range isn't
+ * known, because the index bounds aren't.
+ */
+static void
+dump_user_vertex_buffers(struct trace_context *tr_ctx,
+                         const struct pipe_draw_info *info)
+{
+   const struct trace_vertex_elements *velems = tr_ctx->velems;
+   unsigned begin[PIPE_MAX_ATTRIBS];
+   unsigned end[PIPE_MAX_ATTRIBS];
+   unsigned num = 0;
+   unsigned i;
+
+   if (!velems)
+      return;
+
+   for (i = 0; i < PIPE_MAX_ATTRIBS; i++) {
+      begin[i] = ~0u;
+      end[i] = 0;
+      if (tr_ctx->vertex_buffers[i].user_buffer)
+         num = i + 1;
+   }
+
+   if (!num)
+      return;
+
+   for (i = 0; i < velems->num_elements; i++) {
+      const struct pipe_vertex_element *ve = &velems->elements[i];
+      unsigned index = ve->vertex_buffer_index;
+      const struct pipe_vertex_buffer *vb = &tr_ctx->vertex_buffers[index];
+      unsigned first, last;
+
+      if (!vb->user_buffer)
+         continue;
+
+      if (ve->instance_divisor) {
+         if (!info->instance_count)
+            continue;
+         first = info->start_instance;
+         last = first + (info->instance_count - 1) / ve->instance_divisor;
+      } else if (info->count_from_stream_output) {
+         return;
+      } else if (info->indexed) {
+         if (info->max_index == ~0u || info->max_index < info->min_index)
+            return;
+         first = info->min_index + info->index_bias;
+         last = info->max_index + info->index_bias;
+      } else {
+         if (!info->count)
+            continue;
+         first = info->start;
+         last = info->start + info->count - 1;
+      }
+
+      begin[index] = MIN2(begin[index], vb->buffer_offset +
+                          first * vb->stride + ve->src_offset);
+      end[index] = MAX2(end[index], vb->buffer_offset +
+                        last * vb->stride + ve->src_offset +
+                        util_format_get_blocksize(ve->src_format));
+   }
+
+   trace_dump_arg_begin("user_buffers");
+   trace_dump_array_begin();
+   for (i = 0; i < num; i++) {
+      trace_dump_elem_begin();
+      if (begin[i] < end[i]) {
+         const uint8_t *data = tr_ctx->vertex_buffers[i].user_buffer;
+
+         trace_dump_struct_begin("user_buffer");
+         trace_dump_member_begin("offset");
+         trace_dump_uint(begin[i]);
+         trace_dump_member_end();
+         trace_dump_member_begin("data");
+         trace_dump_bytes(data + begin[i], end[i] - begin[i]);
+         trace_dump_member_end();
+         trace_dump_struct_end();
+      } else {
+         trace_dump_null();
+      }
+      trace_dump_elem_end();
+   }
+   trace_dump_array_end();
+   trace_dump_arg_end();
+}
+
+
 static INLINE void
 trace_context_draw_vbo(struct pipe_context *_pipe,
                        const struct pipe_draw_info *info)
 {
    struct trace_context *tr_ctx = trace_context(_pipe);
    struct pipe_context *pipe = tr_ctx->pipe;
+   const struct pipe_index_buffer *ib = &tr_ctx->index_buffer;
 
    trace_dump_call_begin("pipe_context", "draw_vbo");
 
    trace_dump_arg(ptr,  pipe);
    trace_dump_arg(draw_info, info);
 
+   /*
+    * User arrays are only dumped to binary traces, for replay.  XML traces
+    * skip texture contents too.
+    */
+   if (trace_dump_trace_binary())
+      dump_user_vertex_buffers(tr_ctx, info);
+
+   if (info->indexed && ib->user_buffer && trace_dump_trace_binary()) {
+      const uint8_t *indices = ib->user_buffer;
+
+      trace_dump_arg_begin("user_indices");
+      trace_dump_bytes(indices + ib->offset + info->start * ib->index_size,
+                       info->count * ib->index_size);
+      trace_dump_arg_end();
+   }
+
    trace_dump_trace_flush();
 
    pipe->draw_vbo(pipe, info);
@@ -577,6 +711,22 @@ trace_context_create_vertex_elements_state(struct pipe_context *_pipe,
 
    trace_dump_call_end();
 
+   /* Wrap it, to know the elements when it's bound. */
+   if (result) {
+      struct trace_vertex_elements *tr_velems =
+         CALLOC_STRUCT(trace_vertex_elements);
+      if (tr_velems) {
+         tr_velems->state = result;
+         tr_velems->num_elements = MIN2(num_elements, PIPE_MAX_ATTRIBS);
+         memcpy(tr_velems->elements, elements,
+                tr_velems->num_elements * sizeof *elements);
+         result = tr_velems;
+      } else {
+         pipe->delete_vertex_elements_state(pipe, result);
+         result = NULL;
+      }
+   }
+
    return result;
 }
 
@@ -588,6 +738,9 @@ trace_context_bind_vertex_elements_state(struct pipe_context *_pipe,
    struct trace_context *tr_ctx = trace_context(_pipe);
    struct pipe_context *pipe = tr_ctx->pipe;
 
+   tr_ctx->velems = trace_vertex_elements(state);
+   state = trace_vertex_elements_unwrap(state);
+
    trace_dump_call_begin("pipe_context", "bind_vertex_elements_state");
 
    trace_dump_arg(ptr, pipe);
@@ -605,6 +758,11 @@ trace_context_delete_vertex_elements_state(struct pipe_context *_pipe,
 {
    struct trace_context *tr_ctx = trace_context(_pipe);
    struct pipe_context *pipe = tr_ctx->pipe;
+   struct trace_vertex_elements *tr_velems = trace_vertex_elements(state);
+
+   if (tr_ctx->velems == tr_velems)
+      tr_ctx->velems = NULL;
+   state = trace_vertex_elements_unwrap(state);
 
    trace_dump_call_begin("pipe_context", "delete_vertex_elements_state");
 
@@ -614,6 +772,8 @@ trace_context_delete_vertex_elements_state(struct pipe_context *_pipe,
    pipe->delete_vertex_elements_state(pipe, state);
 
    trace_dump_call_end();
+
+   FREE(tr_velems);
 }
 
 
@@ -987,6 +1147,14 @@ trace_context_set_vertex_buffers(struct pipe_context *_pipe,
    trace_dump_struct_array(vertex_buffer, buffers, num_buffers);
    trace_dump_arg_end();
 
+   for (i = 0; i < num_buffers && start_slot + i < PIPE_MAX_ATTRIBS; i++) {
+      if (buffers)
+         tr_ctx->vertex_buffers[start_slot + i] = buffers[i];
+      else
+         memset(&tr_ctx->vertex_buffers[start_slot + i], 0,
+                sizeof tr_ctx->vertex_buffers[0]);
+   }
+
    if (buffers) {
       struct pipe_vertex_buffer *_buffers = MALLOC(num_buffers * sizeof(*_buffers));
       memcpy(_buffers, buffers, num_buffers * sizeof(*_buffers));
@@ -1014,6 +1182,11 @@ trace_context_set_index_buffer(struct pipe_context *_pipe,
    trace_dump_arg(ptr, pipe);
    trace_dump_arg(index_buffer, ib);
 
+   if (ib)
+      tr_ctx->index_buffer = *ib;
+   else
+      memset(&tr_ctx->index_buffer, 0, sizeof tr_ctx->index_buffer);
+
    if (ib) {
       struct pipe_index_buffer _ib;
       _ib = *ib;
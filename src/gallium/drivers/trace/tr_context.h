@@ -32,6 +32,7 @@
 #include "pipe/p_compiler.h"
 #include "util/u_debug.h"
 #include "pipe/p_context.h"
+#include "pipe/p_state.h"
 
 #include "tr_screen.h"
 
@@ -42,11 +43,18 @@ extern "C" {
 
 struct trace_screen;
    
+struct trace_vertex_elements;
+
 struct trace_context
 {
    struct pipe_context base;
 
    struct pipe_context *pipe;
+
+   /* Bound state, to dump the user memory draws read */
+   struct pipe_vertex_buffer vertex_buffers[PIPE_MAX_ATTRIBS];
+   struct pipe_index_buffer index_buffer;
+   struct trace_vertex_elements *velems;
 };
 
 
@@ -30,10 +30,11 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect.  Setting
+ * GALLIUM_TRACE_FORMAT=binary switches to the compact representation from
+ * tr_dump_bin.c, optionally LZ4 compressed with GALLIUM_TRACE_COMPRESS=lz4,
+ * for tracing applications where the XML is too slow or too big.
  *
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -53,6 +54,7 @@
 #include "util/u_format.h"
 
 #include "tr_dump.h"
+#include "tr_dump_bin.h"
 #include "tr_screen.h"
 #include "tr_texture.h"
 
@@ -62,6 +64,7 @@ static FILE *stream = NULL;
 pipe_static_mutex(call_mutex);
 static long unsigned call_no = 0;
 static boolean dumping = FALSE;
+static boolean binary = FALSE;
 
 
 static INLINE void
@@ -218,7 +221,8 @@ trace_dump_tag_end(const char *name)
 void
 trace_dump_trace_flush(void)
 {
-   if(stream) {
+   /* the binary writer thread flushes every chunk it writes */
+   if(stream && !binary) {
       fflush(stream);
    }
 }
@@ -226,6 +230,15 @@ trace_dump_trace_flush(void)
 static void
 trace_dump_trace_close(void)
 {
+   if (binary) {
+      trace_bin_end();
+      binary = FALSE;
+      close_stream = FALSE;
+      stream = NULL;
+      call_no = 0;
+      return;
+   }
+
    if(stream) {
       trace_dump_writes("</trace>\n");
       if (close_stream) {
@@ -255,12 +268,15 @@ boolean
 trace_dump_trace_begin(void)
 {
    const char *filename;
+   const char *format;
 
    filename = debug_get_option("GALLIUM_TRACE", NULL);
    if(!filename)
       return FALSE;
 
    if(!stream) {
+      format = debug_get_option("GALLIUM_TRACE_FORMAT", "xml");
+      binary = strcmp(format, "binary") == 0;
 
       if (strcmp(filename, "stderr") == 0) {
          close_stream = FALSE;
@@ -272,11 +288,32 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = TRUE;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, binary ? "wb" : "wt");
          if (!stream)
             return FALSE;
       }
 
+      if (binary) {
+         const char *compress = debug_get_option("GALLIUM_TRACE_COMPRESS",
+                                                 "none");
+
+         if (!trace_bin_begin(stream,
+                              close_stream,
+                              strcmp(compress, "lz4") == 0 ?
+                              TRACE_BIN_COMPRESS_LZ4 :
+                              TRACE_BIN_COMPRESS_NONE)) {
+            if (close_stream)
+               fclose(stream);
+            close_stream = FALSE;
+            stream = NULL;
+            binary = FALSE;
+            return FALSE;
+         }
+
+         atexit(trace_dump_trace_close);
+         return TRUE;
+      }
+
       trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
       trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
       trace_dump_writes("<trace version='0.1'>\n");
@@ -296,6 +333,11 @@ boolean trace_dump_trace_enabled(void)
    return stream ? TRUE : FALSE;
 }
 
+boolean trace_dump_trace_binary(void)
+{
+   return binary;
+}
+
 /*
  * Call lock
  */
@@ -364,6 +406,13 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      trace_bin_call_begin(call_no, klass, method);
+      call_start_time = os_time_get();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -386,6 +435,11 @@ void trace_dump_call_end_locked(void)
 
    call_end_time = os_time_get();
 
+   if (binary) {
+      trace_bin_call_end(call_end_time - call_start_time);
+      return;
+   }
+
    trace_dump_call_time(call_end_time - call_start_time);
    trace_dump_indent(1);
    trace_dump_tag_end("call");
@@ -410,6 +464,11 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token_string(TRACE_BIN_ARG_BEGIN, name);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
@@ -419,6 +478,11 @@ void trace_dump_arg_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_ARG_END);
+      return;
+   }
+
    trace_dump_tag_end("arg");
    trace_dump_newline();
 }
@@ -428,6 +492,11 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_RET_BEGIN);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
@@ -437,6 +506,11 @@ void trace_dump_ret_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_RET_END);
+      return;
+   }
+
    trace_dump_tag_end("ret");
    trace_dump_newline();
 }
@@ -446,6 +520,11 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_bool(value);
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -454,6 +533,11 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_int(value);
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -462,6 +546,11 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_uint(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -470,6 +559,11 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_float(value);
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -483,6 +577,11 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_bytes(data, size);
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -500,23 +599,22 @@ void trace_dump_box_bytes(const void *data,
 			  unsigned stride,
 			  unsigned slice_stride)
 {
+   enum pipe_format format = resource->format;
    size_t size;
 
    /*
-    * Only dump buffer transfers to avoid huge files.
-    * TODO: Make this run-time configurable
+    * Only dump buffer transfers to XML to avoid huge files.  Binary traces
+    * store each content once, so textures are dumped there too, for replay.
     */
-   if (resource->target != PIPE_BUFFER) {
+   if (resource->target != PIPE_BUFFER && !binary) {
+      size = 0;
+   } else if (box->width <= 0 || box->height <= 0 || box->depth <= 0) {
       size = 0;
    } else {
-      enum pipe_format format = resource->format;
-      if (slice_stride)
-         size = box->depth * slice_stride;
-      else if (stride)
-         size = util_format_get_nblocksy(format, box->height) * stride;
-      else {
-         size = util_format_get_nblocksx(format, box->width) * util_format_get_blocksize(format);
-      }
+      /* don't read past the last row of the last slice */
+      size = util_format_get_nblocksx(format, box->width) * util_format_get_blocksize(format);
+      size += (util_format_get_nblocksy(format, box->height) - 1) * stride;
+      size += (box->depth - 1) * slice_stride;
    }
 
    trace_dump_bytes(data, size);
@@ -527,6 +625,11 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token_string(TRACE_BIN_STRING, str);
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -537,6 +640,11 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token_string(TRACE_BIN_ENUM, value);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -547,6 +655,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_ARRAY_BEGIN);
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -555,6 +668,11 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_ARRAY_END);
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
@@ -563,6 +681,11 @@ void trace_dump_elem_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_ELEM_BEGIN);
+      return;
+   }
+
    trace_dump_writes("<elem>");
 }
 
@@ -571,6 +694,11 @@ void trace_dump_elem_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_ELEM_END);
+      return;
+   }
+
    trace_dump_writes("</elem>");
 }
 
@@ -579,6 +707,11 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token_string(TRACE_BIN_STRUCT_BEGIN, name);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -587,6 +720,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_STRUCT_END);
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -595,6 +733,11 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token_string(TRACE_BIN_MEMBER_BEGIN, name);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
@@ -603,6 +746,11 @@ void trace_dump_member_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_MEMBER_END);
+      return;
+   }
+
    trace_dump_writes("</member>");
 }
 
@@ -611,6 +759,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_token(TRACE_BIN_NULL);
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -619,7 +772,9 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
-   if(value)
+   if(value && binary)
+      trace_bin_ptr(value);
+   else if(value)
       trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
    else
       trace_dump_null();
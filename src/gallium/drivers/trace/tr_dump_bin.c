@@ -0,0 +1,672 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace writer.
+ *
+ * The calls are encoded into a ring of chunks, which a thread compresses
+ * and writes out, so that the traced application only pays for the
+ * encoding.  If the thread can't be created the chunks are written as
+ * they fill up instead.  See tr_dump_bin.h for the format.
+ */
+
+#include "pipe/p_config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "tr_dump_bin.h"
+
+
+#define CHUNK_SIZE (1024 * 1024)
+
+/** Chunks in the ring, including the one being encoded into */
+#define NUM_CHUNKS 4
+
+/** Bytes of blob contents kept around to find repeated ones */
+#define BLOB_CACHE_SIZE (64 * 1024 * 1024)
+
+/** Worst case size of a chunk compressed with LZ4 */
+#define PACKED_SIZE (CHUNK_SIZE + CHUNK_SIZE / 255 + 16)
+
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 65535
+/** The last match must start this many bytes before the end */
+#define LZ4_MATCH_LIMIT 12
+/** And the last literals are at least this many bytes long */
+#define LZ4_LAST_LITERALS 5
+
+
+struct blob_entry {
+   uint64_t hash;
+   size_t size;
+   void *data;
+   unsigned id;
+};
+
+
+static struct {
+   FILE *stream;
+   boolean close_stream;
+   enum trace_bin_compress compress;
+
+   /** Zero if the chunks are written synchronously */
+   pipe_thread thread;
+   pipe_mutex mutex;
+   pipe_condvar cond;
+   boolean quit;
+
+   uint8_t *chunk[NUM_CHUNKS];
+   /** LZ4 block of the chunk being written */
+   uint8_t *packed;
+   unsigned chunk_size[NUM_CHUNKS];
+   /** Chunks queued so far, and written so far */
+   unsigned head, tail;
+
+   /** The chunk being encoded into, chunk[head % NUM_CHUNKS] */
+   uint8_t *cur;
+   unsigned used;
+
+   /** Open addressing hash table of the blobs written */
+   struct blob_entry *blobs;
+   unsigned blob_table_size;
+   unsigned num_blobs;
+   /** Bytes of blob contents in the table */
+   size_t blob_cache_used;
+} bin;
+
+
+/*
+ * LZ4 block compression.
+ */
+
+static INLINE uint32_t
+read32(const uint8_t *p)
+{
+   uint32_t v;
+   memcpy(&v, p, sizeof v);
+   return v;
+}
+
+
+static INLINE unsigned
+lz4_hash(uint32_t seq)
+{
+   return (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+
+static INLINE uint8_t *
+lz4_write_length(uint8_t *op, unsigned len)
+{
+   while (len >= 255) {
+      *op++ = 255;
+      len -= 255;
+   }
+   *op++ = (uint8_t) len;
+   return op;
+}
+
+
+static uint8_t *
+lz4_write_sequence(uint8_t *op,
+                   const uint8_t *literals, unsigned num_literals,
+                   unsigned offset, unsigned match_len)
+{
+   uint8_t *token = op++;
+
+   *token = MIN2(num_literals, 15) << 4;
+   if (num_literals >= 15)
+      op = lz4_write_length(op, num_literals - 15);
+   memcpy(op, literals, num_literals);
+   op += num_literals;
+
+   if (match_len) {
+      match_len -= LZ4_MIN_MATCH;
+      *op++ = offset & 0xff;
+      *op++ = offset >> 8;
+      *token |= MIN2(match_len, 15);
+      if (match_len >= 15)
+         op = lz4_write_length(op, match_len - 15);
+   }
+
+   return op;
+}
+
+
+/**
+ * Greedy LZ4 compression.
+ * \return the size of the block, which may be bigger than the input
+ */
+static unsigned
+lz4_compress(const uint8_t *src, unsigned size, uint8_t *dst)
+{
+   unsigned table[1 << LZ4_HASH_BITS];
+   unsigned ip = 0, anchor = 0;
+   uint8_t *op = dst;
+
+   if (size > LZ4_MATCH_LIMIT) {
+      const unsigned match_limit = size - LZ4_MATCH_LIMIT;
+      const unsigned end_limit = size - LZ4_LAST_LITERALS;
+
+      /* positions plus one, zero meaning none */
+      memset(table, 0, sizeof table);
+
+      while (ip < match_limit) {
+         const uint32_t seq = read32(src + ip);
+         const unsigned h = lz4_hash(seq);
+         const unsigned ref = table[h];
+         unsigned len;
+
+         table[h] = ip + 1;
+
+         if (!ref || ip - (ref - 1) > LZ4_MAX_OFFSET ||
+             read32(src + ref - 1) != seq) {
+            ip++;
+            continue;
+         }
+
+         len = LZ4_MIN_MATCH;
+         while (ip + len < end_limit && src[ref - 1 + len] == src[ip + len])
+            len++;
+
+         op = lz4_write_sequence(op, src + anchor, ip - anchor,
+                                 ip - (ref - 1), len);
+         ip += len;
+         anchor = ip;
+      }
+   }
+
+   op = lz4_write_sequence(op, src + anchor, size - anchor, 0, 0);
+
+   return op - dst;
+}
+
+
+/*
+ * Writer thread.
+ */
+
+static INLINE void
+write32(FILE *stream, uint32_t value)
+{
+   uint8_t buf[4];
+
+   buf[0] = value;
+   buf[1] = value >> 8;
+   buf[2] = value >> 16;
+   buf[3] = value >> 24;
+   fwrite(buf, sizeof buf, 1, stream);
+}
+
+
+static void
+write_chunk(const uint8_t *data, unsigned size, uint8_t *packed)
+{
+   if (bin.compress == TRACE_BIN_COMPRESS_LZ4) {
+      unsigned packed_size = lz4_compress(data, size, packed);
+
+      write32(bin.stream, size);
+      if (packed_size < size) {
+         write32(bin.stream, packed_size);
+         fwrite(packed, packed_size, 1, bin.stream);
+      }
+      else {
+         write32(bin.stream, 0);
+         fwrite(data, size, 1, bin.stream);
+      }
+   }
+   else {
+      fwrite(data, size, 1, bin.stream);
+   }
+
+   fflush(bin.stream);
+}
+
+
+static PIPE_THREAD_ROUTINE(writer_thread, param)
+{
+   pipe_mutex_lock(bin.mutex);
+   for (;;) {
+      unsigned index;
+
+      while (bin.tail == bin.head && !bin.quit)
+         pipe_condvar_wait(bin.cond, bin.mutex);
+      if (bin.tail == bin.head)
+         break;
+
+      index = bin.tail % NUM_CHUNKS;
+      pipe_mutex_unlock(bin.mutex);
+
+      write_chunk(bin.chunk[index], bin.chunk_size[index], bin.packed);
+
+      pipe_mutex_lock(bin.mutex);
+      bin.tail++;
+      pipe_condvar_broadcast(bin.cond);
+   }
+   pipe_mutex_unlock(bin.mutex);
+
+   return 0;
+}
+
+
+/**
+ * Queue the current chunk and take the next one, waiting for the writer if
+ * all are queued.
+ */
+static void
+submit_chunk(void)
+{
+   if (!bin.thread) {
+      write_chunk(bin.cur, bin.used, bin.packed);
+      bin.used = 0;
+      return;
+   }
+
+   pipe_mutex_lock(bin.mutex);
+   bin.chunk_size[bin.head % NUM_CHUNKS] = bin.used;
+   bin.head++;
+   pipe_condvar_broadcast(bin.cond);
+   while (bin.head - bin.tail >= NUM_CHUNKS)
+      pipe_condvar_wait(bin.cond, bin.mutex);
+   pipe_mutex_unlock(bin.mutex);
+
+   bin.cur = bin.chunk[bin.head % NUM_CHUNKS];
+   bin.used = 0;
+}
+
+
+static void
+write_bytes(const void *data, size_t size)
+{
+   const uint8_t *p = data;
+
+   while (size) {
+      size_t n = MIN2(size, CHUNK_SIZE - bin.used);
+
+      memcpy(bin.cur + bin.used, p, n);
+      bin.used += n;
+      p += n;
+      size -= n;
+
+      if (bin.used == CHUNK_SIZE)
+         submit_chunk();
+   }
+}
+
+
+/*
+ * Encoding.
+ */
+
+static INLINE void
+write_byte(uint8_t value)
+{
+   if (bin.used == CHUNK_SIZE)
+      submit_chunk();
+   bin.cur[bin.used++] = value;
+}
+
+
+static INLINE void
+write_unsigned(uint64_t value)
+{
+   while (value >= 0x80) {
+      write_byte((uint8_t) (value | 0x80));
+      value >>= 7;
+   }
+   write_byte((uint8_t) value);
+}
+
+
+static INLINE void
+write_signed(int64_t value)
+{
+   write_unsigned(((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+
+static INLINE void
+write_string(const char *str)
+{
+   size_t len = strlen(str);
+
+   write_unsigned(len);
+   write_bytes(str, len);
+}
+
+
+static uint64_t
+hash_bytes(const void *data, size_t size)
+{
+   const uint8_t *p = data;
+   uint64_t h = 0xcbf29ce484222325ULL ^ size;
+
+   while (size >= 8) {
+      uint64_t k;
+      memcpy(&k, p, sizeof k);
+      k *= 0x87c37b91114253d5ULL;
+      k ^= k >> 31;
+      h = (h ^ k) * 0x4cf5ad432745937fULL;
+      p += 8;
+      size -= 8;
+   }
+   while (size--)
+      h = (h ^ *p++) * 0x100000001b3ULL;
+
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   return h;
+}
+
+
+/**
+ * Look up a blob by contents.
+ * \return its entry, or the empty slot to store it in
+ */
+static struct blob_entry *
+find_blob(uint64_t hash, const void *data, size_t size)
+{
+   unsigned mask = bin.blob_table_size - 1;
+   unsigned i = (unsigned) hash & mask;
+
+   /* the size is stored plus one, so that empty slots are zero */
+   while (bin.blobs[i].size) {
+      if (bin.blobs[i].hash == hash && bin.blobs[i].size == size + 1 &&
+          (!size || memcmp(bin.blobs[i].data, data, size) == 0))
+         break;
+      i = (i + 1) & mask;
+   }
+
+   return &bin.blobs[i];
+}
+
+
+static struct blob_entry *
+find_empty_slot(uint64_t hash)
+{
+   unsigned mask = bin.blob_table_size - 1;
+   unsigned i = (unsigned) hash & mask;
+
+   while (bin.blobs[i].size)
+      i = (i + 1) & mask;
+
+   return &bin.blobs[i];
+}
+
+
+static boolean
+grow_blob_table(void)
+{
+   struct blob_entry *old = bin.blobs;
+   unsigned old_size = bin.blob_table_size;
+   struct blob_entry *blobs;
+   unsigned i;
+
+   blobs = CALLOC(old_size * 2, sizeof *blobs);
+   if (!blobs)
+      return FALSE;
+
+   bin.blobs = blobs;
+   bin.blob_table_size = old_size * 2;
+   for (i = 0; i < old_size; i++) {
+      if (old[i].size)
+         *find_empty_slot(old[i].hash) = old[i];
+   }
+
+   FREE(old);
+   return TRUE;
+}
+
+
+boolean
+trace_bin_begin(FILE *stream, boolean close_stream,
+                enum trace_bin_compress compress)
+{
+   unsigned i;
+
+   memset(&bin, 0, sizeof bin);
+   bin.stream = stream;
+   bin.close_stream = close_stream;
+   bin.compress = compress;
+
+   for (i = 0; i < NUM_CHUNKS; i++) {
+      bin.chunk[i] = MALLOC(CHUNK_SIZE);
+      if (!bin.chunk[i])
+         goto fail;
+   }
+
+   bin.blob_table_size = 256;
+   bin.blobs = CALLOC(bin.blob_table_size, sizeof *bin.blobs);
+   if (!bin.blobs)
+      goto fail;
+
+   if (compress != TRACE_BIN_COMPRESS_NONE) {
+      bin.packed = MALLOC(PACKED_SIZE);
+      if (!bin.packed)
+         goto fail;
+   }
+
+   bin.cur = bin.chunk[0];
+
+   /* the header isn't compressed */
+   fwrite("GTRACE", 6, 1, stream);
+   fputc(TRACE_BIN_VERSION, stream);
+   fputc(compress, stream);
+
+   pipe_mutex_init(bin.mutex);
+   pipe_condvar_init(bin.cond);
+   bin.thread = pipe_thread_create(writer_thread, NULL);
+   if (!bin.thread)
+      debug_printf("trace: couldn't create the writer thread, "
+                   "writing synchronously\n");
+
+   return TRUE;
+
+fail:
+   for (i = 0; i < NUM_CHUNKS; i++)
+      FREE(bin.chunk[i]);
+   FREE(bin.blobs);
+   FREE(bin.packed);
+   return FALSE;
+}
+
+
+void
+trace_bin_end(void)
+{
+   unsigned i;
+
+   if (!bin.stream)
+      return;
+
+   if (bin.used)
+      submit_chunk();
+
+   if (bin.thread) {
+      pipe_mutex_lock(bin.mutex);
+      bin.quit = TRUE;
+      pipe_condvar_broadcast(bin.cond);
+      pipe_mutex_unlock(bin.mutex);
+
+      pipe_thread_wait(bin.thread);
+   }
+
+   pipe_condvar_destroy(bin.cond);
+   pipe_mutex_destroy(bin.mutex);
+
+   for (i = 0; i < NUM_CHUNKS; i++)
+      FREE(bin.chunk[i]);
+   for (i = 0; i < bin.blob_table_size; i++)
+      FREE(bin.blobs[i].data);
+   FREE(bin.blobs);
+   FREE(bin.packed);
+
+   if (bin.close_stream)
+      fclose(bin.stream);
+   bin.stream = NULL;
+}
+
+
+void
+trace_bin_token(enum trace_bin_token token)
+{
+   write_byte(token);
+}
+
+
+void
+trace_bin_token_string(enum trace_bin_token token, const char *str)
+{
+   write_byte(token);
+   write_string(str);
+}
+
+
+void
+trace_bin_call_begin(unsigned long no, const char *klass, const char *method)
+{
+   write_byte(TRACE_BIN_CALL_BEGIN);
+   write_unsigned(no);
+   write_string(klass);
+   write_string(method);
+}
+
+
+void
+trace_bin_call_end(int64_t time)
+{
+   write_byte(TRACE_BIN_CALL_END);
+   write_signed(time);
+}
+
+
+void
+trace_bin_bool(int value)
+{
+   write_byte(TRACE_BIN_BOOL);
+   write_byte(value ? 1 : 0);
+}
+
+
+void
+trace_bin_int(long long int value)
+{
+   write_byte(TRACE_BIN_INT);
+   write_signed(value);
+}
+
+
+void
+trace_bin_uint(long long unsigned value)
+{
+   write_byte(TRACE_BIN_UINT);
+   write_unsigned(value);
+}
+
+
+void
+trace_bin_float(double value)
+{
+   union {
+      double f;
+      uint64_t u;
+   } v;
+   unsigned i;
+
+   v.f = value;
+   write_byte(TRACE_BIN_FLOAT);
+   for (i = 0; i < 8; i++)
+      write_byte((uint8_t) (v.u >> (i * 8)));
+}
+
+
+/**
+ * Resources are often uploaded with the same contents over and over, so
+ * each content is only stored once.  The contents are kept to compare
+ * against, up to BLOB_CACHE_SIZE bytes; past that new contents are
+ * always stored.
+ */
+void
+trace_bin_bytes(const void *data, size_t size)
+{
+   uint64_t hash = hash_bytes(data, size);
+   struct blob_entry *entry = find_blob(hash, data, size);
+   void *copy = NULL;
+
+   if (!entry->size) {
+      if (bin.blob_cache_used + size > BLOB_CACHE_SIZE ||
+          (size && !(copy = MALLOC(size))) ||
+          (bin.num_blobs * 2 >= bin.blob_table_size &&
+           !grow_blob_table())) {
+         /* too bad, store it as a new one */
+         FREE(copy);
+         write_byte(TRACE_BIN_BLOB);
+         write_unsigned(bin.num_blobs);
+         write_unsigned(size);
+         write_bytes(data, size);
+         write_byte(TRACE_BIN_BYTES);
+         write_unsigned(bin.num_blobs++);
+         return;
+      }
+
+      if (size)
+         memcpy(copy, data, size);
+
+      entry = find_empty_slot(hash);
+      entry->hash = hash;
+      entry->size = size + 1;
+      entry->data = copy;
+      entry->id = bin.num_blobs++;
+      bin.blob_cache_used += size;
+
+      write_byte(TRACE_BIN_BLOB);
+      write_unsigned(entry->id);
+      write_unsigned(size);
+      write_bytes(data, size);
+   }
+
+   write_byte(TRACE_BIN_BYTES);
+   write_unsigned(entry->id);
+}
+
+
+void
+trace_bin_ptr(const void *value)
+{
+   write_byte(TRACE_BIN_PTR);
+   write_unsigned((uintptr_t) value);
+}
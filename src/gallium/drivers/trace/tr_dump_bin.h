@@ -0,0 +1,115 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace encoding.
+ *
+ * A binary trace starts with the 6 bytes "GTRACE", a version byte and a
+ * compression byte (TRACE_BIN_COMPRESS_x).  Then comes a stream of tokens,
+ * each one a TRACE_BIN_x byte followed by its operands, which mirrors the
+ * nesting of the XML elements:
+ *
+ *   - unsigned numbers are LEB128 encoded, signed ones zigzag encoded first;
+ *   - strings are a length followed by the characters, without terminator;
+ *   - floats are little endian doubles.
+ *
+ * Byte arrays are stored once per content: a TRACE_BIN_BLOB token with a
+ * new id, the size and the bytes comes right before the first
+ * TRACE_BIN_BYTES token referring to the id.
+ *
+ * With LZ4 compression the token stream is cut in chunks, each one stored
+ * as its 32-bit little endian size, the 32-bit size of the LZ4 block it was
+ * compressed to, or zero if it's stored as is, and the data.
+ */
+
+#ifndef TR_DUMP_BIN_H
+#define TR_DUMP_BIN_H
+
+
+#include <stdio.h>
+
+#include "pipe/p_compiler.h"
+
+
+#define TRACE_BIN_VERSION 1
+
+enum trace_bin_compress {
+   TRACE_BIN_COMPRESS_NONE = 0,
+   TRACE_BIN_COMPRESS_LZ4 = 1
+};
+
+enum trace_bin_token {
+   TRACE_BIN_CALL_BEGIN = 1,  /**< call no, class, method */
+   TRACE_BIN_CALL_END,        /**< call time */
+   TRACE_BIN_ARG_BEGIN,       /**< name */
+   TRACE_BIN_ARG_END,
+   TRACE_BIN_RET_BEGIN,
+   TRACE_BIN_RET_END,
+   TRACE_BIN_BOOL,            /**< byte */
+   TRACE_BIN_INT,             /**< signed */
+   TRACE_BIN_UINT,            /**< unsigned */
+   TRACE_BIN_FLOAT,           /**< double */
+   TRACE_BIN_BYTES,           /**< blob id */
+   TRACE_BIN_STRING,          /**< string */
+   TRACE_BIN_ENUM,            /**< string */
+   TRACE_BIN_ARRAY_BEGIN,
+   TRACE_BIN_ARRAY_END,
+   TRACE_BIN_ELEM_BEGIN,
+   TRACE_BIN_ELEM_END,
+   TRACE_BIN_STRUCT_BEGIN,    /**< name */
+   TRACE_BIN_STRUCT_END,
+   TRACE_BIN_MEMBER_BEGIN,    /**< name */
+   TRACE_BIN_MEMBER_END,
+   TRACE_BIN_NULL,
+   TRACE_BIN_PTR,             /**< unsigned */
+   TRACE_BIN_BLOB             /**< blob id, size, bytes */
+};
+
+
+/*
+ * The stream is written by a thread of its own.  These functions aren't
+ * thread safe, the call mutex serializes them.
+ */
+boolean trace_bin_begin(FILE *stream, boolean close_stream,
+                        enum trace_bin_compress compress);
+void trace_bin_end(void);
+
+void trace_bin_token(enum trace_bin_token token);
+void trace_bin_token_string(enum trace_bin_token token, const char *str);
+void trace_bin_call_begin(unsigned long no,
+                          const char *klass, const char *method);
+void trace_bin_call_end(int64_t time);
+void trace_bin_bool(int value);
+void trace_bin_int(long long int value);
+void trace_bin_uint(long long unsigned value);
+void trace_bin_float(double value);
+void trace_bin_bytes(const void *data, size_t size);
+void trace_bin_ptr(const void *value);
+
+
+#endif /* TR_DUMP_BIN_H */
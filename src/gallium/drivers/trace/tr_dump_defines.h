@@ -50,7 +50,11 @@ trace_dump_query_type(unsigned value)
    if (!trace_dumping_enabled_locked())
       return;
 
-   trace_dump_enum(util_dump_query_type(value, FALSE));
+   /* driver queries have no name, but must be replayable */
+   if (value >= PIPE_QUERY_DRIVER_SPECIFIC)
+      trace_dump_uint(value);
+   else
+      trace_dump_enum(util_dump_query_type(value, FALSE));
 }
 
 
@@ -683,6 +683,15 @@ void trace_dump_constant_buffer(const struct pipe_constant_buffer *state)
    trace_dump_member(ptr, state, buffer);
    trace_dump_member(uint, state, buffer_offset);
    trace_dump_member(uint, state, buffer_size);
+
+   /* user constants are needed to replay the trace */
+   trace_dump_member_begin("user_buffer");
+   if (state->user_buffer)
+      trace_dump_bytes(state->user_buffer, state->buffer_size);
+   else
+      trace_dump_null();
+   trace_dump_member_end();
+
    trace_dump_struct_end();
 }
 
@@ -554,6 +554,7 @@ enum pipe_cap {
    PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT = 92,
    PIPE_CAP_FAKE_SW_MSAA = 93,
    PIPE_CAP_TEXTURE_QUERY_LOD = 94,
+   PIPE_CAP_SHARED_STATE_OBJECTS = 95,
 };
 
 #define PIPE_QUIRK_TEXTURE_BORDER_COLOR_SWIZZLE_NV50 (1 << 0)
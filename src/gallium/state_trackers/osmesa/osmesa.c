@@ -61,6 +61,7 @@
 #include "util/u_box.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_memcpy_wc.h"
 #include "util/u_memory.h"
 
 #include "postprocess/filters.h"
@@ -364,7 +365,7 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    }
 
    for (y = 0; y < res->height0; y++) {
-      memcpy(dst, src, bytes);
+      util_memcpy_from_wc(dst, src, bytes);
       dst += dst_stride;
       src += transfer->stride;
    }
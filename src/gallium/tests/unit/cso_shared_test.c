@@ -0,0 +1,549 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for cso_shared_cache.
+ *
+ * Runs CSO contexts sharing a state cache on a fake driver, which records
+ * the states bound in each of its contexts and fails if a state gets
+ * deleted while bound, or bound after being deleted.  The contexts create,
+ * bind, save and restore states from their own threads, with more states
+ * than their caches hold and a small shared cache, so that the states get
+ * evicted and trimmed meanwhile.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "os/os_thread.h"
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_memory.h"
+#include "cso_cache/cso_context.h"
+
+
+#define NUM_THREADS 4
+#define NUM_ITERATIONS 20000
+#define MAX_CONTEXTS 16
+
+/** More than the 4096 states of each type a CSO context caches */
+#define NUM_KEYS 6000
+
+#define STATE_MAGIC 0x57a7e
+
+
+enum bind_slot {
+   BIND_BLEND,
+   BIND_DSA,
+   BIND_RASTERIZER,
+   BIND_VELEMENTS,
+   BIND_FS,
+   BIND_VS,
+   BIND_COUNT
+};
+
+struct test_context {
+   struct pipe_context base;
+   void *bound[BIND_COUNT];
+   void *samplers[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
+};
+
+struct test_state {
+   unsigned magic;
+};
+
+
+pipe_static_mutex(test_mutex);
+
+static struct test_context *contexts[MAX_CONTEXTS];
+static unsigned num_contexts;
+
+/** Driver objects created and not deleted yet */
+static int live_states;
+static unsigned created_states;
+static boolean failed;
+
+
+static void
+fail(const char *message)
+{
+   printf("FAILED: %s\n", message);
+   failed = TRUE;
+}
+
+
+static void *
+create_state(struct pipe_context *pipe, const void *templ)
+{
+   struct test_state *state = MALLOC_STRUCT(test_state);
+
+   state->magic = STATE_MAGIC;
+
+   pipe_mutex_lock(test_mutex);
+   live_states++;
+   created_states++;
+   pipe_mutex_unlock(test_mutex);
+
+   return state;
+}
+
+
+static void *
+create_vertex_elements_state(struct pipe_context *pipe, unsigned count,
+                             const struct pipe_vertex_element *elements)
+{
+   return create_state(pipe, elements);
+}
+
+
+/**
+ * Check that a state is alive, with the mutex held.
+ */
+static void
+check_state(const void *data)
+{
+   const struct test_state *state = data;
+
+   if (state && state->magic != STATE_MAGIC)
+      fail("deleted state bound");
+}
+
+
+static void
+delete_state(struct pipe_context *pipe, void *data)
+{
+   struct test_state *state = data;
+   unsigned i, j, k;
+
+   pipe_mutex_lock(test_mutex);
+
+   check_state(state);
+
+   for (i = 0; i < num_contexts; i++) {
+      if (!contexts[i])
+         continue;
+      for (j = 0; j < BIND_COUNT; j++) {
+         if (contexts[i]->bound[j] == data)
+            fail("bound state deleted");
+      }
+      for (j = 0; j < PIPE_SHADER_TYPES; j++) {
+         for (k = 0; k < PIPE_MAX_SAMPLERS; k++) {
+            if (contexts[i]->samplers[j][k] == data)
+               fail("bound sampler deleted");
+         }
+      }
+   }
+
+   live_states--;
+   state->magic = 0;
+
+   pipe_mutex_unlock(test_mutex);
+
+   FREE(state);
+}
+
+
+static void
+bind_state(struct pipe_context *pipe, enum bind_slot slot, void *data)
+{
+   struct test_context *ctx = (struct test_context *)pipe;
+
+   pipe_mutex_lock(test_mutex);
+   check_state(data);
+   ctx->bound[slot] = data;
+   pipe_mutex_unlock(test_mutex);
+}
+
+
+static void
+bind_blend_state(struct pipe_context *pipe, void *data)
+{
+   bind_state(pipe, BIND_BLEND, data);
+}
+
+
+static void
+bind_depth_stencil_alpha_state(struct pipe_context *pipe, void *data)
+{
+   bind_state(pipe, BIND_DSA, data);
+}
+
+
+static void
+bind_rasterizer_state(struct pipe_context *pipe, void *data)
+{
+   bind_state(pipe, BIND_RASTERIZER, data);
+}
+
+
+static void
+bind_vertex_elements_state(struct pipe_context *pipe, void *data)
+{
+   bind_state(pipe, BIND_VELEMENTS, data);
+}
+
+
+static void
+bind_fs_state(struct pipe_context *pipe, void *data)
+{
+   bind_state(pipe, BIND_FS, data);
+}
+
+
+static void
+bind_vs_state(struct pipe_context *pipe, void *data)
+{
+   bind_state(pipe, BIND_VS, data);
+}
+
+
+static void
+bind_sampler_states(struct pipe_context *pipe, unsigned shader,
+                    unsigned start, unsigned count, void **samplers)
+{
+   struct test_context *ctx = (struct test_context *)pipe;
+   unsigned i;
+
+   pipe_mutex_lock(test_mutex);
+   for (i = 0; i < count; i++) {
+      check_state(samplers[i]);
+      ctx->samplers[shader][start + i] = samplers[i];
+   }
+   pipe_mutex_unlock(test_mutex);
+}
+
+
+static void
+set_sampler_views(struct pipe_context *pipe, unsigned shader,
+                  unsigned start, unsigned count,
+                  struct pipe_sampler_view **views)
+{
+}
+
+
+static void
+context_destroy(struct pipe_context *pipe)
+{
+   unsigned i;
+
+   pipe_mutex_lock(test_mutex);
+   for (i = 0; i < num_contexts; i++) {
+      if (contexts[i] == (struct test_context *)pipe)
+         contexts[i] = NULL;
+   }
+   pipe_mutex_unlock(test_mutex);
+
+   FREE(pipe);
+}
+
+
+static struct pipe_context *
+context_create(struct pipe_screen *screen, void *priv)
+{
+   struct test_context *ctx = CALLOC_STRUCT(test_context);
+   struct pipe_context *pipe = &ctx->base;
+
+   pipe->screen = screen;
+   pipe->destroy = context_destroy;
+
+   pipe->create_blend_state = (void *)create_state;
+   pipe->bind_blend_state = bind_blend_state;
+   pipe->delete_blend_state = delete_state;
+   pipe->create_depth_stencil_alpha_state = (void *)create_state;
+   pipe->bind_depth_stencil_alpha_state = bind_depth_stencil_alpha_state;
+   pipe->delete_depth_stencil_alpha_state = delete_state;
+   pipe->create_rasterizer_state = (void *)create_state;
+   pipe->bind_rasterizer_state = bind_rasterizer_state;
+   pipe->delete_rasterizer_state = delete_state;
+   pipe->create_sampler_state = (void *)create_state;
+   pipe->bind_sampler_states = bind_sampler_states;
+   pipe->delete_sampler_state = delete_state;
+   pipe->create_vertex_elements_state = create_vertex_elements_state;
+   pipe->bind_vertex_elements_state = bind_vertex_elements_state;
+   pipe->delete_vertex_elements_state = delete_state;
+   pipe->bind_fs_state = bind_fs_state;
+   pipe->bind_vs_state = bind_vs_state;
+   pipe->set_sampler_views = set_sampler_views;
+
+   pipe_mutex_lock(test_mutex);
+   assert(num_contexts < MAX_CONTEXTS);
+   contexts[num_contexts++] = ctx;
+   pipe_mutex_unlock(test_mutex);
+
+   return pipe;
+}
+
+
+static int
+get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   switch (param) {
+   case PIPE_CAP_MAX_STREAM_OUTPUT_BUFFERS:
+   case PIPE_CAP_VERTEX_BUFFER_OFFSET_4BYTE_ALIGNED_ONLY:
+   case PIPE_CAP_VERTEX_BUFFER_STRIDE_4BYTE_ALIGNED_ONLY:
+   case PIPE_CAP_VERTEX_ELEMENT_SRC_OFFSET_4BYTE_ALIGNED_ONLY:
+      return 0;
+   default:
+      return 1;
+   }
+}
+
+
+static int
+get_shader_param(struct pipe_screen *screen, unsigned shader,
+                 enum pipe_shader_cap param)
+{
+   switch (param) {
+   case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
+   case PIPE_SHADER_CAP_MAX_SAMPLER_VIEWS:
+      return PIPE_MAX_SAMPLERS;
+   default:
+      return shader == PIPE_SHADER_GEOMETRY ? 0 : 1;
+   }
+}
+
+
+static boolean
+is_format_supported(struct pipe_screen *screen, enum pipe_format format,
+                    enum pipe_texture_target target, unsigned sample_count,
+                    unsigned bindings)
+{
+   return TRUE;
+}
+
+
+static struct pipe_screen screen;
+
+
+static void
+init_screen(void)
+{
+   screen.context_create = context_create;
+   screen.get_param = get_param;
+   screen.get_shader_param = get_shader_param;
+   screen.is_format_supported = is_format_supported;
+}
+
+
+static struct cso_context *
+create_cso_context(struct cso_shared_cache *shared)
+{
+   return cso_create_context_shared(screen.context_create(&screen, NULL),
+                                    shared);
+}
+
+
+static void
+destroy_cso_context(struct cso_context *cso, struct pipe_context *pipe)
+{
+   cso_release_all(cso);
+   cso_destroy_context(cso);
+   pipe->destroy(pipe);
+}
+
+
+/**
+ * Check that identical states set in different contexts share the driver
+ * object.
+ */
+static void
+test_sharing(struct cso_shared_cache *shared)
+{
+   struct pipe_blend_state blend;
+   struct pipe_rasterizer_state rasterizer;
+   struct cso_context *cso[2];
+   struct test_context *ctx[2];
+   unsigned created, i;
+
+   created = created_states;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   memset(&rasterizer, 0, sizeof rasterizer);
+   rasterizer.line_width = 1.0f;
+
+   for (i = 0; i < 2; i++) {
+      cso[i] = create_cso_context(shared);
+      ctx[i] = contexts[num_contexts - 1];
+      cso_set_blend(cso[i], &blend);
+      cso_set_rasterizer(cso[i], &rasterizer);
+   }
+
+   if (created_states - created != 2)
+      fail("identical states created twice");
+   if (ctx[0]->bound[BIND_BLEND] != ctx[1]->bound[BIND_BLEND] ||
+       ctx[0]->bound[BIND_RASTERIZER] != ctx[1]->bound[BIND_RASTERIZER])
+      fail("identical states not shared");
+
+   for (i = 0; i < 2; i++)
+      destroy_cso_context(cso[i], &ctx[i]->base);
+}
+
+
+/**
+ * Check that the states no context caches anymore get trimmed.
+ */
+static void
+test_trim(struct cso_shared_cache *shared)
+{
+   struct pipe_rasterizer_state rasterizer;
+   struct cso_context *cso = create_cso_context(shared);
+   struct pipe_context *pipe = &contexts[num_contexts - 1]->base;
+   unsigned i;
+
+   memset(&rasterizer, 0, sizeof rasterizer);
+   for (i = 0; i < 2 * NUM_KEYS; i++) {
+      rasterizer.line_width = (float)i;
+      cso_set_rasterizer(cso, &rasterizer);
+   }
+
+   if (live_states >= NUM_KEYS)
+      fail("unused states not trimmed");
+
+   destroy_cso_context(cso, pipe);
+}
+
+
+static unsigned
+next_random(unsigned *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return (*seed >> 16) & 0x7fff;
+}
+
+
+static PIPE_THREAD_ROUTINE(thread_function, thread_data)
+{
+   struct cso_context *cso = thread_data;
+   unsigned seed = (unsigned)(uintptr_t)thread_data;
+   unsigned i;
+
+   for (i = 0; i < NUM_ITERATIONS; i++) {
+      struct pipe_blend_state blend;
+      struct pipe_depth_stencil_alpha_state dsa;
+      struct pipe_rasterizer_state rasterizer;
+      struct pipe_sampler_state samplers[3];
+      const struct pipe_sampler_state *templates[3];
+      struct pipe_vertex_element velems[2];
+      unsigned key = next_random(&seed) % NUM_KEYS;
+      unsigned j;
+
+      memset(&blend, 0, sizeof blend);
+      blend.rt[0].colormask = key & PIPE_MASK_RGBA;
+      blend.rt[0].rgb_func = (key >> 4) & 7;
+      memset(&dsa, 0, sizeof dsa);
+      dsa.alpha.ref_value = (float)key;
+      memset(&rasterizer, 0, sizeof rasterizer);
+      rasterizer.line_width = (float)key;
+      memset(samplers, 0, sizeof samplers);
+      for (j = 0; j < 3; j++) {
+         samplers[j].lod_bias = (float)(next_random(&seed) % NUM_KEYS);
+         templates[j] = &samplers[j];
+      }
+      memset(velems, 0, sizeof velems);
+      velems[0].src_offset = key;
+      velems[1].src_offset = 16;
+
+      cso_set_blend(cso, &blend);
+      if (i % 7 == 0)
+         cso_save_blend(cso);
+      cso_set_depth_stencil_alpha(cso, &dsa);
+      cso_set_rasterizer(cso, &rasterizer);
+      cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1 + key % 3, templates);
+      cso_set_vertex_elements(cso, 2, velems);
+      if (i % 7 == 0) {
+         blend.dither = 1;
+         cso_set_blend(cso, &blend);
+         cso_restore_blend(cso);
+      }
+   }
+
+   return 0;
+}
+
+
+/**
+ * Create, bind and trim states from several threads at once.
+ */
+static void
+test_threads(struct cso_shared_cache *shared)
+{
+   pipe_thread threads[NUM_THREADS];
+   struct cso_context *cso[NUM_THREADS];
+   struct pipe_context *pipe[NUM_THREADS];
+   unsigned i;
+
+   for (i = 0; i < NUM_THREADS; i++) {
+      cso[i] = create_cso_context(shared);
+      pipe[i] = &contexts[num_contexts - 1]->base;
+   }
+
+   for (i = 0; i < NUM_THREADS; i++)
+      threads[i] = pipe_thread_create(thread_function, cso[i]);
+
+   for (i = 0; i < NUM_THREADS; i++)
+      pipe_thread_wait(threads[i]);
+
+   for (i = 0; i < NUM_THREADS; i++)
+      destroy_cso_context(cso[i], pipe[i]);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct cso_shared_cache *shared;
+
+   init_screen();
+
+   shared = cso_shared_cache_create(&screen);
+   if (!shared) {
+      printf("FAILED: cso_shared_cache_create\n");
+      return 1;
+   }
+
+   test_sharing(shared);
+
+   /* A few dozen states */
+   cso_shared_cache_set_max_memory(shared, 16 * 1024);
+
+   test_trim(shared);
+   test_threads(shared);
+
+   cso_shared_cache_destroy(shared);
+
+   if (live_states != 0)
+      fail("states leaked");
+
+   printf("%s\n", failed ? "Failure!" : "Success!");
+
+   return failed ? 1 : 0;
+}
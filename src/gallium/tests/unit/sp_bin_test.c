@@ -0,0 +1,356 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for softpipe's binned fragment processing.
+ *
+ * Draws blended rectangles over two groups of screen tiles which share
+ * tile cache slots, alternating between the groups, so that shading the
+ * quads as they're rasterized evicts the tiles all the time, while binning
+ * shades each tile in one go.  The results must be the same bits with
+ * SOFTPIPE_NUM_THREADS set to 0, 1 and the max, for each color format.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "sw/null/null_sw_winsys.h"
+#include "softpipe/sp_public.h"
+
+
+/**
+ * 65 x 16 tiles of 64 x 64 pixels: more than the 1024 slots of a tile
+ * cache, so tile (49, 15) shares the slot of tile (0, 0), and so on.
+ */
+#define WIDTH (65 * 64)
+#define HEIGHT (16 * 64)
+
+/** The two groups of tiles, three tiles wide, which share slots */
+#define REGION_WIDTH (3 * 64)
+#define REGION_HEIGHT 64
+static const unsigned region_x[2] = { 0, 49 * 64 };
+static const unsigned region_y[2] = { 0, 15 * 64 };
+
+#define NUM_RECTS 64
+
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_B8G8R8A8_SRGB,
+   PIPE_FORMAT_B5G6R5_UNORM,
+   PIPE_FORMAT_B5G5R5A1_UNORM,
+   PIPE_FORMAT_R10G10B10A2_UNORM,
+   PIPE_FORMAT_R16G16B16A16_UNORM,
+   PIPE_FORMAT_R16G16B16A16_SNORM,
+   PIPE_FORMAT_R16G16B16A16_FLOAT,
+   PIPE_FORMAT_R11G11B10_FLOAT,
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+   PIPE_FORMAT_R32_UNORM,
+   PIPE_FORMAT_L8_UNORM,
+};
+
+static const char *num_threads_options[] = {
+   "SOFTPIPE_NUM_THREADS=0",
+   "SOFTPIPE_NUM_THREADS=1",
+   "SOFTPIPE_NUM_THREADS=8",
+};
+
+
+static boolean failed = FALSE;
+
+
+static unsigned seed;
+
+static float
+frand(void)
+{
+   seed = seed * 1103515245 + 12345;
+   return ((seed >> 8) & 0xffff) / 65535.0f;
+}
+
+
+/**
+ * Fill in the two triangles of a rectangle somewhere in the given region,
+ * with position and color attributes.
+ */
+static void
+make_rect(float *verts, unsigned region)
+{
+   static const unsigned corners[6] = { 0, 1, 2, 2, 1, 3 };
+   const float x0 = region_x[region] + frand() * (REGION_WIDTH - 40);
+   const float y0 = region_y[region] + frand() * (REGION_HEIGHT - 20);
+   const float x1 = x0 + 20 + frand() * (region_x[region] + REGION_WIDTH - 20 - x0);
+   const float y1 = y0 + 10 + frand() * (region_y[region] + REGION_HEIGHT - 10 - y0);
+   float colors[4][4];
+   unsigned i, j;
+
+   for (i = 0; i < 4; i++) {
+      for (j = 0; j < 3; j++)
+         colors[i][j] = frand();
+      colors[i][3] = 0.2f + 0.6f * frand();
+   }
+
+   for (i = 0; i < 6; i++) {
+      const unsigned c = corners[i];
+      float *v = verts + i * 8;
+
+      v[0] = 2.0f * (c & 1 ? x1 : x0) / WIDTH - 1.0f;
+      v[1] = 2.0f * (c & 2 ? y1 : y0) / HEIGHT - 1.0f;
+      v[2] = 0.0f;
+      v[3] = 1.0f;
+      memcpy(&v[4], colors[c], sizeof colors[c]);
+   }
+}
+
+
+/**
+ * Draw the rectangles into a new surface of the given format, and return
+ * the contents of the two regions.
+ */
+static void *
+render(struct pipe_screen *screen, enum pipe_format format)
+{
+   static const uint semantic_names[] = {
+      TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_COLOR
+   };
+   static const uint semantic_indexes[] = { 0, 0 };
+   const unsigned stride = REGION_WIDTH * util_format_get_blocksize(format);
+   struct pipe_context *pipe = screen->context_create(screen, NULL);
+   struct pipe_resource templ, *tex, *vbuf;
+   struct pipe_surface surf_tmpl, *surf;
+   struct pipe_framebuffer_state fb;
+   struct pipe_viewport_state vp;
+   struct pipe_blend_state blend;
+   struct pipe_rasterizer_state rast;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_vertex_element velems[2];
+   struct pipe_vertex_buffer vb;
+   union pipe_color_union clear_color;
+   void *blend_h, *rast_h, *dsa_h, *velems_h, *vs, *fs;
+   float *verts;
+   ubyte *pixels;
+   unsigned i, r;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   tex = screen->resource_create(screen, &templ);
+
+   memset(&surf_tmpl, 0, sizeof surf_tmpl);
+   surf_tmpl.format = format;
+   surf = pipe->create_surface(pipe, tex, &surf_tmpl);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   vp.scale[0] = WIDTH / 2.0f;
+   vp.scale[1] = HEIGHT / 2.0f;
+   vp.scale[2] = 0.5f;
+   vp.scale[3] = 1.0f;
+   vp.translate[0] = WIDTH / 2.0f;
+   vp.translate[1] = HEIGHT / 2.0f;
+   vp.translate[2] = 0.5f;
+   vp.translate[3] = 0.0f;
+   pipe->set_viewport_states(pipe, 0, 1, &vp);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend_h = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, blend_h);
+
+   memset(&rast, 0, sizeof rast);
+   rast.half_pixel_center = 1;
+   rast.depth_clip = 1;
+   rast_h = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, rast_h);
+
+   memset(&dsa, 0, sizeof dsa);
+   dsa_h = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, dsa_h);
+
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < 2; i++) {
+      velems[i].src_offset = i * 4 * sizeof(float);
+      velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   }
+   velems_h = pipe->create_vertex_elements_state(pipe, 2, velems);
+   pipe->bind_vertex_elements_state(pipe, velems_h);
+
+   vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                            semantic_indexes);
+   pipe->bind_vs_state(pipe, vs);
+   fs = util_make_fragment_passthrough_shader(pipe, TGSI_SEMANTIC_COLOR,
+                                              TGSI_INTERPOLATE_PERSPECTIVE,
+                                              FALSE);
+   pipe->bind_fs_state(pipe, fs);
+
+   /* alternate between the regions, so they keep evicting each other */
+   verts = MALLOC(NUM_RECTS * 6 * 8 * sizeof(float));
+   seed = 1;
+   for (i = 0; i < NUM_RECTS; i++)
+      make_rect(verts + i * 6 * 8, i & 1);
+   vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_DEFAULT,
+                             NUM_RECTS * 6 * 8 * sizeof(float));
+   pipe_buffer_write(pipe, vbuf, 0, NUM_RECTS * 6 * 8 * sizeof(float), verts);
+   FREE(verts);
+
+   memset(&vb, 0, sizeof vb);
+   vb.stride = 8 * sizeof(float);
+   vb.buffer = vbuf;
+   pipe->set_vertex_buffers(pipe, 0, 1, &vb);
+
+   clear_color.f[0] = 0.3f;
+   clear_color.f[1] = 0.6f;
+   clear_color.f[2] = 0.1f;
+   clear_color.f[3] = 0.7f;
+   pipe->clear(pipe, PIPE_CLEAR_COLOR0, &clear_color, 0.0, 0);
+
+   util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, NUM_RECTS * 6);
+   pipe->flush(pipe, NULL, 0);
+
+   pixels = MALLOC(2 * REGION_HEIGHT * stride);
+   for (r = 0; r < 2; r++) {
+      struct pipe_transfer *transfer;
+      const ubyte *map = pipe_transfer_map(pipe, tex, 0, 0,
+                                           PIPE_TRANSFER_READ,
+                                           region_x[r], region_y[r],
+                                           REGION_WIDTH, REGION_HEIGHT,
+                                           &transfer);
+
+      for (i = 0; i < REGION_HEIGHT; i++) {
+         memcpy(pixels + (r * REGION_HEIGHT + i) * stride,
+                map + i * transfer->stride, stride);
+      }
+      pipe->transfer_unmap(pipe, transfer);
+   }
+
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe->set_vertex_buffers(pipe, 0, 1, NULL);
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   pipe->delete_fs_state(pipe, fs);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_vertex_elements_state(pipe, velems_h);
+   pipe->delete_depth_stencil_alpha_state(pipe, dsa_h);
+   pipe->delete_rasterizer_state(pipe, rast_h);
+   pipe->delete_blend_state(pipe, blend_h);
+   pipe_resource_reference(&vbuf, NULL);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&tex, NULL);
+   pipe->destroy(pipe);
+
+   return pixels;
+}
+
+
+static void
+test_format(struct pipe_screen *screen, enum pipe_format format)
+{
+   const unsigned size = 2 * REGION_HEIGHT * REGION_WIDTH *
+                         util_format_get_blocksize(format);
+   void *expected = NULL;
+   unsigned i;
+
+   if (!screen->is_format_supported(screen, format, PIPE_TEXTURE_2D, 0,
+                                    PIPE_BIND_RENDER_TARGET))
+      return;
+
+   for (i = 0; i < Elements(num_threads_options); i++) {
+      void *pixels;
+
+      putenv((char *) num_threads_options[i]);
+      pixels = render(screen, format);
+
+      if (!expected) {
+         expected = pixels;
+      }
+      else {
+         if (memcmp(pixels, expected, size) != 0) {
+            printf("FAILED: %s differs with %s\n",
+                   util_format_name(format), num_threads_options[i]);
+            failed = TRUE;
+         }
+         FREE(pixels);
+      }
+   }
+
+   FREE(expected);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen *screen = softpipe_create_screen(null_sw_create());
+   unsigned i;
+
+   if (!screen) {
+      printf("FAILED: softpipe_create_screen\n");
+      return 1;
+   }
+
+   for (i = 0; i < Elements(formats); i++)
+      test_format(screen, formats[i]);
+
+   screen->destroy(screen);
+
+   printf("%s\n", failed ? "Failure!" : "Success!");
+
+   return failed ? 1 : 0;
+}
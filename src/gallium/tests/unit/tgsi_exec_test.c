@@ -0,0 +1,335 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Runs shaders on a tgsi_exec_machine with pre-decoded instructions and on
+ * one without, and checks that the outputs and temporaries come out
+ * bit-identical, including for infinities and negative zeros, and with
+ * some channels disabled by control flow.  NaNs only have to be NaNs:
+ * which one an operation on two NaNs returns depends on the order the
+ * compiler puts the operands in.
+ *
+ * Run with -b to also print how many quads per second both run a vertex
+ * transform and lighting shader at.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+
+
+#define NUM_TOKENS 1024
+#define NUM_INPUTS 3
+#define NUM_OUTPUTS 4
+#define NUM_TEMPS 8
+#define NUM_CONSTS 8
+
+
+/** Every opcode with a pre-decoded version, with all kinds of operands */
+static const char alu_shader[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL IN[2]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL OUT[2], GENERIC[1]\n"
+   "DCL OUT[3], GENERIC[2]\n"
+   "DCL CONST[0..7]\n"
+   "DCL TEMP[0..7]\n"
+   "IMM FLT32 {    0.5,    -1.0,     2.0,     0.0 }\n"
+   "  0: MOV TEMP[0], IN[0].yzwx\n"
+   "  1: ADD TEMP[1], TEMP[0], -IN[1]\n"
+   "  2: SUB TEMP[2].xz, |IN[2]|, CONST[1].wzyx\n"
+   "  3: MUL TEMP[2].yw, TEMP[1].xxyy, IMM[0].zyxw\n"
+   "  4: MAD TEMP[3], TEMP[2], CONST[0], -|TEMP[1]|\n"
+   "  5: MIN TEMP[4], TEMP[3], IN[1].wzyx\n"
+   "  6: MAX TEMP[5], IN[1].wzyx, TEMP[3]\n"
+   "  7: SLT TEMP[6], TEMP[4], TEMP[5].yxwz\n"
+   "  8: SGE TEMP[7], TEMP[4], TEMP[5].yxwz\n"
+   "  9: LRP TEMP[0], TEMP[6], IN[0], IN[2]\n"
+   " 10: CMP TEMP[1], TEMP[3], TEMP[0], IMM[0].wzyx\n"
+   " 11: DP3 TEMP[4].xy, TEMP[1], CONST[2]\n"
+   " 12: DP4 TEMP[4].zw, TEMP[0], IN[2]\n"
+   " 13: MAD_SAT OUT[0], TEMP[3], TEMP[4], TEMP[1]\n"
+   " 14: ADD_SAT OUT[1], TEMP[5], -IN[0]\n"
+   " 15: MOV OUT[2], -|IN[0]|\n"
+   " 16: MUL OUT[3].xyw, CONST[7], TEMP[7]\n"
+   " 17: ADD TEMP[2], TEMP[2], TEMP[2].wzyx\n"
+   " 18: MAD TEMP[3].xy, TEMP[3], TEMP[3].yxxx, TEMP[3].wwww\n"
+   " 19: END\n";
+
+/** Partially enabled channels, and the instructions left to exec_instruction() */
+static const char control_flow_shader[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL IN[2]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL OUT[2], GENERIC[1]\n"
+   "DCL OUT[3], GENERIC[2]\n"
+   "DCL CONST[0..7]\n"
+   "DCL TEMP[0..7]\n"
+   "DCL ADDR[0]\n"
+   "IMM FLT32 {    0.0,     1.0,     3.0,     0.5 }\n"
+   "  0: MOV TEMP[0], IN[0]\n"
+   "  1: MOV OUT[0], IMM[0].xxxx\n"
+   "  2: MOV OUT[1], IMM[0].yyyy\n"
+   "  3: SLT TEMP[1], IN[1], IMM[0].xxxx\n"
+   "  4: IF TEMP[1].xxxx :9\n"
+   "  5:   MAD OUT[0], TEMP[0], IN[1], IN[2]\n"
+   "  6:   RCP TEMP[2].x, IN[1].yyyy\n"
+   "  7:   MUL OUT[1].xy, TEMP[2].xxxx, IN[2]\n"
+   "  8: ELSE :12\n"
+   "  9:   DP4_SAT OUT[0].yw, TEMP[0], IN[2]\n"
+   " 10:   ARL ADDR[0].x, IMM[0].zzzz\n"
+   " 11:   ADD OUT[1], CONST[ADDR[0].x+2], TEMP[0]\n"
+   " 12: ENDIF\n"
+   " 13: MOV_SAT OUT[2], TEMP[0].wzyx\n"
+   " 14: MUL TEMP[0], TEMP[0], IMM[0].wwww\n"
+   " 15: MOV OUT[3], TEMP[0]\n"
+   " 16: END\n";
+
+/** Vertex transform and a directional light, for the benchmark */
+static const char transform_shader[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL IN[2]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], COLOR\n"
+   "DCL CONST[0..7]\n"
+   "DCL TEMP[0..3]\n"
+   "IMM FLT32 {    0.0,     1.0,     0.0,     0.0 }\n"
+   "  0: MUL TEMP[0], CONST[0], IN[0].xxxx\n"
+   "  1: MAD TEMP[0], CONST[1], IN[0].yyyy, TEMP[0]\n"
+   "  2: MAD TEMP[0], CONST[2], IN[0].zzzz, TEMP[0]\n"
+   "  3: MAD OUT[0], CONST[3], IN[0].wwww, TEMP[0]\n"
+   "  4: DP3 TEMP[1].x, IN[1], IN[1]\n"
+   "  5: MUL TEMP[1], IN[1], TEMP[1].xxxx\n"
+   "  6: DP3 TEMP[2].x, TEMP[1], CONST[4]\n"
+   "  7: MAX TEMP[2].x, TEMP[2].xxxx, IMM[0].xxxx\n"
+   "  8: MAD TEMP[3], CONST[5], TEMP[2].xxxx, CONST[6]\n"
+   "  9: MUL TEMP[3], TEMP[3], IN[2]\n"
+   " 10: MIN TEMP[3], TEMP[3], IMM[0].yyyy\n"
+   " 11: MOV OUT[1].xyz, TEMP[3]\n"
+   " 12: MOV OUT[1].w, IN[2].wwww\n"
+   " 13: END\n";
+
+
+static float consts[NUM_CONSTS][4];
+
+
+static struct tgsi_exec_machine *
+create_machine(boolean predecode, const struct tgsi_token *tokens)
+{
+   const void *bufs[PIPE_MAX_CONSTANT_BUFFERS] = { consts };
+   unsigned sizes[PIPE_MAX_CONSTANT_BUFFERS] = { sizeof(consts) };
+   struct tgsi_exec_machine *mach = tgsi_exec_machine_create();
+
+   mach->Predecode = predecode;
+   tgsi_exec_machine_bind_shader(mach, tokens, NULL);
+   tgsi_exec_set_constant_buffers(mach, PIPE_MAX_CONSTANT_BUFFERS,
+                                  bufs, sizes);
+   return mach;
+}
+
+
+/**
+ * Fill the inputs with pseudo-random values, with infinities, NaNs and the
+ * special values from the table mixed in.
+ */
+static void
+set_inputs(struct tgsi_exec_machine *mach, unsigned seed)
+{
+   static const float special[] = {
+      0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.0f, -3.0f, 1e30f, -1e-30f
+   };
+   unsigned i, j, k;
+
+   for (i = 0; i < NUM_INPUTS; i++) {
+      for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
+         for (k = 0; k < TGSI_QUAD_SIZE; k++) {
+            float v;
+
+            seed = seed * 1103515245 + 12345;
+            switch ((seed >> 16) % 16) {
+            case 0:
+               v = INFINITY;
+               break;
+            case 1:
+               v = -INFINITY;
+               break;
+            case 2:
+               v = NAN;
+               break;
+            case 3:
+            case 4:
+            case 5:
+               v = special[(seed >> 8) % Elements(special)];
+               break;
+            default:
+               v = (float) ((seed >> 8) % 2000) / 250.0f - 4.0f;
+               break;
+            }
+            mach->Inputs[i].xyzw[j].f[k] = v;
+         }
+      }
+   }
+}
+
+
+static boolean
+channels_match(const union tgsi_exec_channel *a,
+               const union tgsi_exec_channel *b)
+{
+   unsigned i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      /* NaNs are the only values unequal to themselves */
+      if (a->u[i] != b->u[i] &&
+          !(a->f[i] != a->f[i] && b->f[i] != b->f[i]))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+
+static boolean
+vectors_match(const struct tgsi_exec_vector *a,
+              const struct tgsi_exec_vector *b,
+              unsigned count)
+{
+   unsigned i, j;
+
+   for (i = 0; i < count; i++) {
+      for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
+         if (!channels_match(&a[i].xyzw[j], &b[i].xyzw[j]))
+            return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+static boolean
+test_shader(const char *name, const char *text)
+{
+   struct tgsi_token tokens[NUM_TOKENS];
+   struct tgsi_exec_machine *fast, *slow;
+   unsigned failures = 0;
+   unsigned seed, i;
+
+   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
+      printf("FAILED: %s doesn't translate\n", name);
+      return FALSE;
+   }
+
+   fast = create_machine(TRUE, tokens);
+   slow = create_machine(FALSE, tokens);
+
+   for (seed = 1; seed <= 2000; seed++) {
+      for (i = 0; i < NUM_CONSTS * 4; i++)
+         consts[i / 4][i % 4] = (float) ((seed * 7 + i * 13) % 17) * 0.25f - 2.0f;
+
+      memset(fast->Temps, 0, sizeof(fast->Temps));
+      memset(slow->Temps, 0, sizeof(slow->Temps));
+      memset(fast->Outputs, 0, NUM_OUTPUTS * sizeof(fast->Outputs[0]));
+      memset(slow->Outputs, 0, NUM_OUTPUTS * sizeof(slow->Outputs[0]));
+      set_inputs(fast, seed);
+      set_inputs(slow, seed);
+
+      tgsi_exec_machine_run(fast);
+      tgsi_exec_machine_run(slow);
+
+      if (!vectors_match(fast->Outputs, slow->Outputs, NUM_OUTPUTS) ||
+          !vectors_match(fast->Temps, slow->Temps, NUM_TEMPS)) {
+         if (failures++ < 10)
+            printf("FAILED: %s, seed %u\n", name, seed);
+      }
+   }
+
+   tgsi_exec_machine_destroy(fast);
+   tgsi_exec_machine_destroy(slow);
+
+   return failures == 0;
+}
+
+
+static void
+benchmark(void)
+{
+   struct tgsi_token tokens[NUM_TOKENS];
+   unsigned predecode;
+
+   tgsi_text_translate(transform_shader, tokens, Elements(tokens));
+
+   for (predecode = 0; predecode < 2; predecode++) {
+      struct tgsi_exec_machine *mach = create_machine(predecode, tokens);
+      const unsigned quads = 1000000;
+      int64_t start, end;
+      unsigned i;
+
+      set_inputs(mach, 1);
+
+      start = os_time_get();
+      for (i = 0; i < quads; i++)
+         tgsi_exec_machine_run(mach);
+      end = os_time_get();
+
+      printf("%-13s %6.2f Mquads/s\n",
+             predecode ? "pre-decoded" : "not decoded",
+             (double) quads / (end - start));
+
+      tgsi_exec_machine_destroy(mach);
+   }
+}
+
+
+int
+main(int argc, char **argv)
+{
+   boolean success = TRUE;
+
+   success &= test_shader("alu", alu_shader);
+   success &= test_shader("control flow", control_flow_shader);
+   success &= test_shader("transform", transform_shader);
+
+   printf("%s\n", success ? "Success!" : "Failure!");
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark();
+
+   return success ? 0 : 1;
+}
@@ -29,6 +29,7 @@
 #include "util/u_format.h"
 #include "util/u_half.h"
 #include "util/u_cpu_detect.h"
+#include "os/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,75 @@ static double rand_double()
    return v;
 }
 
+/**
+ * Measure how fast each input format is fetched into float[4] vertices,
+ * the way the draw module and u_vbuf use translate.
+ */
+static void benchmark(struct translate *(*create_fn)(const struct translate_key *key))
+{
+   const unsigned count = 65536;
+   const unsigned iterations = 64;
+   struct translate_key key;
+   unsigned char *input;
+   float *output;
+   unsigned *elts;
+   unsigned format;
+   unsigned i;
+
+   input = align_malloc(count * 32, 64);
+   output = align_malloc(count * 4 * sizeof(float), 64);
+   elts = align_malloc(count * sizeof *elts, 64);
+
+   for (i = 0; i < count * 32; ++i)
+      input[i] = rand() & 0x7f;
+
+   /* not quite in order, like the indices of a mesh */
+   for (i = 0; i < count; ++i)
+      elts[i] = (i ^ 0x5) & (count - 1);
+
+   memset(&key, 0, sizeof key);
+   key.nr_elements = 1;
+   key.output_stride = 4 * sizeof(float);
+   key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+   key.element[0].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; ++format)
+   {
+      const struct util_format_description* format_desc = util_format_description(format);
+      struct translate *translate;
+      int64_t start, end;
+
+      if (!format_desc
+            || !format_desc->fetch_rgba_float
+            || format_desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB
+            || format_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN
+            || format_desc->channel[0].pure_integer)
+         continue;
+
+      key.element[0].input_format = format;
+      translate = create_fn(&key);
+      if (!translate)
+         continue;
+
+      translate->set_buffer(translate, 0, input,
+                            util_format_get_stride(format, 1), count - 1);
+
+      start = os_time_get();
+      for (i = 0; i < iterations; ++i)
+         translate->run_elts(translate, elts, count, 0, 0, output);
+      end = os_time_get();
+
+      printf("%-40s %8.2f Mverts/s\n", format_desc->name,
+             (double) count * iterations / MAX2(end - start, 1));
+
+      translate->release(translate);
+   }
+
+   align_free(input);
+   align_free(output);
+   align_free(elts);
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -129,10 +199,16 @@ int main(int argc, char** argv)
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [generic|x86|nosse|sse|sse2|sse3|sse4.1] [-b]\n");
       return 2;
    }
 
+   if (argc > 2 && !strcmp(argv[2], "-b"))
+   {
+      benchmark(create_fn);
+      return 0;
+   }
+
    for (i = 1; i < Elements(buffer); ++i)
       buffer[i] = align_malloc(buffer_size, 4096);
 
@@ -0,0 +1,167 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Checks util_memcpy_from_wc() against memcpy() for all small sizes and
+ * source/destination alignments, then prints the copy bandwidth of both
+ * across buffer sizes and alignments.
+ *
+ * Run with -b for the benchmark.  The buffers here are ordinary cached
+ * memory, so it shows what the streaming loads cost on cached mappings.
+ * The gain on write-combined mappings of GPU memory is much larger, but
+ * those need a driver to set them up.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+#include "util/u_memcpy_wc.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+
+
+static boolean
+test_correctness(void)
+{
+   const unsigned max_size = 600, max_offset = 64;
+   ubyte *src = align_malloc(max_size + max_offset, 64);
+   ubyte *dst = align_malloc(max_size + max_offset + 1, 64);
+   ubyte *ref = align_malloc(max_size + max_offset + 1, 64);
+   unsigned size, src_offset, dst_offset, i;
+   unsigned failures = 0;
+
+   for (i = 0; i < max_size + max_offset; i++)
+      src[i] = (ubyte) (i * 7 + 3);
+
+   for (size = 0; size <= max_size; size += size < 260 ? 1 : 13) {
+      for (src_offset = 0; src_offset < max_offset; src_offset++) {
+         for (dst_offset = 0; dst_offset < max_offset; dst_offset += 3) {
+            memset(dst, 0xcd, max_size + max_offset + 1);
+            memset(ref, 0xcd, max_size + max_offset + 1);
+
+            util_memcpy_from_wc(dst + dst_offset, src + src_offset, size);
+            memcpy(ref + dst_offset, src + src_offset, size);
+
+            if (memcmp(dst, ref, max_size + max_offset + 1) != 0) {
+               if (failures++ < 10)
+                  printf("FAILED: size %u, src offset %u, dst offset %u\n",
+                         size, src_offset, dst_offset);
+            }
+         }
+      }
+   }
+
+   align_free(src);
+   align_free(dst);
+   align_free(ref);
+
+   return failures == 0;
+}
+
+
+/**
+ * Bandwidth of copying size bytes, in MB/s.
+ */
+static double
+bandwidth(boolean wc, ubyte *dst, const ubyte *src, unsigned size)
+{
+   /* copy about 256 MB, at least 4 times */
+   const unsigned iterations = MAX2(4, (256 << 20) / size);
+   int64_t start, end;
+   unsigned i;
+
+   start = os_time_get();
+   for (i = 0; i < iterations; i++) {
+      if (wc)
+         util_memcpy_from_wc(dst, src, size);
+      else
+         memcpy(dst, src, size);
+   }
+   end = os_time_get();
+
+   return (double) size * iterations / MAX2(end - start, 1);
+}
+
+
+static void
+benchmark(void)
+{
+   static const unsigned sizes[] = {
+      256, 4 << 10, 64 << 10, 1 << 20, 16 << 20
+   };
+   static const unsigned offsets[][2] = {
+      { 0, 0 }, { 4, 4 }, { 0, 4 }, { 16, 0 }, { 0, 16 }
+   };
+   const unsigned max_size = 16 << 20;
+   ubyte *src = align_malloc(max_size + 64, 64);
+   ubyte *dst = align_malloc(max_size + 64, 64);
+   unsigned s, o;
+
+   memset(src, 0x5a, max_size + 64);
+   memset(dst, 0, max_size + 64);
+
+   printf("%10s %5s %5s %12s %12s\n",
+          "size", "src", "dst", "memcpy MB/s", "wc MB/s");
+   for (s = 0; s < Elements(sizes); s++) {
+      for (o = 0; o < Elements(offsets); o++) {
+         ubyte *d = dst + offsets[o][1];
+         const ubyte *sp = src + offsets[o][0];
+
+         printf("%10u %5u %5u %12.0f %12.0f\n",
+                sizes[s], offsets[o][0], offsets[o][1],
+                bandwidth(FALSE, d, sp, sizes[s]),
+                bandwidth(TRUE, d, sp, sizes[s]));
+      }
+   }
+
+   align_free(src);
+   align_free(dst);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   boolean success;
+
+   util_cpu_detect();
+
+   printf("sse4.1 %u, avx2 %u\n",
+          util_cpu_caps.has_sse4_1, util_cpu_caps.has_avx2);
+
+   success = test_correctness();
+   printf("%s\n", success ? "Success!" : "Failure!");
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark();
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Test case for u_vertex_cache.
+ *
+ * Shuffles the triangles of grid meshes, reorders them again, and checks
+ * that the same triangles come out with the same winding and that the
+ * ACMR of a 16 entry FIFO cache gets close to the one of the grid drawn
+ * strip by strip.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/u_memory.h"
+#include "util/u_vertex_cache.h"
+
+
+static unsigned
+get_index(const void *indices, unsigned index_size, unsigned i)
+{
+   switch (index_size) {
+   case 1:
+      return ((const ubyte *) indices)[i];
+   case 2:
+      return ((const ushort *) indices)[i];
+   default:
+      return ((const uint *) indices)[i];
+   }
+}
+
+
+static void
+set_index(void *indices, unsigned index_size, unsigned i, unsigned value)
+{
+   switch (index_size) {
+   case 1:
+      ((ubyte *) indices)[i] = (ubyte) value;
+      break;
+   case 2:
+      ((ushort *) indices)[i] = (ushort) value;
+      break;
+   default:
+      ((uint *) indices)[i] = value;
+      break;
+   }
+}
+
+
+/**
+ * Rotate the triangle so that its smallest index comes first, which keeps
+ * the winding.
+ */
+static void
+canonical_tri(const void *indices, unsigned index_size, unsigned tri,
+              unsigned out[3])
+{
+   unsigned v[3], first = 0, k;
+
+   for (k = 0; k < 3; k++) {
+      v[k] = get_index(indices, index_size, tri * 3 + k);
+      if (v[k] < v[first])
+         first = k;
+   }
+
+   for (k = 0; k < 3; k++)
+      out[k] = v[(first + k) % 3];
+}
+
+
+static int
+compare_tris(const void *a, const void *b)
+{
+   const unsigned *ta = a, *tb = b;
+   unsigned k;
+
+   for (k = 0; k < 3; k++) {
+      if (ta[k] != tb[k])
+         return ta[k] < tb[k] ? -1 : 1;
+   }
+   return 0;
+}
+
+
+static unsigned *
+sorted_tris(const void *indices, unsigned index_size, unsigned num_tris)
+{
+   unsigned *tris = MALLOC(num_tris * 3 * sizeof(unsigned));
+   unsigned i;
+
+   for (i = 0; i < num_tris; i++)
+      canonical_tri(indices, index_size, i, &tris[i * 3]);
+   qsort(tris, num_tris, 3 * sizeof(unsigned), compare_tris);
+
+   return tris;
+}
+
+
+static boolean
+test_grid(unsigned width, unsigned height, unsigned index_size)
+{
+   const unsigned num_tris = (width - 1) * (height - 1) * 2;
+   /* one stray index which isn't part of a triangle */
+   const unsigned num_indices = num_tris * 3 + 1;
+   void *indices = MALLOC(num_indices * index_size);
+   unsigned *before, *after;
+   float strips, shuffled, optimized;
+   boolean success = TRUE;
+   unsigned x, y, i, n = 0;
+
+   for (y = 0; y + 1 < height; y++) {
+      for (x = 0; x + 1 < width; x++) {
+         const unsigned v = y * width + x;
+
+         set_index(indices, index_size, n++, v);
+         set_index(indices, index_size, n++, v + width);
+         set_index(indices, index_size, n++, v + 1);
+         set_index(indices, index_size, n++, v + 1);
+         set_index(indices, index_size, n++, v + width);
+         set_index(indices, index_size, n++, v + width + 1);
+      }
+   }
+   set_index(indices, index_size, n, 7);
+
+   strips = util_vertex_cache_acmr(indices, index_size, num_indices, 16);
+
+   srand(width * height);
+   for (i = num_tris - 1; i > 0; i--) {
+      const unsigned j = rand() % (i + 1);
+      unsigned k;
+
+      for (k = 0; k < 3; k++) {
+         const unsigned t = get_index(indices, index_size, i * 3 + k);
+
+         set_index(indices, index_size, i * 3 + k,
+                   get_index(indices, index_size, j * 3 + k));
+         set_index(indices, index_size, j * 3 + k, t);
+      }
+   }
+
+   shuffled = util_vertex_cache_acmr(indices, index_size, num_indices, 16);
+   before = sorted_tris(indices, index_size, num_tris);
+
+   if (!util_optimize_vertex_cache(indices, index_size, num_indices)) {
+      printf("FAILED: out of memory\n");
+      return FALSE;
+   }
+
+   optimized = util_vertex_cache_acmr(indices, index_size, num_indices, 16);
+   after = sorted_tris(indices, index_size, num_tris);
+
+   printf("%ux%u grid, %u byte indices: ACMR %.3f in strips, "
+          "%.3f shuffled, %.3f optimized\n",
+          width, height, index_size, strips, shuffled, optimized);
+
+   if (memcmp(before, after, num_tris * 3 * sizeof(unsigned)) != 0) {
+      printf("FAILED: triangles changed\n");
+      success = FALSE;
+   }
+
+   if (get_index(indices, index_size, num_tris * 3) != 7) {
+      printf("FAILED: trailing index changed\n");
+      success = FALSE;
+   }
+
+   if (optimized >= shuffled || optimized > strips * 1.1f) {
+      printf("FAILED: ACMR not improved enough\n");
+      success = FALSE;
+   }
+
+   FREE(before);
+   FREE(after);
+   FREE(indices);
+
+   return success;
+}
+
+
+/**
+ * Index 0xffffffff can't be counted, the indices must be left alone.
+ */
+static boolean
+test_max_index(void)
+{
+   static const unsigned expected[6] = { 0, 1, 2, 2, 1, ~0u };
+   unsigned indices[6];
+
+   memcpy(indices, expected, sizeof(indices));
+
+   if (!util_optimize_vertex_cache(indices, 4, 6)) {
+      printf("FAILED: index 0xffffffff reported as out of memory\n");
+      return FALSE;
+   }
+
+   if (memcmp(indices, expected, sizeof(indices)) != 0) {
+      printf("FAILED: indices with index 0xffffffff changed\n");
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   boolean success = TRUE;
+
+   success &= test_grid(16, 16, 1);
+   success &= test_grid(100, 80, 2);
+   success &= test_grid(300, 300, 4);
+   success &= test_max_index();
+
+   printf("%s\n", success ? "Success!" : "Failure!");
+
+   return success ? 0 : 1;
+}
@@ -540,7 +540,7 @@ class Context(Dispatcher):
         self._state.so_targets = tgs
         self._state.offsets = offsets
 
-    def draw_vbo(self, info):
+    def draw_vbo(self, info, user_buffers=None, user_indices=None):
         self._draw_no += 1
 
         if self.interpreter.call_no < self.interpreter.options.call and \
@@ -66,8 +66,8 @@ class Literal(Node):
 
 class Blob(Node):
     
-    def __init__(self, value):
-        self._rawValue = None
+    def __init__(self, value = None, rawValue = None):
+        self._rawValue = rawValue
         self._hexValue = value
 
     def getValue(self):
@@ -28,6 +28,7 @@
 
 
 import sys
+import struct
 import xml.parsers.expat
 import optparse
 
@@ -187,13 +188,215 @@ class XmlParser:
         return data
 
 
+BINARY_MAGIC = 'GTRACE'
+
+# Keep in sync with tr_dump_bin.h
+BINARY_COMPRESS_NONE, BINARY_COMPRESS_LZ4 = range(2)
+
+(
+    BINARY_CALL_BEGIN,
+    BINARY_CALL_END,
+    BINARY_ARG_BEGIN,
+    BINARY_ARG_END,
+    BINARY_RET_BEGIN,
+    BINARY_RET_END,
+    BINARY_BOOL,
+    BINARY_INT,
+    BINARY_UINT,
+    BINARY_FLOAT,
+    BINARY_BYTES,
+    BINARY_STRING,
+    BINARY_ENUM,
+    BINARY_ARRAY_BEGIN,
+    BINARY_ARRAY_END,
+    BINARY_ELEM_BEGIN,
+    BINARY_ELEM_END,
+    BINARY_STRUCT_BEGIN,
+    BINARY_STRUCT_END,
+    BINARY_MEMBER_BEGIN,
+    BINARY_MEMBER_END,
+    BINARY_NULL,
+    BINARY_PTR,
+    BINARY_BLOB,
+) = range(1, 25)
+
+
+class PrefixedFile:
+    """Puts back the bytes read while sniffing the trace format."""
+
+    def __init__(self, prefix, fp):
+        self.prefix = prefix
+        self.fp = fp
+
+    def read(self, size):
+        if self.prefix:
+            data = self.prefix + self.fp.read(max(size - len(self.prefix), 0))
+            self.prefix = ''
+            return data
+        return self.fp.read(size)
+
+
+def lz4_decompress(src, size):
+    dst = bytearray()
+    i = 0
+    end = len(src)
+    while i < end:
+        token = ord(src[i])
+        i += 1
+
+        length = token >> 4
+        if length == 15:
+            while True:
+                byte = ord(src[i])
+                i += 1
+                length += byte
+                if byte != 255:
+                    break
+        dst += src[i:i + length]
+        i += length
+        if i >= end:
+            break
+
+        offset = ord(src[i]) | (ord(src[i + 1]) << 8)
+        i += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                byte = ord(src[i])
+                i += 1
+                length += byte
+                if byte != 255:
+                    break
+        length += 4
+
+        start = len(dst) - offset
+        if offset >= length:
+            dst += dst[start:start + length]
+        else:
+            # overlapping match, repeats the last offset bytes
+            pattern = dst[start:]
+            dst += (pattern * (length // offset + 1))[:length]
+
+    if len(dst) != size:
+        raise ValueError('corrupted LZ4 chunk')
+    return str(dst)
+
+
+class RawChunkReader:
+
+    def __init__(self, fp):
+        self.fp = fp
+
+    def read(self):
+        return self.fp.read(64*1024)
+
+
+class Lz4ChunkReader:
+
+    def __init__(self, fp):
+        self.fp = fp
+
+    def read(self):
+        header = self.fp.read(8)
+        if len(header) < 8:
+            return ''
+        size, packed_size = struct.unpack('<II', header)
+        if packed_size:
+            data = self.fp.read(packed_size)
+            if len(data) < packed_size:
+                return ''
+            return lz4_decompress(data, size)
+        else:
+            return self.fp.read(size)
+
+
+class BinaryEOF(Exception):
+
+    pass
+
+
+class BinaryReader:
+    """Decodes the operands of the binary trace tokens."""
+
+    def __init__(self, chunks):
+        self.chunks = chunks
+        self.data = ''
+        self.pos = 0
+
+    def fill(self, size):
+        chunks = [self.data[self.pos:]]
+        available = len(chunks[0])
+        while available < size:
+            chunk = self.chunks.read()
+            if not chunk:
+                raise BinaryEOF
+            chunks.append(chunk)
+            available += len(chunk)
+        self.data = ''.join(chunks)
+        self.pos = 0
+
+    def read(self, size):
+        if self.pos + size > len(self.data):
+            self.fill(size)
+        data = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return data
+
+    def read_byte(self):
+        if self.pos >= len(self.data):
+            self.fill(1)
+        byte = ord(self.data[self.pos])
+        self.pos += 1
+        return byte
+
+    def read_uint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.read_byte()
+            value |= (byte & 0x7f) << shift
+            if byte < 0x80:
+                return value
+            shift += 7
+
+    def read_sint(self):
+        value = self.read_uint()
+        return (value >> 1) ^ -(value & 1)
+
+    def read_double(self):
+        return struct.unpack('<d', self.read(8))[0]
+
+    def read_string(self):
+        return self.read(self.read_uint()).decode('utf-8')
+
+
 class TraceParser(XmlParser):
+    """Parses both the XML and the binary traces."""
 
     def __init__(self, fp):
-        XmlParser.__init__(self, fp)
+        magic = fp.read(len(BINARY_MAGIC))
+        if magic == BINARY_MAGIC:
+            version, compress = struct.unpack('BB', fp.read(2))
+            if version != 1:
+                raise ValueError('unsupported binary trace version %u' % version)
+            if compress == BINARY_COMPRESS_LZ4:
+                chunks = Lz4ChunkReader(fp)
+            elif compress == BINARY_COMPRESS_NONE:
+                chunks = RawChunkReader(fp)
+            else:
+                raise ValueError('unsupported binary trace compression %u' % compress)
+            self.binary = BinaryReader(chunks)
+            self.blobs = {}
+        else:
+            self.binary = None
+            XmlParser.__init__(self, PrefixedFile(magic, fp))
         self.last_call_no = 0
     
     def parse(self):
+        if self.binary is not None:
+            self.parse_binary()
+            return
+
         self.element_start('trace')
         while self.token.type not in (ELEMENT_END, EOF):
             call = self.parse_call()
@@ -346,6 +549,106 @@ class TraceParser(XmlParser):
 
         return Pointer(address)
 
+    def parse_binary(self):
+        while True:
+            try:
+                token = self.binary_token()
+                if token != BINARY_CALL_BEGIN:
+                    raise ValueError('call expected, token %u found' % token)
+                call = self.parse_binary_call()
+            except BinaryEOF:
+                # also accept traces cut in the middle of a call
+                break
+            self.handle_call(call)
+
+    def binary_token(self):
+        """Read the next token, storing any blobs on the way."""
+        while True:
+            token = self.binary.read_byte()
+            if token != BINARY_BLOB:
+                return token
+            id = self.binary.read_uint()
+            size = self.binary.read_uint()
+            self.blobs[id] = Blob(rawValue = self.binary.read(size))
+
+    def binary_expect(self, expected):
+        token = self.binary_token()
+        if token != expected:
+            raise ValueError('token %u expected, %u found' % (expected, token))
+
+    def parse_binary_call(self):
+        reader = self.binary
+        no = reader.read_uint()
+        self.last_call_no = no
+        klass = reader.read_string()
+        method = reader.read_string()
+        args = []
+        ret = None
+        while True:
+            token = self.binary_token()
+            if token == BINARY_ARG_BEGIN:
+                name = reader.read_string()
+                value = self.parse_binary_value()
+                self.binary_expect(BINARY_ARG_END)
+                args.append((name, value))
+            elif token == BINARY_RET_BEGIN:
+                ret = self.parse_binary_value()
+                self.binary_expect(BINARY_RET_END)
+            elif token == BINARY_CALL_END:
+                time = Literal(reader.read_sint())
+                break
+            else:
+                raise ValueError('argument or return value expected, token %u found' % token)
+
+        return Call(no, klass, method, args, ret, time)
+
+    def parse_binary_value(self):
+        reader = self.binary
+        token = self.binary_token()
+        if token == BINARY_NULL:
+            return Literal(None)
+        if token == BINARY_BOOL:
+            return Literal(reader.read_byte())
+        if token == BINARY_INT:
+            return Literal(reader.read_sint())
+        if token == BINARY_UINT:
+            return Literal(reader.read_uint())
+        if token == BINARY_FLOAT:
+            return Literal(reader.read_double())
+        if token == BINARY_STRING:
+            return Literal(reader.read_string())
+        if token == BINARY_ENUM:
+            return NamedConstant(reader.read_string())
+        if token == BINARY_BYTES:
+            return self.blobs[reader.read_uint()]
+        if token == BINARY_PTR:
+            return Pointer('0x%08x' % reader.read_uint())
+        if token == BINARY_ARRAY_BEGIN:
+            elems = []
+            while True:
+                token = self.binary_token()
+                if token == BINARY_ARRAY_END:
+                    break
+                if token != BINARY_ELEM_BEGIN:
+                    raise ValueError('element expected, token %u found' % token)
+                elems.append(self.parse_binary_value())
+                self.binary_expect(BINARY_ELEM_END)
+            return Array(elems)
+        if token == BINARY_STRUCT_BEGIN:
+            name = reader.read_string()
+            members = []
+            while True:
+                token = self.binary_token()
+                if token == BINARY_STRUCT_END:
+                    break
+                if token != BINARY_MEMBER_BEGIN:
+                    raise ValueError('member expected, token %u found' % token)
+                member_name = reader.read_string()
+                members.append((member_name, self.parse_binary_value()))
+                self.binary_expect(BINARY_MEMBER_END)
+            return Struct(name, members)
+        raise ValueError('value expected, token %u found' % token)
+
     def handle_call(self, call):
         pass
     
@@ -378,12 +681,12 @@ class Main:
         for arg in args:
             if arg.endswith('.gz'):
                 from gzip import GzipFile
-                stream = GzipFile(arg, 'rt')
+                stream = GzipFile(arg, 'rb')
             elif arg.endswith('.bz2'):
                 from bz2 import BZ2File
-                stream = BZ2File(arg, 'rU')
+                stream = BZ2File(arg, 'rb')
             else:
-                stream = open(arg, 'rt')
+                stream = open(arg, 'rb')
             self.process_arg(stream, options)
 
     def get_optparser(self):
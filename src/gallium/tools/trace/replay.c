@@ -0,0 +1,2901 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Replays binary traces of the trace driver on a software screen, timing
+ * the frames and the calls.
+ *
+ * The whole trace is decoded in memory first, so that only the pipe driver
+ * is timed, and so that it can be replayed several times.  Objects are
+ * recreated as the calls that created them are replayed, and are looked up
+ * by the address they had when traced.
+ *
+ * Frames end at every pipe_screen::flush_frontbuffer, or at every
+ * pipe_context::flush if the trace has none.  The replay waits for the
+ * rendering to finish at the end of every frame.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_double_list.h"
+#include "util/u_dump.h"
+#include "util/u_format.h"
+#include "util/u_framebuffer.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "pipe-loader/pipe_loader.h"
+
+#include "trace/tr_dump_bin.h"
+
+
+#define MAX_SHADER_TOKENS (64 * 1024)
+
+
+/*
+ * Decoded trace.
+ */
+
+enum value_type {
+   VALUE_NULL,
+   VALUE_BOOL,
+   VALUE_INT,
+   VALUE_UINT,
+   VALUE_FLOAT,
+   VALUE_BYTES,
+   VALUE_STRING,
+   VALUE_ENUM,
+   VALUE_ARRAY,
+   VALUE_STRUCT,
+   VALUE_PTR
+};
+
+struct blob {
+   size_t size;
+   void *data;
+};
+
+struct member;
+
+struct value {
+   enum value_type type;
+   unsigned count;            /**< array elements or struct members */
+   const char *str;           /**< string, enum name or struct name */
+   union {
+      int64_t i;
+      uint64_t u;             /**< also pointers and resolved enums */
+      double f;
+      const struct blob *blob;
+      struct value *elems;
+      struct member *members;
+   } u;
+};
+
+struct member {
+   const char *name;
+   struct value value;
+};
+
+struct call {
+   unsigned no;
+   int method;                /**< index in methods[], or -1 */
+   unsigned num_args;
+   struct member *args;
+   struct value ret;
+};
+
+
+/** Bump allocator for the decoded trace */
+struct arena_block {
+   struct arena_block *next;
+   size_t used, size;
+};
+
+#define ARENA_BLOCK_SIZE (256 * 1024)
+
+static struct arena_block *arena = NULL;
+
+
+static void *
+arena_alloc(size_t size)
+{
+   struct arena_block *block = arena;
+   void *ptr;
+
+   size = align(size, 8);
+
+   if (!block || block->used + size > block->size) {
+      size_t block_size = MAX2(size, ARENA_BLOCK_SIZE);
+
+      block = MALLOC(sizeof *block + block_size);
+      if (!block) {
+         fprintf(stderr, "error: out of memory\n");
+         exit(1);
+      }
+      block->size = block_size;
+      block->used = 0;
+      block->next = arena;
+      arena = block;
+   }
+
+   ptr = (uint8_t *) (block + 1) + block->used;
+   block->used += size;
+   return ptr;
+}
+
+
+static void *
+arena_dup(const void *data, size_t size)
+{
+   void *ptr = arena_alloc(size);
+   memcpy(ptr, data, size);
+   return ptr;
+}
+
+
+static void
+arena_free(void)
+{
+   while (arena) {
+      struct arena_block *next = arena->next;
+      FREE(arena);
+      arena = next;
+   }
+}
+
+
+/**
+ * Append an element to a growable array.
+ */
+static void *
+array_grow(void **data, unsigned *count, unsigned *capacity, size_t size)
+{
+   if (*count == *capacity) {
+      unsigned new_capacity = MAX2(*capacity * 2, 16);
+      void *new_data = REALLOC(*data, *capacity * size, new_capacity * size);
+      if (!new_data) {
+         fprintf(stderr, "error: out of memory\n");
+         exit(1);
+      }
+      *data = new_data;
+      *capacity = new_capacity;
+   }
+   return (uint8_t *) *data + (*count)++ * size;
+}
+
+
+/*
+ * Binary trace reader.  See tr_dump_bin.h for the format.
+ */
+
+struct reader {
+   FILE *stream;
+   enum trace_bin_compress compress;
+   boolean eof;
+
+   uint8_t *data;
+   size_t size, pos, capacity;
+
+   uint8_t *packed;
+   size_t packed_capacity;
+};
+
+
+static boolean
+lz4_decompress(const uint8_t *src, size_t src_size,
+               uint8_t *dst, size_t dst_size)
+{
+   const uint8_t *ip = src, *ip_end = src + src_size;
+   uint8_t *op = dst, *op_end = dst + dst_size;
+
+   while (ip < ip_end) {
+      unsigned token = *ip++;
+      size_t len = token >> 4;
+      size_t offset;
+      const uint8_t *match;
+
+      if (len == 15) {
+         unsigned byte;
+         do {
+            if (ip >= ip_end)
+               return FALSE;
+            byte = *ip++;
+            len += byte;
+         } while (byte == 255);
+      }
+      if (len > (size_t) (ip_end - ip) || len > (size_t) (op_end - op))
+         return FALSE;
+      memcpy(op, ip, len);
+      ip += len;
+      op += len;
+
+      if (ip >= ip_end)
+         break;
+
+      if (ip_end - ip < 2)
+         return FALSE;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+
+      len = token & 15;
+      if (len == 15) {
+         unsigned byte;
+         do {
+            if (ip >= ip_end)
+               return FALSE;
+            byte = *ip++;
+            len += byte;
+         } while (byte == 255);
+      }
+      len += 4;
+
+      if (!offset || offset > (size_t) (op - dst) ||
+          len > (size_t) (op_end - op))
+         return FALSE;
+
+      /* byte by byte, as matches may overlap */
+      match = op - offset;
+      while (len--)
+         *op++ = *match++;
+   }
+
+   return op == op_end;
+}
+
+
+static boolean
+reader_reserve(uint8_t **data, size_t *capacity, size_t size)
+{
+   if (size > *capacity) {
+      uint8_t *new_data = REALLOC(*data, *capacity, size);
+      if (!new_data)
+         return FALSE;
+      *data = new_data;
+      *capacity = size;
+   }
+   return TRUE;
+}
+
+
+/**
+ * Read the next chunk of tokens.
+ */
+static boolean
+reader_fill(struct reader *rd)
+{
+   rd->pos = 0;
+   rd->size = 0;
+
+   if (rd->compress == TRACE_BIN_COMPRESS_LZ4) {
+      uint8_t header[8];
+      size_t size, packed_size;
+
+      if (fread(header, sizeof header, 1, rd->stream) != 1)
+         return FALSE;
+
+      size = header[0] | (header[1] << 8) | (header[2] << 16) |
+             ((size_t) header[3] << 24);
+      packed_size = header[4] | (header[5] << 8) | (header[6] << 16) |
+                    ((size_t) header[7] << 24);
+
+      if (!reader_reserve(&rd->data, &rd->capacity, size))
+         return FALSE;
+
+      if (packed_size) {
+         if (!reader_reserve(&rd->packed, &rd->packed_capacity, packed_size) ||
+             fread(rd->packed, packed_size, 1, rd->stream) != 1)
+            return FALSE;
+         if (!lz4_decompress(rd->packed, packed_size, rd->data, size)) {
+            fprintf(stderr, "warning: corrupted chunk\n");
+            return FALSE;
+         }
+      }
+      else if (fread(rd->data, size, 1, rd->stream) != 1) {
+         return FALSE;
+      }
+
+      rd->size = size;
+   }
+   else {
+      if (!reader_reserve(&rd->data, &rd->capacity, 64 * 1024))
+         return FALSE;
+      rd->size = fread(rd->data, 1, rd->capacity, rd->stream);
+   }
+
+   return rd->size != 0;
+}
+
+
+static void
+reader_read(struct reader *rd, void *dst, size_t size)
+{
+   uint8_t *p = dst;
+
+   while (size) {
+      size_t n;
+
+      if (rd->pos == rd->size && (rd->eof || !reader_fill(rd))) {
+         rd->eof = TRUE;
+         memset(p, 0, size);
+         return;
+      }
+
+      n = MIN2(size, rd->size - rd->pos);
+      memcpy(p, rd->data + rd->pos, n);
+      rd->pos += n;
+      p += n;
+      size -= n;
+   }
+}
+
+
+static INLINE unsigned
+reader_byte(struct reader *rd)
+{
+   uint8_t byte;
+
+   if (rd->pos < rd->size)
+      return rd->data[rd->pos++];
+
+   reader_read(rd, &byte, 1);
+   return byte;
+}
+
+
+static uint64_t
+reader_uint(struct reader *rd)
+{
+   uint64_t value = 0;
+   unsigned shift = 0;
+   unsigned byte;
+
+   do {
+      byte = reader_byte(rd);
+      if (shift < 64)
+         value |= (uint64_t) (byte & 0x7f) << shift;
+      shift += 7;
+   } while ((byte & 0x80) && !rd->eof);
+
+   return value;
+}
+
+
+static int64_t
+reader_int(struct reader *rd)
+{
+   uint64_t value = reader_uint(rd);
+   return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+
+static double
+reader_float(struct reader *rd)
+{
+   uint8_t bytes[8];
+   union {
+      double f;
+      uint64_t u;
+   } v;
+   unsigned i;
+
+   reader_read(rd, bytes, sizeof bytes);
+   v.u = 0;
+   for (i = 0; i < 8; i++)
+      v.u |= (uint64_t) bytes[i] << (i * 8);
+   return v.f;
+}
+
+
+static const char *
+reader_string(struct reader *rd)
+{
+   size_t len = reader_uint(rd);
+   char *str;
+
+   if (rd->eof)
+      return "";
+
+   str = arena_alloc(len + 1);
+   reader_read(rd, str, len);
+   str[len] = 0;
+   return str;
+}
+
+
+/*
+ * Trace decoding.
+ */
+
+struct trace {
+   struct call *calls;
+   unsigned num_calls, calls_capacity;
+
+   struct blob *blobs;
+   unsigned num_blobs, blobs_capacity;
+
+   struct {
+      const char *name;
+      uint64_t value;
+   } enums[256];
+   unsigned num_enums;
+};
+
+
+/**
+ * Map the enum names the trace driver writes back to their values.
+ */
+static uint64_t
+resolve_enum(struct trace *trace, const char *name)
+{
+   uint64_t value = ~0ULL;
+   unsigned i;
+
+   for (i = 0; i < trace->num_enums; i++) {
+      if (strcmp(trace->enums[i].name, name) == 0)
+         return trace->enums[i].value;
+   }
+
+   if (strncmp(name, "PIPE_FORMAT_", 12) == 0) {
+      for (i = 0; i < PIPE_FORMAT_COUNT; i++) {
+         if (strcmp(util_format_name(i), name) == 0) {
+            value = i;
+            break;
+         }
+      }
+   }
+   else {
+      for (i = 0; i < PIPE_QUERY_TYPES; i++) {
+         if (strcmp(util_dump_query_type(i, FALSE), name) == 0) {
+            value = i;
+            break;
+         }
+      }
+   }
+
+   if (trace->num_enums < Elements(trace->enums)) {
+      trace->enums[trace->num_enums].name = name;
+      trace->enums[trace->num_enums].value = value;
+      trace->num_enums++;
+   }
+
+   return value;
+}
+
+
+/**
+ * Read a token, storing the blobs which come before it.
+ */
+static unsigned
+read_token(struct trace *trace, struct reader *rd)
+{
+   for (;;) {
+      unsigned token = reader_byte(rd);
+      uint64_t id;
+      struct blob *blob;
+
+      if (token != TRACE_BIN_BLOB || rd->eof)
+         return rd->eof ? 0 : token;
+
+      id = reader_uint(rd);
+      while (trace->num_blobs <= id) {
+         blob = array_grow((void **) &trace->blobs, &trace->num_blobs,
+                           &trace->blobs_capacity, sizeof *blob);
+         blob->size = 0;
+         blob->data = NULL;
+      }
+
+      blob = &trace->blobs[id];
+      blob->size = reader_uint(rd);
+      blob->data = MALLOC(blob->size ? blob->size : 1);
+      if (!blob->data) {
+         fprintf(stderr, "error: out of memory\n");
+         exit(1);
+      }
+      reader_read(rd, blob->data, blob->size);
+   }
+}
+
+
+static boolean
+read_value(struct trace *trace, struct reader *rd, struct value *value);
+
+
+static boolean
+read_array(struct trace *trace, struct reader *rd, struct value *value)
+{
+   struct value *elems = NULL;
+   unsigned count = 0, capacity = 0;
+   unsigned token;
+
+   while ((token = read_token(trace, rd)) == TRACE_BIN_ELEM_BEGIN) {
+      struct value *elem = array_grow((void **) &elems, &count, &capacity,
+                                      sizeof *elem);
+      if (!read_value(trace, rd, elem) ||
+          read_token(trace, rd) != TRACE_BIN_ELEM_END) {
+         FREE(elems);
+         return FALSE;
+      }
+   }
+
+   value->type = VALUE_ARRAY;
+   value->count = count;
+   value->u.elems = count ? arena_dup(elems, count * sizeof *elems) : NULL;
+   FREE(elems);
+
+   return token == TRACE_BIN_ARRAY_END;
+}
+
+
+static boolean
+read_struct(struct trace *trace, struct reader *rd, struct value *value)
+{
+   struct member *members = NULL;
+   unsigned count = 0, capacity = 0;
+   unsigned token;
+
+   value->str = reader_string(rd);
+
+   while ((token = read_token(trace, rd)) == TRACE_BIN_MEMBER_BEGIN) {
+      struct member *member = array_grow((void **) &members, &count,
+                                         &capacity, sizeof *member);
+      member->name = reader_string(rd);
+      if (!read_value(trace, rd, &member->value) ||
+          read_token(trace, rd) != TRACE_BIN_MEMBER_END) {
+         FREE(members);
+         return FALSE;
+      }
+   }
+
+   value->type = VALUE_STRUCT;
+   value->count = count;
+   value->u.members = count ? arena_dup(members, count * sizeof *members)
+                            : NULL;
+   FREE(members);
+
+   return token == TRACE_BIN_STRUCT_END;
+}
+
+
+static boolean
+read_value(struct trace *trace, struct reader *rd, struct value *value)
+{
+   uint64_t id;
+
+   memset(value, 0, sizeof *value);
+
+   switch (read_token(trace, rd)) {
+   case TRACE_BIN_NULL:
+      value->type = VALUE_NULL;
+      return TRUE;
+   case TRACE_BIN_BOOL:
+      value->type = VALUE_BOOL;
+      value->u.u = reader_byte(rd);
+      return TRUE;
+   case TRACE_BIN_INT:
+      value->type = VALUE_INT;
+      value->u.i = reader_int(rd);
+      return TRUE;
+   case TRACE_BIN_UINT:
+      value->type = VALUE_UINT;
+      value->u.u = reader_uint(rd);
+      return TRUE;
+   case TRACE_BIN_FLOAT:
+      value->type = VALUE_FLOAT;
+      value->u.f = reader_float(rd);
+      return TRUE;
+   case TRACE_BIN_BYTES:
+      id = reader_uint(rd);
+      if (id >= trace->num_blobs)
+         return FALSE;
+      value->type = VALUE_BYTES;
+      value->u.blob = &trace->blobs[id];
+      return TRUE;
+   case TRACE_BIN_STRING:
+      value->type = VALUE_STRING;
+      value->str = reader_string(rd);
+      return TRUE;
+   case TRACE_BIN_ENUM:
+      value->type = VALUE_ENUM;
+      value->str = reader_string(rd);
+      value->u.u = resolve_enum(trace, value->str);
+      return TRUE;
+   case TRACE_BIN_PTR:
+      value->type = VALUE_PTR;
+      value->u.u = reader_uint(rd);
+      return TRUE;
+   case TRACE_BIN_ARRAY_BEGIN:
+      return read_array(trace, rd, value);
+   case TRACE_BIN_STRUCT_BEGIN:
+      return read_struct(trace, rd, value);
+   default:
+      return FALSE;
+   }
+}
+
+
+static int
+find_method(const char *klass, const char *name);
+
+
+/**
+ * Decode a call, after its TRACE_BIN_CALL_BEGIN token.
+ */
+static boolean
+read_call(struct trace *trace, struct reader *rd, struct call *call)
+{
+   struct member *args = NULL;
+   unsigned count = 0, capacity = 0;
+   const char *klass, *method;
+
+   memset(call, 0, sizeof *call);
+
+   call->no = reader_uint(rd);
+   klass = reader_string(rd);
+   method = reader_string(rd);
+   call->method = find_method(klass, method);
+
+   for (;;) {
+      unsigned token = read_token(trace, rd);
+
+      if (token == TRACE_BIN_ARG_BEGIN) {
+         struct member *arg = array_grow((void **) &args, &count, &capacity,
+                                         sizeof *arg);
+         arg->name = reader_string(rd);
+         if (!read_value(trace, rd, &arg->value) ||
+             read_token(trace, rd) != TRACE_BIN_ARG_END)
+            break;
+      }
+      else if (token == TRACE_BIN_RET_BEGIN) {
+         if (!read_value(trace, rd, &call->ret) ||
+             read_token(trace, rd) != TRACE_BIN_RET_END)
+            break;
+      }
+      else if (token == TRACE_BIN_CALL_END) {
+         reader_int(rd);
+         if (rd->eof)
+            break;
+         call->num_args = count;
+         call->args = count ? arena_dup(args, count * sizeof *args) : NULL;
+         FREE(args);
+         return TRUE;
+      }
+      else {
+         break;
+      }
+   }
+
+   FREE(args);
+   return FALSE;
+}
+
+
+static boolean
+trace_load(struct trace *trace, const char *filename)
+{
+   struct reader rd;
+   char magic[6];
+   int version, compress;
+
+   memset(trace, 0, sizeof *trace);
+   memset(&rd, 0, sizeof rd);
+
+   rd.stream = fopen(filename, "rb");
+   if (!rd.stream) {
+      fprintf(stderr, "error: failed to open %s\n", filename);
+      return FALSE;
+   }
+
+   if (fread(magic, sizeof magic, 1, rd.stream) != 1 ||
+       memcmp(magic, "GTRACE", sizeof magic) != 0) {
+      fprintf(stderr, "error: %s is not a binary trace, record it with "
+              "GALLIUM_TRACE_FORMAT=binary\n", filename);
+      fclose(rd.stream);
+      return FALSE;
+   }
+
+   version = fgetc(rd.stream);
+   compress = fgetc(rd.stream);
+   if (version != TRACE_BIN_VERSION ||
+       (compress != TRACE_BIN_COMPRESS_NONE &&
+        compress != TRACE_BIN_COMPRESS_LZ4)) {
+      fprintf(stderr, "error: unsupported trace version %i compression %i\n",
+              version, compress);
+      fclose(rd.stream);
+      return FALSE;
+   }
+   rd.compress = compress;
+
+   for (;;) {
+      unsigned token = read_token(trace, &rd);
+      struct call *call;
+
+      if (rd.eof)
+         break;
+
+      if (token != TRACE_BIN_CALL_BEGIN) {
+         fprintf(stderr, "warning: unexpected token %u after call %u\n",
+                 token, trace->num_calls ?
+                 trace->calls[trace->num_calls - 1].no : 0);
+         break;
+      }
+
+      call = array_grow((void **) &trace->calls, &trace->num_calls,
+                        &trace->calls_capacity, sizeof *call);
+      if (!read_call(trace, &rd, call)) {
+         /* the application may have died in the middle of a call */
+         trace->num_calls--;
+         if (!rd.eof)
+            fprintf(stderr, "warning: malformed call %u\n", call->no);
+         break;
+      }
+   }
+
+   FREE(rd.data);
+   FREE(rd.packed);
+   fclose(rd.stream);
+
+   return TRUE;
+}
+
+
+static void
+trace_free(struct trace *trace)
+{
+   unsigned i;
+
+   for (i = 0; i < trace->num_blobs; i++)
+      FREE(trace->blobs[i].data);
+   FREE(trace->blobs);
+   FREE(trace->calls);
+   arena_free();
+}
+
+
+/*
+ * Value accessors.  Missing values read as zero.
+ */
+
+static const struct value *
+call_arg(const struct call *call, const char *name)
+{
+   unsigned i;
+
+   for (i = 0; i < call->num_args; i++) {
+      if (strcmp(call->args[i].name, name) == 0)
+         return &call->args[i].value;
+   }
+   return NULL;
+}
+
+
+static const struct value *
+value_member(const struct value *value, const char *name)
+{
+   unsigned i;
+
+   if (!value || value->type != VALUE_STRUCT)
+      return NULL;
+
+   for (i = 0; i < value->count; i++) {
+      if (strcmp(value->u.members[i].name, name) == 0)
+         return &value->u.members[i].value;
+   }
+   return NULL;
+}
+
+
+static const struct value *
+value_elem(const struct value *value, unsigned index)
+{
+   if (!value || value->type != VALUE_ARRAY || index >= value->count)
+      return NULL;
+   return &value->u.elems[index];
+}
+
+
+static uint64_t
+value_uint(const struct value *value)
+{
+   if (!value)
+      return 0;
+
+   switch (value->type) {
+   case VALUE_INT:
+      return value->u.i;
+   case VALUE_FLOAT:
+      return (uint64_t) value->u.f;
+   case VALUE_BOOL:
+   case VALUE_UINT:
+   case VALUE_ENUM:
+   case VALUE_PTR:
+      return value->u.u;
+   default:
+      return 0;
+   }
+}
+
+
+static int64_t
+value_int(const struct value *value)
+{
+   if (value && value->type == VALUE_FLOAT)
+      return (int64_t) value->u.f;
+   return (int64_t) value_uint(value);
+}
+
+
+static boolean
+value_bool(const struct value *value)
+{
+   return value_uint(value) != 0;
+}
+
+
+static double
+value_float(const struct value *value)
+{
+   if (!value)
+      return 0.0;
+
+   switch (value->type) {
+   case VALUE_FLOAT:
+      return value->u.f;
+   case VALUE_INT:
+      return (double) value->u.i;
+   default:
+      return (double) value_uint(value);
+   }
+}
+
+
+static enum pipe_format
+value_format(const struct value *value)
+{
+   uint64_t format = value_uint(value);
+   return format < PIPE_FORMAT_COUNT ? format : PIPE_FORMAT_NONE;
+}
+
+
+/** Counterpart of trace_dump_member() */
+#define replay_member(_type, _value, _obj, _member) \
+   (_obj)->_member = value_##_type(value_member(_value, #_member))
+
+/** Counterpart of trace_dump_member_array() */
+#define replay_member_array(_type, _value, _obj, _member) \
+   do { \
+      const struct value *__array = value_member(_value, #_member); \
+      unsigned __i; \
+      for (__i = 0; __i < Elements((_obj)->_member); ++__i) \
+         (_obj)->_member[__i] = value_##_type(value_elem(__array, __i)); \
+   } while (0)
+
+
+/*
+ * Replayed objects.
+ */
+
+enum object_type {
+   OBJECT_CONTEXT,
+   OBJECT_RESOURCE,
+   OBJECT_SURFACE,
+   OBJECT_SAMPLER_VIEW,
+   OBJECT_SO_TARGET,
+   OBJECT_QUERY,
+   OBJECT_FENCE,
+   OBJECT_BLEND,
+   OBJECT_SAMPLER,
+   OBJECT_RASTERIZER,
+   OBJECT_DEPTH_STENCIL_ALPHA,
+   OBJECT_FS,
+   OBJECT_VS,
+   OBJECT_GS,
+   OBJECT_VERTEX_ELEMENTS
+};
+
+struct replay_context {
+   struct pipe_context *pipe;
+
+   /** User buffers are bound at each draw, from the memory it traced */
+   struct pipe_vertex_buffer vertex_buffers[PIPE_MAX_ATTRIBS];
+   unsigned user_vertex_buffers;
+   struct pipe_index_buffer index_buffer;
+   boolean user_index_buffer;
+
+   /** For the checksums */
+   struct pipe_framebuffer_state fb;
+};
+
+struct object {
+   struct list_head head;
+   uint64_t address;
+   enum object_type type;
+   void *ptr;
+   struct replay_context *ctx;
+   unsigned refcount;         /**< for fences */
+};
+
+struct replay {
+   struct pipe_screen *screen;
+
+   struct util_hash_table *objects;
+   struct list_head object_list;
+
+   /** Last context used, for the frame ends */
+   struct replay_context *ctx;
+
+   struct tgsi_token *tokens;
+
+   unsigned skipped_draws;
+   unsigned skipped_uploads;
+   unsigned missing_objects;
+};
+
+
+static unsigned
+address_hash(void *key)
+{
+   uintptr_t address = (uintptr_t) key;
+   return (unsigned) (address >> 4) ^ (unsigned) (address >> 32);
+}
+
+
+static int
+address_compare(void *key1, void *key2)
+{
+   return key1 != key2;
+}
+
+
+/**
+ * Unbind the state objects, so that they can be deleted.
+ */
+static void
+context_unbind(struct replay_context *ctx)
+{
+   struct pipe_context *pipe = ctx->pipe;
+   struct pipe_sampler_view *views[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct pipe_framebuffer_state fb;
+   unsigned shader;
+
+   memset(views, 0, sizeof views);
+   for (shader = 0; shader <= PIPE_SHADER_GEOMETRY; shader++) {
+      if (shader == PIPE_SHADER_GEOMETRY && !pipe->bind_gs_state)
+         continue;
+      pipe->set_sampler_views(pipe, shader, 0, Elements(views), views);
+   }
+
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->bind_rasterizer_state(pipe, NULL);
+   pipe->bind_depth_stencil_alpha_state(pipe, NULL);
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   if (pipe->bind_gs_state)
+      pipe->bind_gs_state(pipe, NULL);
+   pipe->bind_vertex_elements_state(pipe, NULL);
+   util_unreference_framebuffer_state(&ctx->fb);
+}
+
+
+static void
+object_destroy(struct replay *r, struct object *obj)
+{
+   struct pipe_context *pipe = obj->ctx ? obj->ctx->pipe : NULL;
+   struct object *other, *next;
+
+   switch (obj->type) {
+   case OBJECT_CONTEXT:
+      /* the application may have leaked some of the context's objects */
+      context_unbind(obj->ctx);
+      LIST_FOR_EACH_ENTRY_SAFE_REV(other, next, &r->object_list, head) {
+         if (other != obj && other->ctx == obj->ctx)
+            object_destroy(r, other);
+      }
+      obj->ctx->pipe->destroy(obj->ctx->pipe);
+      if (r->ctx == obj->ctx)
+         r->ctx = NULL;
+      FREE(obj->ctx);
+      break;
+   case OBJECT_RESOURCE:
+      {
+         struct pipe_resource *resource = obj->ptr;
+         pipe_resource_reference(&resource, NULL);
+      }
+      break;
+   case OBJECT_SURFACE:
+      {
+         struct pipe_surface *surface = obj->ptr;
+         pipe_surface_reference(&surface, NULL);
+      }
+      break;
+   case OBJECT_SAMPLER_VIEW:
+      {
+         struct pipe_sampler_view *view = obj->ptr;
+         pipe_sampler_view_reference(&view, NULL);
+      }
+      break;
+   case OBJECT_SO_TARGET:
+      {
+         struct pipe_stream_output_target *target = obj->ptr;
+         pipe_so_target_reference(&target, NULL);
+      }
+      break;
+   case OBJECT_FENCE:
+      {
+         struct pipe_fence_handle *fence = obj->ptr;
+         r->screen->fence_reference(r->screen, &fence, NULL);
+      }
+      break;
+   case OBJECT_QUERY:
+      pipe->destroy_query(pipe, obj->ptr);
+      break;
+   case OBJECT_BLEND:
+      pipe->delete_blend_state(pipe, obj->ptr);
+      break;
+   case OBJECT_SAMPLER:
+      pipe->delete_sampler_state(pipe, obj->ptr);
+      break;
+   case OBJECT_RASTERIZER:
+      pipe->delete_rasterizer_state(pipe, obj->ptr);
+      break;
+   case OBJECT_DEPTH_STENCIL_ALPHA:
+      pipe->delete_depth_stencil_alpha_state(pipe, obj->ptr);
+      break;
+   case OBJECT_FS:
+      pipe->delete_fs_state(pipe, obj->ptr);
+      break;
+   case OBJECT_VS:
+      pipe->delete_vs_state(pipe, obj->ptr);
+      break;
+   case OBJECT_GS:
+      pipe->delete_gs_state(pipe, obj->ptr);
+      break;
+   case OBJECT_VERTEX_ELEMENTS:
+      pipe->delete_vertex_elements_state(pipe, obj->ptr);
+      break;
+   }
+
+   util_hash_table_remove(r->objects, (void *) (uintptr_t) obj->address);
+   LIST_DEL(&obj->head);
+   FREE(obj);
+}
+
+
+static struct object *
+object_lookup(struct replay *r, const struct value *value)
+{
+   uint64_t address = value_uint(value);
+
+   if (!address)
+      return NULL;
+
+   return util_hash_table_get(r->objects, (void *) (uintptr_t) address);
+}
+
+
+static void *
+object_get(struct replay *r, const struct value *value, enum object_type type)
+{
+   struct object *obj = object_lookup(r, value);
+
+   if (!obj || obj->type != type) {
+      if (value_uint(value))
+         r->missing_objects++;
+      return NULL;
+   }
+
+   return obj->ptr;
+}
+
+
+static void
+object_add(struct replay *r, const struct value *value, enum object_type type,
+           void *ptr, struct replay_context *ctx)
+{
+   uint64_t address = value_uint(value);
+   struct object *obj;
+
+   if (!address || !ptr)
+      return;
+
+   /* the trace missed its destruction */
+   obj = object_lookup(r, value);
+   if (obj)
+      object_destroy(r, obj);
+
+   obj = CALLOC_STRUCT(object);
+   if (!obj)
+      return;
+
+   obj->address = address;
+   obj->type = type;
+   obj->ptr = ptr;
+   obj->ctx = ctx;
+   obj->refcount = 1;
+   LIST_ADDTAIL(&obj->head, &r->object_list);
+   util_hash_table_set(r->objects, (void *) (uintptr_t) address, obj);
+}
+
+
+static void
+object_remove(struct replay *r, const struct value *value,
+              enum object_type type)
+{
+   struct object *obj = object_lookup(r, value);
+
+   if (obj && obj->type == type)
+      object_destroy(r, obj);
+}
+
+
+/**
+ * Destroy what the trace left alive, newest first.
+ */
+static void
+replay_cleanup(struct replay *r)
+{
+   while (!LIST_IS_EMPTY(&r->object_list)) {
+      struct object *obj = LIST_ENTRY(struct object, r->object_list.prev,
+                                      head);
+      object_destroy(r, obj);
+   }
+}
+
+
+/*
+ * State decoding.
+ */
+
+static void
+decode_box(const struct value *v, struct pipe_box *box)
+{
+   replay_member(int, v, box, x);
+   replay_member(int, v, box, y);
+   replay_member(int, v, box, z);
+   replay_member(int, v, box, width);
+   replay_member(int, v, box, height);
+   replay_member(int, v, box, depth);
+}
+
+
+static void
+decode_resource_template(const struct value *v, struct pipe_resource *templat)
+{
+   memset(templat, 0, sizeof *templat);
+   replay_member(uint, v, templat, target);
+   replay_member(format, v, templat, format);
+   templat->width0 = value_uint(value_member(v, "width"));
+   templat->height0 = value_uint(value_member(v, "height"));
+   templat->depth0 = value_uint(value_member(v, "depth"));
+   templat->array_size = value_uint(value_member(v, "array_size"));
+   replay_member(uint, v, templat, last_level);
+   replay_member(uint, v, templat, nr_samples);
+   replay_member(uint, v, templat, usage);
+   replay_member(uint, v, templat, bind);
+   replay_member(uint, v, templat, flags);
+}
+
+
+static void
+decode_blend_state(const struct value *v, struct pipe_blend_state *state)
+{
+   const struct value *rt = value_member(v, "rt");
+   unsigned i;
+
+   memset(state, 0, sizeof *state);
+   replay_member(bool, v, state, dither);
+   replay_member(bool, v, state, logicop_enable);
+   replay_member(uint, v, state, logicop_func);
+   replay_member(bool, v, state, independent_blend_enable);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      const struct value *elem = value_elem(rt, i);
+      struct pipe_rt_blend_state *rt_state = &state->rt[i];
+
+      if (!elem)
+         break;
+
+      replay_member(uint, elem, rt_state, blend_enable);
+      replay_member(uint, elem, rt_state, rgb_func);
+      replay_member(uint, elem, rt_state, rgb_src_factor);
+      replay_member(uint, elem, rt_state, rgb_dst_factor);
+      replay_member(uint, elem, rt_state, alpha_func);
+      replay_member(uint, elem, rt_state, alpha_src_factor);
+      replay_member(uint, elem, rt_state, alpha_dst_factor);
+      replay_member(uint, elem, rt_state, colormask);
+   }
+}
+
+
+static void
+decode_sampler_state(const struct value *v, struct pipe_sampler_state *state)
+{
+   const struct value *border_color = value_member(v, "border_color.f");
+   unsigned i;
+
+   memset(state, 0, sizeof *state);
+   replay_member(uint, v, state, wrap_s);
+   replay_member(uint, v, state, wrap_t);
+   replay_member(uint, v, state, wrap_r);
+   replay_member(uint, v, state, min_img_filter);
+   replay_member(uint, v, state, min_mip_filter);
+   replay_member(uint, v, state, mag_img_filter);
+   replay_member(uint, v, state, compare_mode);
+   replay_member(uint, v, state, compare_func);
+   replay_member(bool, v, state, normalized_coords);
+   replay_member(uint, v, state, max_anisotropy);
+   replay_member(bool, v, state, seamless_cube_map);
+   replay_member(float, v, state, lod_bias);
+   replay_member(float, v, state, min_lod);
+   replay_member(float, v, state, max_lod);
+   for (i = 0; i < 4; i++)
+      state->border_color.f[i] = value_float(value_elem(border_color, i));
+}
+
+
+static void
+decode_rasterizer_state(const struct value *v,
+                        struct pipe_rasterizer_state *state)
+{
+   memset(state, 0, sizeof *state);
+   replay_member(bool, v, state, flatshade);
+   replay_member(bool, v, state, light_twoside);
+   replay_member(bool, v, state, clamp_vertex_color);
+   replay_member(bool, v, state, clamp_fragment_color);
+   replay_member(uint, v, state, front_ccw);
+   replay_member(uint, v, state, cull_face);
+   replay_member(uint, v, state, fill_front);
+   replay_member(uint, v, state, fill_back);
+   replay_member(bool, v, state, offset_point);
+   replay_member(bool, v, state, offset_line);
+   replay_member(bool, v, state, offset_tri);
+   replay_member(bool, v, state, scissor);
+   replay_member(bool, v, state, poly_smooth);
+   replay_member(bool, v, state, poly_stipple_enable);
+   replay_member(bool, v, state, point_smooth);
+   replay_member(bool, v, state, sprite_coord_mode);
+   replay_member(bool, v, state, point_quad_rasterization);
+   replay_member(bool, v, state, point_size_per_vertex);
+   replay_member(bool, v, state, multisample);
+   replay_member(bool, v, state, line_smooth);
+   replay_member(bool, v, state, line_stipple_enable);
+   replay_member(bool, v, state, line_last_pixel);
+   replay_member(bool, v, state, flatshade_first);
+   replay_member(bool, v, state, half_pixel_center);
+   replay_member(bool, v, state, bottom_edge_rule);
+   replay_member(bool, v, state, rasterizer_discard);
+   replay_member(bool, v, state, depth_clip);
+   replay_member(bool, v, state, clip_halfz);
+   replay_member(uint, v, state, clip_plane_enable);
+   replay_member(uint, v, state, line_stipple_factor);
+   replay_member(uint, v, state, line_stipple_pattern);
+   replay_member(uint, v, state, sprite_coord_enable);
+   replay_member(float, v, state, line_width);
+   replay_member(float, v, state, point_size);
+   replay_member(float, v, state, offset_units);
+   replay_member(float, v, state, offset_scale);
+   replay_member(float, v, state, offset_clamp);
+}
+
+
+static void
+decode_depth_stencil_alpha_state(const struct value *v,
+                                 struct pipe_depth_stencil_alpha_state *state)
+{
+   const struct value *depth = value_member(v, "depth");
+   const struct value *stencil = value_member(v, "stencil");
+   const struct value *alpha = value_member(v, "alpha");
+   unsigned i;
+
+   memset(state, 0, sizeof *state);
+
+   replay_member(bool, depth, &state->depth, enabled);
+   replay_member(bool, depth, &state->depth, writemask);
+   replay_member(uint, depth, &state->depth, func);
+
+   for (i = 0; i < Elements(state->stencil); i++) {
+      const struct value *elem = value_elem(stencil, i);
+      replay_member(bool, elem, &state->stencil[i], enabled);
+      replay_member(uint, elem, &state->stencil[i], func);
+      replay_member(uint, elem, &state->stencil[i], fail_op);
+      replay_member(uint, elem, &state->stencil[i], zpass_op);
+      replay_member(uint, elem, &state->stencil[i], zfail_op);
+      replay_member(uint, elem, &state->stencil[i], valuemask);
+      replay_member(uint, elem, &state->stencil[i], writemask);
+   }
+
+   replay_member(bool, alpha, &state->alpha, enabled);
+   replay_member(uint, alpha, &state->alpha, func);
+   replay_member(float, alpha, &state->alpha, ref_value);
+}
+
+
+/**
+ * The trace has the shaders as TGSI text.
+ */
+static boolean
+decode_shader_state(struct replay *r, const struct value *v,
+                    struct pipe_shader_state *state)
+{
+   const struct value *tokens = value_member(v, "tokens");
+   const struct value *so = value_member(v, "stream_output");
+   const struct value *outputs = value_member(so, "output");
+   unsigned i;
+
+   memset(state, 0, sizeof *state);
+
+   if (!tokens || tokens->type != VALUE_STRING ||
+       !tgsi_text_translate(tokens->str, r->tokens, MAX_SHADER_TOKENS)) {
+      fprintf(stderr, "warning: failed to translate shader\n");
+      return FALSE;
+   }
+   state->tokens = r->tokens;
+
+   replay_member(uint, so, &state->stream_output, num_outputs);
+   replay_member_array(uint, so, &state->stream_output, stride);
+   for (i = 0; i < state->stream_output.num_outputs &&
+               i < Elements(state->stream_output.output); i++) {
+      const struct value *elem = value_elem(outputs, i);
+      replay_member(uint, elem, &state->stream_output.output[i], register_index);
+      replay_member(uint, elem, &state->stream_output.output[i], start_component);
+      replay_member(uint, elem, &state->stream_output.output[i], num_components);
+      replay_member(uint, elem, &state->stream_output.output[i], output_buffer);
+      replay_member(uint, elem, &state->stream_output.output[i], dst_offset);
+   }
+
+   return TRUE;
+}
+
+
+/*
+ * Call replay.
+ */
+
+typedef void (*replay_func)(struct replay *r, const struct call *call);
+
+
+static struct replay_context *
+call_context(struct replay *r, const struct call *call)
+{
+   /* the context is always the first argument */
+   struct replay_context *ctx;
+
+   if (!call->num_args)
+      return NULL;
+
+   ctx = object_get(r, &call->args[0].value, OBJECT_CONTEXT);
+   if (ctx)
+      r->ctx = ctx;
+   return ctx;
+}
+
+
+#define CALL_PIPE(_call) \
+   struct replay_context *ctx = call_context(r, _call); \
+   struct pipe_context *pipe; \
+   if (!ctx) \
+      return; \
+   pipe = ctx->pipe
+
+
+static void
+replay_screen_context_create(struct replay *r, const struct call *call)
+{
+   struct replay_context *ctx = CALLOC_STRUCT(replay_context);
+
+   if (!ctx)
+      return;
+
+   ctx->pipe = r->screen->context_create(r->screen, NULL);
+   if (!ctx->pipe) {
+      FREE(ctx);
+      return;
+   }
+
+   object_add(r, &call->ret, OBJECT_CONTEXT, ctx, ctx);
+   r->ctx = ctx;
+}
+
+
+static void
+replay_screen_resource_create(struct replay *r, const struct call *call)
+{
+   struct pipe_resource templat;
+   struct pipe_resource *resource;
+
+   decode_resource_template(call_arg(call, "templat"), &templat);
+   resource = r->screen->resource_create(r->screen, &templat);
+   object_add(r, &call->ret, OBJECT_RESOURCE, resource, NULL);
+}
+
+
+static void
+replay_screen_resource_destroy(struct replay *r, const struct call *call)
+{
+   object_remove(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+}
+
+
+static void
+replay_screen_flush_frontbuffer(struct replay *r, const struct call *call)
+{
+   struct pipe_resource *resource =
+      object_get(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+
+   if (resource)
+      r->screen->flush_frontbuffer(r->screen, resource,
+                                   value_uint(call_arg(call, "level")),
+                                   value_uint(call_arg(call, "layer")),
+                                   NULL, NULL);
+}
+
+
+static void
+replay_screen_fence_reference(struct replay *r, const struct call *call)
+{
+   struct object *dst = object_lookup(r, call_arg(call, "dst"));
+   struct object *src = object_lookup(r, call_arg(call, "src"));
+
+   if (src && src->type == OBJECT_FENCE)
+      src->refcount++;
+   if (dst && dst->type == OBJECT_FENCE && --dst->refcount == 0)
+      object_destroy(r, dst);
+}
+
+
+static void
+replay_screen_fence_finish(struct replay *r, const struct call *call)
+{
+   struct pipe_fence_handle *fence =
+      object_get(r, call_arg(call, "fence"), OBJECT_FENCE);
+
+   if (fence)
+      r->screen->fence_finish(r->screen, fence,
+                              value_uint(call_arg(call, "timeout")));
+}
+
+
+static void
+replay_screen_fence_signalled(struct replay *r, const struct call *call)
+{
+   struct pipe_fence_handle *fence =
+      object_get(r, call_arg(call, "fence"), OBJECT_FENCE);
+
+   if (fence)
+      r->screen->fence_signalled(r->screen, fence);
+}
+
+
+static void
+replay_context_destroy(struct replay *r, const struct call *call)
+{
+   object_remove(r, call_arg(call, "pipe"), OBJECT_CONTEXT);
+}
+
+
+/**
+ * Bind the user vertex and index buffer contents traced with the draw.
+ * \return FALSE if they weren't traced
+ */
+static boolean
+bind_user_buffers(struct replay_context *ctx, const struct call *call,
+                  struct pipe_draw_info *info)
+{
+   struct pipe_context *pipe = ctx->pipe;
+
+   if (ctx->user_vertex_buffers) {
+      const struct value *v = call_arg(call, "user_buffers");
+      unsigned slot;
+
+      if (!v || v->type != VALUE_ARRAY)
+         return FALSE;
+
+      for (slot = 0; slot < PIPE_MAX_ATTRIBS; slot++) {
+         const struct value *elem = value_elem(v, slot);
+         const struct value *data = value_member(elem, "data");
+         struct pipe_vertex_buffer vb;
+
+         if (!(ctx->user_vertex_buffers & (1u << slot)) ||
+             !data || data->type != VALUE_BYTES)
+            continue;
+
+         /* The bytes were traced from the offset on, point the driver at
+          * where the start of the user memory would be.
+          */
+         vb = ctx->vertex_buffers[slot];
+         vb.user_buffer = (const uint8_t *) data->u.blob->data -
+                          value_uint(value_member(elem, "offset"));
+         pipe->set_vertex_buffers(pipe, slot, 1, &vb);
+      }
+   }
+
+   if (info->indexed && ctx->user_index_buffer) {
+      const struct value *data = call_arg(call, "user_indices");
+      struct pipe_index_buffer ib;
+
+      if (!data || data->type != VALUE_BYTES)
+         return FALSE;
+
+      /* The indices were traced from the first one drawn on. */
+      ib = ctx->index_buffer;
+      ib.offset = 0;
+      ib.user_buffer = data->u.blob->data;
+      pipe->set_index_buffer(pipe, &ib);
+      info->start = 0;
+   }
+
+   return TRUE;
+}
+
+
+static void
+replay_context_draw_vbo(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "info");
+   struct pipe_draw_info info;
+   CALL_PIPE(call);
+
+   memset(&info, 0, sizeof info);
+   replay_member(bool, v, &info, indexed);
+   replay_member(uint, v, &info, mode);
+   replay_member(uint, v, &info, start);
+   replay_member(uint, v, &info, count);
+   replay_member(uint, v, &info, start_instance);
+   replay_member(uint, v, &info, instance_count);
+   replay_member(int, v, &info, index_bias);
+   replay_member(uint, v, &info, min_index);
+   replay_member(uint, v, &info, max_index);
+   replay_member(bool, v, &info, primitive_restart);
+   replay_member(uint, v, &info, restart_index);
+   info.count_from_stream_output =
+      object_get(r, value_member(v, "count_from_stream_output"),
+                 OBJECT_SO_TARGET);
+
+   if (ctx->user_vertex_buffers || (info.indexed && ctx->user_index_buffer)) {
+      if (!bind_user_buffers(ctx, call, &info)) {
+         if (!r->skipped_draws)
+            fprintf(stderr, "warning: call %u: user buffer contents "
+                    "weren't traced, skipping the draws using them\n",
+                    call->no);
+         r->skipped_draws++;
+         return;
+      }
+   }
+
+   pipe->draw_vbo(pipe, &info);
+}
+
+
+static void
+replay_context_create_query(struct replay *r, const struct call *call)
+{
+   struct pipe_query *query;
+   uint64_t query_type;
+   CALL_PIPE(call);
+
+   query_type = value_uint(call_arg(call, "query_type"));
+   if (query_type >= PIPE_QUERY_TYPES &&
+       query_type < PIPE_QUERY_DRIVER_SPECIFIC)
+      return;
+
+   query = pipe->create_query(pipe, query_type);
+   object_add(r, &call->ret, OBJECT_QUERY, query, ctx);
+}
+
+
+static void
+replay_context_destroy_query(struct replay *r, const struct call *call)
+{
+   object_remove(r, call_arg(call, "query"), OBJECT_QUERY);
+}
+
+
+static void
+replay_context_begin_query(struct replay *r, const struct call *call)
+{
+   struct pipe_query *query;
+   CALL_PIPE(call);
+
+   query = object_get(r, call_arg(call, "query"), OBJECT_QUERY);
+   if (query)
+      pipe->begin_query(pipe, query);
+}
+
+
+static void
+replay_context_end_query(struct replay *r, const struct call *call)
+{
+   struct pipe_query *query;
+   CALL_PIPE(call);
+
+   query = object_get(r, call_arg(call, "query"), OBJECT_QUERY);
+   if (query)
+      pipe->end_query(pipe, query);
+}
+
+
+static void
+replay_context_get_query_result(struct replay *r, const struct call *call)
+{
+   union pipe_query_result result;
+   struct pipe_query *query;
+   CALL_PIPE(call);
+
+   /*
+    * Whether the application waited isn't traced, but it must have if the
+    * result was ready.
+    */
+   query = object_get(r, call_arg(call, "query"), OBJECT_QUERY);
+   if (query)
+      pipe->get_query_result(pipe, query, value_bool(&call->ret), &result);
+}
+
+
+static void
+replay_context_render_condition(struct replay *r, const struct call *call)
+{
+   CALL_PIPE(call);
+
+   pipe->render_condition(pipe,
+                          object_get(r, call_arg(call, "query"), OBJECT_QUERY),
+                          value_bool(call_arg(call, "condition")),
+                          value_uint(call_arg(call, "mode")));
+}
+
+
+static void
+replay_context_create_blend_state(struct replay *r, const struct call *call)
+{
+   struct pipe_blend_state state;
+   CALL_PIPE(call);
+
+   decode_blend_state(call_arg(call, "state"), &state);
+   object_add(r, &call->ret, OBJECT_BLEND,
+              pipe->create_blend_state(pipe, &state), ctx);
+}
+
+
+static void
+replay_context_create_sampler_state(struct replay *r, const struct call *call)
+{
+   struct pipe_sampler_state state;
+   CALL_PIPE(call);
+
+   decode_sampler_state(call_arg(call, "state"), &state);
+   object_add(r, &call->ret, OBJECT_SAMPLER,
+              pipe->create_sampler_state(pipe, &state), ctx);
+}
+
+
+static void
+replay_context_create_rasterizer_state(struct replay *r,
+                                       const struct call *call)
+{
+   struct pipe_rasterizer_state state;
+   CALL_PIPE(call);
+
+   decode_rasterizer_state(call_arg(call, "state"), &state);
+   object_add(r, &call->ret, OBJECT_RASTERIZER,
+              pipe->create_rasterizer_state(pipe, &state), ctx);
+}
+
+
+static void
+replay_context_create_depth_stencil_alpha_state(struct replay *r,
+                                                const struct call *call)
+{
+   struct pipe_depth_stencil_alpha_state state;
+   CALL_PIPE(call);
+
+   decode_depth_stencil_alpha_state(call_arg(call, "state"), &state);
+   object_add(r, &call->ret, OBJECT_DEPTH_STENCIL_ALPHA,
+              pipe->create_depth_stencil_alpha_state(pipe, &state), ctx);
+}
+
+
+#define REPLAY_SHADER_STATE(_shader) \
+   static void \
+   replay_context_create_##_shader##_state(struct replay *r, \
+                                           const struct call *call) \
+   { \
+      struct pipe_shader_state state; \
+      CALL_PIPE(call); \
+      if (decode_shader_state(r, call_arg(call, "state"), &state)) \
+         object_add(r, &call->ret, OBJECT_##_shader, \
+                    pipe->create_##_shader##_state(pipe, &state), ctx); \
+   }
+
+#define OBJECT_fs OBJECT_FS
+#define OBJECT_vs OBJECT_VS
+#define OBJECT_gs OBJECT_GS
+
+REPLAY_SHADER_STATE(fs)
+REPLAY_SHADER_STATE(vs)
+REPLAY_SHADER_STATE(gs)
+
+#undef REPLAY_SHADER_STATE
+
+
+/** Binding and deletion of the state objects */
+#define REPLAY_STATE(_name, _type) \
+   static void \
+   replay_context_bind_##_name(struct replay *r, const struct call *call) \
+   { \
+      CALL_PIPE(call); \
+      pipe->bind_##_name(pipe, object_get(r, call_arg(call, "state"), \
+                                          _type)); \
+   } \
+   \
+   static void \
+   replay_context_delete_##_name(struct replay *r, const struct call *call) \
+   { \
+      object_remove(r, call_arg(call, "state"), _type); \
+   }
+
+REPLAY_STATE(blend_state, OBJECT_BLEND)
+REPLAY_STATE(rasterizer_state, OBJECT_RASTERIZER)
+REPLAY_STATE(depth_stencil_alpha_state, OBJECT_DEPTH_STENCIL_ALPHA)
+REPLAY_STATE(fs_state, OBJECT_FS)
+REPLAY_STATE(vs_state, OBJECT_VS)
+REPLAY_STATE(gs_state, OBJECT_GS)
+REPLAY_STATE(vertex_elements_state, OBJECT_VERTEX_ELEMENTS)
+
+#undef REPLAY_STATE
+
+
+static void
+replay_context_delete_sampler_state(struct replay *r, const struct call *call)
+{
+   object_remove(r, call_arg(call, "state"), OBJECT_SAMPLER);
+}
+
+
+static void
+replay_context_bind_sampler_states(struct replay *r, const struct call *call)
+{
+   const struct value *states = call_arg(call, "states");
+   void *samplers[PIPE_MAX_SAMPLERS];
+   unsigned num_states = value_uint(call_arg(call, "num_states"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num_states = MIN2(num_states, PIPE_MAX_SAMPLERS);
+   for (i = 0; i < num_states; i++)
+      samplers[i] = object_get(r, value_elem(states, i), OBJECT_SAMPLER);
+
+   pipe->bind_sampler_states(pipe,
+                             value_uint(call_arg(call, "shader")),
+                             value_uint(call_arg(call, "start")),
+                             num_states, samplers);
+}
+
+
+static void
+replay_context_create_vertex_elements_state(struct replay *r,
+                                            const struct call *call)
+{
+   const struct value *elements = call_arg(call, "elements");
+   struct pipe_vertex_element velems[PIPE_MAX_ATTRIBS];
+   unsigned num_elements = value_uint(call_arg(call, "num_elements"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num_elements = MIN2(num_elements, PIPE_MAX_ATTRIBS);
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < num_elements; i++) {
+      const struct value *elem = value_elem(elements, i);
+      replay_member(uint, elem, &velems[i], src_offset);
+      replay_member(uint, elem, &velems[i], vertex_buffer_index);
+      replay_member(format, elem, &velems[i], src_format);
+      /* not traced */
+      velems[i].instance_divisor = 0;
+   }
+
+   object_add(r, &call->ret, OBJECT_VERTEX_ELEMENTS,
+              pipe->create_vertex_elements_state(pipe, num_elements, velems),
+              ctx);
+}
+
+
+static void
+replay_context_set_blend_color(struct replay *r, const struct call *call)
+{
+   struct pipe_blend_color state;
+   CALL_PIPE(call);
+
+   replay_member_array(float, call_arg(call, "state"), &state, color);
+   pipe->set_blend_color(pipe, &state);
+}
+
+
+static void
+replay_context_set_stencil_ref(struct replay *r, const struct call *call)
+{
+   struct pipe_stencil_ref state;
+   CALL_PIPE(call);
+
+   replay_member_array(uint, call_arg(call, "state"), &state, ref_value);
+   pipe->set_stencil_ref(pipe, &state);
+}
+
+
+static void
+replay_context_set_clip_state(struct replay *r, const struct call *call)
+{
+   const struct value *ucp = value_member(call_arg(call, "state"), "ucp");
+   struct pipe_clip_state state;
+   unsigned i, j;
+   CALL_PIPE(call);
+
+   for (i = 0; i < PIPE_MAX_CLIP_PLANES; i++) {
+      const struct value *plane = value_elem(ucp, i);
+      for (j = 0; j < 4; j++)
+         state.ucp[i][j] = value_float(value_elem(plane, j));
+   }
+   pipe->set_clip_state(pipe, &state);
+}
+
+
+static void
+replay_context_set_sample_mask(struct replay *r, const struct call *call)
+{
+   CALL_PIPE(call);
+
+   pipe->set_sample_mask(pipe, value_uint(call_arg(call, "sample_mask")));
+}
+
+
+static void
+replay_context_set_constant_buffer(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "constant_buffer");
+   const struct value *user_buffer = value_member(v, "user_buffer");
+   struct pipe_constant_buffer cb;
+   CALL_PIPE(call);
+
+   if (!v || v->type != VALUE_STRUCT) {
+      pipe->set_constant_buffer(pipe,
+                                value_uint(call_arg(call, "shader")),
+                                value_uint(call_arg(call, "index")),
+                                NULL);
+      return;
+   }
+
+   memset(&cb, 0, sizeof cb);
+   cb.buffer = object_get(r, value_member(v, "buffer"), OBJECT_RESOURCE);
+   replay_member(uint, v, &cb, buffer_offset);
+   replay_member(uint, v, &cb, buffer_size);
+   if (user_buffer && user_buffer->type == VALUE_BYTES) {
+      cb.user_buffer = user_buffer->u.blob->data;
+      cb.buffer_size = MIN2(cb.buffer_size, user_buffer->u.blob->size);
+   }
+
+   pipe->set_constant_buffer(pipe,
+                             value_uint(call_arg(call, "shader")),
+                             value_uint(call_arg(call, "index")),
+                             &cb);
+}
+
+
+static void
+replay_context_set_framebuffer_state(struct replay *r,
+                                     const struct call *call)
+{
+   const struct value *v = call_arg(call, "state");
+   const struct value *cbufs = value_member(v, "cbufs");
+   struct pipe_framebuffer_state fb;
+   unsigned i;
+   CALL_PIPE(call);
+
+   memset(&fb, 0, sizeof fb);
+   replay_member(uint, v, &fb, width);
+   replay_member(uint, v, &fb, height);
+   replay_member(uint, v, &fb, nr_cbufs);
+   fb.nr_cbufs = MIN2(fb.nr_cbufs, PIPE_MAX_COLOR_BUFS);
+   for (i = 0; i < fb.nr_cbufs; i++)
+      fb.cbufs[i] = object_get(r, value_elem(cbufs, i), OBJECT_SURFACE);
+   fb.zsbuf = object_get(r, value_member(v, "zsbuf"), OBJECT_SURFACE);
+
+   pipe->set_framebuffer_state(pipe, &fb);
+   util_copy_framebuffer_state(&ctx->fb, &fb);
+}
+
+
+static void
+replay_context_set_polygon_stipple(struct replay *r, const struct call *call)
+{
+   struct pipe_poly_stipple state;
+   CALL_PIPE(call);
+
+   replay_member_array(uint, call_arg(call, "state"), &state, stipple);
+   pipe->set_polygon_stipple(pipe, &state);
+}
+
+
+/**
+ * Only the first scissor and viewport are traced, so they are repeated.
+ */
+static void
+replay_context_set_scissor_states(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "states");
+   struct pipe_scissor_state states[PIPE_MAX_VIEWPORTS];
+   unsigned num = value_uint(call_arg(call, "num_scissors"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num = MIN2(num, PIPE_MAX_VIEWPORTS);
+   for (i = 0; i < num; i++) {
+      replay_member(uint, v, &states[i], minx);
+      replay_member(uint, v, &states[i], miny);
+      replay_member(uint, v, &states[i], maxx);
+      replay_member(uint, v, &states[i], maxy);
+   }
+
+   pipe->set_scissor_states(pipe, value_uint(call_arg(call, "start_slot")),
+                            num, states);
+}
+
+
+static void
+replay_context_set_viewport_states(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "states");
+   struct pipe_viewport_state states[PIPE_MAX_VIEWPORTS];
+   unsigned num = value_uint(call_arg(call, "num_viewports"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num = MIN2(num, PIPE_MAX_VIEWPORTS);
+   for (i = 0; i < num; i++) {
+      replay_member_array(float, v, &states[i], scale);
+      replay_member_array(float, v, &states[i], translate);
+   }
+
+   pipe->set_viewport_states(pipe, value_uint(call_arg(call, "start_slot")),
+                             num, states);
+}
+
+
+static void
+replay_context_create_sampler_view(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "templ");
+   const struct value *u = value_member(v, "u");
+   struct pipe_resource *resource;
+   struct pipe_sampler_view templ;
+   CALL_PIPE(call);
+
+   resource = object_get(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+   if (!resource)
+      return;
+
+   memset(&templ, 0, sizeof templ);
+   replay_member(format, v, &templ, format);
+   if (resource->target == PIPE_BUFFER) {
+      const struct value *buf = value_member(u, "buf");
+      replay_member(uint, buf, &templ.u.buf, first_element);
+      replay_member(uint, buf, &templ.u.buf, last_element);
+   }
+   else {
+      const struct value *tex = value_member(u, "tex");
+      replay_member(uint, tex, &templ.u.tex, first_layer);
+      replay_member(uint, tex, &templ.u.tex, last_layer);
+      replay_member(uint, tex, &templ.u.tex, first_level);
+      replay_member(uint, tex, &templ.u.tex, last_level);
+   }
+   replay_member(uint, v, &templ, swizzle_r);
+   replay_member(uint, v, &templ, swizzle_g);
+   replay_member(uint, v, &templ, swizzle_b);
+   replay_member(uint, v, &templ, swizzle_a);
+
+   object_add(r, &call->ret, OBJECT_SAMPLER_VIEW,
+              pipe->create_sampler_view(pipe, resource, &templ), ctx);
+}
+
+
+static void
+replay_context_sampler_view_destroy(struct replay *r, const struct call *call)
+{
+   object_remove(r, call_arg(call, "view"), OBJECT_SAMPLER_VIEW);
+}
+
+
+static void
+replay_context_create_surface(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "surf_tmpl");
+   const struct value *u = value_member(v, "u");
+   struct pipe_resource *resource;
+   struct pipe_surface templ;
+   CALL_PIPE(call);
+
+   resource = object_get(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+   if (!resource)
+      return;
+
+   memset(&templ, 0, sizeof templ);
+   replay_member(format, v, &templ, format);
+   replay_member(uint, v, &templ, width);
+   replay_member(uint, v, &templ, height);
+   if (resource->target == PIPE_BUFFER) {
+      const struct value *buf = value_member(u, "buf");
+      replay_member(uint, buf, &templ.u.buf, first_element);
+      replay_member(uint, buf, &templ.u.buf, last_element);
+   }
+   else {
+      const struct value *tex = value_member(u, "tex");
+      replay_member(uint, tex, &templ.u.tex, level);
+      replay_member(uint, tex, &templ.u.tex, first_layer);
+      replay_member(uint, tex, &templ.u.tex, last_layer);
+   }
+
+   object_add(r, &call->ret, OBJECT_SURFACE,
+              pipe->create_surface(pipe, resource, &templ), ctx);
+}
+
+
+static void
+replay_context_surface_destroy(struct replay *r, const struct call *call)
+{
+   object_remove(r, call_arg(call, "surface"), OBJECT_SURFACE);
+}
+
+
+static void
+replay_context_set_sampler_views(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "views");
+   struct pipe_sampler_view *views[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned num = value_uint(call_arg(call, "num"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num = MIN2(num, PIPE_MAX_SHADER_SAMPLER_VIEWS);
+   for (i = 0; i < num; i++)
+      views[i] = object_get(r, value_elem(v, i), OBJECT_SAMPLER_VIEW);
+
+   pipe->set_sampler_views(pipe,
+                           value_uint(call_arg(call, "shader")),
+                           value_uint(call_arg(call, "start")),
+                           num, views);
+}
+
+
+static void
+replay_context_set_vertex_buffers(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "buffers");
+   struct pipe_vertex_buffer buffers[PIPE_MAX_ATTRIBS];
+   unsigned start_slot = value_uint(call_arg(call, "start_slot"));
+   unsigned num = value_uint(call_arg(call, "num_buffers"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num = MIN2(num, PIPE_MAX_ATTRIBS - MIN2(start_slot, PIPE_MAX_ATTRIBS));
+   memset(buffers, 0, sizeof buffers);
+   for (i = 0; i < num; i++) {
+      const struct value *elem = value_elem(v, i);
+      unsigned slot = 1u << (start_slot + i);
+
+      replay_member(uint, elem, &buffers[i], stride);
+      replay_member(uint, elem, &buffers[i], buffer_offset);
+      buffers[i].buffer = object_get(r, value_member(elem, "buffer"),
+                                     OBJECT_RESOURCE);
+
+      if (value_uint(value_member(elem, "user_buffer")))
+         ctx->user_vertex_buffers |= slot;
+      else
+         ctx->user_vertex_buffers &= ~slot;
+      ctx->vertex_buffers[start_slot + i] = buffers[i];
+   }
+
+   pipe->set_vertex_buffers(pipe, start_slot, num,
+                            v && v->type == VALUE_ARRAY ? buffers : NULL);
+}
+
+
+static void
+replay_context_set_index_buffer(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "ib");
+   struct pipe_index_buffer ib;
+   CALL_PIPE(call);
+
+   if (!v || v->type != VALUE_STRUCT) {
+      ctx->user_index_buffer = FALSE;
+      pipe->set_index_buffer(pipe, NULL);
+      return;
+   }
+
+   memset(&ib, 0, sizeof ib);
+   replay_member(uint, v, &ib, index_size);
+   replay_member(uint, v, &ib, offset);
+   ib.buffer = object_get(r, value_member(v, "buffer"), OBJECT_RESOURCE);
+   ctx->user_index_buffer = value_uint(value_member(v, "user_buffer")) != 0;
+   ctx->index_buffer = ib;
+
+   pipe->set_index_buffer(pipe, &ib);
+}
+
+
+static void
+replay_context_create_stream_output_target(struct replay *r,
+                                           const struct call *call)
+{
+   struct pipe_resource *resource;
+   CALL_PIPE(call);
+
+   resource = object_get(r, call_arg(call, "res"), OBJECT_RESOURCE);
+   if (!resource)
+      return;
+
+   object_add(r, &call->ret, OBJECT_SO_TARGET,
+              pipe->create_stream_output_target(
+                 pipe, resource,
+                 value_uint(call_arg(call, "buffer_offset")),
+                 value_uint(call_arg(call, "buffer_size"))),
+              ctx);
+}
+
+
+static void
+replay_context_stream_output_target_destroy(struct replay *r,
+                                            const struct call *call)
+{
+   object_remove(r, call_arg(call, "target"), OBJECT_SO_TARGET);
+}
+
+
+static void
+replay_context_set_stream_output_targets(struct replay *r,
+                                         const struct call *call)
+{
+   const struct value *tgs = call_arg(call, "tgs");
+   const struct value *offsets = call_arg(call, "offsets");
+   struct pipe_stream_output_target *targets[PIPE_MAX_SO_BUFFERS];
+   unsigned offs[PIPE_MAX_SO_BUFFERS];
+   unsigned num = value_uint(call_arg(call, "num_targets"));
+   unsigned i;
+   CALL_PIPE(call);
+
+   num = MIN2(num, PIPE_MAX_SO_BUFFERS);
+   for (i = 0; i < num; i++) {
+      targets[i] = object_get(r, value_elem(tgs, i), OBJECT_SO_TARGET);
+      offs[i] = value_uint(value_elem(offsets, i));
+   }
+
+   pipe->set_stream_output_targets(pipe, num, targets, offs);
+}
+
+
+static void
+replay_context_resource_copy_region(struct replay *r, const struct call *call)
+{
+   struct pipe_resource *dst, *src;
+   struct pipe_box box;
+   CALL_PIPE(call);
+
+   dst = object_get(r, call_arg(call, "dst"), OBJECT_RESOURCE);
+   src = object_get(r, call_arg(call, "src"), OBJECT_RESOURCE);
+   if (!dst || !src)
+      return;
+
+   decode_box(call_arg(call, "src_box"), &box);
+   pipe->resource_copy_region(pipe, dst,
+                              value_uint(call_arg(call, "dst_level")),
+                              value_uint(call_arg(call, "dstx")),
+                              value_uint(call_arg(call, "dsty")),
+                              value_uint(call_arg(call, "dstz")),
+                              src,
+                              value_uint(call_arg(call, "src_level")),
+                              &box);
+}
+
+
+static void
+replay_context_blit(struct replay *r, const struct call *call)
+{
+   const struct value *v = call_arg(call, "info");
+   const struct value *dst = value_member(v, "dst");
+   const struct value *src = value_member(v, "src");
+   const struct value *mask = value_member(v, "mask");
+   const struct value *scissor = value_member(v, "scissor");
+   struct pipe_blit_info info;
+   CALL_PIPE(call);
+
+   memset(&info, 0, sizeof info);
+
+   info.dst.resource = object_get(r, value_member(dst, "resource"),
+                                  OBJECT_RESOURCE);
+   replay_member(uint, dst, &info.dst, level);
+   replay_member(format, dst, &info.dst, format);
+   decode_box(value_member(dst, "box"), &info.dst.box);
+
+   info.src.resource = object_get(r, value_member(src, "resource"),
+                                  OBJECT_RESOURCE);
+   replay_member(uint, src, &info.src, level);
+   replay_member(format, src, &info.src, format);
+   decode_box(value_member(src, "box"), &info.src.box);
+
+   if (!info.dst.resource || !info.src.resource)
+      return;
+
+   /* the mask is traced as a "RGBAZS" string */
+   if (mask && mask->type == VALUE_STRING && strlen(mask->str) == 6) {
+      static const unsigned masks[6] = {
+         PIPE_MASK_R, PIPE_MASK_G, PIPE_MASK_B, PIPE_MASK_A,
+         PIPE_MASK_Z, PIPE_MASK_S
+      };
+      unsigned i;
+
+      for (i = 0; i < 6; i++) {
+         if (mask->str[i] != '-')
+            info.mask |= masks[i];
+      }
+   }
+
+   replay_member(uint, v, &info, filter);
+   replay_member(bool, v, &info, scissor_enable);
+   replay_member(uint, scissor, &info.scissor, minx);
+   replay_member(uint, scissor, &info.scissor, miny);
+   replay_member(uint, scissor, &info.scissor, maxx);
+   replay_member(uint, scissor, &info.scissor, maxy);
+
+   pipe->blit(pipe, &info);
+}
+
+
+static void
+replay_context_flush_resource(struct replay *r, const struct call *call)
+{
+   struct pipe_resource *resource;
+   CALL_PIPE(call);
+
+   resource = object_get(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+   if (resource && pipe->flush_resource)
+      pipe->flush_resource(pipe, resource);
+}
+
+
+static void
+decode_color(const struct value *v, union pipe_color_union *color)
+{
+   unsigned i;
+
+   for (i = 0; i < 4; i++)
+      color->f[i] = value_float(value_elem(v, i));
+}
+
+
+static void
+replay_context_clear(struct replay *r, const struct call *call)
+{
+   union pipe_color_union color;
+   CALL_PIPE(call);
+
+   decode_color(call_arg(call, "color"), &color);
+   pipe->clear(pipe,
+               value_uint(call_arg(call, "buffers")),
+               &color,
+               value_float(call_arg(call, "depth")),
+               value_uint(call_arg(call, "stencil")));
+}
+
+
+static void
+replay_context_clear_render_target(struct replay *r, const struct call *call)
+{
+   union pipe_color_union color;
+   struct pipe_surface *dst;
+   CALL_PIPE(call);
+
+   dst = object_get(r, call_arg(call, "dst"), OBJECT_SURFACE);
+   if (!dst)
+      return;
+
+   decode_color(call_arg(call, "color->f"), &color);
+   pipe->clear_render_target(pipe, dst, &color,
+                             value_uint(call_arg(call, "dstx")),
+                             value_uint(call_arg(call, "dsty")),
+                             value_uint(call_arg(call, "width")),
+                             value_uint(call_arg(call, "height")));
+}
+
+
+static void
+replay_context_clear_depth_stencil(struct replay *r, const struct call *call)
+{
+   struct pipe_surface *dst;
+   CALL_PIPE(call);
+
+   dst = object_get(r, call_arg(call, "dst"), OBJECT_SURFACE);
+   if (!dst)
+      return;
+
+   pipe->clear_depth_stencil(pipe, dst,
+                             value_uint(call_arg(call, "clear_flags")),
+                             value_float(call_arg(call, "depth")),
+                             value_uint(call_arg(call, "stencil")),
+                             value_uint(call_arg(call, "dstx")),
+                             value_uint(call_arg(call, "dsty")),
+                             value_uint(call_arg(call, "width")),
+                             value_uint(call_arg(call, "height")));
+}
+
+
+static void
+replay_context_flush(struct replay *r, const struct call *call)
+{
+   struct pipe_fence_handle *fence = NULL;
+   CALL_PIPE(call);
+
+   if (call->ret.type == VALUE_PTR) {
+      pipe->flush(pipe, &fence, value_uint(call_arg(call, "flags")));
+      object_add(r, &call->ret, OBJECT_FENCE, fence, NULL);
+   }
+   else {
+      pipe->flush(pipe, NULL, value_uint(call_arg(call, "flags")));
+   }
+}
+
+
+/** Size of the texture data traced for a transfer, see tr_dump.c */
+static size_t
+texture_data_size(enum pipe_format format, const struct pipe_box *box,
+                  unsigned stride, unsigned layer_stride)
+{
+   if (box->width <= 0 || box->height <= 0 || box->depth <= 0)
+      return 0;
+
+   return util_format_get_nblocksx(format, box->width) *
+          util_format_get_blocksize(format) +
+          (util_format_get_nblocksy(format, box->height) - 1) * stride +
+          (box->depth - 1) * layer_stride;
+}
+
+
+static void
+replay_context_transfer_inline_write(struct replay *r,
+                                     const struct call *call)
+{
+   const struct value *data = call_arg(call, "data");
+   unsigned stride = value_uint(call_arg(call, "stride"));
+   unsigned layer_stride = value_uint(call_arg(call, "layer_stride"));
+   struct pipe_resource *resource;
+   struct pipe_box box;
+   CALL_PIPE(call);
+
+   resource = object_get(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+   if (!resource)
+      return;
+
+   decode_box(call_arg(call, "box"), &box);
+
+   if (!data || data->type != VALUE_BYTES)
+      return;
+
+   if (resource->target == PIPE_BUFFER) {
+      if (!data->u.blob->size)
+         return;
+      box.width = MIN2(box.width, (int) data->u.blob->size);
+   }
+   else if (data->u.blob->size < texture_data_size(resource->format, &box,
+                                                    stride, layer_stride)) {
+      /* older trace drivers left texture data out */
+      r->skipped_uploads++;
+      return;
+   }
+
+   pipe->transfer_inline_write(pipe, resource,
+                               value_uint(call_arg(call, "level")),
+                               value_uint(call_arg(call, "usage")),
+                               &box, data->u.blob->data,
+                               stride, layer_stride);
+}
+
+
+static void
+replay_context_texture_barrier(struct replay *r, const struct call *call)
+{
+   CALL_PIPE(call);
+
+   if (pipe->texture_barrier)
+      pipe->texture_barrier(pipe);
+}
+
+
+static void
+replay_context_memory_barrier(struct replay *r, const struct call *call)
+{
+   CALL_PIPE(call);
+
+   if (pipe->memory_barrier)
+      pipe->memory_barrier(pipe, value_uint(call_arg(call, "flags")));
+}
+
+
+/*
+ * Methods.  Calls to the others, like the screen queries, are not replayed.
+ */
+
+struct method {
+   const char *klass;
+   const char *name;
+   replay_func func;
+};
+
+#define SCREEN(_name) { "pipe_screen", #_name, replay_screen_##_name }
+#define CONTEXT(_name) { "pipe_context", #_name, replay_context_##_name }
+
+static const struct method methods[] = {
+   SCREEN(context_create),
+   SCREEN(resource_create),
+   SCREEN(resource_destroy),
+   SCREEN(flush_frontbuffer),
+   SCREEN(fence_reference),
+   SCREEN(fence_finish),
+   SCREEN(fence_signalled),
+   CONTEXT(destroy),
+   CONTEXT(draw_vbo),
+   CONTEXT(create_query),
+   CONTEXT(destroy_query),
+   CONTEXT(begin_query),
+   CONTEXT(end_query),
+   CONTEXT(get_query_result),
+   CONTEXT(render_condition),
+   CONTEXT(create_blend_state),
+   CONTEXT(bind_blend_state),
+   CONTEXT(delete_blend_state),
+   CONTEXT(create_sampler_state),
+   CONTEXT(bind_sampler_states),
+   CONTEXT(delete_sampler_state),
+   CONTEXT(create_rasterizer_state),
+   CONTEXT(bind_rasterizer_state),
+   CONTEXT(delete_rasterizer_state),
+   CONTEXT(create_depth_stencil_alpha_state),
+   CONTEXT(bind_depth_stencil_alpha_state),
+   CONTEXT(delete_depth_stencil_alpha_state),
+   CONTEXT(create_fs_state),
+   CONTEXT(bind_fs_state),
+   CONTEXT(delete_fs_state),
+   CONTEXT(create_vs_state),
+   CONTEXT(bind_vs_state),
+   CONTEXT(delete_vs_state),
+   CONTEXT(create_gs_state),
+   CONTEXT(bind_gs_state),
+   CONTEXT(delete_gs_state),
+   CONTEXT(create_vertex_elements_state),
+   CONTEXT(bind_vertex_elements_state),
+   CONTEXT(delete_vertex_elements_state),
+   CONTEXT(set_blend_color),
+   CONTEXT(set_stencil_ref),
+   CONTEXT(set_clip_state),
+   CONTEXT(set_sample_mask),
+   CONTEXT(set_constant_buffer),
+   CONTEXT(set_framebuffer_state),
+   CONTEXT(set_polygon_stipple),
+   CONTEXT(set_scissor_states),
+   CONTEXT(set_viewport_states),
+   CONTEXT(create_sampler_view),
+   CONTEXT(sampler_view_destroy),
+   CONTEXT(create_surface),
+   CONTEXT(surface_destroy),
+   CONTEXT(set_sampler_views),
+   CONTEXT(set_vertex_buffers),
+   CONTEXT(set_index_buffer),
+   CONTEXT(create_stream_output_target),
+   CONTEXT(stream_output_target_destroy),
+   CONTEXT(set_stream_output_targets),
+   CONTEXT(resource_copy_region),
+   CONTEXT(blit),
+   CONTEXT(flush_resource),
+   CONTEXT(clear),
+   CONTEXT(clear_render_target),
+   CONTEXT(clear_depth_stencil),
+   CONTEXT(flush),
+   CONTEXT(transfer_inline_write),
+   CONTEXT(texture_barrier),
+   CONTEXT(memory_barrier),
+};
+
+#undef SCREEN
+#undef CONTEXT
+
+#define METHOD_FLUSH_FRONTBUFFER 3
+#define METHOD_DRAW_VBO 8
+#define METHOD_FLUSH 64
+
+
+static int
+find_method(const char *klass, const char *name)
+{
+   unsigned i;
+
+   for (i = 0; i < Elements(methods); i++) {
+      if (strcmp(methods[i].klass, klass) == 0 &&
+          strcmp(methods[i].name, name) == 0)
+         return i;
+   }
+   return -1;
+}
+
+
+/*
+ * Frames and statistics.
+ */
+
+struct method_stats {
+   unsigned method;
+   uint64_t count;
+   int64_t time;
+};
+
+struct frame_stats {
+   unsigned first_call;
+   unsigned num_calls;
+   unsigned num_draws;
+   int64_t time;
+   uint32_t checksum;
+};
+
+
+/**
+ * CRC32 of the first color buffer, or of the frontbuffer.
+ */
+static uint32_t
+checksum_resource(struct pipe_context *pipe, struct pipe_resource *resource,
+                  unsigned level, unsigned layer)
+{
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   const uint8_t *map;
+   unsigned y, rows, row_size;
+   uint32_t crc = 0;
+
+   u_box_2d_zslice(0, 0, layer,
+                   u_minify(resource->width0, level),
+                   u_minify(resource->height0, level), &box);
+
+   map = pipe->transfer_map(pipe, resource, level, PIPE_TRANSFER_READ,
+                            &box, &transfer);
+   if (!map)
+      return 0;
+
+   rows = util_format_get_nblocksy(resource->format, box.height);
+   row_size = util_format_get_stride(resource->format, box.width);
+   for (y = 0; y < rows; y++)
+      crc ^= util_hash_crc32(map + y * transfer->stride, row_size) + y;
+
+   pipe->transfer_unmap(pipe, transfer);
+
+   return crc;
+}
+
+
+static uint32_t
+frame_checksum(struct replay *r, const struct call *call)
+{
+   struct replay_context *ctx = r->ctx;
+   struct pipe_surface *cbuf;
+
+   if (!ctx)
+      return 0;
+
+   if (call->method == METHOD_FLUSH_FRONTBUFFER) {
+      struct pipe_resource *resource =
+         object_get(r, call_arg(call, "resource"), OBJECT_RESOURCE);
+      if (!resource)
+         return 0;
+      return checksum_resource(ctx->pipe, resource,
+                               value_uint(call_arg(call, "level")),
+                               value_uint(call_arg(call, "layer")));
+   }
+
+   cbuf = ctx->fb.nr_cbufs ? ctx->fb.cbufs[0] : NULL;
+   if (!cbuf || cbuf->texture->target == PIPE_BUFFER)
+      return 0;
+
+   return checksum_resource(ctx->pipe, cbuf->texture, cbuf->u.tex.level,
+                            cbuf->u.tex.first_layer);
+}
+
+
+/**
+ * Wait for the rendering of the frame to finish.
+ */
+static void
+finish_frame(struct replay *r)
+{
+   struct pipe_fence_handle *fence = NULL;
+
+   if (!r->ctx)
+      return;
+
+   r->ctx->pipe->flush(r->ctx->pipe, &fence, 0);
+   if (fence) {
+      r->screen->fence_finish(r->screen, fence, PIPE_TIMEOUT_INFINITE);
+      r->screen->fence_reference(r->screen, &fence, NULL);
+   }
+}
+
+
+/**
+ * Replay the whole trace once.
+ */
+static void
+replay_pass(struct replay *r, const struct trace *trace,
+            int frame_method, struct frame_stats *frames, unsigned num_frames,
+            struct method_stats *stats, boolean checksums)
+{
+   unsigned i, frame = 0;
+   int64_t frame_start = os_time_get_nano();
+
+   for (i = 0; i < trace->num_calls; i++) {
+      const struct call *call = &trace->calls[i];
+      int64_t start, end;
+
+      if (call->method < 0)
+         continue;
+
+      start = os_time_get_nano();
+      methods[call->method].func(r, call);
+      end = os_time_get_nano();
+
+      stats[call->method].count++;
+      stats[call->method].time += end - start;
+
+      if (call->method == frame_method && frame < num_frames) {
+         finish_frame(r);
+         end = os_time_get_nano();
+         frames[frame].time += end - frame_start;
+         if (checksums)
+            frames[frame].checksum = frame_checksum(r, call);
+         frame++;
+         frame_start = os_time_get_nano();
+      }
+   }
+
+   /* what comes after the last frame isn't timed */
+   replay_cleanup(r);
+}
+
+
+static int
+compare_stats(const void *a, const void *b)
+{
+   const struct method_stats *sa = a, *sb = b;
+
+   if (sa->time != sb->time)
+      return sa->time < sb->time ? 1 : -1;
+   return 0;
+}
+
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "usage: %s [options] TRACE\n"
+           "\n"
+           "Replays a binary gallium trace, recorded with GALLIUM_TRACE and\n"
+           "GALLIUM_TRACE_FORMAT=binary, on a software screen.\n"
+           "\n"
+           "options:\n"
+           "  -l N  replay N times, timing only the passes after the first\n"
+           "  -c    print a CRC32 of the color buffer after every frame\n"
+           "  -q    don't print the frame timings\n",
+           name);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_loader_device *dev = NULL;
+   struct replay r;
+   struct trace trace;
+   struct method_stats stats[Elements(methods)];
+   struct frame_stats *frames;
+   unsigned num_frames = 0, loops = 1, timed_loops, loop;
+   boolean checksums = FALSE, quiet = FALSE;
+   const char *filename = NULL;
+   int frame_method = METHOD_FLUSH;
+   int64_t total = 0;
+   unsigned i, ignored = 0;
+
+   for (i = 1; i < (unsigned) argc; i++) {
+      if (strcmp(argv[i], "-l") == 0 && i + 1 < (unsigned) argc) {
+         int n = atoi(argv[++i]);
+         loops = MAX2(n, 1);
+      }
+      else if (strcmp(argv[i], "-c") == 0)
+         checksums = TRUE;
+      else if (strcmp(argv[i], "-q") == 0)
+         quiet = TRUE;
+      else if (argv[i][0] != '-' && !filename)
+         filename = argv[i];
+      else {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (!filename) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   assert(methods[METHOD_FLUSH_FRONTBUFFER].func ==
+          replay_screen_flush_frontbuffer);
+   assert(methods[METHOD_DRAW_VBO].func == replay_context_draw_vbo);
+   assert(methods[METHOD_FLUSH].func == replay_context_flush);
+
+   if (!trace_load(&trace, filename))
+      return 1;
+
+   /* find the frames */
+   for (i = 0; i < trace.num_calls; i++) {
+      if (trace.calls[i].method == METHOD_FLUSH_FRONTBUFFER) {
+         frame_method = METHOD_FLUSH_FRONTBUFFER;
+         break;
+      }
+   }
+
+   frames = CALLOC(trace.num_calls + 1, sizeof *frames);
+   if (!frames)
+      return 1;
+
+   for (i = 0; i < trace.num_calls; i++) {
+      int method = trace.calls[i].method;
+
+      if (method < 0) {
+         ignored++;
+         continue;
+      }
+      if (!frames[num_frames].num_calls)
+         frames[num_frames].first_call = trace.calls[i].no;
+      frames[num_frames].num_calls++;
+      if (method == METHOD_DRAW_VBO)
+         frames[num_frames].num_draws++;
+      if (method == frame_method)
+         num_frames++;
+   }
+
+   if (!pipe_loader_sw_probe_null(&dev)) {
+      fprintf(stderr, "error: no software device\n");
+      return 1;
+   }
+
+   memset(&r, 0, sizeof r);
+   r.screen = pipe_loader_create_screen(dev, PIPE_SEARCH_DIR);
+   if (!r.screen) {
+      fprintf(stderr, "error: failed to create the screen\n");
+      pipe_loader_release(&dev, 1);
+      return 1;
+   }
+   r.objects = util_hash_table_create(address_hash, address_compare);
+   LIST_INITHEAD(&r.object_list);
+   r.tokens = MALLOC(MAX_SHADER_TOKENS * sizeof *r.tokens);
+
+   printf("%s: %u calls, %u frames, %u calls not replayed\n",
+          r.screen->get_name(r.screen), trace.num_calls, num_frames,
+          ignored);
+
+   memset(stats, 0, sizeof stats);
+   for (i = 0; i < Elements(methods); i++)
+      stats[i].method = i;
+
+   /* the first pass warms the caches up, unless it's the only one */
+   timed_loops = loops > 1 ? loops - 1 : 1;
+   for (loop = 0; loop < loops; loop++) {
+      if (loops == 1 || loop > 0) {
+         replay_pass(&r, &trace, frame_method, frames, num_frames, stats,
+                     checksums && loop + 1 == loops);
+      }
+      else {
+         struct method_stats warm_stats[Elements(methods)];
+         struct frame_stats *warm_frames = CALLOC(num_frames + 1,
+                                                  sizeof *warm_frames);
+
+         memset(warm_stats, 0, sizeof warm_stats);
+         replay_pass(&r, &trace, frame_method, warm_frames, num_frames,
+                     warm_stats, FALSE);
+         FREE(warm_frames);
+      }
+   }
+
+   if (!quiet && num_frames) {
+      printf("\n%8s %12s %8s %8s %12s%s\n", "frame", "first call", "calls",
+             "draws", "time (ms)", checksums ? "        crc" : "");
+      for (i = 0; i < num_frames; i++) {
+         printf("%8u %12u %8u %8u %12.3f", i, frames[i].first_call,
+                frames[i].num_calls, frames[i].num_draws,
+                frames[i].time / timed_loops / 1e6);
+         if (checksums)
+            printf("  0x%08x", frames[i].checksum);
+         printf("\n");
+      }
+   }
+
+   for (i = 0; i < num_frames; i++)
+      total += frames[i].time;
+   if (num_frames)
+      printf("\n%u frames in %.3f ms, %.2f fps\n", num_frames,
+             total / timed_loops / 1e6,
+             total ? num_frames * timed_loops * 1e9 / total : 0.0);
+
+   qsort(stats, Elements(methods), sizeof stats[0], compare_stats);
+   printf("\n%-48s %10s %12s %10s\n", "call", "count", "total (ms)",
+          "avg (us)");
+   for (i = 0; i < Elements(methods); i++) {
+      const struct method *method = &methods[stats[i].method];
+      char name[64];
+
+      if (!stats[i].count)
+         continue;
+
+      util_snprintf(name, sizeof name, "%s::%s", method->klass, method->name);
+      printf("%-48s %10u %12.3f %10.3f\n", name,
+             (unsigned) (stats[i].count / timed_loops),
+             stats[i].time / timed_loops / 1e6,
+             stats[i].time / 1e3 / stats[i].count);
+   }
+
+   if (r.skipped_draws)
+      printf("\n%u draws with untraced user vertex or index buffers "
+             "skipped\n", r.skipped_draws / loops);
+   if (r.skipped_uploads)
+      printf("%u texture uploads without their data skipped\n",
+             r.skipped_uploads / loops);
+   if (r.missing_objects)
+      printf("%u references to unknown objects\n",
+             r.missing_objects / loops);
+
+   util_hash_table_destroy(r.objects);
+   FREE(r.tokens);
+   FREE(frames);
+   trace_free(&trace);
+   r.screen->destroy(r.screen);
+   pipe_loader_release(&dev, 1);
+
+   return 0;
+}
@@ -81,7 +81,7 @@ static int classify_identifier(struct _mesa_glsl_parse_state *, const char *);
 			  "illegal use of reserved word `%s'", yytext);	\
 	 return ERROR_TOK;						\
       } else {								\
-	 yylval->identifier = strdup(yytext);				\
+	 yylval->identifier = linear_strdup(yyextra->linalloc, yytext);	\
 	 return classify_identifier(yyextra, yytext);			\
       }									\
    } while (0)
@@ -228,7 +228,7 @@ HASH		^{SPC}#{SPC}
 <PP>[ \t\r]*			{ }
 <PP>:				return COLON;
 <PP>[_a-zA-Z][_a-zA-Z0-9]*	{
-				   yylval->identifier = strdup(yytext);
+				   yylval->identifier = linear_strdup(yyextra->linalloc, yytext);
 				   return IDENTIFIER;
 				}
 <PP>[1-9][0-9]*			{
@@ -400,7 +400,7 @@ layout		{
                       || yyextra->ARB_compute_shader_enable) {
 		      return LAYOUT_TOK;
 		   } else {
-		      yylval->identifier = strdup(yytext);
+		      yylval->identifier = linear_strdup(yyextra->linalloc, yytext);
 		      return classify_identifier(yyextra, yytext);
 		   }
 		}
@@ -544,8 +544,8 @@ subroutine	KEYWORD(0, 300, 0, 0, SUBROUTINE);
 
 [_a-zA-Z][_a-zA-Z0-9]*	{
 			    struct _mesa_glsl_parse_state *state = yyextra;
-			    void *ctx = state;	
-			    yylval->identifier = ralloc_strdup(ctx, yytext);
+			    void *ctx = state->linalloc;
+			    yylval->identifier = linear_strdup(ctx, yytext);
 			    return classify_identifier(state, yytext);
 			}
 
@@ -64,6 +64,7 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
 
    this->scanner = NULL;
    this->translation_unit.make_empty();
+   this->linalloc = linear_alloc_parent(this, 0);
    this->symbols = new(mem_ctx) glsl_symbol_table;
 
    this->info_log = ralloc_strdup(mem_ctx, "");
@@ -1328,12 +1329,13 @@ ast_struct_specifier::print(void) const
 }
 
 
-ast_struct_specifier::ast_struct_specifier(const char *identifier,
+ast_struct_specifier::ast_struct_specifier(void *lin_ctx,
+					   const char *identifier,
 					   ast_declarator_list *declarator_list)
 {
    if (identifier == NULL) {
       static unsigned anon_count = 1;
-      identifier = ralloc_asprintf(this, "#anon_struct_%04x", anon_count);
+      identifier = linear_asprintf(lin_ctx, "#anon_struct_%04x", anon_count);
       anon_count++;
    }
    name = identifier;
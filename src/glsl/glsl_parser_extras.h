@@ -173,6 +173,16 @@ struct _mesa_glsl_parse_state {
    struct gl_context *const ctx;
    void *scanner;
    exec_list translation_unit;
+
+   /**
+    * Linear allocation context for AST nodes and identifier strings.
+    *
+    * These are created in large numbers while parsing and are all thrown
+    * away together with the parse state, so they don't need ralloc's
+    * per-allocation bookkeeping.
+    */
+   void *linalloc;
+
    glsl_symbol_table *symbols;
 
    unsigned num_supported_versions;
@@ -0,0 +1,1409 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_serialize.cpp
+ *
+ * Binary writer and reader for GLSL IR.
+ *
+ * A blob is laid out as:
+ *
+ *    header     magic, format version, sizeof(ir_variable::data)
+ *    types      every glsl_type referenced by the blob
+ *    functions  names of every ir_function referenced by the blob
+ *    variables  every ir_variable referenced by the blob
+ *    signatures every ir_function_signature referenced by the blob
+ *    body       the instruction stream
+ *
+ * Every table entry only refers to entries of earlier tables (or to earlier
+ * entries of its own table, for types), so the reader can build all of the
+ * referenced objects before decoding the instruction stream.  The writer
+ * fills the tables on demand while encoding the body, so the IR is walked
+ * only once.
+ *
+ * Integers are stored as LEB128 varints (zig-zag encoded when signed).
+ * Instructions are stored as their \c ir_node_type followed by a
+ * type-specific payload; \c ir_type_unset encodes a \c NULL pointer.
+ */
+
+#include <string.h>
+#include "ir_serialize.h"
+#include "glsl_types.h"
+#include "glsl_symbol_table.h"
+#include "program/hash_table.h"
+
+#define IR_BINARY_MAGIC    0x52494c47 /* "GLIR" */
+#define IR_BINARY_VERSION  1
+
+namespace {
+
+enum type_kind {
+   type_kind_builtin,
+   type_kind_array,
+   type_kind_record,
+   type_kind_interface
+};
+
+/**
+ * Map a built-in type to its position in builtin_type_macros.h
+ *
+ * Built-ins are stored as this index, so that the reader hands out the same
+ * singleton pointers the rest of the compiler compares against.  Returns -1
+ * for types that are not built-ins.
+ */
+static int
+builtin_type_index(const glsl_type *type)
+{
+   int i = 0;
+#define DECL_TYPE(NAME, ...)                                    \
+   if (type == glsl_type::NAME##_type)                          \
+      return i;                                                 \
+   i++;
+#define STRUCT_TYPE(NAME)                                       \
+   if (type == glsl_type::struct_##NAME##_type)                 \
+      return i;                                                 \
+   i++;
+#include "builtin_type_macros.h"
+#undef DECL_TYPE
+#undef STRUCT_TYPE
+   return -1;
+}
+
+/**
+ * Inverse of builtin_type_index(); returns \c NULL for bad indices.
+ */
+static const glsl_type *
+builtin_type_from_index(uint64_t idx)
+{
+   uint64_t i = 0;
+#define DECL_TYPE(NAME, ...)                                    \
+   if (idx == i++)                                              \
+      return glsl_type::NAME##_type;
+#define STRUCT_TYPE(NAME)                                       \
+   if (idx == i++)                                              \
+      return glsl_type::struct_##NAME##_type;
+#include "builtin_type_macros.h"
+#undef DECL_TYPE
+#undef STRUCT_TYPE
+   return NULL;
+}
+
+static bool
+always_available(const _mesa_glsl_parse_state *)
+{
+   return true;
+}
+
+
+/**
+ * Growable byte buffer
+ */
+class blob {
+public:
+   blob(void *mem_ctx)
+      : mem_ctx(mem_ctx), data(NULL), size(0), capacity(0)
+   {
+   }
+
+   void write_bytes(const void *bytes, size_t n)
+   {
+      if (n == 0)
+         return;
+
+      if (size + n > capacity) {
+         size_t new_capacity = capacity ? capacity * 2 : 4096;
+         while (new_capacity < size + n)
+            new_capacity *= 2;
+         data = (uint8_t *) reralloc_size(mem_ctx, data, new_capacity);
+         capacity = new_capacity;
+      }
+      memcpy(data + size, bytes, n);
+      size += n;
+   }
+
+   void write_u8(uint8_t v)
+   {
+      write_bytes(&v, 1);
+   }
+
+   void write_uint(uint64_t v)
+   {
+      uint8_t buf[10];
+      unsigned n = 0;
+      do {
+         uint8_t byte = v & 0x7f;
+         v >>= 7;
+         buf[n++] = byte | (v ? 0x80 : 0);
+      } while (v);
+      write_bytes(buf, n);
+   }
+
+   void write_int(int64_t v)
+   {
+      write_uint(((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+   }
+
+   /** Strings are stored as length + 1, with 0 denoting \c NULL. */
+   void write_string(const char *str)
+   {
+      if (str == NULL) {
+         write_uint(0);
+         return;
+      }
+      size_t len = strlen(str);
+      write_uint(len + 1);
+      write_bytes(str, len);
+   }
+
+   void *mem_ctx;
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+};
+
+
+/**
+ * Bounds-checked cursor over a serialized blob
+ *
+ * Reads past the end return zeros and set \c overrun, so the decoder only
+ * needs to check for errors at a few convenient points.
+ */
+class blob_reader {
+public:
+   blob_reader(const uint8_t *data, size_t size)
+      : current(data), end(data + size), overrun(false)
+   {
+   }
+
+   bool read_bytes(void *dst, size_t n)
+   {
+      if (overrun || (size_t) (end - current) < n) {
+         overrun = true;
+         memset(dst, 0, n);
+         return false;
+      }
+      memcpy(dst, current, n);
+      current += n;
+      return true;
+   }
+
+   uint8_t read_u8()
+   {
+      uint8_t v;
+      read_bytes(&v, 1);
+      return v;
+   }
+
+   uint64_t read_uint()
+   {
+      uint64_t v = 0;
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+         if (overrun || current >= end) {
+            overrun = true;
+            return 0;
+         }
+         uint8_t byte = *current++;
+         v |= (uint64_t) (byte & 0x7f) << shift;
+         if (!(byte & 0x80))
+            return v;
+      }
+      overrun = true;
+      return 0;
+   }
+
+   int64_t read_int()
+   {
+      uint64_t v = read_uint();
+      return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+   }
+
+   const char *read_string(void *mem_ctx)
+   {
+      uint64_t len = read_uint();
+      if (len == 0)
+         return NULL;
+      len--;
+      if (overrun || (uint64_t) (end - current) < len) {
+         overrun = true;
+         return NULL;
+      }
+      const char *str = ralloc_strndup(mem_ctx, (const char *) current, len);
+      current += len;
+      return str;
+   }
+
+   const uint8_t *current;
+   const uint8_t *end;
+   bool overrun;
+};
+
+
+class ir_binary_writer {
+public:
+   ir_binary_writer(void *mem_ctx);
+   ~ir_binary_writer();
+
+   uint8_t *write(void *mem_ctx, exec_list *instructions, size_t *size);
+
+private:
+   unsigned type_index(const glsl_type *type);
+   unsigned function_index(const ir_function *f);
+   unsigned variable_index(ir_variable *var);
+   unsigned signature_index(ir_function_signature *sig);
+
+   void write_type_ref(blob *b, const glsl_type *type);
+   void write_constant_data(blob *b, const ir_constant *c);
+   void write_constant(blob *b, const ir_constant *c);
+   void write_list(exec_list *list);
+   void write_ir(ir_instruction *ir);
+   void write_texture(ir_texture *tex);
+
+   void *tmp_ctx;
+
+   blob types;
+   blob functions;
+   blob variables;
+   blob signatures;
+   blob body;
+
+   unsigned num_types;
+   unsigned num_functions;
+   unsigned num_variables;
+   unsigned num_signatures;
+
+   /** Maps each object to its table index + 1. */
+   struct hash_table *ht;
+};
+
+ir_binary_writer::ir_binary_writer(void *tmp_ctx)
+   : tmp_ctx(tmp_ctx), types(tmp_ctx), functions(tmp_ctx),
+     variables(tmp_ctx), signatures(tmp_ctx), body(tmp_ctx),
+     num_types(0), num_functions(0), num_variables(0), num_signatures(0)
+{
+   ht = hash_table_ctor(0, hash_table_pointer_hash, hash_table_pointer_compare);
+}
+
+ir_binary_writer::~ir_binary_writer()
+{
+   hash_table_dtor(ht);
+}
+
+unsigned
+ir_binary_writer::type_index(const glsl_type *type)
+{
+   uintptr_t idx = (uintptr_t) hash_table_find(ht, type);
+   if (idx != 0)
+      return idx - 1;
+
+   /* Register the types this one is built from first, so that the reader
+    * never sees a forward reference.
+    */
+   if (type->is_array()) {
+      unsigned elem = type_index(type->fields.array);
+      types.write_u8(type_kind_array);
+      types.write_uint(elem);
+      types.write_uint(type->length);
+   } else if (type->is_record() || type->is_interface()) {
+      int builtin = builtin_type_index(type);
+
+      if (builtin >= 0) {
+         types.write_u8(type_kind_builtin);
+         types.write_uint(builtin);
+      } else {
+         unsigned *field_types = ralloc_array(tmp_ctx, unsigned, type->length);
+         for (unsigned f = 0; f < type->length; f++)
+            field_types[f] = type_index(type->fields.structure[f].type);
+
+         if (type->is_interface()) {
+            types.write_u8(type_kind_interface);
+            types.write_uint(type->interface_packing);
+         } else {
+            types.write_u8(type_kind_record);
+         }
+         types.write_string(type->name);
+         types.write_uint(type->length);
+         for (unsigned f = 0; f < type->length; f++) {
+            const glsl_struct_field *field = &type->fields.structure[f];
+            types.write_uint(field_types[f]);
+            types.write_string(field->name);
+            types.write_int(field->location);
+            types.write_u8((field->row_major ? 1 : 0) |
+                           (field->centroid << 1) |
+                           (field->sample << 2) |
+                           (field->interpolation << 3));
+         }
+         ralloc_free(field_types);
+      }
+   } else {
+      int builtin = builtin_type_index(type);
+      assert(builtin >= 0);
+
+      types.write_u8(type_kind_builtin);
+      types.write_uint(builtin);
+   }
+
+   idx = ++num_types;
+   hash_table_insert(ht, (void *) idx, type);
+   return idx - 1;
+}
+
+unsigned
+ir_binary_writer::function_index(const ir_function *f)
+{
+   uintptr_t idx = (uintptr_t) hash_table_find(ht, f);
+   if (idx != 0)
+      return idx - 1;
+
+   functions.write_string(f->name);
+
+   idx = ++num_functions;
+   hash_table_insert(ht, (void *) idx, f);
+   return idx - 1;
+}
+
+unsigned
+ir_binary_writer::variable_index(ir_variable *var)
+{
+   uintptr_t idx = (uintptr_t) hash_table_find(ht, var);
+   if (idx != 0)
+      return idx - 1;
+
+   const glsl_type *ifc_type = var->get_interface_type();
+   unsigned type = type_index(var->type);
+   unsigned ifc = ifc_type ? type_index(ifc_type) + 1 : 0;
+
+   variables.write_uint(type);
+   variables.write_string(var->name);
+   variables.write_bytes(&var->data, sizeof(var->data));
+   variables.write_uint(ifc);
+
+   if (var->max_ifc_array_access != NULL) {
+      variables.write_uint(ifc_type->length);
+      for (unsigned i = 0; i < ifc_type->length; i++)
+         variables.write_uint(var->max_ifc_array_access[i]);
+   } else {
+      variables.write_uint(0);
+   }
+
+   variables.write_uint(var->num_state_slots);
+   for (unsigned i = 0; i < var->num_state_slots; i++) {
+      for (unsigned j = 0; j < Elements(var->state_slots[i].tokens); j++)
+         variables.write_int(var->state_slots[i].tokens[j]);
+      variables.write_int(var->state_slots[i].swizzle);
+   }
+
+   variables.write_string(var->warn_extension);
+   write_constant(&variables, var->constant_value);
+   write_constant(&variables, var->constant_initializer);
+
+   idx = ++num_variables;
+   hash_table_insert(ht, (void *) idx, var);
+   return idx - 1;
+}
+
+unsigned
+ir_binary_writer::signature_index(ir_function_signature *sig)
+{
+   uintptr_t idx = (uintptr_t) hash_table_find(ht, sig);
+   if (idx != 0)
+      return idx - 1;
+
+   unsigned func = function_index(sig->function());
+   unsigned ret = type_index(sig->return_type);
+   unsigned num_params = 0;
+   foreach_list(node, &sig->parameters) {
+      variable_index((ir_variable *) node);
+      num_params++;
+   }
+
+   signatures.write_uint(func);
+   signatures.write_uint(ret);
+   signatures.write_u8((sig->is_defined ? 1 : 0) |
+                       (sig->is_intrinsic ? 2 : 0) |
+                       (sig->is_builtin() ? 4 : 0));
+   signatures.write_uint(num_params);
+   foreach_list(node, &sig->parameters)
+      signatures.write_uint(variable_index((ir_variable *) node));
+
+   idx = ++num_signatures;
+   hash_table_insert(ht, (void *) idx, sig);
+   return idx - 1;
+}
+
+void
+ir_binary_writer::write_type_ref(blob *b, const glsl_type *type)
+{
+   b->write_uint(type_index(type));
+}
+
+void
+ir_binary_writer::write_constant_data(blob *b, const ir_constant *c)
+{
+   if (c->type->is_array()) {
+      for (unsigned i = 0; i < c->type->length; i++)
+         write_constant_data(b, c->array_elements[i]);
+   } else if (c->type->is_record()) {
+      foreach_list(node, &c->components)
+         write_constant_data(b, (ir_constant *) node);
+   } else if (c->type->base_type == GLSL_TYPE_BOOL) {
+      for (unsigned i = 0; i < c->type->components(); i++)
+         b->write_u8(c->value.b[i]);
+   } else {
+      b->write_bytes(c->value.u, c->type->components() * sizeof(c->value.u[0]));
+   }
+}
+
+/**
+ * Write an optional constant: type index + 1 (0 for \c NULL), then the raw
+ * data.
+ */
+void
+ir_binary_writer::write_constant(blob *b, const ir_constant *c)
+{
+   if (c == NULL) {
+      b->write_uint(0);
+      return;
+   }
+   b->write_uint(type_index(c->type) + 1);
+   write_constant_data(b, c);
+}
+
+void
+ir_binary_writer::write_list(exec_list *list)
+{
+   unsigned count = 0;
+   foreach_list(node, list)
+      count++;
+
+   body.write_uint(count);
+   foreach_list(node, list)
+      write_ir((ir_instruction *) node);
+}
+
+void
+ir_binary_writer::write_texture(ir_texture *tex)
+{
+   body.write_u8(tex->op);
+   write_type_ref(&body, tex->type);
+   write_ir(tex->sampler);
+   write_ir(tex->coordinate);
+   write_ir(tex->projector);
+   write_ir(tex->shadow_comparitor);
+   write_ir(tex->offset);
+
+   switch (tex->op) {
+   case ir_txb:
+      write_ir(tex->lod_info.bias);
+      break;
+   case ir_txl:
+   case ir_txf:
+   case ir_txs:
+      write_ir(tex->lod_info.lod);
+      break;
+   case ir_txf_ms:
+      write_ir(tex->lod_info.sample_index);
+      break;
+   case ir_txd:
+      write_ir(tex->lod_info.grad.dPdx);
+      write_ir(tex->lod_info.grad.dPdy);
+      break;
+   case ir_tg4:
+      write_ir(tex->lod_info.component);
+      break;
+   case ir_tex:
+   case ir_lod:
+   case ir_query_levels:
+      break;
+   }
+}
+
+void
+ir_binary_writer::write_ir(ir_instruction *ir)
+{
+   if (ir == NULL) {
+      body.write_u8(ir_type_unset);
+      return;
+   }
+
+   body.write_u8(ir->ir_type);
+
+   switch (ir->ir_type) {
+   case ir_type_variable:
+      body.write_uint(variable_index((ir_variable *) ir));
+      break;
+
+   case ir_type_assignment: {
+      ir_assignment *assign = (ir_assignment *) ir;
+      body.write_u8(assign->write_mask);
+      write_ir(assign->lhs);
+      write_ir(assign->rhs);
+      write_ir(assign->condition);
+      break;
+   }
+
+   case ir_type_call: {
+      ir_call *call = (ir_call *) ir;
+      body.write_uint(signature_index(call->callee));
+      write_ir(call->return_deref);
+      write_list(&call->actual_parameters);
+      break;
+   }
+
+   case ir_type_constant:
+      write_constant(&body, (ir_constant *) ir);
+      break;
+
+   case ir_type_dereference_array: {
+      ir_dereference_array *deref = (ir_dereference_array *) ir;
+      write_type_ref(&body, deref->type);
+      write_ir(deref->array);
+      write_ir(deref->array_index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_dereference_record *deref = (ir_dereference_record *) ir;
+      write_type_ref(&body, deref->type);
+      body.write_string(deref->field);
+      write_ir(deref->record);
+      break;
+   }
+
+   case ir_type_dereference_variable:
+      body.write_uint(variable_index(((ir_dereference_variable *) ir)->var));
+      break;
+
+   case ir_type_discard:
+      write_ir(((ir_discard *) ir)->condition);
+      break;
+
+   case ir_type_expression: {
+      ir_expression *expr = (ir_expression *) ir;
+      unsigned num_operands = expr->get_num_operands();
+      body.write_uint(expr->operation);
+      write_type_ref(&body, expr->type);
+      body.write_u8(num_operands);
+      for (unsigned i = 0; i < num_operands; i++)
+         write_ir(expr->operands[i]);
+      break;
+   }
+
+   case ir_type_function: {
+      ir_function *f = (ir_function *) ir;
+      unsigned count = 0;
+      foreach_list(node, &f->signatures)
+         count++;
+
+      body.write_uint(function_index(f));
+      body.write_uint(count);
+      foreach_list(node, &f->signatures) {
+         ir_function_signature *sig = (ir_function_signature *) node;
+         body.write_uint(signature_index(sig));
+         write_list(&sig->body);
+      }
+      break;
+   }
+
+   case ir_type_if: {
+      ir_if *iff = (ir_if *) ir;
+      write_ir(iff->condition);
+      write_list(&iff->then_instructions);
+      write_list(&iff->else_instructions);
+      break;
+   }
+
+   case ir_type_loop:
+      write_list(&((ir_loop *) ir)->body_instructions);
+      break;
+
+   case ir_type_loop_jump:
+      body.write_u8(((ir_loop_jump *) ir)->mode);
+      break;
+
+   case ir_type_return:
+      write_ir(((ir_return *) ir)->value);
+      break;
+
+   case ir_type_swizzle: {
+      ir_swizzle *swiz = (ir_swizzle *) ir;
+      write_type_ref(&body, swiz->type);
+      body.write_uint(swiz->mask.x | (swiz->mask.y << 2) |
+                      (swiz->mask.z << 4) | (swiz->mask.w << 6) |
+                      (swiz->mask.num_components << 8) |
+                      (swiz->mask.has_duplicates << 11));
+      write_ir(swiz->val);
+      break;
+   }
+
+   case ir_type_texture:
+      write_texture((ir_texture *) ir);
+      break;
+
+   case ir_type_emit_vertex:
+   case ir_type_end_primitive:
+      break;
+
+   case ir_type_function_signature:
+   case ir_type_unset:
+   case ir_type_max:
+      assert(!"Invalid IR node in instruction stream");
+      break;
+   }
+}
+
+uint8_t *
+ir_binary_writer::write(void *mem_ctx, exec_list *instructions, size_t *size)
+{
+   write_list(instructions);
+
+   blob out(mem_ctx);
+   uint32_t header[3] = {
+      IR_BINARY_MAGIC, IR_BINARY_VERSION,
+      sizeof(((ir_variable *) NULL)->data)
+   };
+   out.write_bytes(header, sizeof(header));
+
+   out.write_uint(num_types);
+   out.write_bytes(types.data, types.size);
+   out.write_uint(num_functions);
+   out.write_bytes(functions.data, functions.size);
+   out.write_uint(num_variables);
+   out.write_bytes(variables.data, variables.size);
+   out.write_uint(num_signatures);
+   out.write_bytes(signatures.data, signatures.size);
+   out.write_bytes(body.data, body.size);
+
+   *size = out.size;
+   return out.data;
+}
+
+
+class ir_binary_reader {
+public:
+   ir_binary_reader(void *mem_ctx, const uint8_t *data, size_t size)
+      : mem_ctx(mem_ctx), b(data, size), error(false),
+        types(NULL), num_types(0), functions(NULL), num_functions(0),
+        variables(NULL), num_variables(0), signatures(NULL),
+        signature_functions(NULL), num_signatures(0)
+   {
+   }
+
+   bool read(glsl_symbol_table *symbols, exec_list *instructions);
+
+private:
+   bool read_types();
+   bool read_functions();
+   bool read_variables();
+   bool read_signatures();
+
+   const glsl_type *read_type_ref();
+   bool read_constant_data(ir_constant *c);
+   ir_constant *read_constant();
+   bool read_list(exec_list *list);
+   ir_instruction *read_ir();
+   ir_rvalue *read_rvalue();
+   ir_dereference *read_dereference();
+   ir_texture *read_texture();
+
+   void *mem_ctx;
+   blob_reader b;
+   bool error;
+
+   const glsl_type **types;
+   unsigned num_types;
+   ir_function **functions;
+   unsigned num_functions;
+   ir_variable **variables;
+   unsigned num_variables;
+   ir_function_signature **signatures;
+   unsigned *signature_functions;
+   unsigned num_signatures;
+};
+
+/**
+ * Read a table length, rejecting counts that cannot possibly fit in the
+ * remaining data (every entry takes at least one byte).
+ */
+#define READ_COUNT(count)                                               \
+   do {                                                                 \
+      uint64_t n = b.read_uint();                                       \
+      if (b.overrun || n > (uint64_t) (b.end - b.current))              \
+         return false;                                                  \
+      (count) = (unsigned) n;                                           \
+   } while (0)
+
+bool
+ir_binary_reader::read_types()
+{
+   READ_COUNT(num_types);
+   types = ralloc_array(mem_ctx, const glsl_type *, num_types);
+
+   for (unsigned i = 0; i < num_types; i++) {
+      uint8_t kind = b.read_u8();
+
+      switch (kind) {
+      case type_kind_builtin:
+         types[i] = builtin_type_from_index(b.read_uint());
+         if (types[i] == NULL)
+            return false;
+         break;
+
+      case type_kind_array: {
+         uint64_t elem = b.read_uint();
+         uint64_t length = b.read_uint();
+         if (elem >= i)
+            return false;
+         types[i] = glsl_type::get_array_instance(types[elem], length);
+         break;
+      }
+
+      case type_kind_record:
+      case type_kind_interface: {
+         unsigned packing = 0;
+         if (kind == type_kind_interface)
+            packing = b.read_uint();
+         const char *name = b.read_string(mem_ctx);
+         unsigned num_fields;
+         READ_COUNT(num_fields);
+
+         glsl_struct_field *fields =
+            ralloc_array(mem_ctx, glsl_struct_field, num_fields);
+         for (unsigned f = 0; f < num_fields; f++) {
+            uint64_t type = b.read_uint();
+            if (type >= i)
+               return false;
+            fields[f].type = types[type];
+            fields[f].name = b.read_string(mem_ctx);
+            fields[f].location = b.read_int();
+            uint8_t flags = b.read_u8();
+            fields[f].row_major = flags & 1;
+            fields[f].centroid = (flags >> 1) & 1;
+            fields[f].sample = (flags >> 2) & 1;
+            fields[f].interpolation = (flags >> 3) & 3;
+         }
+         if (b.overrun || name == NULL)
+            return false;
+
+         if (kind == type_kind_interface) {
+            types[i] = glsl_type::get_interface_instance(fields, num_fields,
+               (enum glsl_interface_packing) packing, name);
+         } else {
+            types[i] = glsl_type::get_record_instance(fields, num_fields,
+                                                      name);
+         }
+         break;
+      }
+
+      default:
+         return false;
+      }
+
+      if (b.overrun)
+         return false;
+   }
+
+   return true;
+}
+
+bool
+ir_binary_reader::read_functions()
+{
+   READ_COUNT(num_functions);
+   functions = ralloc_array(mem_ctx, ir_function *, num_functions);
+
+   for (unsigned i = 0; i < num_functions; i++) {
+      const char *name = b.read_string(mem_ctx);
+      if (name == NULL)
+         return false;
+      functions[i] = new(mem_ctx) ir_function(name);
+   }
+
+   return true;
+}
+
+bool
+ir_binary_reader::read_variables()
+{
+   READ_COUNT(num_variables);
+   variables = ralloc_array(mem_ctx, ir_variable *, num_variables);
+
+   for (unsigned i = 0; i < num_variables; i++) {
+      const glsl_type *type = read_type_ref();
+      const char *name = b.read_string(mem_ctx);
+      if (type == NULL)
+         return false;
+
+      ir_variable *var = new(mem_ctx) ir_variable(type, name, ir_var_auto);
+      b.read_bytes(&var->data, sizeof(var->data));
+
+      uint64_t ifc = b.read_uint();
+      if (ifc > num_types)
+         return false;
+      if (ifc != 0) {
+         const glsl_type *ifc_type = types[ifc - 1];
+         if (var->get_interface_type() == NULL)
+            var->init_interface_type(ifc_type);
+         else if (var->get_interface_type() != ifc_type)
+            var->change_interface_type(ifc_type);
+      }
+
+      /* The access array is sized by the interface type, so a stale or
+       * corrupt count mustn't be trusted.
+       */
+      unsigned num_ifc_access;
+      READ_COUNT(num_ifc_access);
+      if (num_ifc_access != 0) {
+         const glsl_type *ifc_type = var->get_interface_type();
+         if (ifc_type == NULL || num_ifc_access != ifc_type->length)
+            return false;
+         if (var->max_ifc_array_access == NULL) {
+            var->max_ifc_array_access =
+               rzalloc_array(var, unsigned, num_ifc_access);
+         }
+         for (unsigned j = 0; j < num_ifc_access; j++)
+            var->max_ifc_array_access[j] = b.read_uint();
+      }
+
+      READ_COUNT(var->num_state_slots);
+      if (var->num_state_slots != 0) {
+         var->state_slots = ralloc_array(var, ir_state_slot,
+                                         var->num_state_slots);
+         for (unsigned j = 0; j < var->num_state_slots; j++) {
+            for (unsigned k = 0; k < Elements(var->state_slots[j].tokens); k++)
+               var->state_slots[j].tokens[k] = b.read_int();
+            var->state_slots[j].swizzle = b.read_int();
+         }
+      }
+
+      var->warn_extension = b.read_string(var);
+      var->constant_value = read_constant();
+      var->constant_initializer = read_constant();
+
+      if (b.overrun || error)
+         return false;
+
+      variables[i] = var;
+   }
+
+   return true;
+}
+
+bool
+ir_binary_reader::read_signatures()
+{
+   READ_COUNT(num_signatures);
+   signatures = ralloc_array(mem_ctx, ir_function_signature *,
+                             num_signatures);
+   signature_functions = ralloc_array(mem_ctx, unsigned, num_signatures);
+
+   for (unsigned i = 0; i < num_signatures; i++) {
+      uint64_t func = b.read_uint();
+      const glsl_type *return_type = read_type_ref();
+      uint8_t flags = b.read_u8();
+      unsigned num_params;
+      READ_COUNT(num_params);
+
+      if (func >= num_functions || return_type == NULL)
+         return false;
+
+      ir_function_signature *sig =
+         new(mem_ctx) ir_function_signature(return_type,
+                                            (flags & 4) ? always_available
+                                                        : NULL);
+      sig->is_defined = (flags & 1) != 0;
+      sig->is_intrinsic = (flags & 2) != 0;
+
+      for (unsigned j = 0; j < num_params; j++) {
+         uint64_t idx = b.read_uint();
+         if (idx >= num_variables)
+            return false;
+         sig->parameters.push_tail(variables[idx]);
+      }
+
+      if (b.overrun)
+         return false;
+
+      signatures[i] = sig;
+      signature_functions[i] = func;
+   }
+
+   return true;
+}
+
+const glsl_type *
+ir_binary_reader::read_type_ref()
+{
+   uint64_t idx = b.read_uint();
+   if (b.overrun || idx >= num_types) {
+      error = true;
+      return NULL;
+   }
+   return types[idx];
+}
+
+bool
+ir_binary_reader::read_constant_data(ir_constant *c)
+{
+   const glsl_type *type = c->type;
+
+   if (type->is_array()) {
+      for (unsigned i = 0; i < type->length; i++) {
+         if (!read_constant_data(c->array_elements[i]))
+            return false;
+      }
+   } else if (type->is_record()) {
+      foreach_list(node, &c->components) {
+         if (!read_constant_data((ir_constant *) node))
+            return false;
+      }
+   } else if (type->base_type == GLSL_TYPE_BOOL) {
+      for (unsigned i = 0; i < type->components(); i++)
+         c->value.b[i] = b.read_u8() != 0;
+   } else {
+      b.read_bytes(c->value.u, type->components() * sizeof(c->value.u[0]));
+   }
+
+   return !b.overrun;
+}
+
+ir_constant *
+ir_binary_reader::read_constant()
+{
+   uint64_t idx = b.read_uint();
+   if (idx == 0)
+      return NULL;
+   if (b.overrun || idx > num_types) {
+      error = true;
+      return NULL;
+   }
+
+   const glsl_type *type = types[idx - 1];
+   if (!type->is_scalar() && !type->is_vector() && !type->is_matrix() &&
+       !type->is_record() && !type->is_array()) {
+      error = true;
+      return NULL;
+   }
+
+   /* ir_constant::zero builds the whole aggregate; the raw data is then
+    * stored into its leaves in the same order the writer visited them.
+    */
+   ir_constant *c = ir_constant::zero(mem_ctx, type);
+   if (!read_constant_data(c)) {
+      error = true;
+      return NULL;
+   }
+   return c;
+}
+
+bool
+ir_binary_reader::read_list(exec_list *list)
+{
+   unsigned count;
+   READ_COUNT(count);
+
+   for (unsigned i = 0; i < count; i++) {
+      ir_instruction *ir = read_ir();
+      if (ir == NULL)
+         return false;
+      list->push_tail(ir);
+   }
+
+   return true;
+}
+
+ir_rvalue *
+ir_binary_reader::read_rvalue()
+{
+   ir_instruction *ir = read_ir();
+   if (ir == NULL)
+      return NULL;
+
+   ir_rvalue *rvalue = ir->as_rvalue();
+   if (rvalue == NULL)
+      error = true;
+   return rvalue;
+}
+
+ir_dereference *
+ir_binary_reader::read_dereference()
+{
+   ir_instruction *ir = read_ir();
+   if (ir == NULL)
+      return NULL;
+
+   ir_dereference *deref = ir->as_dereference();
+   if (deref == NULL)
+      error = true;
+   return deref;
+}
+
+ir_texture *
+ir_binary_reader::read_texture()
+{
+   uint8_t op = b.read_u8();
+   if (op > ir_query_levels) {
+      error = true;
+      return NULL;
+   }
+
+   ir_texture *tex = new(mem_ctx) ir_texture((ir_texture_opcode) op);
+   tex->type = read_type_ref();
+   tex->sampler = read_dereference();
+   if (tex->type == NULL || tex->sampler == NULL) {
+      error = true;
+      return NULL;
+   }
+   tex->coordinate = read_rvalue();
+   tex->projector = read_rvalue();
+   tex->shadow_comparitor = read_rvalue();
+   tex->offset = read_rvalue();
+
+   switch (tex->op) {
+   case ir_txb:
+      tex->lod_info.bias = read_rvalue();
+      break;
+   case ir_txl:
+   case ir_txf:
+   case ir_txs:
+      tex->lod_info.lod = read_rvalue();
+      break;
+   case ir_txf_ms:
+      tex->lod_info.sample_index = read_rvalue();
+      break;
+   case ir_txd:
+      tex->lod_info.grad.dPdx = read_rvalue();
+      tex->lod_info.grad.dPdy = read_rvalue();
+      break;
+   case ir_tg4:
+      tex->lod_info.component = read_rvalue();
+      break;
+   case ir_tex:
+   case ir_lod:
+   case ir_query_levels:
+      break;
+   }
+
+   return error ? NULL : tex;
+}
+
+/**
+ * Read one node of the instruction stream
+ *
+ * Returns \c NULL both for an encoded \c NULL pointer and on error; callers
+ * that need to tell the two apart check \c error.
+ */
+ir_instruction *
+ir_binary_reader::read_ir()
+{
+   if (error)
+      return NULL;
+
+   uint8_t tag = b.read_u8();
+   if (b.overrun) {
+      error = true;
+      return NULL;
+   }
+
+   ir_instruction *ir = NULL;
+
+   switch (tag) {
+   case ir_type_unset:
+      return NULL;
+
+   case ir_type_variable: {
+      uint64_t idx = b.read_uint();
+      if (idx >= num_variables)
+         break;
+      ir = variables[idx];
+      break;
+   }
+
+   case ir_type_assignment: {
+      unsigned write_mask = b.read_u8();
+      ir_dereference *lhs = read_dereference();
+      ir_rvalue *rhs = read_rvalue();
+      ir_rvalue *condition = read_rvalue();
+      if (lhs == NULL || rhs == NULL || error)
+         break;
+      ir = new(mem_ctx) ir_assignment(lhs, rhs, condition, write_mask);
+      break;
+   }
+
+   case ir_type_call: {
+      uint64_t idx = b.read_uint();
+      if (idx >= num_signatures)
+         break;
+      ir_instruction *ret = read_ir();
+      if (error || (ret != NULL && ret->as_dereference_variable() == NULL))
+         break;
+
+      exec_list parameters;
+      if (!read_list(&parameters))
+         break;
+      ir = new(mem_ctx) ir_call(signatures[idx], (ir_dereference_variable *) ret,
+                                &parameters);
+      break;
+   }
+
+   case ir_type_constant:
+      ir = read_constant();
+      break;
+
+   case ir_type_dereference_array: {
+      const glsl_type *type = read_type_ref();
+      ir_rvalue *array = read_rvalue();
+      ir_rvalue *index = read_rvalue();
+      if (array == NULL || index == NULL || error)
+         break;
+      ir_dereference_array *deref =
+         new(mem_ctx) ir_dereference_array(array, index);
+      deref->type = type;
+      ir = deref;
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      const glsl_type *type = read_type_ref();
+      const char *field = b.read_string(mem_ctx);
+      ir_rvalue *record = read_rvalue();
+      if (record == NULL || field == NULL || error)
+         break;
+      if (!record->type->is_record() && !record->type->is_interface())
+         break;
+      ir_dereference_record *deref =
+         new(mem_ctx) ir_dereference_record(record, field);
+      deref->type = type;
+      ir = deref;
+      break;
+   }
+
+   case ir_type_dereference_variable: {
+      uint64_t idx = b.read_uint();
+      if (idx >= num_variables)
+         break;
+      ir = new(mem_ctx) ir_dereference_variable(variables[idx]);
+      break;
+   }
+
+   case ir_type_discard: {
+      ir_rvalue *condition = read_rvalue();
+      if (error)
+         break;
+      ir = new(mem_ctx) ir_discard(condition);
+      break;
+   }
+
+   case ir_type_expression: {
+      uint64_t op = b.read_uint();
+      const glsl_type *type = read_type_ref();
+      unsigned num_operands = b.read_u8();
+      if (op > ir_last_opcode || num_operands > 4 || type == NULL)
+         break;
+
+      ir_rvalue *operands[4] = { NULL, NULL, NULL, NULL };
+      for (unsigned i = 0; i < num_operands; i++) {
+         operands[i] = read_rvalue();
+         if (operands[i] == NULL)
+            break;
+      }
+      if (error)
+         break;
+      ir = new(mem_ctx) ir_expression(op, type, operands[0], operands[1],
+                                      operands[2], operands[3]);
+      break;
+   }
+
+   case ir_type_function: {
+      uint64_t idx = b.read_uint();
+      unsigned count;
+      count = b.read_uint();
+      if (idx >= num_functions || count > (uint64_t) (b.end - b.current))
+         break;
+
+      ir_function *f = functions[idx];
+      for (unsigned i = 0; i < count; i++) {
+         uint64_t sig_idx = b.read_uint();
+         if (sig_idx >= num_signatures ||
+             signatures[sig_idx]->function() != NULL) {
+            error = true;
+            return NULL;
+         }
+         ir_function_signature *sig = signatures[sig_idx];
+         f->add_signature(sig);
+         if (!read_list(&sig->body)) {
+            error = true;
+            return NULL;
+         }
+      }
+      ir = f;
+      break;
+   }
+
+   case ir_type_if: {
+      ir_rvalue *condition = read_rvalue();
+      if (condition == NULL)
+         break;
+      ir_if *iff = new(mem_ctx) ir_if(condition);
+      if (!read_list(&iff->then_instructions) ||
+          !read_list(&iff->else_instructions))
+         break;
+      ir = iff;
+      break;
+   }
+
+   case ir_type_loop: {
+      ir_loop *loop = new(mem_ctx) ir_loop;
+      if (!read_list(&loop->body_instructions))
+         break;
+      ir = loop;
+      break;
+   }
+
+   case ir_type_loop_jump: {
+      uint8_t mode = b.read_u8();
+      if (mode > ir_loop_jump::jump_continue)
+         break;
+      ir = new(mem_ctx) ir_loop_jump((ir_loop_jump::jump_mode) mode);
+      break;
+   }
+
+   case ir_type_return: {
+      ir_rvalue *value = read_rvalue();
+      if (error)
+         break;
+      ir = new(mem_ctx) ir_return(value);
+      break;
+   }
+
+   case ir_type_swizzle: {
+      const glsl_type *type = read_type_ref();
+      uint64_t bits = b.read_uint();
+      ir_rvalue *val = read_rvalue();
+      if (val == NULL || error)
+         break;
+
+      ir_swizzle_mask mask;
+      mask.x = bits & 3;
+      mask.y = (bits >> 2) & 3;
+      mask.z = (bits >> 4) & 3;
+      mask.w = (bits >> 6) & 3;
+      mask.num_components = (bits >> 8) & 7;
+      mask.has_duplicates = (bits >> 11) & 1;
+      ir_swizzle *swiz = new(mem_ctx) ir_swizzle(val, mask);
+      swiz->type = type;
+      ir = swiz;
+      break;
+   }
+
+   case ir_type_texture:
+      ir = read_texture();
+      break;
+
+   case ir_type_emit_vertex:
+      ir = new(mem_ctx) ir_emit_vertex;
+      break;
+
+   case ir_type_end_primitive:
+      ir = new(mem_ctx) ir_end_primitive;
+      break;
+
+   default:
+      break;
+   }
+
+   if (ir == NULL || b.overrun)
+      error = true;
+
+   return error ? NULL : ir;
+}
+
+bool
+ir_binary_reader::read(glsl_symbol_table *symbols, exec_list *instructions)
+{
+   uint32_t header[3];
+   b.read_bytes(header, sizeof(header));
+   if (b.overrun || header[0] != IR_BINARY_MAGIC ||
+       header[1] != IR_BINARY_VERSION ||
+       header[2] != sizeof(((ir_variable *) NULL)->data))
+      return false;
+
+   if (!read_types() || !read_functions() || !read_variables() ||
+       !read_signatures() || error)
+      return false;
+
+   exec_list list;
+   if (!read_list(&list) || error || b.current != b.end)
+      return false;
+
+   /* Signatures that are only referenced by calls (prototypes of functions
+    * defined elsewhere) still need an owning ir_function so that
+    * ir_call::callee_name() works.
+    */
+   for (unsigned i = 0; i < num_signatures; i++) {
+      if (signatures[i]->function() == NULL)
+         functions[signature_functions[i]]->add_signature(signatures[i]);
+   }
+
+   if (symbols != NULL) {
+      foreach_list(node, &list) {
+         ir_instruction *ir = (ir_instruction *) node;
+         if (ir->as_variable())
+            symbols->add_variable(ir->as_variable());
+         else if (ir->as_function())
+            symbols->add_function(ir->as_function());
+      }
+   }
+
+   list.move_nodes_to(instructions);
+   return true;
+}
+
+} /* anonymous namespace */
+
+
+uint8_t *
+_mesa_glsl_write_ir_binary(void *mem_ctx, exec_list *instructions,
+                           size_t *size)
+{
+   void *tmp_ctx = ralloc_context(NULL);
+   ir_binary_writer w(tmp_ctx);
+   uint8_t *data = w.write(mem_ctx, instructions, size);
+   ralloc_free(tmp_ctx);
+   return data;
+}
+
+bool
+_mesa_glsl_read_ir_binary(void *mem_ctx, glsl_symbol_table *symbols,
+                          exec_list *instructions,
+                          const uint8_t *data, size_t size)
+{
+   void *ctx = ralloc_context(mem_ctx);
+   ir_binary_reader r(ctx, data, size);
+
+   if (!r.read(symbols, instructions)) {
+      ralloc_free(ctx);
+      return false;
+   }
+
+   return true;
+}
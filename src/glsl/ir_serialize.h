@@ -0,0 +1,79 @@
+/* -*- c++ -*- */
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef IR_SERIALIZE_H
+#define IR_SERIALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ir.h"
+
+struct glsl_symbol_table;
+
+/**
+ * \file ir_serialize.h
+ *
+ * Compact binary encoding of GLSL IR.
+ *
+ * This is the binary counterpart of \c ir_print_visitor / \c ir_reader.  It
+ * is intended for storing IR that is reloaded by the same build of the
+ * compiler (shader caches, pre-compiled built-in functions), so the format
+ * is versioned but makes no attempt at being portable across releases.
+ *
+ * Types are stored once per blob and referenced by index.  Variables and
+ * function signatures are stored in tables ahead of the instruction stream
+ * and referenced by index, so references may appear before declarations.
+ * Constant data is stored raw.
+ */
+
+/**
+ * Serialize a list of IR instructions
+ *
+ * \param mem_ctx  ralloc context that will own the returned buffer.
+ * \param size     Returns the size of the buffer in bytes.
+ *
+ * \return A buffer holding the binary encoding of \c instructions.
+ */
+uint8_t *
+_mesa_glsl_write_ir_binary(void *mem_ctx, exec_list *instructions,
+                           size_t *size);
+
+/**
+ * Deserialize a list of IR instructions
+ *
+ * The decoded instructions are appended to \c instructions and are allocated
+ * out of \c mem_ctx.  If \c symbols is not \c NULL, top-level variable
+ * declarations and functions are also added to the symbol table.
+ *
+ * \return \c false if the buffer is truncated, corrupt or was written by an
+ * incompatible build.  In that case \c instructions is left untouched.
+ */
+bool
+_mesa_glsl_read_ir_binary(void *mem_ctx, glsl_symbol_table *symbols,
+                          exec_list *instructions,
+                          const uint8_t *data, size_t size);
+
+#endif /* IR_SERIALIZE_H */
@@ -46,6 +46,8 @@ namespace {
 class acp_entry : public exec_node
 {
 public:
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(acp_entry);
+
    acp_entry(ir_variable *var, unsigned write_mask, ir_constant *constant)
    {
       assert(var);
@@ -76,6 +78,8 @@ public:
 class kill_entry : public exec_node
 {
 public:
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(kill_entry);
+
    kill_entry(ir_variable *var, unsigned write_mask)
    {
       assert(var);
@@ -94,6 +98,7 @@ public:
       progress = false;
       killed_all = false;
       mem_ctx = ralloc_context(0);
+      lin_ctx = linear_alloc_parent(mem_ctx, 0);
       this->acp = new(mem_ctx) exec_list;
       this->kills = new(mem_ctx) exec_list;
    }
@@ -128,6 +133,7 @@ public:
    bool killed_all;
 
    void *mem_ctx;
+   void *lin_ctx;
 };
 
 
@@ -319,7 +325,7 @@ ir_constant_propagation_visitor::handle_if_block(exec_list *instructions)
    /* Populate the initial acp with a constant of the original */
    foreach_list(n, orig_acp) {
       acp_entry *a = (acp_entry *) n;
-      this->acp->push_tail(new(this->mem_ctx) acp_entry(a));
+      this->acp->push_tail(new(this->lin_ctx) acp_entry(a));
    }
 
    visit_list_elements(this, instructions);
@@ -419,7 +425,7 @@ ir_constant_propagation_visitor::kill(ir_variable *var, unsigned write_mask)
       }
    }
    /* Not already in the list.  Make new entry. */
-   this->kills->push_tail(new(this->mem_ctx) kill_entry(var, write_mask));
+   this->kills->push_tail(new(this->lin_ctx) kill_entry(var, write_mask));
 }
 
 /**
@@ -449,7 +455,7 @@ ir_constant_propagation_visitor::add_constant(ir_assignment *ir)
    if (!deref->var->type->is_vector() && !deref->var->type->is_scalar())
       return;
 
-   entry = new(this->mem_ctx) acp_entry(deref->var, ir->write_mask, constant);
+   entry = new(this->lin_ctx) acp_entry(deref->var, ir->write_mask, constant);
    this->acp->push_tail(entry);
 }
 
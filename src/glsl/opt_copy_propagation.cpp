@@ -43,6 +43,8 @@ namespace {
 class acp_entry : public exec_node
 {
 public:
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(acp_entry);
+
    acp_entry(ir_variable *lhs, ir_variable *rhs)
    {
       assert(lhs);
@@ -59,6 +61,8 @@ public:
 class kill_entry : public exec_node
 {
 public:
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(kill_entry);
+
    kill_entry(ir_variable *var)
    {
       assert(var);
@@ -74,6 +78,7 @@ public:
    {
       progress = false;
       mem_ctx = ralloc_context(0);
+      lin_ctx = linear_alloc_parent(mem_ctx, 0);
       this->acp = new(mem_ctx) exec_list;
       this->kills = new(mem_ctx) exec_list;
    }
@@ -107,6 +112,7 @@ public:
    bool killed_all;
 
    void *mem_ctx;
+   void *lin_ctx;
 };
 
 } /* unnamed namespace */
@@ -218,7 +224,7 @@ ir_copy_propagation_visitor::handle_if_block(exec_list *instructions)
    /* Populate the initial acp with a copy of the original */
    foreach_list(n, orig_acp) {
       acp_entry *a = (acp_entry *) n;
-      this->acp->push_tail(new(this->mem_ctx) acp_entry(a->lhs, a->rhs));
+      this->acp->push_tail(new(this->lin_ctx) acp_entry(a->lhs, a->rhs));
    }
 
    visit_list_elements(this, instructions);
@@ -301,7 +307,7 @@ ir_copy_propagation_visitor::kill(ir_variable *var)
 
    /* Add the LHS variable to the list of killed variables in this block.
     */
-   this->kills->push_tail(new(this->mem_ctx) kill_entry(var));
+   this->kills->push_tail(new(this->lin_ctx) kill_entry(var));
 }
 
 /**
@@ -329,7 +335,7 @@ ir_copy_propagation_visitor::add_copy(ir_assignment *ir)
 	 ir->condition = new(ralloc_parent(ir)) ir_constant(false);
 	 this->progress = true;
       } else {
-	 entry = new(this->mem_ctx) acp_entry(lhs_var, rhs_var);
+	 entry = new(this->lin_ctx) acp_entry(lhs_var, rhs_var);
 	 this->acp->push_tail(entry);
       }
    }
@@ -54,6 +54,8 @@ namespace {
 class acp_entry : public exec_node
 {
 public:
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(acp_entry);
+
    acp_entry(ir_variable *lhs, ir_variable *rhs, int write_mask, int swizzle[4])
    {
       this->lhs = lhs;
@@ -80,6 +82,8 @@ public:
 class kill_entry : public exec_node
 {
 public:
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(kill_entry);
+
    kill_entry(ir_variable *var, int write_mask)
    {
       this->var = var;
@@ -97,6 +101,7 @@ public:
       this->progress = false;
       this->killed_all = false;
       this->mem_ctx = ralloc_context(NULL);
+      this->lin_ctx = linear_alloc_parent(this->mem_ctx, 0);
       this->shader_mem_ctx = NULL;
       this->acp = new(mem_ctx) exec_list;
       this->kills = new(mem_ctx) exec_list;
@@ -133,6 +138,7 @@ public:
 
    /* Context for our local data structures. */
    void *mem_ctx;
+   void *lin_ctx;
    /* Context for allocating new shader nodes. */
    void *shader_mem_ctx;
 };
@@ -173,9 +179,9 @@ ir_copy_propagation_elements_visitor::visit_leave(ir_assignment *ir)
       kill_entry *k;
 
       if (lhs)
-	 k = new(mem_ctx) kill_entry(var, ir->write_mask);
+	 k = new(lin_ctx) kill_entry(var, ir->write_mask);
       else
-	 k = new(mem_ctx) kill_entry(var, ~0);
+	 k = new(lin_ctx) kill_entry(var, ~0);
 
       kill(k);
    }
@@ -326,7 +332,7 @@ ir_copy_propagation_elements_visitor::handle_if_block(exec_list *instructions)
    /* Populate the initial acp with a copy of the original */
    foreach_list(n, orig_acp) {
       acp_entry *a = (acp_entry *) n;
-      this->acp->push_tail(new(this->mem_ctx) acp_entry(a));
+      this->acp->push_tail(new(this->lin_ctx) acp_entry(a));
    }
 
    visit_list_elements(this, instructions);
@@ -479,7 +485,7 @@ ir_copy_propagation_elements_visitor::add_copy(ir_assignment *ir)
       }
    }
 
-   entry = new(this->mem_ctx) acp_entry(lhs->var, rhs->var, write_mask,
+   entry = new(this->lin_ctx) acp_entry(lhs->var, rhs->var, write_mask,
 					swizzle);
    this->acp->push_tail(entry);
 }
@@ -490,3 +490,204 @@ ralloc_vasprintf_rewrite_tail(char **str, size_t *start, const char *fmt,
    *start += new_length;
    return true;
 }
+
+/***************************************************************************
+ * Linear allocator for short-living allocations.
+ ***************************************************************************
+ *
+ * A linear parent is a ralloc'd buffer prefixed with a linear_header.
+ * Children are carved out of it by bumping an offset; when it runs out, a
+ * new buffer is allocated as a ralloc child of the first one, so freeing the
+ * first buffer releases everything.  Children carry no header of their own.
+ */
+
+#define MIN_LINEAR_BUFSIZE 2048
+#define SUBALLOC_ALIGNMENT 8
+#define LMAGIC 0x87b9c7d3
+
+#define ALIGN_POT(x, a) (((x) + (a) - 1) & ~((a) - 1))
+
+struct linear_header {
+#ifdef DEBUG
+   unsigned magic;   /* for debugging */
+#endif
+   unsigned offset;  /* points to the first unused byte in the buffer */
+   unsigned size;    /* size of the buffer */
+
+   /* The buffer children are currently allocated from.  Only meaningful in
+    * the first buffer of a linear parent.
+    */
+   struct linear_header *latest;
+};
+
+typedef struct linear_header linear_header;
+
+#define LINEAR_HEADER_SIZE \
+   ALIGN_POT(sizeof(linear_header), SUBALLOC_ALIGNMENT)
+
+#define LINEAR_DATA(node) (((char *) (node)) + LINEAR_HEADER_SIZE)
+
+/* The linear parent pointer is always the start of the first buffer. */
+static linear_header *
+get_linear_header(const void *ptr)
+{
+   linear_header *node = (linear_header *) (((char *) ptr) -
+                                            LINEAR_HEADER_SIZE);
+#ifdef DEBUG
+   assert(node->magic == LMAGIC);
+#endif
+   return node;
+}
+
+static linear_header *
+create_linear_node(void *ralloc_ctx, unsigned min_size)
+{
+   linear_header *node;
+
+   min_size = ALIGN_POT(min_size, SUBALLOC_ALIGNMENT);
+   if (likely(min_size < MIN_LINEAR_BUFSIZE))
+      min_size = MIN_LINEAR_BUFSIZE;
+
+   node = ralloc_size(ralloc_ctx, LINEAR_HEADER_SIZE + min_size);
+   if (unlikely(node == NULL))
+      return NULL;
+
+#ifdef DEBUG
+   node->magic = LMAGIC;
+#endif
+   node->offset = 0;
+   node->size = min_size;
+   node->latest = node;
+   return node;
+}
+
+void *
+linear_alloc_parent(void *ralloc_ctx, unsigned size)
+{
+   linear_header *node;
+
+   size = ALIGN_POT(size, SUBALLOC_ALIGNMENT);
+
+   node = create_linear_node(ralloc_ctx, size);
+   if (unlikely(node == NULL))
+      return NULL;
+
+   node->offset = size;
+   return LINEAR_DATA(node);
+}
+
+void *
+linear_zalloc_parent(void *ralloc_ctx, unsigned size)
+{
+   void *ptr = linear_alloc_parent(ralloc_ctx, size);
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+   return ptr;
+}
+
+void *
+linear_alloc_child(void *parent, unsigned size)
+{
+   linear_header *first = get_linear_header(parent);
+   linear_header *latest = first->latest;
+   linear_header *node;
+   void *ptr;
+
+   size = ALIGN_POT(size, SUBALLOC_ALIGNMENT);
+
+   if (unlikely(latest->offset + size > latest->size)) {
+      node = create_linear_node(first, size);
+      if (unlikely(node == NULL))
+         return NULL;
+
+      /* Large requests get a buffer of their own; don't throw away the
+       * remaining space in the current one for them.
+       */
+      if (size > MIN_LINEAR_BUFSIZE / 2) {
+         node->offset = size;
+         return LINEAR_DATA(node);
+      }
+
+      first->latest = node;
+      latest = node;
+   }
+
+   ptr = LINEAR_DATA(latest) + latest->offset;
+   latest->offset += size;
+   return ptr;
+}
+
+void *
+linear_zalloc_child(void *parent, unsigned size)
+{
+   void *ptr = linear_alloc_child(parent, size);
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+   return ptr;
+}
+
+void
+linear_free_parent(void *ptr)
+{
+   if (unlikely(ptr == NULL))
+      return;
+
+   ralloc_free(get_linear_header(ptr));
+}
+
+void
+ralloc_steal_linear_parent(void *new_ralloc_ctx, void *ptr)
+{
+   if (unlikely(ptr == NULL))
+      return;
+
+   ralloc_steal(new_ralloc_ctx, get_linear_header(ptr));
+}
+
+void *
+ralloc_parent_of_linear_parent(void *ptr)
+{
+   return ralloc_parent(get_linear_header(ptr));
+}
+
+char *
+linear_strdup(void *parent, const char *str)
+{
+   size_t n;
+   char *ptr;
+
+   if (unlikely(str == NULL))
+      return NULL;
+
+   n = strlen(str);
+   ptr = linear_alloc_child(parent, n + 1);
+   if (unlikely(ptr == NULL))
+      return NULL;
+
+   memcpy(ptr, str, n);
+   ptr[n] = '\0';
+   return ptr;
+}
+
+char *
+linear_asprintf(void *parent, const char *fmt, ...)
+{
+   char *ptr;
+   va_list args;
+   va_start(args, fmt);
+   ptr = linear_vasprintf(parent, fmt, args);
+   va_end(args);
+   return ptr;
+}
+
+char *
+linear_vasprintf(void *parent, const char *fmt, va_list args)
+{
+   unsigned size = printf_length(fmt, args) + 1;
+
+   char *ptr = linear_alloc_child(parent, size);
+   if (ptr != NULL)
+      vsnprintf(ptr, size, fmt, args);
+
+   return ptr;
+}
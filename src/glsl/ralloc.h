@@ -400,6 +400,99 @@ bool ralloc_asprintf_append (char **str, const char *fmt, ...)
 bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
 /// @}
 
+/**
+ * \name Linear allocation
+ *
+ * A linear allocator hands out memory by bumping an offset into large
+ * buffers, with no per-allocation header.  This makes it much cheaper than
+ * ralloc for the many small, short-lived objects a compiler pass creates,
+ * at the cost of flexibility:
+ *
+ * - Individual allocations cannot be freed, resized, stolen or given a
+ *   destructor.  Everything is released at once when the linear parent (or
+ *   the ralloc context owning it) is freed.
+ * - Linear allocations cannot be used as ralloc contexts.
+ *
+ * A linear parent is created with \c linear_alloc_parent, which returns a
+ * (possibly zero-sized) allocation that is itself a child of an ordinary
+ * ralloc context.  All further allocations are made against that pointer
+ * with \c linear_alloc_child and friends.
+ *
+ * \code
+ * void *lin_ctx = linear_alloc_parent(mem_ctx, 0);
+ * struct entry *e = linear_alloc_child(lin_ctx, sizeof(*e));
+ * ...
+ * ralloc_free(mem_ctx);  // also frees lin_ctx and e
+ * \endcode
+ */
+/// @{
+
+/**
+ * Create a new linear parent as a child of the ralloc context \p ralloc_ctx.
+ *
+ * As with ralloc, \p ralloc_ctx may be \c NULL; the parent must then be
+ * freed explicitly with \c linear_free_parent.
+ *
+ * \param size  Size of the memory returned to the caller; may be zero.
+ *
+ * \return A pointer to \p size bytes of memory that can be passed to the
+ * \c linear_*_child functions, or \c NULL on failure.
+ */
+void *linear_alloc_parent(void *ralloc_ctx, unsigned size);
+
+/**
+ * Like \c linear_alloc_parent, but the returned memory is zeroed.
+ */
+void *linear_zalloc_parent(void *ralloc_ctx, unsigned size);
+
+/**
+ * Allocate \p size bytes out of the linear parent \p parent.
+ *
+ * The memory is uninitialized.
+ */
+void *linear_alloc_child(void *parent, unsigned size);
+
+/**
+ * Like \c linear_alloc_child, but the returned memory is zeroed.
+ */
+void *linear_zalloc_child(void *parent, unsigned size);
+
+/**
+ * Free a linear parent and every allocation made from it.
+ */
+void linear_free_parent(void *ptr);
+
+/**
+ * Move a linear parent, along with every allocation made from it, to a
+ * different ralloc context.
+ */
+void ralloc_steal_linear_parent(void *new_ralloc_ctx, void *ptr);
+
+/**
+ * Return the ralloc context owning a linear parent.
+ */
+void *ralloc_parent_of_linear_parent(void *ptr);
+
+/**
+ * Duplicate a string, allocating the memory out of \p parent.
+ */
+char *linear_strdup(void *parent, const char *str);
+
+/**
+ * Print to a string allocated out of \p parent.
+ *
+ * \sa ralloc_asprintf
+ */
+char *linear_asprintf(void *parent, const char *fmt, ...) PRINTFLIKE(2, 3);
+
+/**
+ * Print to a string allocated out of \p parent, given a va_list.
+ *
+ * \sa ralloc_vasprintf
+ */
+char *linear_vasprintf(void *parent, const char *fmt, va_list args);
+/// @}
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -441,5 +534,30 @@ public:                                                                  \
       ralloc_free(p);                                                    \
    }
 
+/**
+ * Declare C++ new and delete operators which use the linear allocator.
+ *
+ * Placing this macro in the body of a class makes it possible to do:
+ *
+ * TYPE *var = new(lin_ctx) TYPE(...);
+ *
+ * where \c lin_ctx was returned by \c linear_alloc_parent.  Objects allocated
+ * this way are released along with \c lin_ctx; their destructors are never
+ * run, so \c TYPE should not need one, and \c delete is a no-op.
+ */
+#define DECLARE_LINEAR_ALLOC_CXX_OPERATORS(TYPE)                         \
+public:                                                                  \
+   static void* operator new(size_t size, void *lin_ctx)                 \
+   {                                                                     \
+      void *p = linear_alloc_child(lin_ctx, size);                       \
+      assert(p != NULL);                                                 \
+      return p;                                                          \
+   }                                                                     \
+                                                                         \
+   static void operator delete(void *p)                                  \
+   {                                                                     \
+      /* Linear allocations are only freed with their parent. */         \
+   }
+
 
 #endif
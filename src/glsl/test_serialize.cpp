@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file test_serialize.cpp
+ *
+ * Standalone benchmark for IR serialization.
+ *
+ * This file provides the "serialize" command for the standalone glsl_test
+ * app.  It compiles a GLSL shader (or reads high-level IR) from stdin and
+ * then repeatedly saves and reloads the resulting IR, once through the
+ * s-expression path (ir_print_visitor + ir_reader) and once through the
+ * binary path (ir_serialize), validating every reloaded tree.  It reports
+ * the encoded sizes and the average time per round trip.
+ */
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <getopt.h>
+#include <time.h>
+
+#include "ast.h"
+#include "glsl_parser_extras.h"
+#include "program.h"
+#include "ir_reader.h"
+#include "ir_serialize.h"
+#include "standalone_scaffolding.h"
+
+using namespace std;
+
+static string read_stdin_to_eof()
+{
+   stringbuf sb;
+   cin.get(sb, '\0');
+   return sb.str();
+}
+
+static double
+get_time_us()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+/**
+ * Save the IR as text and load it back into a fresh parse state.
+ */
+static bool
+text_round_trip(struct gl_context *ctx, struct gl_shader *shader,
+                exec_list *ir, size_t *size)
+{
+   char *text = NULL;
+   size_t len = 0;
+   FILE *f = open_memstream(&text, &len);
+   if (f == NULL)
+      return false;
+   _mesa_print_ir(f, ir, NULL);
+   fclose(f);
+   *size = len;
+
+   _mesa_glsl_parse_state *state =
+      new(shader) _mesa_glsl_parse_state(ctx, shader->Stage, shader);
+   _mesa_glsl_initialize_types(state);
+
+   exec_list *result = new(state) exec_list;
+   _mesa_glsl_read_ir(state, result, text, true);
+   free(text);
+
+   bool ok = !state->error;
+   if (ok)
+      validate_ir_tree(result);
+   ralloc_free(state);
+   return ok;
+}
+
+/**
+ * Save the IR as a binary blob and load it back.
+ */
+static bool
+binary_round_trip(exec_list *ir, size_t *size)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   uint8_t *data = _mesa_glsl_write_ir_binary(mem_ctx, ir, size);
+
+   exec_list *result = new(mem_ctx) exec_list;
+   bool ok = _mesa_glsl_read_ir_binary(mem_ctx, NULL, result, data, *size);
+   if (ok)
+      validate_ir_tree(result);
+   ralloc_free(mem_ctx);
+   return ok;
+}
+
+int test_serialize(int argc, char **argv)
+{
+   int input_format_ir = 0; /* 0=glsl, 1=ir */
+   int shader_type = GL_VERTEX_SHADER;
+   int iterations = 1000;
+
+   const struct option serialize_opts[] = {
+      { "input-ir", no_argument, &input_format_ir, 1 },
+      { "input-glsl", no_argument, &input_format_ir, 0 },
+      { "vertex-shader", no_argument, &shader_type, GL_VERTEX_SHADER },
+      { "fragment-shader", no_argument, &shader_type, GL_FRAGMENT_SHADER },
+      { "iterations", required_argument, NULL, 'n' },
+      { NULL, 0, NULL, 0 }
+   };
+
+   int idx = 0;
+   int c;
+   while ((c = getopt_long(argc, argv, "", serialize_opts, &idx)) != -1) {
+      if (c == 'n') {
+         iterations = atoi(optarg);
+      } else if (c != 0) {
+         printf("*** usage: %s serialize <options>\n", argv[0]);
+         printf("\n");
+         printf("Possible options are:\n");
+         printf("  --input-ir: input format is IR\n");
+         printf("  --input-glsl: input format is GLSL (the default)\n");
+         printf("  --vertex-shader: test with a vertex shader (the default)\n");
+         printf("  --fragment-shader: test with a fragment shader\n");
+         printf("  --iterations=N: number of round trips to time\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   struct gl_context local_ctx;
+   struct gl_context *ctx = &local_ctx;
+   initialize_context_to_defaults(ctx, API_OPENGL_COMPAT);
+
+   ctx->Driver.NewShader = _mesa_new_shader;
+
+   struct gl_shader *shader = rzalloc(NULL, struct gl_shader);
+   shader->Type = shader_type;
+   shader->Stage = _mesa_shader_enum_to_shader_stage(shader_type);
+
+   string input = read_stdin_to_eof();
+
+   struct _mesa_glsl_parse_state *state
+      = new(shader) _mesa_glsl_parse_state(ctx, shader->Stage, shader);
+
+   shader->ir = new(shader) exec_list;
+   if (input_format_ir) {
+      _mesa_glsl_initialize_types(state);
+      _mesa_glsl_read_ir(state, shader->ir, input.c_str(), true);
+   } else {
+      shader->Source = input.c_str();
+      const char *source = shader->Source;
+      state->error = glcpp_preprocess(state, &source, &state->info_log,
+                                      state->extensions, ctx) != 0;
+
+      if (!state->error) {
+         _mesa_glsl_lexer_ctor(state, source);
+         _mesa_glsl_parse(state);
+         _mesa_glsl_lexer_dtor(state);
+      }
+
+      if (!state->error && !state->translation_unit.is_empty())
+         _mesa_ast_to_hir(shader->ir, state);
+   }
+
+   if (state->error) {
+      printf("*** error(s) occurred:\n");
+      printf("%s\n", state->info_log);
+      printf("--\n");
+      ralloc_free(shader);
+      return EXIT_FAILURE;
+   }
+
+   int status = EXIT_SUCCESS;
+   size_t text_size = 0, binary_size = 0;
+
+   double start = get_time_us();
+   for (int i = 0; i < iterations; i++) {
+      if (!text_round_trip(ctx, shader, shader->ir, &text_size)) {
+         printf("s-expression round trip failed\n");
+         status = EXIT_FAILURE;
+         break;
+      }
+   }
+   double text_time = (get_time_us() - start) / iterations;
+
+   start = get_time_us();
+   for (int i = 0; i < iterations; i++) {
+      if (!binary_round_trip(shader->ir, &binary_size)) {
+         printf("binary round trip failed\n");
+         status = EXIT_FAILURE;
+         break;
+      }
+   }
+   double binary_time = (get_time_us() - start) / iterations;
+
+   printf("s-expression: %8zu bytes, %10.1f us per round trip\n",
+          text_size, text_time);
+   printf("binary:       %8zu bytes, %10.1f us per round trip\n",
+          binary_size, binary_time);
+
+   ralloc_free(shader);
+   return status;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "standalone_scaffolding.h"
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "ralloc.h"
+#include "ir.h"
+#include "glsl_parser_extras.h"
+#include "program.h"
+
+/**
+ * \file compile_test.cpp
+ *
+ * Compiles whole shaders, so that every AST node the parser creates goes
+ * through the linear allocator of the parse state.
+ */
+
+class compile_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   /**
+    * Compile \c source as a shader of the given type and check that it
+    * succeeds.
+    */
+   void compile(GLenum type, const char *source);
+
+   void *mem_ctx;
+   gl_context ctx;
+};
+
+void
+compile_test::SetUp()
+{
+   this->mem_ctx = ralloc_context(NULL);
+
+   initialize_context_to_defaults(&this->ctx, API_OPENGL_COMPAT);
+   this->ctx.Const.GLSLVersion = 150;
+}
+
+void
+compile_test::TearDown()
+{
+   ralloc_free(this->mem_ctx);
+   this->mem_ctx = NULL;
+}
+
+void
+compile_test::compile(GLenum type, const char *source)
+{
+   struct gl_shader *shader = rzalloc(this->mem_ctx, gl_shader);
+   shader->Type = type;
+   shader->Stage = _mesa_shader_enum_to_shader_stage(type);
+   shader->Source = source;
+
+   _mesa_glsl_compile_shader(&this->ctx, shader, false, false);
+
+   EXPECT_TRUE(shader->CompileStatus) << shader->InfoLog;
+   EXPECT_FALSE(shader->ir->is_empty());
+}
+
+TEST_F(compile_test, selection)
+{
+   compile(GL_FRAGMENT_SHADER,
+           "#version 150\n"
+           "uniform int mode;\n"
+           "out vec4 color;\n"
+           "void main() {\n"
+           "   vec4 c = vec4(0.0);\n"
+           "   if (mode > 0)\n"
+           "      c.x = 1.0;\n"
+           "   else if (mode < -1) {\n"
+           "      if (mode == -2)\n"
+           "         c.y = 1.0;\n"
+           "   } else\n"
+           "      c.z = 1.0;\n"
+           "   color = c;\n"
+           "}\n");
+}
+
+TEST_F(compile_test, switch_case_default)
+{
+   compile(GL_FRAGMENT_SHADER,
+           "#version 150\n"
+           "uniform int mode;\n"
+           "out vec4 color;\n"
+           "void main() {\n"
+           "   vec4 c = vec4(0.0);\n"
+           "   switch (mode) {\n"
+           "   case 0:\n"
+           "   case 1:\n"
+           "      c.x = 1.0;\n"
+           "      break;\n"
+           "   case 2:\n"
+           "      c.y = 1.0;\n"
+           "   default:\n"
+           "      c.z = 1.0;\n"
+           "      break;\n"
+           "   }\n"
+           "   switch (mode) {\n"
+           "   }\n"
+           "   color = c;\n"
+           "}\n");
+}
+
+TEST_F(compile_test, interface_blocks)
+{
+   compile(GL_VERTEX_SHADER,
+           "#version 150\n"
+           "uniform Transform { mat4 mvp; };\n"
+           "uniform Material { vec4 color; } material;\n"
+           "uniform Lights { vec4 pos; } lights[2];\n"
+           "out Varyings { vec4 color; } vs_out;\n"
+           "in vec4 position;\n"
+           "void main() {\n"
+           "   vs_out.color = material.color + lights[1].pos;\n"
+           "   gl_Position = mvp * position;\n"
+           "}\n");
+}
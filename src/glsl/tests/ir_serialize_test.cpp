@@ -0,0 +1,305 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <string.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "ralloc.h"
+#include "ir.h"
+#include "ir_builder.h"
+#include "ir_serialize.h"
+#include "program/prog_instruction.h"
+
+/**
+ * \file ir_serialize_test.cpp
+ *
+ * Round-trip tests for the binary IR writer and reader.
+ */
+
+using namespace ir_builder;
+
+class ir_serialize : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   /**
+    * Serialize \c ir, read it back into \c result and check that the result
+    * validates and serializes to the same bytes.
+    */
+   void round_trip();
+
+   void *mem_ctx;
+   exec_list ir;
+   exec_list result;
+};
+
+void
+ir_serialize::SetUp()
+{
+   this->mem_ctx = ralloc_context(NULL);
+   this->ir.make_empty();
+   this->result.make_empty();
+}
+
+void
+ir_serialize::TearDown()
+{
+   ralloc_free(this->mem_ctx);
+   this->mem_ctx = NULL;
+}
+
+void
+ir_serialize::round_trip()
+{
+   validate_ir_tree(&ir);
+
+   size_t size;
+   uint8_t *data = _mesa_glsl_write_ir_binary(mem_ctx, &ir, &size);
+   ASSERT_TRUE(data != NULL);
+   ASSERT_GT(size, 0u);
+
+   ASSERT_TRUE(_mesa_glsl_read_ir_binary(mem_ctx, NULL, &result, data, size));
+   validate_ir_tree(&result);
+
+   size_t size2;
+   uint8_t *data2 = _mesa_glsl_write_ir_binary(mem_ctx, &result, &size2);
+   ASSERT_EQ(size, size2);
+   EXPECT_EQ(0, memcmp(data, data2, size));
+}
+
+TEST_F(ir_serialize, variables)
+{
+   ir_variable *in = new(mem_ctx) ir_variable(glsl_type::vec4_type, "in_pos",
+                                              ir_var_shader_in);
+   in->data.location = VERT_ATTRIB_GENERIC0 + 3;
+   in->data.explicit_location = true;
+   in->data.centroid = 1;
+   ir.push_tail(in);
+
+   ir_variable *u = new(mem_ctx) ir_variable(
+      glsl_type::get_array_instance(glsl_type::mat4_type, 3), "mvp",
+      ir_var_uniform);
+   u->data.max_array_access = 2;
+   ir.push_tail(u);
+
+   ir_variable *c = new(mem_ctx) ir_variable(glsl_type::ivec2_type, "k",
+                                             ir_var_auto);
+   ir_constant_data data;
+   memset(&data, 0, sizeof(data));
+   data.i[0] = -7;
+   data.i[1] = 1 << 20;
+   c->constant_value = new(c) ir_constant(glsl_type::ivec2_type, &data);
+   c->constant_initializer = new(c) ir_constant(glsl_type::ivec2_type, &data);
+   c->data.has_initializer = true;
+   c->data.read_only = true;
+   ir.push_tail(c);
+
+   round_trip();
+
+   ir_variable *in2 = ((ir_instruction *) result.get_head())->as_variable();
+   ASSERT_TRUE(in2 != NULL);
+   EXPECT_STREQ("in_pos", in2->name);
+   EXPECT_EQ(glsl_type::vec4_type, in2->type);
+   EXPECT_EQ((unsigned) ir_var_shader_in, in2->data.mode);
+   EXPECT_EQ(VERT_ATTRIB_GENERIC0 + 3, in2->data.location);
+   EXPECT_TRUE(in2->data.explicit_location);
+   EXPECT_TRUE(in2->data.centroid);
+
+   ir_variable *u2 = ((ir_instruction *) in2->next)->as_variable();
+   ASSERT_TRUE(u2 != NULL);
+   EXPECT_EQ(u->type, u2->type);
+   EXPECT_EQ(2u, u2->data.max_array_access);
+
+   ir_variable *c2 = ((ir_instruction *) u2->next)->as_variable();
+   ASSERT_TRUE(c2 != NULL);
+   ASSERT_TRUE(c2->constant_value != NULL);
+   ASSERT_TRUE(c2->constant_initializer != NULL);
+   EXPECT_NE(c2->constant_value, c2->constant_initializer);
+   EXPECT_EQ(-7, c2->constant_value->value.i[0]);
+   EXPECT_EQ(1 << 20, c2->constant_value->value.i[1]);
+}
+
+TEST_F(ir_serialize, function_body)
+{
+   ir_variable *out = new(mem_ctx) ir_variable(glsl_type::vec4_type, "color",
+                                               ir_var_shader_out);
+   ir.push_tail(out);
+
+   /* float scale(float x) { return x * 2.0; } */
+   ir_function *scale_f = new(mem_ctx) ir_function("scale");
+   ir_function_signature *scale =
+      new(mem_ctx) ir_function_signature(glsl_type::float_type);
+   ir_variable *x = new(mem_ctx) ir_variable(glsl_type::float_type, "x",
+                                             ir_var_function_in);
+   scale->parameters.push_tail(x);
+   scale->body.push_tail(new(mem_ctx) ir_return(mul(x, new(mem_ctx) ir_constant(2.0f))));
+   scale->is_defined = true;
+   scale_f->add_signature(scale);
+   ir.push_tail(scale_f);
+
+   /* void main() { ... } */
+   ir_function *main_f = new(mem_ctx) ir_function("main");
+   ir_function_signature *main_sig =
+      new(mem_ctx) ir_function_signature(glsl_type::void_type);
+   main_sig->is_defined = true;
+   main_f->add_signature(main_sig);
+   ir.push_tail(main_f);
+
+   exec_list *body = &main_sig->body;
+
+   ir_variable *t = new(mem_ctx) ir_variable(glsl_type::float_type, "t",
+                                             ir_var_temporary);
+   body->push_tail(t);
+
+   ir_variable *i = new(mem_ctx) ir_variable(glsl_type::int_type, "i",
+                                             ir_var_auto);
+   body->push_tail(i);
+   body->push_tail(assign(i, new(mem_ctx) ir_constant(0)));
+
+   exec_list params;
+   params.push_tail(new(mem_ctx) ir_constant(0.25f));
+   body->push_tail(new(mem_ctx) ir_call(scale,
+                                        new(mem_ctx) ir_dereference_variable(t),
+                                        &params));
+
+   ir_loop *loop = new(mem_ctx) ir_loop;
+   ir_if *brk = new(mem_ctx) ir_if(gequal(i, new(mem_ctx) ir_constant(4)));
+   brk->then_instructions.push_tail(new(mem_ctx) ir_loop_jump(ir_loop_jump::jump_break));
+   loop->body_instructions.push_tail(brk);
+   loop->body_instructions.push_tail(assign(i, add(i, new(mem_ctx) ir_constant(1))));
+   loop->body_instructions.push_tail(assign(out, swizzle_xxxx(t), WRITEMASK_XYZW));
+   body->push_tail(loop);
+
+   ir_if *iff = new(mem_ctx) ir_if(less(t, new(mem_ctx) ir_constant(0.0f)));
+   iff->then_instructions.push_tail(new(mem_ctx) ir_discard);
+   iff->else_instructions.push_tail(assign(out, neg(swizzle_for_size(out, 2)), WRITEMASK_XY));
+   body->push_tail(iff);
+
+   round_trip();
+
+   ir_function *scale2 = ((ir_instruction *) result.get_head()->next)->as_function();
+   ASSERT_TRUE(scale2 != NULL);
+   EXPECT_STREQ("scale", scale2->name);
+
+   ir_function *main2 = ((ir_instruction *) scale2->next)->as_function();
+   ASSERT_TRUE(main2 != NULL);
+   ir_function_signature *main_sig2 =
+      (ir_function_signature *) main2->signatures.get_head();
+
+   ir_call *call = NULL;
+   foreach_list(node, &main_sig2->body) {
+      call = ((ir_instruction *) node)->as_call();
+      if (call)
+         break;
+   }
+   ASSERT_TRUE(call != NULL);
+   EXPECT_EQ(scale2->signatures.get_head(), call->callee);
+   EXPECT_STREQ("scale", call->callee_name());
+}
+
+TEST_F(ir_serialize, struct_and_constant_array)
+{
+   static const glsl_struct_field fields[] = {
+      { glsl_type::vec3_type, "dir", false, -1, 0, 0, 0 },
+      { glsl_type::get_array_instance(glsl_type::float_type, 2), "w", false,
+        -1, 0, 0, 0 },
+   };
+   const glsl_type *light =
+      glsl_type::get_record_instance(fields, ARRAY_SIZE(fields), "light");
+
+   ir_variable *l = new(mem_ctx) ir_variable(light, "l", ir_var_uniform);
+   ir.push_tail(l);
+
+   ir_variable *f = new(mem_ctx) ir_variable(glsl_type::float_type, "f",
+                                             ir_var_auto);
+   ir.push_tail(f);
+
+   ir_dereference_record *w = new(mem_ctx) ir_dereference_record(l, "w");
+   ir.push_tail(assign(f, new(mem_ctx) ir_dereference_array(w, new(mem_ctx) ir_constant(1))));
+
+   exec_list elements;
+   elements.push_tail(new(mem_ctx) ir_constant(true));
+   elements.push_tail(new(mem_ctx) ir_constant(false));
+   elements.push_tail(new(mem_ctx) ir_constant(true));
+   const glsl_type *bool_array =
+      glsl_type::get_array_instance(glsl_type::bool_type, 3);
+   ir_variable *b = new(mem_ctx) ir_variable(bool_array, "b", ir_var_auto);
+   ir.push_tail(b);
+   ir.push_tail(new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(b),
+                                           new(mem_ctx) ir_constant(bool_array, &elements)));
+
+   round_trip();
+
+   ir_variable *l2 = ((ir_instruction *) result.get_head())->as_variable();
+   ASSERT_TRUE(l2 != NULL);
+   EXPECT_EQ(light, l2->type);
+}
+
+TEST_F(ir_serialize, interface_instance)
+{
+   static const glsl_struct_field f[] = {
+      { glsl_type::vec4_type, "v", false, -1, 0, 0, 0 },
+      { glsl_type::get_array_instance(glsl_type::vec4_type, 8), "a", false,
+        -1, 0, 0, 0 },
+   };
+   const glsl_type *iface =
+      glsl_type::get_interface_instance(f, ARRAY_SIZE(f),
+                                        GLSL_INTERFACE_PACKING_STD140,
+                                        "block");
+
+   ir_variable *v = new(mem_ctx) ir_variable(iface, "inst", ir_var_uniform);
+   v->max_ifc_array_access[1] = 5;
+   ir.push_tail(v);
+
+   round_trip();
+
+   ir_variable *v2 = ((ir_instruction *) result.get_head())->as_variable();
+   ASSERT_TRUE(v2 != NULL);
+   EXPECT_EQ(iface, v2->type);
+   EXPECT_EQ(iface, v2->get_interface_type());
+   ASSERT_TRUE(v2->max_ifc_array_access != NULL);
+   EXPECT_EQ(5u, v2->max_ifc_array_access[1]);
+}
+
+TEST_F(ir_serialize, rejects_truncated_data)
+{
+   ir_variable *a = new(mem_ctx) ir_variable(glsl_type::vec2_type, "a",
+                                             ir_var_auto);
+   ir.push_tail(a);
+   ir.push_tail(assign(a, new(mem_ctx) ir_constant(1.0f, 2)));
+
+   size_t size;
+   uint8_t *data = _mesa_glsl_write_ir_binary(mem_ctx, &ir, &size);
+
+   for (size_t len = 0; len < size; len++) {
+      EXPECT_FALSE(_mesa_glsl_read_ir_binary(mem_ctx, NULL, &result, data, len));
+      EXPECT_TRUE(result.is_empty());
+   }
+
+   /* A blob from a build with a different format version is rejected. */
+   data[4] ^= 0xff;
+   EXPECT_FALSE(_mesa_glsl_read_ir_binary(mem_ctx, NULL, &result, data, size));
+   EXPECT_TRUE(result.is_empty());
+}
@@ -36,3 +36,67 @@ TEST(ralloc_test, null_parent)
    EXPECT_EQ(NULL, ralloc_parent(mem_ctx));
 }
 /*@}*/
+
+/**
+ * \name Linear allocator
+ */
+/*@{*/
+TEST(ralloc_test, linear_parent)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   void *lin_ctx = linear_alloc_parent(mem_ctx, 16);
+
+   ASSERT_TRUE(lin_ctx != NULL);
+   EXPECT_EQ(mem_ctx, ralloc_parent_of_linear_parent(lin_ctx));
+
+   void *other_ctx = ralloc_context(NULL);
+   ralloc_steal_linear_parent(other_ctx, lin_ctx);
+   EXPECT_EQ(other_ctx, ralloc_parent_of_linear_parent(lin_ctx));
+
+   ralloc_free(other_ctx);
+   ralloc_free(mem_ctx);
+}
+
+TEST(ralloc_test, linear_children)
+{
+   void *lin_ctx = linear_alloc_parent(NULL, 0);
+   char *prev = NULL;
+
+   /* Enough allocations to spill into several buffers.  Every allocation
+    * must be distinct, aligned and hold its contents.
+    */
+   char *ptrs[1000];
+   for (unsigned i = 0; i < 1000; i++) {
+      ptrs[i] = (char *) linear_alloc_child(lin_ctx, 1 + i % 37);
+      ASSERT_TRUE(ptrs[i] != NULL);
+      EXPECT_EQ(0u, ((uintptr_t) ptrs[i]) % 8);
+      EXPECT_NE(prev, ptrs[i]);
+      memset(ptrs[i], i & 0xff, 1 + i % 37);
+      prev = ptrs[i];
+   }
+
+   for (unsigned i = 0; i < 1000; i++) {
+      for (unsigned j = 0; j < 1 + i % 37; j++)
+         EXPECT_EQ((char) (i & 0xff), ptrs[i][j]);
+   }
+
+   /* Large allocations get their own buffer. */
+   char *big = (char *) linear_zalloc_child(lin_ctx, 100000);
+   ASSERT_TRUE(big != NULL);
+   EXPECT_EQ(0, big[0]);
+   EXPECT_EQ(0, big[99999]);
+
+   linear_free_parent(lin_ctx);
+}
+
+TEST(ralloc_test, linear_strings)
+{
+   void *lin_ctx = linear_alloc_parent(NULL, 0);
+
+   EXPECT_STREQ("identifier", linear_strdup(lin_ctx, "identifier"));
+   EXPECT_STREQ("#anon_struct_0001",
+                linear_asprintf(lin_ctx, "#anon_struct_%04x", 1));
+
+   linear_free_parent(lin_ctx);
+}
+/*@}*/
@@ -30,6 +30,7 @@
 #include "main/mtypes.h"
 #include "main/macros.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "intel_blit.h"
 #include "intel_buffer_objects.h"
@@ -99,6 +100,7 @@ intel_bufferobj_free(struct gl_context * ctx, struct gl_buffer_object *obj)
    _mesa_align_free(intel_obj->sys_buffer);
 
    drm_intel_bo_unreference(intel_obj->buffer);
+   vbo_delete_minmax_cache(obj);
    free(intel_obj);
 }
 
@@ -1726,7 +1726,6 @@ intel_miptree_unmap_blit(struct brw_context *brw,
    intel_miptree_release(&map->mt);
 }
 
-#ifdef __SSE4_1__
 /**
  * "Map" a buffer by copying it to an untiled temporary using MOVNTDQA.
  */
@@ -1780,7 +1779,7 @@ intel_miptree_map_movntdqa(struct brw_context *brw,
       void *dst_ptr = map->ptr + y * map->stride;
       void *src_ptr = src + y * mt->region->pitch;
 
-      _mesa_streaming_load_memcpy(dst_ptr, src_ptr, width_bytes);
+      _mesa_memcpy_from_wc(dst_ptr, src_ptr, width_bytes);
    }
 
    intel_miptree_unmap_raw(brw, mt);
@@ -1797,7 +1796,6 @@ intel_miptree_unmap_movntdqa(struct brw_context *brw,
    map->buffer = NULL;
    map->ptr = NULL;
 }
-#endif
 
 static void
 intel_miptree_map_s8(struct brw_context *brw,
@@ -2178,10 +2176,9 @@ intel_miptree_map(struct brw_context *brw,
               mt->region->bo->size >= brw->max_gtt_map_object_size) {
       assert(can_blit_slice(mt, level, slice));
       intel_miptree_map_blit(brw, mt, map, level, slice);
-#ifdef __SSE4_1__
-   } else if (!(mode & GL_MAP_WRITE_BIT) && !mt->compressed) {
+   } else if (!(mode & GL_MAP_WRITE_BIT) && !mt->compressed &&
+              _mesa_has_streaming_load_memcpy()) {
       intel_miptree_map_movntdqa(brw, mt, map, level, slice);
-#endif
    } else {
       intel_miptree_map_gtt(brw, mt, map, level, slice);
    }
@@ -2218,10 +2215,8 @@ intel_miptree_unmap(struct brw_context *brw,
       intel_miptree_unmap_depthstencil(brw, mt, map, level, slice);
    } else if (map->mt) {
       intel_miptree_unmap_blit(brw, mt, map, level, slice);
-#ifdef __SSE4_1__
    } else if (map->buffer) {
       intel_miptree_unmap_movntdqa(brw, mt, map, level, slice);
-#endif
    } else {
       intel_miptree_unmap_gtt(brw, mt, map, level, slice);
    }
@@ -280,27 +280,38 @@ static GLboolean
 get_env_param_pointer(struct gl_context *ctx, const char *func,
 		      GLenum target, GLuint index, GLfloat **param)
 {
+   GLfloat (**params)[4];
+   GLuint maxParams;
+
    if (target == GL_FRAGMENT_PROGRAM_ARB
        && ctx->Extensions.ARB_fragment_program) {
-      if (index >= ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxEnvParams) {
-         _mesa_error(ctx, GL_INVALID_VALUE, "%s(index)", func);
-         return GL_FALSE;
-      }
-      *param = ctx->FragmentProgram.Parameters[index];
-      return GL_TRUE;
+      params = &ctx->FragmentProgram.Parameters;
+      maxParams = ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxEnvParams;
    }
    else if (target == GL_VERTEX_PROGRAM_ARB &&
             ctx->Extensions.ARB_vertex_program) {
-      if (index >= ctx->Const.Program[MESA_SHADER_VERTEX].MaxEnvParams) {
-         _mesa_error(ctx, GL_INVALID_VALUE, "%s(index)", func);
-         return GL_FALSE;
-      }
-      *param = ctx->VertexProgram.Parameters[index];
-      return GL_TRUE;
+      params = &ctx->VertexProgram.Parameters;
+      maxParams = ctx->Const.Program[MESA_SHADER_VERTEX].MaxEnvParams;
    } else {
       _mesa_error(ctx, GL_INVALID_ENUM, "%s(target)", func);
       return GL_FALSE;
    }
+
+   if (index >= maxParams) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "%s(index)", func);
+      return GL_FALSE;
+   }
+
+   if (!*params) {
+      *params = calloc(MAX_PROGRAM_ENV_PARAMS, sizeof(float[4]));
+      if (!*params) {
+         _mesa_error(ctx, GL_OUT_OF_MEMORY, "%s", func);
+         return GL_FALSE;
+      }
+   }
+
+   *param = (*params)[index];
+   return GL_TRUE;
 }
 
 void GLAPIENTRY
@@ -440,7 +451,6 @@ _mesa_ProgramEnvParameters4fvEXT(GLenum target, GLuint index, GLsizei count,
          _mesa_error(ctx, GL_INVALID_VALUE, "glProgramEnvParameters4fv(index + count)");
          return;
       }
-      dest = ctx->FragmentProgram.Parameters[index];
    }
    else if (target == GL_VERTEX_PROGRAM_ARB
        && ctx->Extensions.ARB_vertex_program) {
@@ -448,12 +458,11 @@ _mesa_ProgramEnvParameters4fvEXT(GLenum target, GLuint index, GLsizei count,
          _mesa_error(ctx, GL_INVALID_VALUE, "glProgramEnvParameters4fv(index + count)");
          return;
       }
-      dest = ctx->VertexProgram.Parameters[index];
    }
-   else {
-      _mesa_error(ctx, GL_INVALID_ENUM, "glProgramEnvParameters4fv(target)");
+
+   if (!get_env_param_pointer(ctx, "glProgramEnvParameters4fv",
+                              target, index, &dest))
       return;
-   }
 
    memcpy(dest, params, count * 4 * sizeof(GLfloat));
 }
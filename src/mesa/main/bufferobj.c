@@ -46,6 +46,7 @@
 #include "texstore.h"
 #include "transformfeedback.h"
 #include "dispatch.h"
+#include "vbo/vbo.h"
 
 
 /* Debug flags */
@@ -412,12 +413,14 @@ _mesa_delete_buffer_object(struct gl_context *ctx,
    (void) ctx;
 
    _mesa_align_free(bufObj->Data);
+   vbo_delete_minmax_cache(bufObj);
 
    /* assign strange values here to help w/ debugging */
    bufObj->RefCount = -1000;
    bufObj->Name = ~0;
 
    mtx_destroy(&bufObj->Mutex);
+   mtx_destroy(&bufObj->MinMaxCacheMutex);
    free(bufObj->Label);
    free(bufObj);
 }
@@ -501,6 +504,7 @@ _mesa_initialize_buffer_object( struct gl_context *ctx,
 
    memset(obj, 0, sizeof(struct gl_buffer_object));
    mtx_init(&obj->Mutex, mtx_plain);
+   mtx_init(&obj->MinMaxCacheMutex, mtx_plain);
    obj->RefCount = 1;
    obj->Name = name;
    obj->Usage = GL_STATIC_DRAW_ARB;
@@ -934,6 +938,10 @@ bind_buffer_object(struct gl_context *ctx, GLenum target, GLuint buffer)
       if (!_mesa_handle_bind_buffer_gen(ctx, target, buffer,
                                         &newBufObj, "glBindBuffer"))
          return;
+
+      /* Pixel pack buffers are written by glReadPixels and friends. */
+      if (target == GL_PIXEL_PACK_BUFFER)
+         newBufObj->GPUWritable = GL_TRUE;
    }
    
    /* bind new buffer */
@@ -1275,6 +1283,7 @@ _mesa_BufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data,
 
    bufObj->Written = GL_TRUE;
    bufObj->Immutable = GL_TRUE;
+   bufObj->MinMaxCacheDirty = GL_TRUE;
 
    ASSERT(ctx->Driver.BufferData);
    if (!ctx->Driver.BufferData(ctx, target, size, data, GL_DYNAMIC_DRAW,
@@ -1347,6 +1356,7 @@ _mesa_BufferData(GLenum target, GLsizeiptrARB size,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = GL_TRUE;
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1393,6 +1403,7 @@ _mesa_BufferSubData(GLenum target, GLintptrARB offset,
       return;
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = GL_TRUE;
 
    ASSERT(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData( ctx, offset, size, data, bufObj );
@@ -1455,6 +1466,8 @@ _mesa_ClearBufferData(GLenum target, GLenum internalformat, GLenum format,
       return;
    }
 
+   bufObj->MinMaxCacheDirty = GL_TRUE;
+
    if (data == NULL) {
       /* clear to zeros, per the spec */
       ctx->Driver.ClearBufferSubData(ctx, 0, bufObj->Size,
@@ -1506,6 +1519,8 @@ _mesa_ClearBufferSubData(GLenum target, GLenum internalformat,
       return;
    }
 
+   bufObj->MinMaxCacheDirty = GL_TRUE;
+
    if (data == NULL) {
       /* clear to zeros, per the spec */
       if (size > 0) {
@@ -1609,8 +1624,10 @@ _mesa_MapBuffer(GLenum target, GLenum access)
       bufObj->Mappings[MAP_USER].AccessFlags = accessFlags;
    }
 
-   if (access == GL_WRITE_ONLY_ARB || access == GL_READ_WRITE_ARB)
+   if (access == GL_WRITE_ONLY_ARB || access == GL_READ_WRITE_ARB) {
       bufObj->Written = GL_TRUE;
+      bufObj->MinMaxCacheDirty = GL_TRUE;
+   }
 
 #ifdef VBO_DEBUG
    printf("glMapBufferARB(%u, sz %ld, access 0x%x)\n",
@@ -1923,6 +1940,8 @@ _mesa_CopyBufferSubData(GLenum readTarget, GLenum writeTarget,
       }
    }
 
+   dst->MinMaxCacheDirty = GL_TRUE;
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
@@ -2089,6 +2108,9 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
       ASSERT(bufObj->Mappings[MAP_USER].AccessFlags == access);
    }
 
+   if (access & GL_MAP_WRITE_BIT)
+      bufObj->MinMaxCacheDirty = GL_TRUE;
+
    return map;
 }
 
@@ -2636,6 +2658,7 @@ set_atomic_buffer_binding(struct gl_context *ctx,
    }
 
    _mesa_reference_buffer_object(ctx, &ctx->AtomicBuffer, bufObj);
+   bufObj->GPUWritable = GL_TRUE;
 
    binding = &ctx->AtomicBufferBindings[index];
    if (binding->BufferObject == bufObj &&
@@ -25,6 +25,50 @@
 
 #include "main/compiler.h"
 #include "main/cpuinfo.h"
+#include "main/imports.h"
+
+#if defined(USE_SSE41) || defined(USE_AVX2)
+#include <cpuid.h>
+#endif
+
+
+int _mesa_use_sse2_formats = 0;
+int _mesa_cpu_has_sse4_1 = 0;
+int _mesa_cpu_has_avx2 = 0;
+
+
+#if defined(USE_SSE41) || defined(USE_AVX2)
+/**
+ * Detect the extensions that are only used by code built with extra
+ * compiler flags, and so have to be checked for at runtime.
+ */
+static void
+get_x86_simd_features(void)
+{
+   unsigned int eax, ebx, ecx, edx;
+
+   if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      return;
+
+#ifdef USE_SSE41
+   _mesa_cpu_has_sse4_1 = (ecx >> 19) & 1;
+#endif
+
+#ifdef USE_AVX2
+   /* AVX also needs the OS to save the YMM registers (OSXSAVE + XCR0) */
+   if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+      unsigned int xcr0_lo, xcr0_hi;
+
+      __asm__ (".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+               : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+      if ((xcr0_lo & 6) == 6 && __get_cpuid_max(0, NULL) >= 7) {
+         __cpuid_count(7, 0, eax, ebx, ecx, edx);
+         _mesa_cpu_has_avx2 = (ebx >> 5) & 1;
+      }
+   }
+#endif
+}
+#endif
 
 
 /**
@@ -37,6 +81,18 @@ _mesa_get_cpu_features(void)
 #ifdef USE_X86_ASM
    _mesa_get_x86_features();
 #endif
+
+#ifdef __SSE2__
+   /* SSE2 is always there when the compiler is allowed to use it, so the
+    * only reason to fall back to the C pack/unpack code is MESA_NO_ASM.
+    */
+   _mesa_use_sse2_formats = !_mesa_getenv("MESA_NO_ASM");
+#endif
+
+#if defined(USE_SSE41) || defined(USE_AVX2)
+   if (!_mesa_getenv("MESA_NO_ASM"))
+      get_x86_simd_features();
+#endif
 }
 
 
@@ -36,6 +36,22 @@ extern void
 _mesa_get_cpu_features(void);
 
 
+/**
+ * Non-zero if the SSE2 pack/unpack row functions in format_sse2.c should
+ * be used.  Set by _mesa_get_cpu_features().
+ */
+extern int _mesa_use_sse2_formats;
+
+
+/**
+ * Non-zero if the CPU and OS support SSE 4.1 / AVX2.  These are only
+ * detected when Mesa was built with code using them (USE_SSE41 and
+ * USE_AVX2), and are set by _mesa_get_cpu_features().
+ */
+extern int _mesa_cpu_has_sse4_1;
+extern int _mesa_cpu_has_avx2;
+
+
 extern char *
 _mesa_get_cpu_string(void);
 
@@ -82,6 +82,11 @@ struct gl_list_instruction
    void (*Execute)( struct gl_context *ctx, void *data );
    void (*Destroy)( struct gl_context *ctx, void *data );
    void (*Print)( struct gl_context *ctx, void *data );
+
+   /* Optional hooks for the list optimizer, see optimize_list() */
+   GLbitfield64 (*AttribsWritten)( const void *data );
+   GLuint (*Merge)( struct gl_context *ctx, void *dst,
+                    void **src, GLuint count );
 };
 
 
@@ -1053,6 +1058,34 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
 }
 
 
+/**
+ * Set the display list optimizer hooks for an opcode obtained from
+ * _mesa_dlist_alloc_opcode().
+ *
+ * \param attribs_written  returns the VERT_BIT_x mask of current vertex
+ *                         attributes the instruction may change.  If NULL,
+ *                         the optimizer assumes it may change any state.
+ * \param merge  combines as many as possible of \p count consecutive
+ *               instructions \p src into the new one at \p dst and
+ *               returns how many it took; the optimizer then destroys
+ *               those.  Returning less than two means nothing was done.
+ *               May be NULL.
+ */
+void
+_mesa_dlist_set_opcode_optimizer(struct gl_context *ctx, GLint opcode,
+                                 GLbitfield64 (*attribs_written)(const void *),
+                                 GLuint (*merge)(struct gl_context *, void *,
+                                                 void **, GLuint))
+{
+   const GLint i = opcode - OPCODE_EXT_0;
+
+   if (i >= 0 && i < (GLint) ctx->ListExt->NumOpcodes) {
+      ctx->ListExt->Opcode[i].AttribsWritten = attribs_written;
+      ctx->ListExt->Opcode[i].Merge = merge;
+   }
+}
+
+
 /**
  * Allocate space for a display list instruction.  The space is basically
  * an array of Nodes where node[0] holds the opcode, node[1] is the first
@@ -1100,6 +1133,400 @@ trim_list(struct gl_context *ctx)
 }
 
 
+/*
+ * Display list optimizer.
+ *
+ * optimize_list() rewrites a newly compiled list in place:
+ *
+ * - An instruction which sets a piece of state to the same value as an
+ *   earlier one is dropped, if nothing in between could have changed that
+ *   state.  Only a few simple state setters are tracked, anything else
+ *   ends the tracking.
+ * - Driver instructions (i.e. VBO vertex lists) which end up next to each
+ *   other are passed to the driver's Merge hook so that they can be drawn
+ *   at once.
+ *
+ * The result never needs more space than the original, so it's written
+ * over it, in the same blocks.
+ */
+
+/** Max number of state settings optimize_list() tracks at once */
+#define MAX_OPT_STATE 32
+
+/** Max size of a tracked instruction, in nodes */
+#define MAX_OPT_STATE_NODES 6
+
+/** Max number of instructions passed to a Merge hook at once */
+#define MAX_OPT_RUN 256
+
+
+struct list_optimizer
+{
+   struct gl_context *ctx;
+
+   Node **blocks;               /**< the list's blocks, in order */
+   GLuint numBlocks;
+   GLuint block, pos;           /**< where the next instruction goes */
+
+   /** Last instruction seen for each piece of state, see state_key() */
+   struct {
+      GLuint64 key;
+      Node inst[MAX_OPT_STATE_NODES];
+   } state[MAX_OPT_STATE];
+   GLuint numState;
+
+   /** Consecutive driver instructions not written yet */
+   void *run[MAX_OPT_RUN];
+   GLuint runLength;
+   OpCode runOpcode;
+};
+
+
+/** Size of the instruction at n, in nodes */
+static GLuint
+instruction_size(const struct gl_context *ctx, const Node *n)
+{
+   if (is_ext_opcode(n[0].opcode))
+      return ctx->ListExt->Opcode[n[0].opcode - OPCODE_EXT_0].Size;
+   return InstSize[n[0].opcode];
+}
+
+
+/**
+ * If the instruction at n just sets one piece of state, completely,
+ * return a key naming that state.  Two instructions with the same key and
+ * opcode and identical parameters have the same effect.
+ * \return 0 for any other instruction
+ */
+static GLuint64
+state_key(const Node *n)
+{
+   switch (n[0].opcode) {
+   case OPCODE_ALPHA_FUNC:
+   case OPCODE_BLEND_COLOR:
+   case OPCODE_BLEND_FUNC_SEPARATE:
+   case OPCODE_COLOR_MASK:
+   case OPCODE_CULL_FACE:
+   case OPCODE_DEPTH_FUNC:
+   case OPCODE_DEPTH_MASK:
+   case OPCODE_FRONT_FACE:
+   case OPCODE_LINE_STIPPLE:
+   case OPCODE_LINE_WIDTH:
+   case OPCODE_LOGIC_OP:
+   case OPCODE_MATRIX_MODE:
+   case OPCODE_POINT_SIZE:
+   case OPCODE_POLYGON_OFFSET:
+   case OPCODE_PROVOKING_VERTEX:
+   case OPCODE_SHADE_MODEL:
+      return (GLuint64) n[0].opcode << 32;
+   case OPCODE_BLEND_EQUATION:
+   case OPCODE_BLEND_EQUATION_SEPARATE:
+      return (GLuint64) OPCODE_BLEND_EQUATION << 32;
+   case OPCODE_ENABLE:
+   case OPCODE_DISABLE:
+      return ((GLuint64) OPCODE_ENABLE << 32) | n[1].e;
+   case OPCODE_BIND_TEXTURE:
+      return ((GLuint64) OPCODE_BIND_TEXTURE << 32) | n[1].e;
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      /* attribute 0 is a vertex */
+      if (n[1].e == VERT_ATTRIB_POS || n[1].e >= VERT_ATTRIB_FF_MAX)
+         return 0;
+      return ((GLuint64) OPCODE_ATTR_4F_NV << 32) | n[1].e;
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      if (n[1].e == 0 || n[1].e >= VERT_ATTRIB_GENERIC_MAX)
+         return 0;
+      return ((GLuint64) OPCODE_ATTR_4F_NV << 32) |
+             VERT_ATTRIB_GENERIC(n[1].e);
+   default:
+      return 0;
+   }
+}
+
+
+/**
+ * Does the instruction leave all the state tracked by optimize_list()
+ * alone?
+ */
+static GLboolean
+keeps_tracked_state(OpCode opcode)
+{
+   switch (opcode) {
+   case OPCODE_FRUSTUM:
+   case OPCODE_LIGHT:
+   case OPCODE_LOAD_IDENTITY:
+   case OPCODE_LOAD_MATRIX:
+   case OPCODE_MATERIAL:
+   case OPCODE_MULT_MATRIX:
+   case OPCODE_ORTHO:
+   case OPCODE_POP_MATRIX:
+   case OPCODE_PUSH_MATRIX:
+   case OPCODE_ROTATE:
+   case OPCODE_SCALE:
+   case OPCODE_TRANSLATE:
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * Is the instruction at n, with the given state key, a no-op because an
+ * identical one was already executed?
+ */
+static GLboolean
+opt_is_redundant(const struct list_optimizer *opt, GLuint64 key,
+                 const Node *n, GLuint size)
+{
+   GLuint i;
+
+   for (i = 0; i < opt->numState; i++) {
+      if (opt->state[i].key == key) {
+         return opt->state[i].inst[0].opcode == n[0].opcode &&
+                memcmp(&opt->state[i].inst[1], &n[1],
+                       (size - 1) * sizeof(Node)) == 0;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+
+/** Record the state set by the instruction at n */
+static void
+opt_set_state(struct list_optimizer *opt, GLuint64 key,
+              const Node *n, GLuint size)
+{
+   GLuint i;
+
+   for (i = 0; i < opt->numState; i++) {
+      if (opt->state[i].key == key)
+         break;
+   }
+
+   if (size > MAX_OPT_STATE_NODES) {
+      /* can't track it, forget the old value */
+      if (i < opt->numState)
+         opt->state[i] = opt->state[--opt->numState];
+      return;
+   }
+
+   if (i == opt->numState) {
+      if (opt->numState == MAX_OPT_STATE)
+         i = 0;   /* forget the oldest */
+      else
+         opt->numState++;
+   }
+
+   opt->state[i].key = key;
+   memcpy(opt->state[i].inst, n, size * sizeof(Node));
+}
+
+
+/** Forget the values of the given current vertex attributes */
+static void
+opt_forget_attribs(struct list_optimizer *opt, GLbitfield64 attribs)
+{
+   GLuint i = 0;
+
+   while (i < opt->numState) {
+      const GLuint64 key = opt->state[i].key;
+
+      if ((key >> 32) == OPCODE_ATTR_4F_NV &&
+          (attribs & VERT_BIT(key & 0xffffffff)))
+         opt->state[i] = opt->state[--opt->numState];
+      else
+         i++;
+   }
+}
+
+
+/**
+ * Get space for the next instruction of the optimized list.  This is
+ * never past the instruction being read.
+ */
+static Node *
+opt_emit(struct list_optimizer *opt, GLuint numNodes)
+{
+   const GLuint contNodes = 1 + POINTER_DWORDS;
+   Node *n;
+
+   if (opt->pos + numNodes + contNodes > BLOCK_SIZE) {
+      assert(opt->block + 1 < opt->numBlocks);
+      n = opt->blocks[opt->block] + opt->pos;
+      n[0].opcode = OPCODE_CONTINUE;
+      save_pointer(&n[1], opt->blocks[opt->block + 1]);
+      opt->block++;
+      opt->pos = 0;
+   }
+
+   n = opt->blocks[opt->block] + opt->pos;
+   opt->pos += numNodes;
+   return n;
+}
+
+
+/**
+ * Write out the pending run of driver instructions, merging them where
+ * the driver can.
+ */
+static void
+opt_flush_run(struct list_optimizer *opt)
+{
+   struct gl_context *ctx = opt->ctx;
+   const struct gl_list_instruction *inst;
+   GLuint payload, i = 0, j;
+   Node *merged = NULL;
+
+   if (opt->runLength == 0)
+      return;
+
+   inst = &ctx->ListExt->Opcode[opt->runOpcode - OPCODE_EXT_0];
+   payload = (inst->Size - 1) * sizeof(Node);
+
+   /* The merged instruction may go where the first one being merged was,
+    * so it's built in a temporary.
+    */
+   if (inst->Merge && opt->runLength > 1)
+      merged = malloc(payload);
+
+   while (i < opt->runLength) {
+      GLuint count = 0;
+      Node *n;
+
+      if (merged && opt->runLength - i > 1)
+         count = inst->Merge(ctx, merged, opt->run + i, opt->runLength - i);
+
+      if (count >= 2) {
+         for (j = i; j < i + count; j++)
+            inst->Destroy(ctx, opt->run[j]);
+         n = opt_emit(opt, inst->Size);
+         memcpy(&n[1], merged, payload);
+      }
+      else {
+         count = 1;
+         n = opt_emit(opt, inst->Size);
+         memmove(&n[1], opt->run[i], payload);
+      }
+
+      n[0].opcode = opt->runOpcode;
+      i += count;
+   }
+
+   free(merged);
+   opt->runLength = 0;
+}
+
+
+/**
+ * Called by EndList to remove redundant state changes from the list and
+ * to let the driver merge its draws.
+ */
+static void
+optimize_list(struct gl_context *ctx)
+{
+   struct gl_dlist_state *list = &ctx->ListState;
+   const Node *end = list->CurrentBlock + list->CurrentPos;
+   struct list_optimizer *opt;
+   GLuint block;
+   Node *n;
+
+   opt = calloc(1, sizeof(*opt));
+   if (!opt)
+      return;
+   opt->ctx = ctx;
+
+   /* Find the list's blocks */
+   n = list->CurrentList->Head;
+   for (;;) {
+      if ((opt->numBlocks & (opt->numBlocks - 1)) == 0) {
+         Node **blocks = realloc(opt->blocks, MAX2(opt->numBlocks * 2, 1) *
+                                 sizeof(Node *));
+         if (!blocks) {
+            free(opt->blocks);
+            free(opt);
+            return;
+         }
+         opt->blocks = blocks;
+      }
+      opt->blocks[opt->numBlocks++] = n;
+
+      while (n != end && n[0].opcode != OPCODE_CONTINUE)
+         n += instruction_size(ctx, n);
+      if (n == end)
+         break;
+      n = (Node *) get_pointer(&n[1]);
+   }
+
+   /* Rewrite it */
+   block = 0;
+   n = opt->blocks[0];
+   while (n != end) {
+      const OpCode opcode = n[0].opcode;
+      const GLuint size = instruction_size(ctx, n);
+
+      if (opcode == OPCODE_CONTINUE) {
+         n = opt->blocks[++block];
+         continue;
+      }
+
+      if (is_ext_opcode(opcode) &&
+          ctx->ListExt->Opcode[opcode - OPCODE_EXT_0].AttribsWritten) {
+         const struct gl_list_instruction *inst =
+            &ctx->ListExt->Opcode[opcode - OPCODE_EXT_0];
+
+         opt_forget_attribs(opt, inst->AttribsWritten(&n[1]));
+
+         if (opt->runLength &&
+             (opt->runOpcode != opcode || opt->runLength == MAX_OPT_RUN))
+            opt_flush_run(opt);
+
+         opt->runOpcode = opcode;
+         opt->run[opt->runLength++] = &n[1];
+      }
+      else {
+         const GLuint64 key = is_ext_opcode(opcode) ? 0 : state_key(n);
+
+         if (key && opt_is_redundant(opt, key, n, size)) {
+            /* drop it */
+            n += size;
+            continue;
+         }
+
+         opt_flush_run(opt);
+
+         if (key)
+            opt_set_state(opt, key, n, size);
+         else if (is_ext_opcode(opcode) || !keeps_tracked_state(opcode))
+            opt->numState = 0;
+
+         memmove(opt_emit(opt, size), n, size * sizeof(Node));
+      }
+
+      n += size;
+   }
+
+   opt_flush_run(opt);
+
+   /* Continue the list after the last instruction written, and free any
+    * blocks no longer used.
+    */
+   list->CurrentBlock = opt->blocks[opt->block];
+   list->CurrentPos = opt->pos;
+   for (block = opt->block + 1; block < opt->numBlocks; block++)
+      free(opt->blocks[block]);
+
+   free(opt->blocks);
+   free(opt);
+}
+
+
 
 /*
  * Display List compilation functions
@@ -8273,6 +8700,8 @@ _mesa_EndList(void)
     */
    ctx->Driver.EndList(ctx);
 
+   optimize_list(ctx);
+
    (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
 
    trim_list(ctx);
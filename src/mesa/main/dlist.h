@@ -65,6 +65,12 @@ extern GLint _mesa_dlist_alloc_opcode( struct gl_context *ctx, GLuint sz,
                                        void (*destroy)( struct gl_context *, void * ),
                                        void (*print)( struct gl_context *, void * ) );
 
+extern void
+_mesa_dlist_set_opcode_optimizer(struct gl_context *ctx, GLint opcode,
+                                 GLbitfield64 (*attribs_written)(const void *),
+                                 GLuint (*merge)(struct gl_context *, void *,
+                                                 void **, GLuint));
+
 extern void _mesa_delete_list(struct gl_context *ctx, struct gl_display_list *dlist);
 
 extern void _mesa_initialize_save_table(const struct gl_context *);
@@ -114,9 +114,9 @@ _mesa_DrawPixels( GLsizei width, GLsizei height,
       }
       break;
    case GL_COLOR_INDEX:
-      if (ctx->PixelMaps.ItoR.Size == 0 ||
-          ctx->PixelMaps.ItoG.Size == 0 ||
-          ctx->PixelMaps.ItoB.Size == 0) {
+      if (ctx->PixelMaps->ItoR.Size == 0 ||
+          ctx->PixelMaps->ItoG.Size == 0 ||
+          ctx->PixelMaps->ItoB.Size == 0) {
          _mesa_error(ctx, GL_INVALID_OPERATION,
                 "glDrawPixels(drawing color index pixels into RGB buffer)");
          goto end;
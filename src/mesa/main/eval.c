@@ -909,8 +909,10 @@ void _mesa_init_eval( struct gl_context *ctx )
    ctx->Eval.MapGrid2v1 = 0.0;
    ctx->Eval.MapGrid2v2 = 1.0;
 
-   /* Evaluator data */
-   {
+   /* Evaluator data.  Evaluators only exist in compatibility profiles so
+    * the control point arrays are left NULL otherwise.
+    */
+   if (ctx->API == API_OPENGL_COMPAT) {
       static GLfloat vertex[4] = { 0.0, 0.0, 0.0, 1.0 };
       static GLfloat normal[3] = { 0.0, 0.0, 1.0 };
       static GLfloat index[1] = { 1.0 };
@@ -37,7 +37,9 @@
 
 
 #include "colormac.h"
+#include "cpuinfo.h"
 #include "format_pack.h"
+#include "format_sse2.h"
 #include "macros.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
@@ -2323,7 +2325,15 @@ void
 _mesa_pack_float_rgba_row(mesa_format format, GLuint n,
                           const GLfloat src[][4], void *dst)
 {
-   pack_float_rgba_row_func packrow = get_pack_float_rgba_row_function(format);
+   pack_float_rgba_row_func packrow;
+
+#ifdef __SSE2__
+   if (_mesa_use_sse2_formats &&
+       _mesa_pack_float_rgba_row_sse2(format, n, src, dst))
+      return;
+#endif
+
+   packrow = get_pack_float_rgba_row_function(format);
    if (packrow) {
       /* use "fast" function */
       packrow(n, src, dst);
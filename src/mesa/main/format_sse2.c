@@ -0,0 +1,423 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file format_sse2.c
+ * SSE2 pack/unpack row functions.
+ *
+ * Each format is handled by a kernel which converts four pixels at a time.
+ * Partial groups at the end of a row are staged through a small temporary
+ * so the kernels never read or write past the caller's buffers.
+ *
+ * Everything here must produce exactly the same values as the C code in
+ * format_pack.c and format_unpack.c; the main-test unit test checks that.
+ * That rules out reciprocal approximations and rounding shortcuts; the
+ * Z24 scale, for instance, is done in double precision like the C code.
+ * 8888 and sRGB unpacking isn't handled since the C code is already a
+ * table lookup per component, which SSE2 can't beat.
+ */
+
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+#include "colormac.h"
+#include "format_sse2.h"
+#include "macros.h"
+
+
+/** Shift value for a component which isn't stored (X channels) */
+#define NO_COMP 0xff
+
+
+/**
+ * Extract a 'mask'-wide field at bit 'shift' from each 32-bit lane.
+ */
+static inline __m128i
+get_field(__m128i v, GLuint shift, GLuint mask)
+{
+   return _mm_and_si128(_mm_srl_epi32(v, _mm_cvtsi32_si128(shift)),
+                        _mm_set1_epi32(mask));
+}
+
+
+/**
+ * Per-lane select: (mask & a) | (~mask & b).
+ */
+static inline __m128i
+select_si128(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+
+/**
+ * Transpose four planar R/G/B/A vectors and store them as four pixels.
+ */
+static inline void
+store_rgba_4(GLfloat dst[][4], __m128 r, __m128 g, __m128 b, __m128 a)
+{
+   _MM_TRANSPOSE4_PS(r, g, b, a);
+   _mm_storeu_ps(dst[0], r);
+   _mm_storeu_ps(dst[1], g);
+   _mm_storeu_ps(dst[2], b);
+   _mm_storeu_ps(dst[3], a);
+}
+
+
+/**
+ * Same as _mesa_half_to_float(), for the half floats in the low 16 bits
+ * of each lane.
+ */
+static inline __m128
+half_to_float_4(__m128i h)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i sign =
+      _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+   const __m128i e = _mm_and_si128(h, _mm_set1_epi32(0x7c00));
+   const __m128i m = _mm_and_si128(h, _mm_set1_epi32(0x3ff));
+   const __m128i regular =
+      _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)),
+                                   13),
+                    _mm_set1_epi32(112 << 23));
+   /* zero and denorms: m * 2^-24 is exact */
+   const __m128i denorm =
+      _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(m),
+                                  _mm_set1_ps(1.0f / 16777216.0f)));
+   /* infinity, or the NaN with a mantissa of 1 */
+   const __m128i infnan =
+      _mm_or_si128(_mm_set1_epi32(0x7f800000),
+                   _mm_andnot_si128(_mm_cmpeq_epi32(m, zero),
+                                    _mm_set1_epi32(1)));
+   __m128i f;
+
+   f = select_si128(_mm_cmpeq_epi32(e, _mm_set1_epi32(0x7c00)),
+                    infnan, regular);
+   f = select_si128(_mm_cmpeq_epi32(e, zero), denorm, f);
+   return _mm_castsi128_ps(_mm_or_si128(f, sign));
+}
+
+
+/**
+ * Same as uf11_to_f32() / uf10_to_f32(), for the packed float in the low
+ * 5 + mbits bits of each lane.
+ */
+static inline __m128
+small_float_to_float_4(__m128i v, GLuint mbits)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i emask = _mm_set1_epi32(0x1f << mbits);
+   const __m128i e = _mm_and_si128(v, emask);
+   const __m128i m = _mm_and_si128(v, _mm_set1_epi32((1 << mbits) - 1));
+   const __m128i regular =
+      _mm_add_epi32(_mm_sll_epi32(v, _mm_cvtsi32_si128(23 - mbits)),
+                    _mm_set1_epi32(112 << 23));
+   /* both helpers scale denorms by 2^-20, whatever the mantissa width */
+   const __m128i denorm =
+      _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(m),
+                                  _mm_set1_ps(1.0f / (1 << 20))));
+   const __m128i infnan = _mm_or_si128(_mm_set1_epi32(0x7f800000), m);
+   __m128i f;
+
+   f = select_si128(_mm_cmpeq_epi32(e, emask), infnan, regular);
+   f = select_si128(_mm_cmpeq_epi32(e, zero), denorm, f);
+   return _mm_castsi128_ps(f);
+}
+
+
+/**
+ * Same as UNCLAMPED_FLOAT_TO_UBYTE(), with the result in the low 8 bits
+ * of each lane.
+ */
+static inline __m128i
+float_to_ubyte_4(__m128 f)
+{
+#if defined(USE_IEEE) && !defined(DEBUG)
+   const __m128i i = _mm_castps_si128(f);
+   const __m128i ff = _mm_set1_epi32(0xff);
+   const __m128i negative = _mm_cmplt_epi32(i, _mm_setzero_si128());
+   const __m128i ge_one = _mm_cmpgt_epi32(i, _mm_set1_epi32(IEEE_ONE - 1));
+   const __m128 biased = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0F / 256.0F)),
+                                    _mm_set1_ps(32768.0F));
+   __m128i ub;
+
+   ub = _mm_and_si128(_mm_castps_si128(biased), ff);
+   ub = select_si128(ge_one, ff, ub);
+   return _mm_andnot_si128(negative, ub);
+#else
+   /* max_ps() returns the second operand for NaN, so NaN becomes 0 */
+   const __m128 c = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()),
+                               _mm_set1_ps(1.0F));
+   return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0F)),
+                                      _mm_set1_ps(0.5F)));
+#endif
+}
+
+
+/**********************************************************************/
+/*  Unpack to GLfloat RGBA                                            */
+/**********************************************************************/
+
+/** Unpack four pixels */
+typedef void (*unpack_rgba_4_func)(const void *src, GLfloat dst[][4]);
+
+
+static void
+unpack_rgba_4_B5G6R5_UNORM(const void *src, GLfloat dst[][4])
+{
+   const __m128i p = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) src),
+                                        _mm_setzero_si128());
+   const __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(get_field(p, 11, 0x1f)),
+                               _mm_set1_ps(1.0F / 31.0F));
+   const __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(get_field(p, 5, 0x3f)),
+                               _mm_set1_ps(1.0F / 63.0F));
+   const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(get_field(p, 0, 0x1f)),
+                               _mm_set1_ps(1.0F / 31.0F));
+
+   store_rgba_4(dst, r, g, b, _mm_set1_ps(1.0F));
+}
+
+
+static void
+unpack_rgba_4_RGBA_FLOAT16(const void *src, GLfloat dst[][4])
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i p01 = _mm_loadu_si128((const __m128i *) src);
+   const __m128i p23 = _mm_loadu_si128((const __m128i *) src + 1);
+
+   _mm_storeu_ps(dst[0], half_to_float_4(_mm_unpacklo_epi16(p01, zero)));
+   _mm_storeu_ps(dst[1], half_to_float_4(_mm_unpackhi_epi16(p01, zero)));
+   _mm_storeu_ps(dst[2], half_to_float_4(_mm_unpacklo_epi16(p23, zero)));
+   _mm_storeu_ps(dst[3], half_to_float_4(_mm_unpackhi_epi16(p23, zero)));
+}
+
+
+static void
+unpack_rgba_4_R11G11B10_FLOAT(const void *src, GLfloat dst[][4])
+{
+   const __m128i p = _mm_loadu_si128((const __m128i *) src);
+   const __m128 r = small_float_to_float_4(get_field(p, 0, 0x7ff), 6);
+   const __m128 g = small_float_to_float_4(get_field(p, 11, 0x7ff), 6);
+   const __m128 b = small_float_to_float_4(get_field(p, 22, 0x3ff), 5);
+
+   store_rgba_4(dst, r, g, b, _mm_set1_ps(1.0F));
+}
+
+
+static void
+unpack_rgba_rows(unpack_rgba_4_func unpack4, GLuint bpp,
+                 GLuint n, const void *src, GLfloat dst[][4])
+{
+   const GLubyte *s = (const GLubyte *) src;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4)
+      unpack4(s + i * bpp, dst + i);
+
+   if (i < n) {
+      GLubyte tmpSrc[4 * 8];
+      GLfloat tmpDst[4][4];
+
+      assert(bpp <= 8);
+      memset(tmpSrc, 0, sizeof(tmpSrc));
+      memcpy(tmpSrc, s + i * bpp, (n - i) * bpp);
+      unpack4(tmpSrc, tmpDst);
+      memcpy(dst + i, tmpDst, (n - i) * sizeof(tmpDst[0]));
+   }
+}
+
+
+GLboolean
+_mesa_unpack_rgba_row_sse2(mesa_format format, GLuint n,
+                           const void *src, GLfloat dst[][4])
+{
+   switch (format) {
+   case MESA_FORMAT_B5G6R5_UNORM:
+      unpack_rgba_rows(unpack_rgba_4_B5G6R5_UNORM, 2, n, src, dst);
+      return GL_TRUE;
+   case MESA_FORMAT_RGBA_FLOAT16:
+      unpack_rgba_rows(unpack_rgba_4_RGBA_FLOAT16, 8, n, src, dst);
+      return GL_TRUE;
+   case MESA_FORMAT_R11G11B10_FLOAT:
+      unpack_rgba_rows(unpack_rgba_4_R11G11B10_FLOAT, 4, n, src, dst);
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**********************************************************************/
+/*  Unpack to GLfloat Z                                               */
+/**********************************************************************/
+
+/**
+ * Unpack four Z24 values, at bit 'shift' of each 32-bit word.  The scale
+ * is done in double precision like unpack_float_z_Z24_UNORM_X8_UINT().
+ */
+static inline void
+unpack_float_z_4_z24(const void *src, GLfloat *dst, GLuint shift)
+{
+   const __m128d scale = _mm_set1_pd(1.0 / (GLdouble) 0xffffff);
+   const __m128i z = get_field(_mm_loadu_si128((const __m128i *) src),
+                               shift, 0xffffff);
+   const __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(z), scale);
+   const __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(z, z)),
+                                 scale);
+
+   _mm_storeu_ps(dst, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+}
+
+
+GLboolean
+_mesa_unpack_float_z_row_sse2(mesa_format format, GLuint n,
+                              const void *src, GLfloat *dst)
+{
+   const GLuint *s = (const GLuint *) src;
+   GLuint shift, i;
+
+   switch (format) {
+   case MESA_FORMAT_S8_UINT_Z24_UNORM:
+   case MESA_FORMAT_X8_UINT_Z24_UNORM:
+      shift = 8;
+      break;
+   case MESA_FORMAT_Z24_UNORM_S8_UINT:
+   case MESA_FORMAT_Z24_UNORM_X8_UINT:
+      shift = 0;
+      break;
+   default:
+      return GL_FALSE;
+   }
+
+   for (i = 0; i + 4 <= n; i += 4)
+      unpack_float_z_4_z24(s + i, dst + i, shift);
+
+   if (i < n) {
+      GLuint tmpSrc[4] = { 0 };
+      GLfloat tmpDst[4];
+
+      memcpy(tmpSrc, s + i, (n - i) * sizeof(GLuint));
+      unpack_float_z_4_z24(tmpSrc, tmpDst, shift);
+      memcpy(dst + i, tmpDst, (n - i) * sizeof(GLfloat));
+   }
+
+   return GL_TRUE;
+}
+
+
+/**********************************************************************/
+/*  Pack from GLfloat RGBA                                            */
+/**********************************************************************/
+
+/**
+ * Pack four pixels into 8888 words, with the R, G, B and A bytes at the
+ * bit positions given by 'shift'.  Unused (X) bytes are zero, as in the
+ * pack_ubyte_*X8* functions.
+ */
+static void
+pack_float_rgba_4_8888(const GLfloat src[][4], void *dst,
+                       const GLubyte shift[4])
+{
+   __m128 r = _mm_loadu_ps(src[0]);
+   __m128 g = _mm_loadu_ps(src[1]);
+   __m128 b = _mm_loadu_ps(src[2]);
+   __m128 a = _mm_loadu_ps(src[3]);
+   __m128i p;
+
+   _MM_TRANSPOSE4_PS(r, g, b, a);
+
+   p = _mm_sll_epi32(float_to_ubyte_4(r), _mm_cvtsi32_si128(shift[0]));
+   p = _mm_or_si128(p, _mm_sll_epi32(float_to_ubyte_4(g),
+                                     _mm_cvtsi32_si128(shift[1])));
+   p = _mm_or_si128(p, _mm_sll_epi32(float_to_ubyte_4(b),
+                                     _mm_cvtsi32_si128(shift[2])));
+   if (shift[3] != NO_COMP)
+      p = _mm_or_si128(p, _mm_sll_epi32(float_to_ubyte_4(a),
+                                        _mm_cvtsi32_si128(shift[3])));
+
+   _mm_storeu_si128((__m128i *) dst, p);
+}
+
+
+GLboolean
+_mesa_pack_float_rgba_row_sse2(mesa_format format, GLuint n,
+                               const GLfloat src[][4], void *dst)
+{
+   /* R, G, B, A bit positions, see the PACK_COLOR_8888() calls in
+    * format_pack.c.
+    */
+   static const GLubyte shift_A8B8G8R8[4] = { 24, 16, 8, 0 };
+   static const GLubyte shift_R8G8B8A8[4] = { 0, 8, 16, 24 };
+   static const GLubyte shift_B8G8R8A8[4] = { 16, 8, 0, 24 };
+   static const GLubyte shift_A8R8G8B8[4] = { 8, 16, 24, 0 };
+   static const GLubyte shift_B8G8R8X8[4] = { 16, 8, 0, NO_COMP };
+   static const GLubyte shift_X8R8G8B8[4] = { 8, 16, 24, NO_COMP };
+   GLuint *d = (GLuint *) dst;
+   const GLubyte *shift;
+   GLuint i;
+
+   switch (format) {
+   case MESA_FORMAT_A8B8G8R8_UNORM:
+   case MESA_FORMAT_X8B8G8R8_UNORM: /* packs alpha too, like the C code */
+      shift = shift_A8B8G8R8;
+      break;
+   case MESA_FORMAT_R8G8B8A8_UNORM:
+   case MESA_FORMAT_R8G8B8X8_UNORM: /* packs alpha too, like the C code */
+      shift = shift_R8G8B8A8;
+      break;
+   case MESA_FORMAT_B8G8R8A8_UNORM:
+      shift = shift_B8G8R8A8;
+      break;
+   case MESA_FORMAT_A8R8G8B8_UNORM:
+      shift = shift_A8R8G8B8;
+      break;
+   case MESA_FORMAT_B8G8R8X8_UNORM:
+      shift = shift_B8G8R8X8;
+      break;
+   case MESA_FORMAT_X8R8G8B8_UNORM:
+      shift = shift_X8R8G8B8;
+      break;
+   default:
+      return GL_FALSE;
+   }
+
+   for (i = 0; i + 4 <= n; i += 4)
+      pack_float_rgba_4_8888(src + i, d + i, shift);
+
+   if (i < n) {
+      GLfloat tmpSrc[4][4];
+      GLuint tmpDst[4];
+
+      memset(tmpSrc, 0, sizeof(tmpSrc));
+      memcpy(tmpSrc, src + i, (n - i) * sizeof(tmpSrc[0]));
+      pack_float_rgba_4_8888((const GLfloat (*)[4]) tmpSrc, tmpDst, shift);
+      memcpy(d + i, tmpDst, (n - i) * sizeof(GLuint));
+   }
+
+   return GL_TRUE;
+}
+
+#endif /* __SSE2__ */
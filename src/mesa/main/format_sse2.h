@@ -0,0 +1,58 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef FORMAT_SSE2_H
+#define FORMAT_SSE2_H
+
+
+#include "formats.h"
+
+
+#ifdef __SSE2__
+
+/*
+ * SSE2 versions of the pack/unpack row functions for the most common
+ * formats.  Each returns GL_FALSE, without touching dst, if there's no
+ * SSE2 path for the format; the caller then uses the C version.  The
+ * results are bit-identical to the C functions in format_pack.c and
+ * format_unpack.c.
+ */
+
+extern GLboolean
+_mesa_unpack_rgba_row_sse2(mesa_format format, GLuint n,
+                           const void *src, GLfloat dst[][4]);
+
+extern GLboolean
+_mesa_unpack_float_z_row_sse2(mesa_format format, GLuint n,
+                              const void *src, GLfloat *dst);
+
+extern GLboolean
+_mesa_pack_float_rgba_row_sse2(mesa_format format, GLuint n,
+                               const GLfloat src[][4], void *dst);
+
+#endif /* __SSE2__ */
+
+
+#endif /* FORMAT_SSE2_H */
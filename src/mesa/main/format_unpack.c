@@ -24,6 +24,8 @@
 
 
 #include "colormac.h"
+#include "cpuinfo.h"
+#include "format_sse2.h"
 #include "format_unpack.h"
 #include "macros.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
@@ -2578,7 +2580,15 @@ void
 _mesa_unpack_rgba_row(mesa_format format, GLuint n,
                       const void *src, GLfloat dst[][4])
 {
-   unpack_rgba_func unpack = get_unpack_rgba_function(format);
+   unpack_rgba_func unpack;
+
+#ifdef __SSE2__
+   if (_mesa_use_sse2_formats &&
+       _mesa_unpack_rgba_row_sse2(format, n, src, dst))
+      return;
+#endif
+
+   unpack = get_unpack_rgba_function(format);
    unpack(src, dst, n);
 }
 
@@ -4010,6 +4020,12 @@ _mesa_unpack_float_z_row(mesa_format format, GLuint n,
 {
    unpack_float_z_func unpack;
 
+#ifdef __SSE2__
+   if (_mesa_use_sse2_formats &&
+       _mesa_unpack_float_z_row_sse2(format, n, src, dst))
+      return;
+#endif
+
    switch (format) {
    case MESA_FORMAT_S8_UINT_Z24_UNORM:
    case MESA_FORMAT_X8_UINT_Z24_UNORM:
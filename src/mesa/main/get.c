@@ -634,6 +634,38 @@ find_custom_value(struct gl_context *ctx, const struct value_desc *d, union valu
       v->value_float_4[3] = ctx->Eval.MapGrid2v2;
       break;
 
+   /* ctx->PixelMaps points at shared defaults until glPixelMap is called */
+   case GL_PIXEL_MAP_R_TO_R_SIZE:
+      v->value_int = ctx->PixelMaps->RtoR.Size;
+      break;
+   case GL_PIXEL_MAP_G_TO_G_SIZE:
+      v->value_int = ctx->PixelMaps->GtoG.Size;
+      break;
+   case GL_PIXEL_MAP_B_TO_B_SIZE:
+      v->value_int = ctx->PixelMaps->BtoB.Size;
+      break;
+   case GL_PIXEL_MAP_A_TO_A_SIZE:
+      v->value_int = ctx->PixelMaps->AtoA.Size;
+      break;
+   case GL_PIXEL_MAP_I_TO_R_SIZE:
+      v->value_int = ctx->PixelMaps->ItoR.Size;
+      break;
+   case GL_PIXEL_MAP_I_TO_G_SIZE:
+      v->value_int = ctx->PixelMaps->ItoG.Size;
+      break;
+   case GL_PIXEL_MAP_I_TO_B_SIZE:
+      v->value_int = ctx->PixelMaps->ItoB.Size;
+      break;
+   case GL_PIXEL_MAP_I_TO_A_SIZE:
+      v->value_int = ctx->PixelMaps->ItoA.Size;
+      break;
+   case GL_PIXEL_MAP_I_TO_I_SIZE:
+      v->value_int = ctx->PixelMaps->ItoI.Size;
+      break;
+   case GL_PIXEL_MAP_S_TO_S_SIZE:
+      v->value_int = ctx->PixelMaps->StoS.Size;
+      break;
+
    case GL_TEXTURE_STACK_DEPTH:
       unit = ctx->Texture.CurrentUnit;
       v->value_int = ctx->TextureMatrixStack[unit].Depth + 1;
@@ -4,6 +4,9 @@
  *
  * Used for display lists, texture objects, vertex/fragment programs,
  * buffer objects, etc.  The hash functions are thread-safe.
+ *
+ * Lookups of small keys, which is what glGen*() hands out, don't take the
+ * mutex; see the "dense array" comments below.
  * 
  * \note key=0 is illegal.
  *
@@ -52,6 +55,42 @@
  */
 #define DELETED_KEY_VALUE 1
 
+/** @{
+ * Dense array of the data for keys below DENSE_CHUNKS * DENSE_CHUNK_SIZE.
+ *
+ * This shadows the hash table for small keys so that _mesa_HashLookup()
+ * can read it without taking the mutex, which is contended when many
+ * contexts share objects.  Writers still hold the mutex.  A reader
+ * sees either the old or the new pointer for a key, never a torn or
+ * half-initialized one:
+ *
+ *  - chunks are allocated zeroed, published once and only freed by
+ *    _mesa_DeleteHashTable(), so a reader never follows a stale chunk;
+ *  - chunk and data pointers are stored with release semantics, after
+ *    the stores which initialized the chunk or object, and loaded with
+ *    acquire semantics.
+ *
+ * Where we don't know how to do that, lookups lock as before.
+ */
+#define DENSE_CHUNK_SHIFT 10
+#define DENSE_CHUNK_SIZE (1 << DENSE_CHUNK_SHIFT)
+#define DENSE_CHUNKS 64
+
+#if defined(__ATOMIC_ACQUIRE)
+/* gcc >= 4.7 and clang */
+#define dense_load(p) __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define dense_publish(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define HAVE_DENSE_LOOKUP 1
+#elif defined(__GNUC__)
+#define dense_load(p) (*(volatile __typeof__(p) *) &(p))
+#define dense_publish(p, v) \
+   do { __sync_synchronize(); dense_load(p) = (v); } while (0)
+#define HAVE_DENSE_LOOKUP 1
+#else
+#define HAVE_DENSE_LOOKUP 0
+#endif
+/** @} */
+
 /**
  * The hash table data structure.  
  */
@@ -63,6 +102,8 @@ struct _mesa_HashTable {
    GLboolean InDeleteAll;                /**< Debug check */
    /** Value that would be in the table for DELETED_KEY_VALUE. */
    void *deleted_key_data;
+   /** Lock-free copy of the data for small keys, see DENSE_CHUNK_SIZE */
+   void **Dense[DENSE_CHUNKS];
 };
 
 /** @{
@@ -103,6 +144,7 @@ uint_key(GLuint id)
 }
 /** @} */
 
+
 /**
  * Create a new hash table.
  * 
@@ -135,6 +177,8 @@ _mesa_NewHashTable(void)
 void
 _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
+   GLuint i;
+
    assert(table);
 
    if (_mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
@@ -143,6 +187,9 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   for (i = 0; i < DENSE_CHUNKS; i++)
+      free(table->Dense[i]);
+
    mtx_destroy(&table->Mutex);
    mtx_destroy(&table->WalkMutex);
    free(table);
@@ -173,6 +220,53 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 }
 
 
+/**
+ * Update the dense array copy of the data for key, if it has one.
+ * Called with the mutex held.
+ */
+static void
+dense_store(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+#if HAVE_DENSE_LOOKUP
+   const GLuint chunk = key >> DENSE_CHUNK_SHIFT;
+   const GLuint first = chunk << DENSE_CHUNK_SHIFT;
+   void **entries;
+   GLuint i;
+
+   if (chunk >= DENSE_CHUNKS)
+      return;
+
+   entries = table->Dense[chunk];
+   if (!entries) {
+      if (!data)
+         return;
+
+      entries = calloc(DENSE_CHUNK_SIZE, sizeof(void *));
+      if (!entries) {
+         /* Keys in chunks without an array are looked up in the hash
+          * table instead.
+          */
+         return;
+      }
+
+      /* Copy the chunk's keys which were stored while the allocation
+       * failed.
+       */
+      for (i = chunk ? 0 : 1; i < DENSE_CHUNK_SIZE; i++)
+         entries[i] = _mesa_HashLookup_unlocked(table, first + i);
+
+      dense_publish(table->Dense[chunk], entries);
+   }
+
+   dense_publish(entries[key & (DENSE_CHUNK_SIZE - 1)], data);
+#else
+   (void) table;
+   (void) key;
+   (void) data;
+#endif
+}
+
+
 /**
  * Lookup an entry in the hash table.
  * 
@@ -186,6 +280,15 @@ _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
    void *res;
    assert(table);
+
+#if HAVE_DENSE_LOOKUP
+   if ((key >> DENSE_CHUNK_SHIFT) < DENSE_CHUNKS) {
+      void **entries = dense_load(table->Dense[key >> DENSE_CHUNK_SHIFT]);
+      if (entries)
+         return dense_load(entries[key & (DENSE_CHUNK_SIZE - 1)]);
+   }
+#endif
+
    mtx_lock(&table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    mtx_unlock(&table->Mutex);
@@ -225,6 +328,7 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
          _mesa_hash_table_insert(table->ht, hash, uint_key(key), data);
       }
    }
+   dense_store(table, key, data);
 
    mtx_unlock(&table->Mutex);
 }
@@ -262,6 +366,7 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
       entry = _mesa_hash_table_search(table->ht, uint_hash(key), uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
    }
+   dense_store(table, key, NULL);
    mtx_unlock(&table->Mutex);
 }
 
@@ -289,10 +394,12 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
    table->InDeleteAll = GL_TRUE;
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
+      dense_store(table, (uintptr_t)entry->key, NULL);
       _mesa_hash_table_remove(table->ht, entry);
    }
    if (table->deleted_key_data) {
       callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
+      dense_store(table, DELETED_KEY_VALUE, NULL);
       table->deleted_key_data = NULL;
    }
    table->InDeleteAll = GL_FALSE;
@@ -321,6 +428,8 @@ _mesa_HashClone(const struct _mesa_HashTable *table)
    hash_table_foreach(table->ht, entry) {
       _mesa_HashInsert(clonetable, (GLint)(uintptr_t)entry->key, entry->data);
    }
+   if (table->deleted_key_data)
+      _mesa_HashInsert(clonetable, DELETED_KEY_VALUE, table->deleted_key_data);
 
    mtx_unlock(&table2->Mutex);
 
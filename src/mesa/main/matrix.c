@@ -212,6 +212,33 @@ _mesa_MatrixMode( GLenum mode )
 }
 
 
+/**
+ * Make room in the matrix stack for at least one more matrix.
+ *
+ * \return GL_FALSE if out of memory.
+ */
+static GLboolean
+grow_matrix_stack(struct gl_matrix_stack *stack)
+{
+   GLuint newSize = MIN2(stack->StackSize * 2, stack->MaxDepth);
+   GLmatrix *newStack;
+   GLuint i;
+
+   newStack = realloc(stack->Stack, newSize * sizeof(GLmatrix));
+   if (!newStack)
+      return GL_FALSE;
+
+   for (i = stack->StackSize; i < newSize; i++) {
+      _math_matrix_ctr(&newStack[i]);
+   }
+
+   stack->Stack = newStack;
+   stack->StackSize = newSize;
+   stack->Top = &stack->Stack[stack->Depth];
+   return GL_TRUE;
+}
+
+
 /**
  * Push the current matrix stack.
  *
@@ -243,6 +270,11 @@ _mesa_PushMatrix( void )
       }
       return;
    }
+   if (stack->Depth + 1 >= stack->StackSize &&
+       !grow_matrix_stack(stack)) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glPushMatrix()");
+      return;
+   }
    _math_matrix_copy( &stack->Stack[stack->Depth + 1],
                       &stack->Stack[stack->Depth] );
    stack->Depth++;
@@ -633,23 +665,21 @@ void _mesa_update_modelview_project( struct gl_context *ctx, GLuint new_state )
  * \param maxDepth maximum stack depth.
  * \param dirtyFlag dirty flag.
  * 
- * Allocates an array of \p maxDepth elements for the matrix stack and calls
- * _math_matrix_ctr() for each element to initialize it.
+ * Only allocates the bottom matrix of the stack.  The others are
+ * allocated by glPushMatrix() when needed, since most stacks, and all of
+ * them in core and ES 2 contexts, are never pushed.
  */
 static void
 init_matrix_stack( struct gl_matrix_stack *stack,
                    GLuint maxDepth, GLuint dirtyFlag )
 {
-   GLuint i;
-
    stack->Depth = 0;
    stack->MaxDepth = maxDepth;
    stack->DirtyFlag = dirtyFlag;
    /* The stack */
-   stack->Stack = calloc(maxDepth, sizeof(GLmatrix));
-   for (i = 0; i < maxDepth; i++) {
-      _math_matrix_ctr(&stack->Stack[i]);
-   }
+   stack->Stack = calloc(1, sizeof(GLmatrix));
+   stack->StackSize = 1;
+   _math_matrix_ctr(&stack->Stack[0]);
    stack->Top = stack->Stack;
 }
 
@@ -665,7 +695,7 @@ static void
 free_matrix_stack( struct gl_matrix_stack *stack )
 {
    GLuint i;
-   for (i = 0; i < stack->MaxDepth; i++) {
+   for (i = 0; i < stack->StackSize; i++) {
       _math_matrix_dtr(&stack->Stack[i]);
    }
    free(stack->Stack);
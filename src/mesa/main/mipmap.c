@@ -37,9 +37,14 @@
 #include "texstore.h"
 #include "image.h"
 #include "macros.h"
+#include "rowbands.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 
 static GLint
@@ -137,6 +142,144 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#ifdef __SSE2__
+
+/**
+ * SSE2 version of do_row() for the common cases of halving the width of
+ * an 8-bit RGBA/LA/L, 16-bit RGBA or float RGBA image.  The results are
+ * the same as the C code's: integer sums are done at full width and the
+ * float additions happen in the same order.
+ * \return number of destination pixels written, do_row() does the rest
+ */
+static GLint
+do_row_sse2(GLenum datatype, GLuint comps,
+            const GLvoid *srcRowA, const GLvoid *srcRowB,
+            GLint dstWidth, GLvoid *dstRow)
+{
+   const GLubyte *rowA = (const GLubyte *) srcRowA;
+   const GLubyte *rowB = (const GLubyte *) srcRowB;
+   GLubyte *dst = (GLubyte *) dstRow;
+   const __m128i zero = _mm_setzero_si128();
+   GLint i = 0;
+
+   if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
+      /* 8 source pixels -> 4 dest pixels per iteration */
+      for (; i + 4 <= dstWidth; i += 4, rowA += 32, rowB += 32, dst += 16) {
+         __m128i sum[2];
+         int h;
+
+         for (h = 0; h < 2; h++) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) rowA + h);
+            const __m128i b = _mm_loadu_si128((const __m128i *) rowB + h);
+            /* vertical sums of pixels 0,1 and 2,3, as 16-bit components */
+            const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                             _mm_unpacklo_epi8(b, zero));
+            const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                             _mm_unpackhi_epi8(b, zero));
+            sum[h] = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi),
+                                                  _mm_unpackhi_epi64(lo, hi)),
+                                    2);
+         }
+         _mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(sum[0], sum[1]));
+      }
+   }
+   else if (datatype == GL_UNSIGNED_BYTE && comps == 2) {
+      /* 16 source pixels -> 8 dest pixels per iteration */
+      for (; i + 8 <= dstWidth; i += 8, rowA += 32, rowB += 32, dst += 16) {
+         __m128i sum[2];
+         int h;
+
+         for (h = 0; h < 2; h++) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) rowA + h);
+            const __m128i b = _mm_loadu_si128((const __m128i *) rowB + h);
+            const __m128 lo = _mm_castsi128_ps(
+               _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                             _mm_unpacklo_epi8(b, zero)));
+            const __m128 hi = _mm_castsi128_ps(
+               _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                             _mm_unpackhi_epi8(b, zero)));
+            /* each 32-bit lane is one pixel: add even and odd pixels */
+            const __m128i even = _mm_castps_si128(
+               _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i odd = _mm_castps_si128(
+               _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+            sum[h] = _mm_srli_epi16(_mm_add_epi16(even, odd), 2);
+         }
+         _mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(sum[0], sum[1]));
+      }
+   }
+   else if (datatype == GL_UNSIGNED_BYTE && comps == 1) {
+      /* 32 source pixels -> 16 dest pixels per iteration */
+      const __m128i ones = _mm_set1_epi16(1);
+
+      for (; i + 16 <= dstWidth; i += 16, rowA += 32, rowB += 32, dst += 16) {
+         __m128i sum[2];
+         int h;
+
+         for (h = 0; h < 2; h++) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) rowA + h);
+            const __m128i b = _mm_loadu_si128((const __m128i *) rowB + h);
+            const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                             _mm_unpacklo_epi8(b, zero));
+            const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                             _mm_unpackhi_epi8(b, zero));
+            /* madd adds adjacent 16-bit lanes into 32-bit lanes */
+            sum[h] = _mm_packs_epi32(
+               _mm_srli_epi32(_mm_madd_epi16(lo, ones), 2),
+               _mm_srli_epi32(_mm_madd_epi16(hi, ones), 2));
+         }
+         _mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(sum[0], sum[1]));
+      }
+   }
+   else if (datatype == GL_UNSIGNED_SHORT && comps == 4) {
+      /* 4 source pixels -> 2 dest pixels per iteration */
+      const __m128i bias = _mm_set1_epi32(0x8000);
+
+      for (; i + 2 <= dstWidth; i += 2, rowA += 32, rowB += 32, dst += 16) {
+         __m128i sum[2];
+         int h;
+
+         for (h = 0; h < 2; h++) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) rowA + h);
+            const __m128i b = _mm_loadu_si128((const __m128i *) rowB + h);
+            __m128i s;
+
+            s = _mm_add_epi32(_mm_unpacklo_epi16(a, zero),
+                              _mm_unpackhi_epi16(a, zero));
+            s = _mm_add_epi32(s, _mm_unpacklo_epi16(b, zero));
+            s = _mm_add_epi32(s, _mm_unpackhi_epi16(b, zero));
+            /* SSE2 can only pack with signed saturation, so bias the
+             * [0, 65535] averages into the signed range and back.
+             */
+            sum[h] = _mm_sub_epi32(_mm_srli_epi32(s, 2), bias);
+         }
+         _mm_storeu_si128((__m128i *) dst,
+                          _mm_xor_si128(_mm_packs_epi32(sum[0], sum[1]),
+                                        _mm_set1_epi16(0x8000)));
+      }
+   }
+   else if (datatype == GL_FLOAT && comps == 4) {
+      /* 2 source pixels -> 1 dest pixel per iteration */
+      const __m128 quarter = _mm_set1_ps(0.25F);
+
+      for (; i < dstWidth; i++, rowA += 32, rowB += 32, dst += 16) {
+         const __m128 aj = _mm_loadu_ps((const GLfloat *) rowA);
+         const __m128 ak = _mm_loadu_ps((const GLfloat *) rowA + 4);
+         const __m128 bj = _mm_loadu_ps((const GLfloat *) rowB);
+         const __m128 bk = _mm_loadu_ps((const GLfloat *) rowB + 4);
+         __m128 s;
+
+         s = _mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj), bk);
+         _mm_storeu_ps((GLfloat *) dst, _mm_mul_ps(s, quarter));
+      }
+   }
+
+   return i;
+}
+
+#endif /* __SSE2__ */
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -150,12 +293,30 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
        const GLvoid *srcRowA, const GLvoid *srcRowB,
        GLint dstWidth, GLvoid *dstRow)
 {
-   const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
-   const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
+   GLuint k0, colStride;
 
    ASSERT(comps >= 1);
    ASSERT(comps <= 4);
 
+#ifdef __SSE2__
+   if (srcWidth >= 2 * dstWidth) {
+      const GLint done = do_row_sse2(datatype, comps, srcRowA, srcRowB,
+                                     dstWidth, dstRow);
+      if (done > 0) {
+         /* finish the row with the C code */
+         const GLint bpt = bytes_per_pixel(datatype, comps);
+         srcRowA = (const GLubyte *) srcRowA + 2 * done * bpt;
+         srcRowB = (const GLubyte *) srcRowB + 2 * done * bpt;
+         dstRow = (GLubyte *) dstRow + done * bpt;
+         srcWidth -= 2 * done;
+         dstWidth -= done;
+      }
+   }
+#endif
+
+   k0 = (srcWidth == dstWidth) ? 0 : 1;
+   colStride = (srcWidth == dstWidth) ? 1 : 2;
+
    /* This assertion is no longer valid with non-power-of-2 textures
    assert(srcWidth == dstWidth || srcWidth == 2 * dstWidth);
    */
@@ -1441,6 +1602,48 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/** Minimum amount of output per thread for threaded 2D mipmap generation */
+#define MIPMAP_BAND_MIN_BYTES (256 * 1024)
+
+/**
+ * The rows of a 2D mipmap level for make_2d_mipmap() to filter, in bands
+ * which may be done on other threads.
+ */
+struct mipmap_rows
+{
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth, dstWidth;
+   const GLubyte *srcA, *srcB;
+   GLint srcStride;   /**< bytes between the srcA rows of adjacent dst rows */
+   GLubyte *dst;
+   GLint dstStride;
+};
+
+
+/**
+ * Filter a band of rows.  Each dest row only depends on its own source
+ * rows, so the bands are independent.
+ */
+static void
+filter_rows(void *data, GLint firstRow, GLint numRows)
+{
+   const struct mipmap_rows *rows = (const struct mipmap_rows *) data;
+   const GLubyte *srcA = rows->srcA + firstRow * rows->srcStride;
+   const GLubyte *srcB = rows->srcB + firstRow * rows->srcStride;
+   GLubyte *dst = rows->dst + firstRow * rows->dstStride;
+   GLint row;
+
+   for (row = 0; row < numRows; row++) {
+      do_row(rows->datatype, rows->comps, rows->srcWidth, srcA, srcB,
+             rows->dstWidth, dst);
+      srcA += rows->srcStride;
+      srcB += rows->srcStride;
+      dst += rows->dstStride;
+   }
+}
+
+
 static void
 make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, GLint srcHeight,
@@ -1455,6 +1658,7 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLubyte *srcA, *srcB;
    GLubyte *dst;
    GLint row, srcRowStep;
+   struct mipmap_rows rows;
 
    /* Compute src and dst pointers, skipping any border */
    srcA = srcPtr + border * ((srcWidth + 1) * bpt);
@@ -1471,13 +1675,18 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   rows.datatype = datatype;
+   rows.comps = comps;
+   rows.srcWidth = srcWidthNB;
+   rows.dstWidth = dstWidthNB;
+   rows.srcA = srcA;
+   rows.srcB = srcB;
+   rows.srcStride = srcRowStep * srcRowStride;
+   rows.dst = dst;
+   rows.dstStride = dstRowStride;
+   _mesa_process_row_bands(filter_rows, &rows, dstHeightNB,
+                           dstHeightNB * dstWidthNB * bpt /
+                           MIPMAP_BAND_MIN_BYTES);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
@@ -71,6 +71,7 @@ typedef GLuint64 GLbitfield64;
  */
 /*@{*/
 struct _mesa_HashTable;
+struct hash_table;
 struct gl_attrib_node;
 struct gl_list_extensions;
 struct gl_meta_state;
@@ -1380,6 +1381,7 @@ struct gl_texture_attrib
    GLuint CurrentUnit;   /**< GL_ACTIVE_TEXTURE */
    struct gl_texture_unit Unit[MAX_COMBINED_TEXTURE_IMAGE_UNITS];
 
+   /** Proxy texture objects, see _mesa_get_proxy_tex_object() */
    struct gl_texture_object *ProxyTex[NUM_TEXTURE_TARGETS];
 
    /** GL_ARB_texture_buffer_object */
@@ -1476,8 +1478,16 @@ struct gl_buffer_object
    GLboolean Written;   /**< Ever written to? (for debugging) */
    GLboolean Purgeable; /**< Is the buffer purgeable under memory pressure? */
    GLboolean Immutable; /**< GL_ARB_buffer_storage */
+   GLboolean GPUWritable; /**< Ever bound where the GPU may write to it? */
 
    struct gl_buffer_mapping Mappings[MAP_COUNT];
+
+   /** Memoized index min/max per range, see vbo_minmax_cache.c */
+   mtx_t MinMaxCacheMutex;
+   struct hash_table *MinMaxCache;
+   unsigned MinMaxCacheHitIndices;
+   unsigned MinMaxCacheMissIndices;
+   GLboolean MinMaxCacheDirty;  /**< Contents changed since last lookup? */
 };
 
 
@@ -2241,7 +2251,8 @@ struct gl_vertex_program_state
     */
    struct gl_vertex_program *_Current;
 
-   GLfloat Parameters[MAX_PROGRAM_ENV_PARAMS][4]; /**< Env params */
+   /** Env params [MAX_PROGRAM_ENV_PARAMS], allocated on first use */
+   GLfloat (*Parameters)[4];
 
    /** Should fixed-function T&L be implemented with a vertex prog? */
    GLboolean _MaintainTnlProgram;
@@ -2270,8 +2281,6 @@ struct gl_geometry_program_state
     */
    struct gl_geometry_program *_Current;
 
-   GLfloat Parameters[MAX_PROGRAM_ENV_PARAMS][4]; /**< Env params */
-
    /** Cache of fixed-function programs */
    struct gl_program_cache *Cache;
 };
@@ -2291,7 +2300,8 @@ struct gl_fragment_program_state
     */
    struct gl_fragment_program *_Current;
 
-   GLfloat Parameters[MAX_PROGRAM_ENV_PARAMS][4]; /**< Env params */
+   /** Env params [MAX_PROGRAM_ENV_PARAMS], allocated on first use */
+   GLfloat (*Parameters)[4];
 
    /** Should fixed-function texturing be implemented with a fragment prog? */
    GLboolean _MaintainTexEnvProgram;
@@ -3637,9 +3647,10 @@ struct gl_extensions
 struct gl_matrix_stack
 {
    GLmatrix *Top;      /**< points into Stack */
-   GLmatrix *Stack;    /**< array [MaxDepth] of GLmatrix */
+   GLmatrix *Stack;    /**< array [StackSize] of GLmatrix */
+   GLuint StackSize;   /**< number of matrices allocated in Stack[] */
    GLuint Depth;       /**< 0 <= Depth < MaxDepth */
-   GLuint MaxDepth;    /**< size of Stack[] array */
+   GLuint MaxDepth;    /**< max stack depth */
    GLuint DirtyFlag;   /**< _NEW_MODELVIEW or _NEW_PROJECTION, for example */
 };
 
@@ -4117,7 +4128,8 @@ struct gl_context
 
    /** \name Other assorted state (not pushed/popped on attribute stack) */
    /*@{*/
-   struct gl_pixelmaps          PixelMaps;
+   /** Shared read-only defaults until glPixelMap, see _mesa_init_pixel() */
+   struct gl_pixelmaps         *PixelMaps;
 
    struct gl_evaluators EvalMap;   /**< All evaluators */
    struct gl_feedback   Feedback;  /**< Feedback */
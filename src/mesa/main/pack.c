@@ -5208,10 +5208,10 @@ _mesa_unpack_stencil_span( struct gl_context *ctx, GLuint n,
 
       if (ctx->Pixel.MapStencilFlag) {
          /* Apply stencil lookup table */
-         const GLuint mask = ctx->PixelMaps.StoS.Size - 1;
+         const GLuint mask = ctx->PixelMaps->StoS.Size - 1;
          GLuint i;
          for (i = 0; i < n; i++) {
-            indexes[i] = (GLuint)ctx->PixelMaps.StoS.Map[ indexes[i] & mask ];
+            indexes[i] = (GLuint)ctx->PixelMaps->StoS.Map[ indexes[i] & mask ];
          }
       }
 
@@ -71,31 +71,41 @@ get_pixelmap(struct gl_context *ctx, GLenum map)
 {
    switch (map) {
    case GL_PIXEL_MAP_I_TO_I:
-      return &ctx->PixelMaps.ItoI;
+      return &ctx->PixelMaps->ItoI;
    case GL_PIXEL_MAP_S_TO_S:
-      return &ctx->PixelMaps.StoS;
+      return &ctx->PixelMaps->StoS;
    case GL_PIXEL_MAP_I_TO_R:
-      return &ctx->PixelMaps.ItoR;
+      return &ctx->PixelMaps->ItoR;
    case GL_PIXEL_MAP_I_TO_G:
-      return &ctx->PixelMaps.ItoG;
+      return &ctx->PixelMaps->ItoG;
    case GL_PIXEL_MAP_I_TO_B:
-      return &ctx->PixelMaps.ItoB;
+      return &ctx->PixelMaps->ItoB;
    case GL_PIXEL_MAP_I_TO_A:
-      return &ctx->PixelMaps.ItoA;
+      return &ctx->PixelMaps->ItoA;
    case GL_PIXEL_MAP_R_TO_R:
-      return &ctx->PixelMaps.RtoR;
+      return &ctx->PixelMaps->RtoR;
    case GL_PIXEL_MAP_G_TO_G:
-      return &ctx->PixelMaps.GtoG;
+      return &ctx->PixelMaps->GtoG;
    case GL_PIXEL_MAP_B_TO_B:
-      return &ctx->PixelMaps.BtoB;
+      return &ctx->PixelMaps->BtoB;
    case GL_PIXEL_MAP_A_TO_A:
-      return &ctx->PixelMaps.AtoA;
+      return &ctx->PixelMaps->AtoA;
    default:
       return NULL;
    }
 }
 
 
+/**
+ * Initial state of the pixel maps: each has one entry, 0.0.  Contexts
+ * point at this until they set a map, which few apps do, so that they don't
+ * all need 10KB of their own.
+ */
+static const struct gl_pixelmaps default_pixelmaps = {
+   { 1 }, { 1 }, { 1 }, { 1 }, { 1 }, { 1 }, { 1 }, { 1 }, { 1 }, { 1 }
+};
+
+
 /**
  * Helper routine used by the other _mesa_PixelMap() functions.
  */
@@ -104,25 +114,38 @@ store_pixelmap(struct gl_context *ctx, GLenum map, GLsizei mapsize,
                const GLfloat *values)
 {
    GLint i;
-   struct gl_pixelmap *pm = get_pixelmap(ctx, map);
-   if (!pm) {
+   struct gl_pixelmap *pm;
+
+   if (!get_pixelmap(ctx, map)) {
       _mesa_error(ctx, GL_INVALID_ENUM, "glPixelMap(map)");
       return;
    }
 
+   if (ctx->PixelMaps == &default_pixelmaps) {
+      struct gl_pixelmaps *maps = malloc(sizeof(*maps));
+      if (!maps) {
+         _mesa_error(ctx, GL_OUT_OF_MEMORY, "glPixelMap");
+         return;
+      }
+      memcpy(maps, &default_pixelmaps, sizeof(*maps));
+      ctx->PixelMaps = maps;
+   }
+
+   pm = get_pixelmap(ctx, map);
+
    switch (map) {
    case GL_PIXEL_MAP_S_TO_S:
       /* special case */
-      ctx->PixelMaps.StoS.Size = mapsize;
+      ctx->PixelMaps->StoS.Size = mapsize;
       for (i = 0; i < mapsize; i++) {
-         ctx->PixelMaps.StoS.Map[i] = (GLfloat)IROUND(values[i]);
+         ctx->PixelMaps->StoS.Map[i] = (GLfloat)IROUND(values[i]);
       }
       break;
    case GL_PIXEL_MAP_I_TO_I:
       /* special case */
-      ctx->PixelMaps.ItoI.Size = mapsize;
+      ctx->PixelMaps->ItoI.Size = mapsize;
       for (i = 0; i < mapsize; i++) {
-         ctx->PixelMaps.ItoI.Map[i] = values[i];
+         ctx->PixelMaps->ItoI.Map[i] = values[i];
       }
       break;
    default:
@@ -357,7 +380,7 @@ _mesa_GetnPixelMapfvARB( GLenum map, GLsizei bufSize, GLfloat *values )
    if (map == GL_PIXEL_MAP_S_TO_S) {
       /* special case */
       for (i = 0; i < mapsize; i++) {
-         values[i] = (GLfloat) ctx->PixelMaps.StoS.Map[i];
+         values[i] = (GLfloat) ctx->PixelMaps->StoS.Map[i];
       }
    }
    else {
@@ -405,7 +428,7 @@ _mesa_GetnPixelMapuivARB( GLenum map, GLsizei bufSize, GLuint *values )
 
    if (map == GL_PIXEL_MAP_S_TO_S) {
       /* special case */
-      memcpy(values, ctx->PixelMaps.StoS.Map, mapsize * sizeof(GLint));
+      memcpy(values, ctx->PixelMaps->StoS.Map, mapsize * sizeof(GLint));
    }
    else {
       for (i = 0; i < mapsize; i++) {
@@ -456,12 +479,12 @@ _mesa_GetnPixelMapusvARB( GLenum map, GLsizei bufSize, GLushort *values )
    /* special cases */
    case GL_PIXEL_MAP_I_TO_I:
       for (i = 0; i < mapsize; i++) {
-         values[i] = (GLushort) CLAMP(ctx->PixelMaps.ItoI.Map[i], 0.0, 65535.);
+         values[i] = (GLushort) CLAMP(ctx->PixelMaps->ItoI.Map[i], 0.0, 65535.);
       }
       break;
    case GL_PIXEL_MAP_S_TO_S:
       for (i = 0; i < mapsize; i++) {
-         values[i] = (GLushort) CLAMP(ctx->PixelMaps.StoS.Map[i], 0.0, 65535.);
+         values[i] = (GLushort) CLAMP(ctx->PixelMaps->StoS.Map[i], 0.0, 65535.);
       }
       break;
    default:
@@ -638,14 +661,6 @@ void _mesa_update_pixel( struct gl_context *ctx, GLuint new_state )
 /*****                      Initialization                        *****/
 /**********************************************************************/
 
-static void
-init_pixelmap(struct gl_pixelmap *map)
-{
-   map->Size = 1;
-   map->Map[0] = 0.0;
-}
-
-
 /**
  * Initialize the context's PIXEL attribute group.
  */
@@ -669,16 +684,7 @@ _mesa_init_pixel( struct gl_context *ctx )
    ctx->Pixel.ZoomY = 1.0;
    ctx->Pixel.MapColorFlag = GL_FALSE;
    ctx->Pixel.MapStencilFlag = GL_FALSE;
-   init_pixelmap(&ctx->PixelMaps.StoS);
-   init_pixelmap(&ctx->PixelMaps.ItoI);
-   init_pixelmap(&ctx->PixelMaps.ItoR);
-   init_pixelmap(&ctx->PixelMaps.ItoG);
-   init_pixelmap(&ctx->PixelMaps.ItoB);
-   init_pixelmap(&ctx->PixelMaps.ItoA);
-   init_pixelmap(&ctx->PixelMaps.RtoR);
-   init_pixelmap(&ctx->PixelMaps.GtoG);
-   init_pixelmap(&ctx->PixelMaps.BtoB);
-   init_pixelmap(&ctx->PixelMaps.AtoA);
+   ctx->PixelMaps = (struct gl_pixelmaps *) &default_pixelmaps;
 
    if (ctx->Visual.doubleBufferMode) {
       ctx->Pixel.ReadBuffer = GL_BACK;
@@ -690,3 +696,15 @@ _mesa_init_pixel( struct gl_context *ctx )
    /* Miscellaneous */
    ctx->_ImageTransferState = 0;
 }
+
+
+/**
+ * Free the context's pixel maps, if it has its own.
+ */
+void
+_mesa_free_pixel_data( struct gl_context *ctx )
+{
+   if (ctx->PixelMaps != &default_pixelmaps)
+      free(ctx->PixelMaps);
+   ctx->PixelMaps = NULL;
+}
@@ -71,6 +71,9 @@ _mesa_update_pixel( struct gl_context *ctx, GLuint newstate );
 extern void 
 _mesa_init_pixel( struct gl_context * ctx );
 
+extern void
+_mesa_free_pixel_data( struct gl_context *ctx );
+
 /*@}*/
 
 #endif /* PIXEL_H */
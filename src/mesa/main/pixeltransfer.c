@@ -80,14 +80,14 @@ _mesa_scale_and_bias_rgba(GLuint n, GLfloat rgba[][4],
 void
 _mesa_map_rgba( const struct gl_context *ctx, GLuint n, GLfloat rgba[][4] )
 {
-   const GLfloat rscale = (GLfloat) (ctx->PixelMaps.RtoR.Size - 1);
-   const GLfloat gscale = (GLfloat) (ctx->PixelMaps.GtoG.Size - 1);
-   const GLfloat bscale = (GLfloat) (ctx->PixelMaps.BtoB.Size - 1);
-   const GLfloat ascale = (GLfloat) (ctx->PixelMaps.AtoA.Size - 1);
-   const GLfloat *rMap = ctx->PixelMaps.RtoR.Map;
-   const GLfloat *gMap = ctx->PixelMaps.GtoG.Map;
-   const GLfloat *bMap = ctx->PixelMaps.BtoB.Map;
-   const GLfloat *aMap = ctx->PixelMaps.AtoA.Map;
+   const GLfloat rscale = (GLfloat) (ctx->PixelMaps->RtoR.Size - 1);
+   const GLfloat gscale = (GLfloat) (ctx->PixelMaps->GtoG.Size - 1);
+   const GLfloat bscale = (GLfloat) (ctx->PixelMaps->BtoB.Size - 1);
+   const GLfloat ascale = (GLfloat) (ctx->PixelMaps->AtoA.Size - 1);
+   const GLfloat *rMap = ctx->PixelMaps->RtoR.Map;
+   const GLfloat *gMap = ctx->PixelMaps->GtoG.Map;
+   const GLfloat *bMap = ctx->PixelMaps->BtoB.Map;
+   const GLfloat *aMap = ctx->PixelMaps->AtoA.Map;
    GLuint i;
    for (i=0;i<n;i++) {
       GLfloat r = CLAMP(rgba[i][RCOMP], 0.0F, 1.0F);
@@ -108,14 +108,14 @@ void
 _mesa_map_ci_to_rgba( const struct gl_context *ctx, GLuint n,
                       const GLuint index[], GLfloat rgba[][4] )
 {
-   GLuint rmask = ctx->PixelMaps.ItoR.Size - 1;
-   GLuint gmask = ctx->PixelMaps.ItoG.Size - 1;
-   GLuint bmask = ctx->PixelMaps.ItoB.Size - 1;
-   GLuint amask = ctx->PixelMaps.ItoA.Size - 1;
-   const GLfloat *rMap = ctx->PixelMaps.ItoR.Map;
-   const GLfloat *gMap = ctx->PixelMaps.ItoG.Map;
-   const GLfloat *bMap = ctx->PixelMaps.ItoB.Map;
-   const GLfloat *aMap = ctx->PixelMaps.ItoA.Map;
+   GLuint rmask = ctx->PixelMaps->ItoR.Size - 1;
+   GLuint gmask = ctx->PixelMaps->ItoG.Size - 1;
+   GLuint bmask = ctx->PixelMaps->ItoB.Size - 1;
+   GLuint amask = ctx->PixelMaps->ItoA.Size - 1;
+   const GLfloat *rMap = ctx->PixelMaps->ItoR.Map;
+   const GLfloat *gMap = ctx->PixelMaps->ItoG.Map;
+   const GLfloat *bMap = ctx->PixelMaps->ItoB.Map;
+   const GLfloat *aMap = ctx->PixelMaps->ItoA.Map;
    GLuint i;
    for (i=0;i<n;i++) {
       rgba[i][RCOMP] = rMap[index[i] & rmask];
@@ -232,11 +232,11 @@ _mesa_apply_ci_transfer_ops(const struct gl_context *ctx,
       _mesa_shift_and_offset_ci(ctx, n, indexes);
    }
    if (transferOps & IMAGE_MAP_COLOR_BIT) {
-      const GLuint mask = ctx->PixelMaps.ItoI.Size - 1;
+      const GLuint mask = ctx->PixelMaps->ItoI.Size - 1;
       GLuint i;
       for (i = 0; i < n; i++) {
          const GLuint j = indexes[i] & mask;
-         indexes[i] = F_TO_I(ctx->PixelMaps.ItoI.Map[j]);
+         indexes[i] = F_TO_I(ctx->PixelMaps->ItoI.Map[j]);
       }
    }
 }
@@ -272,10 +272,10 @@ _mesa_apply_stencil_transfer_ops(const struct gl_context *ctx, GLuint n,
       }
    }
    if (ctx->Pixel.MapStencilFlag) {
-      GLuint mask = ctx->PixelMaps.StoS.Size - 1;
+      GLuint mask = ctx->PixelMaps->StoS.Size - 1;
       GLuint i;
       for (i = 0; i < n; i++) {
-         stencil[i] = (GLubyte) ctx->PixelMaps.StoS.Map[ stencil[i] & mask ];
+         stencil[i] = (GLubyte) ctx->PixelMaps->StoS.Map[ stencil[i] & mask ];
       }
    }
 }
@@ -39,6 +39,7 @@
 #include "state.h"
 #include "glformats.h"
 #include "fbobject.h"
+#include "streaming-load-memcpy.h"
 
 
 /**
@@ -230,9 +231,9 @@ readpixels_memcpy(struct gl_context *ctx,
 
    texelBytes = _mesa_get_format_bytes(rb->Format);
 
-   /* memcpy*/
+   /* The renderbuffer is likely to be mapped uncached or write-combined */
    for (j = 0; j < height; j++) {
-      memcpy(dst, map, width * texelBytes);
+      _mesa_memcpy_from_wc(dst, map, width * texelBytes);
       dst += dstStride;
       map += stride;
    }
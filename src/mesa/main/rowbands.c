@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file rowbands.c
+ * Processing the rows of an image in bands on several threads, for
+ * mipmap generation and texture compression.
+ */
+
+#include "glheader.h"
+#include "imports.h"
+#include "macros.h"
+#include "rowbands.h"
+
+#ifdef HAVE_PTHREAD
+#include <unistd.h>
+#endif
+
+
+/** Max number of threads processing one image */
+#define ROW_BANDS_MAX_THREADS 8
+
+
+/**
+ * A band of rows, possibly processed on another thread.
+ */
+struct row_band
+{
+   row_band_func func;
+   void *data;
+   GLint firstRow, numRows;
+};
+
+
+static int
+process_band(void *data)
+{
+   const struct row_band *band = (const struct row_band *) data;
+
+   band->func(band->data, band->firstRow, band->numRows);
+
+   return 0;
+}
+
+
+/**
+ * How many threads may process an image.
+ */
+static GLint
+row_bands_max_threads(void)
+{
+   static GLint numThreads = 0;
+
+   if (!numThreads) {
+      long n = 1;
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+      n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+      numThreads = CLAMP(n, 1, ROW_BANDS_MAX_THREADS);
+   }
+
+   return numThreads;
+}
+
+
+/**
+ * Process the rows of an image by calling func on bands of them, in
+ * parallel.  The rows must be independent of each other.  Returns when
+ * all of them are done.
+ *
+ * \param numRows  number of rows in the image
+ * \param maxBands  max number of bands to split the rows into, from the
+ *                  amount of work per row, so that small images aren't
+ *                  worth the cost of starting threads
+ */
+void
+_mesa_process_row_bands(row_band_func func, void *data,
+                        GLint numRows, GLint maxBands)
+{
+   const GLint numBands = MIN3(row_bands_max_threads(), numRows, maxBands);
+   struct row_band bands[ROW_BANDS_MAX_THREADS];
+   thrd_t threads[ROW_BANDS_MAX_THREADS];
+   GLboolean started[ROW_BANDS_MAX_THREADS];
+   GLint b, row = 0;
+
+   if (numBands <= 1) {
+      if (numRows > 0)
+         func(data, 0, numRows);
+      return;
+   }
+
+   for (b = 0; b < numBands; b++) {
+      const GLint endRow = numRows * (b + 1) / numBands;
+
+      bands[b].func = func;
+      bands[b].data = data;
+      bands[b].firstRow = row;
+      bands[b].numRows = endRow - row;
+      row = endRow;
+   }
+
+   /* the calling thread does the first band itself */
+   for (b = 1; b < numBands; b++) {
+      started[b] = thrd_create(&threads[b], process_band, &bands[b]) ==
+                   thrd_success;
+   }
+
+   process_band(&bands[0]);
+
+   for (b = 1; b < numBands; b++) {
+      if (started[b])
+         thrd_join(threads[b], NULL);
+      else
+         process_band(&bands[b]);
+   }
+}
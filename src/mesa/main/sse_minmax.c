@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef __SSE4_1__
+#include "main/macros.h"
+#include "main/sse_minmax.h"
+#include <smmintrin.h>
+#include <stdint.h>
+
+void
+_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned count,
+                         bool restart, unsigned restart_index,
+                         unsigned *min_index, unsigned *max_index)
+{
+   unsigned max_ui = *max_index;
+   unsigned min_ui = *min_index;
+   unsigned i = 0;
+
+   /* Scalar loop until the indices are 16-byte aligned. */
+   for (; i < count && ((uintptr_t)&ui_indices[i] & 15); i++) {
+      if (restart && ui_indices[i] == restart_index)
+         continue;
+      if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+      if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
+   }
+
+   if (count - i >= 4) {
+      const unsigned aligned_count = i + ((count - i) & ~3u);
+      __m128i max_v = _mm_setzero_si128();
+      __m128i min_v = _mm_set1_epi32(~0);
+      __m128i tmp;
+      unsigned vec_min, vec_max;
+
+      if (restart) {
+         const __m128i restart_v = _mm_set1_epi32(restart_index);
+
+         /* Restart indices are replaced by the identity of each reduction:
+          * ~0 for min and 0 for max.
+          */
+         for (; i < aligned_count; i += 4) {
+            __m128i v = _mm_load_si128((const __m128i *)&ui_indices[i]);
+            __m128i is_restart = _mm_cmpeq_epi32(v, restart_v);
+            min_v = _mm_min_epu32(min_v, _mm_or_si128(v, is_restart));
+            max_v = _mm_max_epu32(max_v, _mm_andnot_si128(is_restart, v));
+         }
+      }
+      else {
+         for (; i < aligned_count; i += 4) {
+            __m128i v = _mm_load_si128((const __m128i *)&ui_indices[i]);
+            min_v = _mm_min_epu32(min_v, v);
+            max_v = _mm_max_epu32(max_v, v);
+         }
+      }
+
+      /* Reduce the four lanes. */
+      tmp = _mm_shuffle_epi32(min_v, _MM_SHUFFLE(1, 0, 3, 2));
+      min_v = _mm_min_epu32(min_v, tmp);
+      tmp = _mm_shuffle_epi32(min_v, _MM_SHUFFLE(2, 3, 0, 1));
+      min_v = _mm_min_epu32(min_v, tmp);
+
+      tmp = _mm_shuffle_epi32(max_v, _MM_SHUFFLE(1, 0, 3, 2));
+      max_v = _mm_max_epu32(max_v, tmp);
+      tmp = _mm_shuffle_epi32(max_v, _MM_SHUFFLE(2, 3, 0, 1));
+      max_v = _mm_max_epu32(max_v, tmp);
+
+      vec_min = _mm_cvtsi128_si32(min_v);
+      vec_max = _mm_cvtsi128_si32(max_v);
+      min_ui = MIN2(min_ui, vec_min);
+      max_ui = MAX2(max_ui, vec_max);
+   }
+
+   for (; i < count; i++) {
+      if (restart && ui_indices[i] == restart_index)
+         continue;
+      if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+      if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
+   }
+
+   *min_index = min_ui;
+   *max_index = max_ui;
+}
+
+void
+_mesa_ushort_array_min_max(const unsigned short *us_indices, unsigned count,
+                           bool restart, unsigned restart_index,
+                           unsigned *min_index, unsigned *max_index)
+{
+   unsigned max_us = *max_index;
+   unsigned min_us = *min_index;
+   unsigned i = 0;
+
+   /* A restart index which doesn't fit in 16 bits never matches. */
+   if (restart_index > 0xffff)
+      restart = false;
+
+   for (; i < count && ((uintptr_t)&us_indices[i] & 15); i++) {
+      if (restart && us_indices[i] == restart_index)
+         continue;
+      if (us_indices[i] > max_us) max_us = us_indices[i];
+      if (us_indices[i] < min_us) min_us = us_indices[i];
+   }
+
+   if (count - i >= 8) {
+      const unsigned aligned_count = i + ((count - i) & ~7u);
+      __m128i max_v = _mm_setzero_si128();
+      __m128i min_v = _mm_set1_epi16(-1);
+      unsigned vec_min, vec_max;
+
+      if (restart) {
+         const __m128i restart_v = _mm_set1_epi16((short) restart_index);
+
+         for (; i < aligned_count; i += 8) {
+            __m128i v = _mm_load_si128((const __m128i *)&us_indices[i]);
+            __m128i is_restart = _mm_cmpeq_epi16(v, restart_v);
+            min_v = _mm_min_epu16(min_v, _mm_or_si128(v, is_restart));
+            max_v = _mm_max_epu16(max_v, _mm_andnot_si128(is_restart, v));
+         }
+      }
+      else {
+         for (; i < aligned_count; i += 8) {
+            __m128i v = _mm_load_si128((const __m128i *)&us_indices[i]);
+            min_v = _mm_min_epu16(min_v, v);
+            max_v = _mm_max_epu16(max_v, v);
+         }
+      }
+
+      /* PHMINPOSUW reduces the lanes; max(x) is ~min(~x). */
+      vec_min = _mm_extract_epi16(_mm_minpos_epu16(min_v), 0);
+      vec_max = 0xffff & ~_mm_extract_epi16(
+         _mm_minpos_epu16(_mm_xor_si128(max_v, _mm_set1_epi16(-1))), 0);
+
+      /* If every element was a restart index, min > max and there is
+       * nothing to merge.
+       */
+      if (vec_min <= vec_max) {
+         min_us = MIN2(min_us, vec_min);
+         max_us = MAX2(max_us, vec_max);
+      }
+   }
+
+   for (; i < count; i++) {
+      if (restart && us_indices[i] == restart_index)
+         continue;
+      if (us_indices[i] > max_us) max_us = us_indices[i];
+      if (us_indices[i] < min_us) min_us = us_indices[i];
+   }
+
+   *min_index = min_us;
+   *max_index = max_us;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+
+/* Find the min and max of an index array with SSE 4.1, skipping elements
+ * equal to restart_index if restart is set.  *min_index and *max_index are
+ * only lowered/raised, so they must be initialized by the caller.
+ *
+ * These are only built with USE_SSE41, and must only be called when
+ * _mesa_cpu_has_sse4_1 is set.
+ */
+void
+_mesa_uint_array_min_max(const unsigned *ui_indices, unsigned count,
+                         bool restart, unsigned restart_index,
+                         unsigned *min_index, unsigned *max_index);
+
+void
+_mesa_ushort_array_min_max(const unsigned short *us_indices, unsigned count,
+                           bool restart, unsigned restart_index,
+                           unsigned *min_index, unsigned *max_index);
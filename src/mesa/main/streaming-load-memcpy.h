@@ -26,8 +26,64 @@
  *
  */
 
+#ifndef STREAMING_LOAD_MEMCPY_H
+#define STREAMING_LOAD_MEMCPY_H
+
+#include <stddef.h>
+#include <string.h>
+#include "main/cpuinfo.h"
+
 /* Copies memory from src to dst, using SSE 4.1's MOVNTDQA to get streaming
  * read performance from uncached memory.
  */
 void
-_mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len);
+_mesa_streaming_load_memcpy(void *restrict dst, const void *restrict src,
+                            size_t len);
+
+/* The same with AVX2's 256-bit VMOVNTDQA.
+ */
+void
+_mesa_streaming_load_memcpy_avx2(void *restrict dst, const void *restrict src,
+                                 size_t len);
+
+/* Whether _mesa_memcpy_from_wc() is faster than memcpy() for reading
+ * uncached or write-combined memory on this CPU.
+ */
+static inline int
+_mesa_has_streaming_load_memcpy(void)
+{
+#ifdef USE_AVX2
+   if (_mesa_cpu_has_avx2)
+      return 1;
+#endif
+#ifdef USE_SSE41
+   if (_mesa_cpu_has_sse4_1)
+      return 1;
+#endif
+   return 0;
+}
+
+/* Copies memory that was mapped write-combined or uncached, like a mapping
+ * of a buffer the GPU just rendered to, to cached memory.  Uses the widest
+ * streaming loads the CPU supports and plain memcpy() otherwise, so it is
+ * also fine to call on cached memory.
+ */
+static inline void
+_mesa_memcpy_from_wc(void *restrict dst, const void *restrict src, size_t len)
+{
+#ifdef USE_AVX2
+   if (_mesa_cpu_has_avx2 && len >= 128) {
+      _mesa_streaming_load_memcpy_avx2(dst, src, len);
+      return;
+   }
+#endif
+#ifdef USE_SSE41
+   if (_mesa_cpu_has_sse4_1 && len >= 64) {
+      _mesa_streaming_load_memcpy(dst, src, len);
+      return;
+   }
+#endif
+   memcpy(dst, src, len);
+}
+
+#endif /* STREAMING_LOAD_MEMCPY_H */
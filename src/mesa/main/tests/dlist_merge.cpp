@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file dlist_merge.cpp
+ *
+ * Checks that display lists whose glBegin/glEnd blocks get merged into one
+ * indexed vertex list draw the same vertices as they were compiled with,
+ * including when primitive restart is enabled.  The draw function applies
+ * primitive restart to indexed draws, like drivers do.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/framebuffer.h"
+#include "main/varray.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+
+#include "vbo/vbo.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+}
+
+/** Vertex positions as seen by the draw function */
+static std::vector<GLfloat> drawn;
+
+/** Number of indexed draws */
+static unsigned indexed_draws;
+
+static void
+append_position(const struct gl_client_array *array, GLuint i)
+{
+   const GLubyte *base = (const GLubyte *) array->BufferObj->Data;
+   const GLfloat *v = (const GLfloat *) (base + (GLintptr) array->Ptr +
+                                         i * array->StrideB);
+
+   drawn.insert(drawn.end(), v, v + 3);
+}
+
+static GLuint
+get_index(const struct _mesa_index_buffer *ib, GLuint i)
+{
+   const GLubyte *ptr = (const GLubyte *) ib->obj->Data + (GLintptr) ib->ptr;
+
+   switch (ib->type) {
+   case GL_UNSIGNED_BYTE:
+      return ptr[i];
+   case GL_UNSIGNED_SHORT:
+      return ((const GLushort *) ptr)[i];
+   default:
+      return ((const GLuint *) ptr)[i];
+   }
+}
+
+static void
+record_draw(struct gl_context *ctx, const struct _mesa_prim *prims,
+            GLuint nr_prims, const struct _mesa_index_buffer *ib,
+            GLboolean index_bounds_valid, GLuint min_index, GLuint max_index,
+            struct gl_transform_feedback_object *tfb_vertcount,
+            struct gl_buffer_object *indirect)
+{
+   const struct gl_client_array **arrays = ctx->Array._DrawArrays;
+
+   if (ib)
+      indexed_draws++;
+
+   for (GLuint p = 0; p < nr_prims; p++) {
+      for (GLuint i = prims[p].start; i < prims[p].start + prims[p].count;
+           i++) {
+         GLuint index = i;
+
+         if (ib) {
+            index = get_index(ib, i);
+            if (ctx->Array._PrimitiveRestart &&
+                index == _mesa_primitive_restart_index(ctx, ib->type))
+               continue;
+         }
+
+         append_position(arrays[VERT_ATTRIB_POS], index);
+      }
+   }
+}
+
+static void
+update_state(struct gl_context *ctx, GLuint new_state)
+{
+}
+
+static void
+free_texture_image_buffer(struct gl_context *ctx,
+                          struct gl_texture_image *texImage)
+{
+}
+
+class DlistMerge : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void compile_list(GLuint list);
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context *ctx;
+   struct gl_framebuffer *fb;
+   std::vector<GLfloat> compiled;
+};
+
+void
+DlistMerge::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   _mesa_init_driver_functions(&driver_functions);
+   driver_functions.UpdateState = update_state;
+   driver_functions.FreeTextureImageBuffer = free_texture_image_buffer;
+
+   ctx = _mesa_create_context(API_OPENGL_COMPAT, &visual, NULL,
+                              &driver_functions);
+   ASSERT_TRUE(ctx != NULL);
+   ctx->Version = 31;
+
+   _vbo_CreateContext(ctx);
+   vbo_set_draw_func(ctx, record_draw);
+   vbo_use_buffer_objects(ctx);
+   _mesa_initialize_dispatch_tables(ctx);
+   _mesa_initialize_vbo_vtxfmt(ctx);
+
+   fb = _mesa_create_framebuffer(&visual);
+   _mesa_make_current(ctx, fb, fb);
+
+   drawn.clear();
+   indexed_draws = 0;
+}
+
+void
+DlistMerge::TearDown()
+{
+   if (ctx) {
+      _mesa_make_current(NULL, NULL, NULL);
+      _mesa_reference_framebuffer(&fb, NULL);
+      _vbo_DestroyContext(ctx);
+      _mesa_destroy_context(ctx);
+      ctx = NULL;
+   }
+}
+
+/**
+ * Two triangles in separate glBegin/glEnd blocks, separated by a redundant
+ * state change, which the list optimizer drops so that the blocks' vertex
+ * lists get merged.  The triangles share a vertex, which gets index 0.
+ */
+void
+DlistMerge::compile_list(GLuint list)
+{
+   static const GLfloat tris[2][3][3] = {
+      { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } },
+      { { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } },
+   };
+
+   CALL_NewList(ctx->Exec, (list, GL_COMPILE));
+   for (unsigned t = 0; t < 2; t++) {
+      CALL_Enable(ctx->CurrentDispatch, (GL_DEPTH_TEST));
+      CALL_Begin(ctx->CurrentDispatch, (GL_TRIANGLES));
+      for (unsigned v = 0; v < 3; v++) {
+         CALL_Vertex3fv(ctx->CurrentDispatch, (tris[t][v]));
+         compiled.insert(compiled.end(), tris[t][v], tris[t][v] + 3);
+      }
+      CALL_End(ctx->CurrentDispatch, ());
+   }
+   CALL_EndList(ctx->CurrentDispatch, ());
+}
+
+TEST_F(DlistMerge, Merged)
+{
+   compile_list(1);
+   CALL_CallList(ctx->Exec, (1));
+   ctx->Driver.FlushVertices(ctx, FLUSH_STORED_VERTICES);
+
+   EXPECT_EQ(1u, indexed_draws);
+   EXPECT_TRUE(compiled == drawn);
+}
+
+TEST_F(DlistMerge, PrimitiveRestart)
+{
+   compile_list(1);
+   CALL_Enable(ctx->Exec, (GL_PRIMITIVE_RESTART));
+   CALL_PrimitiveRestartIndex(ctx->Exec, (0));
+   CALL_CallList(ctx->Exec, (1));
+   ctx->Driver.FlushVertices(ctx, FLUSH_STORED_VERTICES);
+
+   EXPECT_TRUE(compiled == drawn);
+}
+
+TEST_F(DlistMerge, FixedIndexRestart)
+{
+   ctx->Extensions.ARB_ES3_compatibility = GL_TRUE;
+
+   compile_list(1);
+   CALL_Enable(ctx->Exec, (GL_PRIMITIVE_RESTART_FIXED_INDEX));
+   CALL_CallList(ctx->Exec, (1));
+   ctx->Driver.FlushVertices(ctx, FLUSH_STORED_VERTICES);
+
+   /* Index 0xffff is never used by merged lists, so they stay indexed */
+   EXPECT_EQ(1u, indexed_draws);
+   EXPECT_TRUE(compiled == drawn);
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file format_sse2.cpp
+ *
+ * Checks that the SSE2 pack/unpack row functions give exactly the same
+ * results as the C versions.  The DISABLED_ benchmark compares their
+ * throughput; run it with --gtest_also_run_disabled_tests.
+ */
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+extern "C" {
+#include "main/macros.h"
+#include "main/cpuinfo.h"
+#include "main/format_pack.h"
+#include "main/format_unpack.h"
+}
+
+#ifdef __SSE2__
+
+/* Odd, so that every row ends with a partial group of pixels */
+#define NUM_PIXELS 1027
+
+static const mesa_format unpack_rgba_formats[] = {
+   MESA_FORMAT_B5G6R5_UNORM,
+   MESA_FORMAT_RGBA_FLOAT16,
+   MESA_FORMAT_R11G11B10_FLOAT,
+};
+
+static const mesa_format unpack_z_formats[] = {
+   MESA_FORMAT_S8_UINT_Z24_UNORM,
+   MESA_FORMAT_X8_UINT_Z24_UNORM,
+   MESA_FORMAT_Z24_UNORM_S8_UINT,
+   MESA_FORMAT_Z24_UNORM_X8_UINT,
+};
+
+static const mesa_format pack_rgba_formats[] = {
+   MESA_FORMAT_A8B8G8R8_UNORM,
+   MESA_FORMAT_R8G8B8A8_UNORM,
+   MESA_FORMAT_B8G8R8A8_UNORM,
+   MESA_FORMAT_A8R8G8B8_UNORM,
+   MESA_FORMAT_X8B8G8R8_UNORM,
+   MESA_FORMAT_R8G8B8X8_UNORM,
+   MESA_FORMAT_B8G8R8X8_UNORM,
+   MESA_FORMAT_X8R8G8B8_UNORM,
+};
+
+class FormatSSE2 : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void fill_random(void *buf, size_t size);
+   void fill_pack_source(GLfloat (*rgba)[4], unsigned n);
+
+   unsigned seed;
+};
+
+void
+FormatSSE2::SetUp()
+{
+   /* Normally done by _mesa_create_context() */
+   for (unsigned i = 0; i < 256; i++)
+      _mesa_ubyte_to_float_color_tab[i] = (float) i / 255.0F;
+
+   seed = 1;
+}
+
+void
+FormatSSE2::TearDown()
+{
+   _mesa_use_sse2_formats = 0;
+}
+
+void
+FormatSSE2::fill_random(void *buf, size_t size)
+{
+   GLubyte *b = (GLubyte *) buf;
+
+   for (size_t i = 0; i < size; i++) {
+      seed = seed * 1103515245 + 12345;
+      b[i] = seed >> 16;
+   }
+}
+
+/**
+ * Mostly values in [0, 1], where the rounding matters, plus the special
+ * cases which UNCLAMPED_FLOAT_TO_UBYTE() has to clamp.
+ */
+void
+FormatSSE2::fill_pack_source(GLfloat (*rgba)[4], unsigned n)
+{
+   static const float special[] = {
+      0.0f, -0.0f, 1.0f, -1.0f, 2.0f, 0.5f, 1.0f / 255.0f, 254.5f / 255.0f,
+      0.99999994f, 1.0e-30f, -1.0e-30f, 1.0e30f, INFINITY, -INFINITY, NAN,
+   };
+   GLfloat *f = &rgba[0][0];
+
+   for (unsigned i = 0; i < n * 4; i++) {
+      unsigned r;
+
+      seed = seed * 1103515245 + 12345;
+      r = seed >> 8;
+      if ((r & 0xf) == 0)
+         f[i] = special[(r >> 4) % Elements(special)];
+      else
+         f[i] = (float) (r >> 4) / (float) 0xfffff * 1.1f - 0.05f;
+   }
+}
+
+TEST_F(FormatSSE2, UnpackRGBARow)
+{
+   std::vector<GLuint> src(NUM_PIXELS * 2);
+   std::vector<GLfloat> c(NUM_PIXELS * 4), sse2(NUM_PIXELS * 4);
+
+   for (unsigned f = 0; f < Elements(unpack_rgba_formats); f++) {
+      const mesa_format format = unpack_rgba_formats[f];
+
+      fill_random(&src[0], src.size() * sizeof(GLuint));
+
+      _mesa_use_sse2_formats = 0;
+      _mesa_unpack_rgba_row(format, NUM_PIXELS, &src[0],
+                            (GLfloat (*)[4]) &c[0]);
+      _mesa_use_sse2_formats = 1;
+      _mesa_unpack_rgba_row(format, NUM_PIXELS, &src[0],
+                            (GLfloat (*)[4]) &sse2[0]);
+
+      EXPECT_EQ(0, memcmp(&c[0], &sse2[0], c.size() * sizeof(GLfloat)))
+         << _mesa_get_format_name(format);
+   }
+}
+
+TEST_F(FormatSSE2, UnpackAllHalfFloats)
+{
+   /* every half float value, including denorms, infinities and NaNs */
+   const unsigned n = 65536 / 4;
+   std::vector<GLushort> src(n * 4);
+   std::vector<GLfloat> c(n * 4), sse2(n * 4);
+
+   for (unsigned i = 0; i < src.size(); i++)
+      src[i] = i;
+
+   _mesa_use_sse2_formats = 0;
+   _mesa_unpack_rgba_row(MESA_FORMAT_RGBA_FLOAT16, n, &src[0],
+                         (GLfloat (*)[4]) &c[0]);
+   _mesa_use_sse2_formats = 1;
+   _mesa_unpack_rgba_row(MESA_FORMAT_RGBA_FLOAT16, n, &src[0],
+                         (GLfloat (*)[4]) &sse2[0]);
+
+   EXPECT_EQ(0, memcmp(&c[0], &sse2[0], c.size() * sizeof(GLfloat)));
+}
+
+TEST_F(FormatSSE2, UnpackFloatZRow)
+{
+   std::vector<GLuint> src(NUM_PIXELS);
+   std::vector<GLfloat> c(NUM_PIXELS), sse2(NUM_PIXELS);
+
+   for (unsigned f = 0; f < Elements(unpack_z_formats); f++) {
+      const mesa_format format = unpack_z_formats[f];
+
+      fill_random(&src[0], src.size() * sizeof(GLuint));
+      src[0] = 0;
+      src[1] = ~0u;
+
+      _mesa_use_sse2_formats = 0;
+      _mesa_unpack_float_z_row(format, NUM_PIXELS, &src[0], &c[0]);
+      _mesa_use_sse2_formats = 1;
+      _mesa_unpack_float_z_row(format, NUM_PIXELS, &src[0], &sse2[0]);
+
+      EXPECT_EQ(0, memcmp(&c[0], &sse2[0], c.size() * sizeof(GLfloat)))
+         << _mesa_get_format_name(format);
+   }
+}
+
+TEST_F(FormatSSE2, PackFloatRGBARow)
+{
+   std::vector<GLfloat> src(NUM_PIXELS * 4);
+   std::vector<GLuint> c(NUM_PIXELS + 1), sse2(NUM_PIXELS + 1);
+
+   for (unsigned f = 0; f < Elements(pack_rgba_formats); f++) {
+      const mesa_format format = pack_rgba_formats[f];
+
+      fill_pack_source((GLfloat (*)[4]) &src[0], NUM_PIXELS);
+
+      /* the word after the row must not be touched */
+      c[NUM_PIXELS] = sse2[NUM_PIXELS] = 0xdeadbeef;
+
+      _mesa_use_sse2_formats = 0;
+      _mesa_pack_float_rgba_row(format, NUM_PIXELS,
+                                (const GLfloat (*)[4]) &src[0], &c[0]);
+      _mesa_use_sse2_formats = 1;
+      _mesa_pack_float_rgba_row(format, NUM_PIXELS,
+                                (const GLfloat (*)[4]) &src[0], &sse2[0]);
+
+      EXPECT_EQ(0, memcmp(&c[0], &sse2[0], c.size() * sizeof(GLuint)))
+         << _mesa_get_format_name(format);
+   }
+}
+
+static double
+seconds(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST_F(FormatSSE2, DISABLED_Throughput)
+{
+   const unsigned width = 4096, rows = 2048;
+   std::vector<GLuint> packed(width * 2);
+   std::vector<GLfloat> rgba(width * 4);
+
+   fill_random(&packed[0], packed.size() * sizeof(GLuint));
+   fill_pack_source((GLfloat (*)[4]) &rgba[0], width);
+
+   for (unsigned f = 0; f < Elements(unpack_rgba_formats); f++) {
+      const mesa_format format = unpack_rgba_formats[f];
+      double t[2];
+
+      for (int sse2 = 0; sse2 < 2; sse2++) {
+         double start = seconds();
+
+         _mesa_use_sse2_formats = sse2;
+         for (unsigned y = 0; y < rows; y++)
+            _mesa_unpack_rgba_row(format, width, &packed[0],
+                                  (GLfloat (*)[4]) &rgba[0]);
+         t[sse2] = seconds() - start;
+      }
+
+      printf("unpack %-24s C %7.1f Mpix/s, SSE2 %7.1f Mpix/s\n",
+             _mesa_get_format_name(format),
+             width * rows / t[0] * 1e-6, width * rows / t[1] * 1e-6);
+   }
+
+   for (unsigned f = 0; f < Elements(pack_rgba_formats); f++) {
+      const mesa_format format = pack_rgba_formats[f];
+      double t[2];
+
+      fill_pack_source((GLfloat (*)[4]) &rgba[0], width);
+
+      for (int sse2 = 0; sse2 < 2; sse2++) {
+         double start = seconds();
+
+         _mesa_use_sse2_formats = sse2;
+         for (unsigned y = 0; y < rows; y++)
+            _mesa_pack_float_rgba_row(format, width,
+                                      (const GLfloat (*)[4]) &rgba[0],
+                                      &packed[0]);
+         t[sse2] = seconds() - start;
+      }
+
+      printf("pack   %-24s C %7.1f Mpix/s, SSE2 %7.1f Mpix/s\n",
+             _mesa_get_format_name(format),
+             width * rows / t[0] * 1e-6, width * rows / t[1] * 1e-6);
+   }
+}
+
+#endif /* __SSE2__ */
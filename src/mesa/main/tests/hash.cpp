@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file hash.cpp
+ *
+ * Tests for the GL object name table in hash.c, in particular the
+ * lock-free dense array used for small keys.  DISABLED_LookupThroughput
+ * measures lookups per second from several threads; run it with
+ * --gtest_also_run_disabled_tests.
+ */
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+extern "C" {
+#include "main/macros.h"
+#include "main/hash.h"
+}
+
+/* Keys on both sides of the dense array chunk and size limits */
+static const GLuint test_keys[] = {
+   1, 2, 3, 1023, 1024, 1025, 65535, 65536, 65537, 100000, 0xfffffffe
+};
+
+struct object {
+   GLuint key;
+};
+
+static void
+count_entry(GLuint key, void *data, void *userData)
+{
+   (void) key;
+   (void) data;
+   (*(unsigned *) userData)++;
+}
+
+static void
+delete_entry(GLuint key, void *data, void *userData)
+{
+   EXPECT_EQ(key, ((struct object *) data)->key);
+   (*(unsigned *) userData)++;
+}
+
+class HashTable : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void insert_all();
+
+   struct _mesa_HashTable *table;
+   struct object objects[Elements(test_keys)];
+};
+
+void
+HashTable::SetUp()
+{
+   table = _mesa_NewHashTable();
+   for (unsigned i = 0; i < Elements(test_keys); i++)
+      objects[i].key = test_keys[i];
+}
+
+void
+HashTable::TearDown()
+{
+   unsigned deleted = 0;
+
+   _mesa_HashDeleteAll(table, delete_entry, &deleted);
+   _mesa_DeleteHashTable(table);
+}
+
+void
+HashTable::insert_all()
+{
+   for (unsigned i = 0; i < Elements(test_keys); i++)
+      _mesa_HashInsert(table, test_keys[i], &objects[i]);
+}
+
+TEST_F(HashTable, InsertLookupRemove)
+{
+   insert_all();
+
+   for (unsigned i = 0; i < Elements(test_keys); i++)
+      EXPECT_EQ(&objects[i], _mesa_HashLookup(table, test_keys[i]));
+   EXPECT_EQ(Elements(test_keys), _mesa_HashNumEntries(table));
+
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 4));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 2048));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 200000));
+
+   for (unsigned i = 0; i < Elements(test_keys); i += 2)
+      _mesa_HashRemove(table, test_keys[i]);
+
+   for (unsigned i = 0; i < Elements(test_keys); i++) {
+      EXPECT_EQ(i % 2 ? &objects[i] : NULL,
+                _mesa_HashLookup(table, test_keys[i]));
+   }
+}
+
+TEST_F(HashTable, Replace)
+{
+   struct object other = { 1024 };
+
+   insert_all();
+   _mesa_HashInsert(table, 1024, &other);
+   EXPECT_EQ(&other, _mesa_HashLookup(table, 1024));
+   _mesa_HashInsert(table, 1024, &objects[4]);
+   EXPECT_EQ(&objects[4], _mesa_HashLookup(table, 1024));
+}
+
+TEST_F(HashTable, DeleteAll)
+{
+   unsigned deleted = 0;
+
+   insert_all();
+   _mesa_HashDeleteAll(table, delete_entry, &deleted);
+   EXPECT_EQ(Elements(test_keys), deleted);
+
+   for (unsigned i = 0; i < Elements(test_keys); i++)
+      EXPECT_EQ(NULL, _mesa_HashLookup(table, test_keys[i]));
+}
+
+TEST_F(HashTable, CloneAndWalk)
+{
+   struct _mesa_HashTable *clone;
+   unsigned count = 0, deleted = 0;
+
+   insert_all();
+   clone = _mesa_HashClone(table);
+
+   for (unsigned i = 0; i < Elements(test_keys); i++)
+      EXPECT_EQ(&objects[i], _mesa_HashLookup(clone, test_keys[i]));
+
+   _mesa_HashWalk(clone, count_entry, &count);
+   EXPECT_EQ(Elements(test_keys), count);
+
+   _mesa_HashDeleteAll(clone, delete_entry, &deleted);
+   _mesa_DeleteHashTable(clone);
+}
+
+
+#define NUM_KEYS 20000
+
+struct lookup_thread {
+   struct _mesa_HashTable *table;
+   GLuint firstKey, numKeys;
+   unsigned iterations;
+   unsigned bad;
+};
+
+/**
+ * Look keys up while another thread may be inserting them.  Anything
+ * found must be the fully initialized object for that key.
+ */
+static void *
+lookup_keys(void *data)
+{
+   struct lookup_thread *t = (struct lookup_thread *) data;
+
+   for (unsigned n = 0; n < t->iterations; n++) {
+      for (GLuint key = t->firstKey; key < t->firstKey + t->numKeys; key++) {
+         struct object *obj =
+            (struct object *) _mesa_HashLookup(t->table, key);
+         if (obj && obj->key != key)
+            t->bad++;
+      }
+   }
+
+   return NULL;
+}
+
+TEST_F(HashTable, ConcurrentLookups)
+{
+   struct lookup_thread t[2];
+   pthread_t threads[2];
+   unsigned deleted = 0;
+
+   /* one thread on the dense array, one on the hash table */
+   t[0].firstKey = 1;
+   t[1].firstKey = 1 << 20;
+   for (unsigned i = 0; i < 2; i++) {
+      t[i].table = table;
+      t[i].numKeys = NUM_KEYS;
+      t[i].iterations = 20;
+      t[i].bad = 0;
+      pthread_create(&threads[i], NULL, lookup_keys, &t[i]);
+   }
+
+   for (GLuint i = 1; i <= NUM_KEYS; i++) {
+      for (unsigned j = 0; j < 2; j++) {
+         struct object *obj = new struct object;
+         obj->key = t[j].firstKey + i - 1;
+         _mesa_HashInsert(table, obj->key, obj);
+      }
+   }
+
+   for (unsigned i = 0; i < 2; i++) {
+      pthread_join(threads[i], NULL);
+      EXPECT_EQ(0u, t[i].bad);
+   }
+
+   for (unsigned j = 0; j < 2; j++) {
+      for (GLuint key = t[j].firstKey; key < t[j].firstKey + NUM_KEYS; key++) {
+         struct object *obj = (struct object *) _mesa_HashLookup(table, key);
+         ASSERT_TRUE(obj != NULL);
+         EXPECT_EQ(key, obj->key);
+         _mesa_HashRemove(table, key);
+         delete obj;
+      }
+   }
+   _mesa_HashDeleteAll(table, delete_entry, &deleted);
+   EXPECT_EQ(0u, deleted);
+}
+
+static double
+seconds(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST_F(HashTable, DISABLED_LookupThroughput)
+{
+   static const struct {
+      const char *name;
+      GLuint firstKey;
+   } ranges[] = {
+      { "dense array", 1 },
+      { "hash table", 1 << 20 },
+   };
+   const GLuint numKeys = 1000;
+   std::vector<struct object> objs(2 * numKeys);
+
+   for (unsigned r = 0; r < 2; r++) {
+      for (GLuint i = 0; i < numKeys; i++) {
+         objs[r * numKeys + i].key = ranges[r].firstKey + i;
+         _mesa_HashInsert(table, ranges[r].firstKey + i,
+                          &objs[r * numKeys + i]);
+      }
+   }
+
+   for (unsigned r = 0; r < 2; r++) {
+      for (unsigned numThreads = 1; numThreads <= 8; numThreads *= 2) {
+         struct lookup_thread t[8];
+         pthread_t threads[8];
+         double start = seconds(), elapsed;
+
+         for (unsigned i = 0; i < numThreads; i++) {
+            t[i].table = table;
+            t[i].firstKey = ranges[r].firstKey;
+            t[i].numKeys = numKeys;
+            t[i].iterations = 5000;
+            t[i].bad = 0;
+            pthread_create(&threads[i], NULL, lookup_keys, &t[i]);
+         }
+         for (unsigned i = 0; i < numThreads; i++)
+            pthread_join(threads[i], NULL);
+         elapsed = seconds() - start;
+
+         printf("%-12s %u threads: %7.1f M lookups/s\n", ranges[r].name,
+                numThreads, numThreads * 5000.0 * numKeys / elapsed * 1e-6);
+      }
+   }
+
+   for (unsigned r = 0; r < 2; r++) {
+      for (GLuint i = 0; i < numKeys; i++)
+         _mesa_HashRemove(table, ranges[r].firstKey + i);
+   }
+}
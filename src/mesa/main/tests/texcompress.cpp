@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file texcompress.cpp
+ *
+ * Round trips through the built-in S3TC and RGTC encoders at both quality
+ * levels, and checks that images big enough to be compressed by several
+ * threads come out the same as when their blocks are compressed one by one.
+ * The S3TC blocks are decoded here, since decoding S3TC still needs
+ * libtxc_dxtn.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/texcompress.h"
+#include "main/texcompress_rgtc.h"
+#include "main/texcompress_s3tc.h"
+}
+
+class TexCompress : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void fill_image(GLint width, GLint height, GLint comps);
+   void compress(mesa_format format, GLenum srcFormat, GLint width,
+                 GLint height, GLint blockSize, GLenum quality);
+   unsigned color_error(GLint width, GLint height, GLint comps,
+                        GLint blockSize, GLint colorOffset);
+
+   struct gl_context *ctx;
+   struct gl_pixelstore_attrib packing;
+   std::vector<GLubyte> image;
+   std::vector<GLubyte> blocks;
+   GLint rowStride;
+};
+
+void
+TexCompress::SetUp()
+{
+   /* texstore only looks at the hint and the image transfer state */
+   ctx = (struct gl_context *) calloc(1, sizeof(struct gl_context));
+
+   /* normally set up when the first context is created */
+   for (int i = 0; i < 256; i++)
+      _mesa_ubyte_to_float_color_tab[i] = (float) i / 255.0F;
+
+   memset(&packing, 0, sizeof(packing));
+   packing.Alignment = 1;
+}
+
+void
+TexCompress::TearDown()
+{
+   free(ctx);
+}
+
+/**
+ * Smooth gradients with a few sharp edges and some noise.
+ */
+void
+TexCompress::fill_image(GLint width, GLint height, GLint comps)
+{
+   unsigned seed = 1;
+
+   image.resize(width * height * comps);
+   for (GLint y = 0; y < height; y++) {
+      for (GLint x = 0; x < width; x++) {
+         GLubyte *p = &image[(y * width + x) * comps];
+
+         seed = seed * 1103515245 + 12345;
+         p[0] = (x * 255 / width + (seed >> 16) % 8) & 0xff;
+         if (comps > 1)
+            p[1] = y * 255 / height;
+         if (comps > 2)
+            p[2] = ((x ^ y) & 32) ? 200 : 40;
+         if (comps > 3)
+            p[3] = (x * 4 + y * 6) & 0xff;
+      }
+   }
+}
+
+void
+TexCompress::compress(mesa_format format, GLenum srcFormat, GLint width,
+                      GLint height, GLint blockSize, GLenum quality)
+{
+   GLubyte *dst;
+   GLboolean ok = GL_FALSE;
+
+   ctx->Hint.TextureCompression = quality;
+   packing.RowLength = width;
+   rowStride = (width + 3) / 4 * blockSize;
+   blocks.assign(rowStride * ((height + 3) / 4), 0);
+   dst = &blocks[0];
+
+   switch (format) {
+   case MESA_FORMAT_RGB_DXT1:
+      ok = _mesa_texstore_rgb_dxt1(ctx, 2, GL_RGB, format, rowStride, &dst,
+                                   width, height, 1, srcFormat,
+                                   GL_UNSIGNED_BYTE, &image[0], &packing);
+      break;
+   case MESA_FORMAT_RGBA_DXT5:
+      ok = _mesa_texstore_rgba_dxt5(ctx, 2, GL_RGBA, format, rowStride, &dst,
+                                    width, height, 1, srcFormat,
+                                    GL_UNSIGNED_BYTE, &image[0], &packing);
+      break;
+   case MESA_FORMAT_R_RGTC1_UNORM:
+      ok = _mesa_texstore_red_rgtc1(ctx, 2, GL_RED, format, rowStride, &dst,
+                                    width, height, 1, srcFormat,
+                                    GL_UNSIGNED_BYTE, &image[0], &packing);
+      break;
+   default:
+      FAIL();
+   }
+   ASSERT_TRUE(ok);
+}
+
+static void
+unpack_565(unsigned v, int c[3])
+{
+   c[0] = ((v >> 11) << 3) | (v >> 13);
+   c[1] = (((v >> 5) & 0x3f) << 2) | ((v >> 9) & 0x3);
+   c[2] = ((v & 0x1f) << 3) | ((v >> 2) & 0x7);
+}
+
+/**
+ * Decode the color part of the DXTn blocks and return the total squared
+ * error against the image.
+ */
+unsigned
+TexCompress::color_error(GLint width, GLint height, GLint comps,
+                         GLint blockSize, GLint colorOffset)
+{
+   unsigned error = 0;
+
+   for (GLint y = 0; y < height; y++) {
+      for (GLint x = 0; x < width; x++) {
+         const GLubyte *blk = &blocks[(y / 4) * rowStride +
+                                      (x / 4) * blockSize + colorOffset];
+         const unsigned c0 = blk[0] | (blk[1] << 8), c1 = blk[2] | (blk[3] << 8);
+         const unsigned bits = blk[4] | (blk[5] << 8) | (blk[6] << 16) |
+                               ((unsigned) blk[7] << 24);
+         const unsigned index = (bits >> (2 * ((y % 4) * 4 + x % 4))) & 3;
+         int p0[3], p1[3];
+
+         unpack_565(c0, p0);
+         unpack_565(c1, p1);
+         for (int i = 0; i < 3; i++) {
+            int v;
+
+            switch (index) {
+            case 0: v = p0[i]; break;
+            case 1: v = p1[i]; break;
+            case 2: v = (2 * p0[i] + p1[i]) / 3; break;
+            default: v = (p0[i] + 2 * p1[i]) / 3; break;
+            }
+            v -= image[(y * width + x) * comps + i];
+            error += v * v;
+         }
+      }
+   }
+
+   return error;
+}
+
+TEST_F(TexCompress, DXT1Quality)
+{
+   const GLint width = 61, height = 35;
+   unsigned fastest, nicest;
+
+   fill_image(width, height, 3);
+
+   compress(MESA_FORMAT_RGB_DXT1, GL_RGB, width, height, 8, GL_FASTEST);
+   fastest = color_error(width, height, 3, 8, 0);
+   compress(MESA_FORMAT_RGB_DXT1, GL_RGB, width, height, 8, GL_NICEST);
+   nicest = color_error(width, height, 3, 8, 0);
+
+   /* RMS error per channel under 8 */
+   EXPECT_LT(fastest, 64u * width * height * 3);
+   EXPECT_LE(nicest, fastest);
+}
+
+TEST_F(TexCompress, DXT5Alpha)
+{
+   const GLint width = 30, height = 18;
+   compressed_fetch_func fetch =
+      _mesa_get_compressed_fetch_func(MESA_FORMAT_R_RGTC1_UNORM);
+
+   fill_image(width, height, 4);
+   compress(MESA_FORMAT_RGBA_DXT5, GL_RGBA, width, height, 16, GL_FASTEST);
+   EXPECT_LT(color_error(width, height, 4, 16, 8),
+             64u * width * height * 3);
+
+   /* DXT5 alpha blocks are laid out like RGTC1 blocks */
+   for (GLint y = 0; y < height; y++) {
+      for (GLint x = 0; x < width; x++) {
+         const GLubyte *blk = &blocks[(y / 4) * rowStride + (x / 4) * 16];
+         GLfloat texel[4];
+
+         fetch(blk, 4, x % 4, y % 4, texel);
+         EXPECT_NEAR(image[(y * width + x) * 4 + 3], texel[0] * 255.0F, 20.0F);
+      }
+   }
+}
+
+TEST_F(TexCompress, RGTC1Fastest)
+{
+   const GLint width = 13, height = 9;
+   compressed_fetch_func fetch =
+      _mesa_get_compressed_fetch_func(MESA_FORMAT_R_RGTC1_UNORM);
+
+   fill_image(width, height, 1);
+   compress(MESA_FORMAT_R_RGTC1_UNORM, GL_RED, width, height, 8, GL_FASTEST);
+
+   for (GLint y = 0; y < height; y++) {
+      for (GLint x = 0; x < width; x++) {
+         GLfloat texel[4];
+
+         fetch(&blocks[0], width, x, y, texel);
+         /* within half a step of the eight values between the endpoints */
+         EXPECT_NEAR(image[y * width + x], texel[0] * 255.0F, 20.0F);
+      }
+   }
+}
+
+/**
+ * A big image is compressed in bands, possibly by several threads.  Each
+ * block must come out as if it was compressed on its own.
+ */
+TEST_F(TexCompress, BandsMatchSingleBlocks)
+{
+   static const mesa_format formats[] = {
+      MESA_FORMAT_RGB_DXT1, MESA_FORMAT_RGBA_DXT5, MESA_FORMAT_R_RGTC1_UNORM
+   };
+   static const GLenum srcFormats[] = { GL_RGB, GL_RGBA, GL_RED };
+   static const GLint comps[] = { 3, 4, 1 }, blockSizes[] = { 8, 16, 8 };
+   const GLint width = 512, height = 256;
+
+   for (unsigned f = 0; f < ARRAY_SIZE(formats); f++) {
+      for (int q = 0; q < 2; q++) {
+         const GLenum quality = q ? GL_NICEST : GL_FASTEST;
+         std::vector<GLubyte> whole, texels(16 * comps[f]);
+
+         fill_image(width, height, comps[f]);
+         compress(formats[f], srcFormats[f], width, height, blockSizes[f],
+                  quality);
+         whole.swap(blocks);
+         texels.swap(image);
+
+         for (GLint by = 0; by < height / 4; by += 7) {
+            for (GLint bx = 0; bx < width / 4; bx += 5) {
+               for (GLint row = 0; row < 4; row++)
+                  memcpy(&image[row * 4 * comps[f]],
+                         &texels[((by * 4 + row) * width + bx * 4) * comps[f]],
+                         4 * comps[f]);
+               compress(formats[f], srcFormats[f], 4, 4, blockSizes[f],
+                        quality);
+               EXPECT_EQ(0, memcmp(&blocks[0],
+                                   &whole[by * (width / 4) * blockSizes[f] +
+                                          bx * blockSizes[f]],
+                                   blockSizes[f]))
+                  << "format " << f << " quality " << q
+                  << " block " << bx << "," << by;
+            }
+         }
+         image.swap(texels);
+      }
+   }
+}
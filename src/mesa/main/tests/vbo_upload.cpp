@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2014  VMware, Inc.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file vbo_upload.cpp
+ *
+ * Checks that glBegin/glEnd vertices reach the driver unchanged when vbo
+ * streams them through its persistently mapped ring buffer, including when
+ * the ring has to be orphaned.  DISABLED_Throughput measures glBegin/glEnd
+ * and client array throughput with and without the ring; run it with
+ * --gtest_also_run_disabled_tests.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+extern "C" {
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/framebuffer.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+
+#include "vbo/vbo.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+}
+
+/** Vertices (position + color) as seen by the draw function */
+static std::vector<GLfloat> drawn;
+
+/** Makes the driver report every other ring buffer fence as busy */
+static bool busy_fences;
+static unsigned num_fence_checks;
+
+static void
+append_attrib(const struct gl_client_array *array, GLuint i)
+{
+   const GLubyte *base = array->BufferObj->Name ?
+      (const GLubyte *) array->BufferObj->Data : NULL;
+   const GLfloat *v = (const GLfloat *) (base + (GLintptr) array->Ptr +
+                                         i * array->StrideB);
+
+   drawn.insert(drawn.end(), v, v + 3);
+}
+
+static void
+record_draw(struct gl_context *ctx, const struct _mesa_prim *prims,
+            GLuint nr_prims, const struct _mesa_index_buffer *ib,
+            GLboolean index_bounds_valid, GLuint min_index, GLuint max_index,
+            struct gl_transform_feedback_object *tfb_vertcount,
+            struct gl_buffer_object *indirect)
+{
+   const struct gl_client_array **arrays = ctx->Array._DrawArrays;
+
+   (void) ib;
+   for (GLuint p = 0; p < nr_prims; p++) {
+      /* Drop incomplete primitives, like drivers do.  Where those end up
+       * depends on where the vertex buffer wraps.
+       */
+      const GLuint verts_per_prim = prims[p].mode == GL_LINES ? 2 : 3;
+      const GLuint count = prims[p].count - prims[p].count % verts_per_prim;
+
+      for (GLuint i = prims[p].start; i < prims[p].start + count; i++) {
+         append_attrib(arrays[VERT_ATTRIB_POS], i);
+         append_attrib(arrays[VERT_ATTRIB_COLOR0], i);
+      }
+   }
+}
+
+static void
+update_state(struct gl_context *ctx, GLuint new_state)
+{
+}
+
+static void
+free_texture_image_buffer(struct gl_context *ctx,
+                          struct gl_texture_image *texImage)
+{
+}
+
+static void
+check_sync(struct gl_context *ctx, struct gl_sync_object *syncObj)
+{
+   syncObj->StatusFlag = busy_fences ? (++num_fence_checks & 1) : 1;
+}
+
+class VboUpload : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void create_context(bool ring);
+   void draw_immediate(unsigned num_prims);
+   void draw_arrays(unsigned num_prims);
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context *ctx;
+   struct gl_framebuffer *fb;
+};
+
+void
+VboUpload::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   _mesa_init_driver_functions(&driver_functions);
+   driver_functions.UpdateState = update_state;
+   driver_functions.CheckSync = check_sync;
+   driver_functions.FreeTextureImageBuffer = free_texture_image_buffer;
+   ctx = NULL;
+   fb = NULL;
+
+   drawn.clear();
+   busy_fences = false;
+}
+
+void
+VboUpload::TearDown()
+{
+   if (ctx) {
+      _mesa_make_current(NULL, NULL, NULL);
+      _mesa_reference_framebuffer(&fb, NULL);
+      _vbo_DestroyContext(ctx);
+      _mesa_destroy_context(ctx);
+      ctx = NULL;
+   }
+}
+
+void
+VboUpload::create_context(bool ring)
+{
+   TearDown();
+
+   ctx = _mesa_create_context(API_OPENGL_COMPAT, &visual, NULL,
+                              &driver_functions);
+   ASSERT_TRUE(ctx != NULL);
+   ctx->Version = 30;
+   ctx->Extensions.ARB_buffer_storage = ring;
+
+   _vbo_CreateContext(ctx);
+   vbo_set_draw_func(ctx, record_draw);
+   vbo_use_buffer_objects(ctx);
+   _mesa_initialize_dispatch_tables(ctx);
+   _mesa_initialize_vbo_vtxfmt(ctx);
+
+   fb = _mesa_create_framebuffer(&visual);
+   _mesa_make_current(ctx, fb, fb);
+}
+
+/**
+ * Triangles and lines of varying size, with a flush every now and then.
+ */
+void
+VboUpload::draw_immediate(unsigned num_prims)
+{
+   for (unsigned p = 0; p < num_prims; p++) {
+      const unsigned count = (p % 3) ? 3 * (1 + p % 7) : 2 * (1 + p % 5);
+
+      CALL_Begin(ctx->Exec, ((p % 3) ? GL_TRIANGLES : GL_LINES));
+      for (unsigned i = 0; i < count; i++) {
+         CALL_Color3f(ctx->Exec, ((p + i) % 2, 0.5f, 1.0f));
+         CALL_Vertex3f(ctx->Exec, (p, i, (p * i) % 5));
+      }
+      CALL_End(ctx->Exec, ());
+
+      if (p % 100 == 7)
+         ctx->Driver.FlushVertices(ctx, FLUSH_STORED_VERTICES);
+   }
+   ctx->Driver.FlushVertices(ctx, FLUSH_STORED_VERTICES);
+}
+
+/**
+ * The same amount of data as client arrays.
+ */
+void
+VboUpload::draw_arrays(unsigned num_prims)
+{
+   std::vector<GLfloat> verts(num_prims * 6 * 6);
+
+   for (unsigned i = 0; i < verts.size(); i++)
+      verts[i] = i % 7;
+
+   CALL_VertexPointer(ctx->Exec, (3, GL_FLOAT, 6 * sizeof(GLfloat),
+                                  &verts[0]));
+   CALL_ColorPointer(ctx->Exec, (3, GL_FLOAT, 6 * sizeof(GLfloat),
+                                 &verts[3]));
+   CALL_EnableClientState(ctx->Exec, (GL_VERTEX_ARRAY));
+   CALL_EnableClientState(ctx->Exec, (GL_COLOR_ARRAY));
+
+   for (unsigned p = 0; p < num_prims; p++)
+      CALL_DrawArrays(ctx->Exec, (GL_TRIANGLES, p * 6, 6));
+
+   CALL_DisableClientState(ctx->Exec, (GL_VERTEX_ARRAY));
+   CALL_DisableClientState(ctx->Exec, (GL_COLOR_ARRAY));
+}
+
+TEST_F(VboUpload, RingMatchesMapPerBatch)
+{
+   std::vector<GLfloat> expected;
+
+   create_context(false);
+   draw_immediate(5000);
+   expected.swap(drawn);
+   ASSERT_GT(expected.size(), 0u);
+
+   create_context(true);
+   draw_immediate(5000);
+   EXPECT_TRUE(expected == drawn);
+
+   /* The ring gets orphaned when the next segment is still busy */
+   drawn.clear();
+   busy_fences = true;
+   draw_immediate(5000);
+   EXPECT_TRUE(expected == drawn);
+   EXPECT_GT(num_fence_checks, 0u);
+}
+
+static double
+seconds(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST_F(VboUpload, DISABLED_Throughput)
+{
+   const unsigned num_prims = 20000, rounds = 50;
+
+   for (int ring = 0; ring < 2; ring++) {
+      double start, immediate, arrays;
+      unsigned vertices;
+
+      create_context(ring);
+
+      start = seconds();
+      for (unsigned r = 0; r < rounds; r++) {
+         drawn.clear();
+         draw_immediate(num_prims);
+      }
+      immediate = seconds() - start;
+      vertices = drawn.size() / 6;
+
+      start = seconds();
+      for (unsigned r = 0; r < rounds; r++) {
+         drawn.clear();
+         draw_arrays(num_prims);
+      }
+      arrays = seconds() - start;
+
+      printf("%-16s glBegin/glEnd %6.2f Mvert/s, client arrays %6.2f Mvert/s\n",
+             ring ? "ring buffer" : "map per batch",
+             vertices * rounds / immediate * 1e-6,
+             num_prims * 6.0 * rounds / arrays * 1e-6);
+   }
+}
@@ -35,6 +35,7 @@
 #include "colormac.h"
 #include "context.h"
 #include "formats.h"
+#include "macros.h"
 #include "mtypes.h"
 #include "context.h"
 #include "texcompress.h"
@@ -625,3 +626,25 @@ _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
       }
    }
 }
+
+
+/** Minimum number of blocks per thread for threaded texture compression */
+#define COMPRESS_MIN_BLOCKS_PER_THREAD 4096
+
+/**
+ * Compress an image by calling func on bands of its block rows, in
+ * parallel if the image is big enough to be worth the cost of starting
+ * threads.  Encoding a block only depends on the block's own texels, so
+ * the bands are independent.  Returns when all of them are done.
+ *
+ * \param numRows  number of block rows in the image
+ * \param blocksPerRow  number of blocks in each row, to size the bands
+ */
+void
+_mesa_compress_block_rows(compress_rows_func func, void *data,
+                          GLint numRows, GLint blocksPerRow)
+{
+   _mesa_process_row_bands(func, data, numRows,
+                           numRows * blocksPerRow /
+                           COMPRESS_MIN_BLOCKS_PER_THREAD);
+}
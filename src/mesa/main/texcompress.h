@@ -27,6 +27,7 @@
 
 #include "formats.h"
 #include "glheader.h"
+#include "rowbands.h"
 
 struct gl_context;
 
@@ -58,6 +59,17 @@ extern compressed_fetch_func
 _mesa_get_compressed_fetch_func(mesa_format format);
 
 
+/**
+ * Callback for _mesa_compress_block_rows(): compress numRows rows of
+ * blocks, starting with block row firstRow.
+ */
+typedef row_band_func compress_rows_func;
+
+extern void
+_mesa_compress_block_rows(compress_rows_func func, void *data,
+                          GLint numRows, GLint blocksPerRow);
+
+
 extern void
 _mesa_decompress_image(mesa_format format, GLuint width, GLuint height,
                        const GLubyte *src, GLint srcRowStride,
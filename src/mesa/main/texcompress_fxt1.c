@@ -1275,14 +1275,52 @@ upscale_teximage2d(GLsizei inWidth, GLsizei inHeight,
 }
 
 
+/**
+ * An image being encoded by fxt1_encode_rows().
+ */
+struct fxt1_image
+{
+   const GLubyte *data;
+   GLuint width;
+   GLint comps;
+   GLint srcRowStride;
+   GLuint *encoded;
+   GLint destRowStride;         /**< GLuints between rows of blocks */
+};
+
+
+static void
+fxt1_encode_rows(void *data, GLint firstRow, GLint numRows)
+{
+   const struct fxt1_image *img = (const struct fxt1_image *) data;
+   GLuint x, y;
+   GLuint *encoded = img->encoded + firstRow * img->destRowStride;
+
+   for (y = firstRow * 4; y < (firstRow + numRows) * 4; y += 4) {
+      GLuint offs = 0 + (y + 0) * img->srcRowStride;
+      GLuint *blk = encoded;
+      for (x = 0; x < img->width; x += 8) {
+         const GLubyte *lines[4];
+         lines[0] = &img->data[offs];
+         lines[1] = lines[0] + img->srcRowStride;
+         lines[2] = lines[1] + img->srcRowStride;
+         lines[3] = lines[2] + img->srcRowStride;
+         offs += 8 * img->comps;
+         fxt1_quantize(blk, lines, img->comps);
+         /* 128 bits per 8x4 block */
+         blk += 4;
+      }
+      encoded += img->destRowStride;
+   }
+}
+
+
 static void
 fxt1_encode (GLuint width, GLuint height, GLint comps,
              const void *source, GLint srcRowStride,
              void *dest, GLint destRowStride)
 {
-   GLuint x, y;
-   const GLubyte *data;
-   GLuint *encoded = (GLuint *)dest;
+   struct fxt1_image img;
    void *newSource = NULL;
 
    assert(comps == 3 || comps == 4);
@@ -1306,23 +1344,16 @@ fxt1_encode (GLuint width, GLuint height, GLint comps,
       srcRowStride = comps * newWidth;
    }
 
-   data = (const GLubyte *) source;
-   destRowStride = (destRowStride - width * 2) / 4;
-   for (y = 0; y < height; y += 4) {
-      GLuint offs = 0 + (y + 0) * srcRowStride;
-      for (x = 0; x < width; x += 8) {
-         const GLubyte *lines[4];
-         lines[0] = &data[offs];
-         lines[1] = lines[0] + srcRowStride;
-         lines[2] = lines[1] + srcRowStride;
-         lines[3] = lines[2] + srcRowStride;
-         offs += 8 * comps;
-         fxt1_quantize(encoded, lines, comps);
-         /* 128 bits per 8x4 block */
-         encoded += 4;
-      }
-      encoded += destRowStride;
-   }
+   img.data = (const GLubyte *) source;
+   img.width = width;
+   img.comps = comps;
+   img.srcRowStride = srcRowStride;
+   img.encoded = (GLuint *) dest;
+   /* the blocks of a row take width * 2 bytes */
+   img.destRowStride = width / 2 + (destRowStride - width * 2) / 4;
+
+   /* the blocks are independent, so rows of them are encoded in parallel */
+   _mesa_compress_block_rows(fxt1_encode_rows, &img, height / 4, width / 8);
 
  cleanUp:
    free(newSource);
@@ -86,17 +86,180 @@ static void extractsrc_s( GLbyte srcpixels[4][4], const GLfloat *srcaddr,
 }
 
 
+/**
+ * Quick RGTC block encoder, for GL_FASTEST.  The endpoints are the lowest
+ * and highest values in the block and each texel gets the nearest of the
+ * eight values from one to the other.
+ */
+static void
+encode_rgtc_fast(GLubyte *blkaddr, const GLint values[16])
+{
+   GLint lo = values[0], hi = values[0];
+   uint64_t bits = 0;
+   GLint k;
+
+   for (k = 1; k < 16; k++) {
+      lo = MIN2(lo, values[k]);
+      hi = MAX2(hi, values[k]);
+   }
+
+   if (hi > lo) {
+      const GLint range = hi - lo;
+
+      for (k = 0; k < 16; k++) {
+         /* 0 for lo ... 7 for hi, rounded */
+         const GLint t = ((values[k] - lo) * 14 + range) / (2 * range);
+         const uint64_t code = t == 7 ? 0 : t == 0 ? 1 : 8 - t;
+
+         bits |= code << (3 * k);
+      }
+   }
+
+   /* alpha0 > alpha1 selects the eight value mode, signed or not */
+   blkaddr[0] = (GLubyte) hi;
+   blkaddr[1] = (GLubyte) lo;
+   for (k = 0; k < 6; k++)
+      blkaddr[2 + k] = (GLubyte) (bits >> (8 * k));
+}
+
+static void unsigned_encode_rgtc_fast(GLubyte *blkaddr, GLubyte srccolors[4][4],
+				      GLint numxpixels, GLint numypixels)
+{
+   GLint values[16], i, j;
+
+   /* replicate the edge texels of partial blocks */
+   for (j = 0; j < 4; j++)
+      for (i = 0; i < 4; i++)
+	 values[j * 4 + i] = srccolors[MIN2(j, numypixels - 1)][MIN2(i, numxpixels - 1)];
+
+   encode_rgtc_fast(blkaddr, values);
+}
+
+static void signed_encode_rgtc_fast(GLbyte *blkaddr, GLbyte srccolors[4][4],
+				    GLint numxpixels, GLint numypixels)
+{
+   GLint values[16], i, j;
+
+   for (j = 0; j < 4; j++)
+      for (i = 0; i < 4; i++)
+	 values[j * 4 + i] = srccolors[MIN2(j, numypixels - 1)][MIN2(i, numxpixels - 1)];
+
+   encode_rgtc_fast((GLubyte *) blkaddr, values);
+}
+
+
+/**
+ * Encode one block of unsigned RGTC1 data.  This is also the layout of
+ * DXT5 alpha blocks.
+ * \param quality  GL_FASTEST, GL_NICEST or GL_DONT_CARE
+ */
+void
+_mesa_encode_rgtc1_block(GLubyte *blkaddr, GLubyte srccolors[4][4],
+                         GLint numxpixels, GLint numypixels, GLenum quality)
+{
+   if (quality == GL_FASTEST)
+      unsigned_encode_rgtc_fast(blkaddr, srccolors, numxpixels, numypixels);
+   else
+      unsigned_encode_rgtc_ubyte(blkaddr, srccolors, numxpixels, numypixels);
+}
+
+
+/**
+ * An image being compressed by compress_rgtc_rows().
+ */
+struct rgtc_image
+{
+   const GLubyte *ubytes;       /**< source image, unsigned formats */
+   const GLfloat *floats;       /**< source image, signed formats */
+   GLint width, height;
+   GLint comps;                 /**< 1 for RGTC1/LATC1, 2 for RGTC2/LATC2 */
+   GLubyte *dst;
+   GLint dstRowStride;          /**< bytes per row of blocks */
+   GLenum quality;
+};
+
+
+static void
+compress_rgtc_rows(void *data, GLint firstRow, GLint numRows)
+{
+   const struct rgtc_image *img = (const struct rgtc_image *) data;
+   const GLint endRow = MIN2(img->height, (firstRow + numRows) * 4);
+   GLint i, j, c;
+   int numxpixels, numypixels;
+
+   for (j = firstRow * 4; j < endRow; j += 4) {
+      GLubyte *blkaddr = img->dst + (j / 4) * img->dstRowStride;
+
+      if (img->height > j + 3) numypixels = 4;
+      else numypixels = img->height - j;
+      for (i = 0; i < img->width; i += 4) {
+	 const GLint offset = (j * img->width + i) * img->comps;
+
+	 if (img->width > i + 3) numxpixels = 4;
+	 else numxpixels = img->width - i;
+
+	 /* RGTC2 is two RGTC1 blocks, red first */
+	 for (c = 0; c < img->comps; c++) {
+	    if (img->floats) {
+	       GLbyte srcpixels[4][4];
+
+	       extractsrc_s(srcpixels, img->floats + offset + c, img->width,
+			    numxpixels, numypixels, img->comps);
+	       if (img->quality == GL_FASTEST)
+		  signed_encode_rgtc_fast((GLbyte *) blkaddr, srcpixels,
+					  numxpixels, numypixels);
+	       else
+		  signed_encode_rgtc_ubyte((GLbyte *) blkaddr, srcpixels,
+					   numxpixels, numypixels);
+	    }
+	    else {
+	       GLubyte srcpixels[4][4];
+
+	       extractsrc_u(srcpixels, img->ubytes + offset + c, img->width,
+			    numxpixels, numypixels, img->comps);
+	       _mesa_encode_rgtc1_block(blkaddr, srcpixels,
+					numxpixels, numypixels, img->quality);
+	    }
+	    blkaddr += 8;
+	 }
+      }
+   }
+}
+
+
+/**
+ * Compress a temporary image, ubyte for unsigned formats and float for
+ * signed ones, with bands of block rows encoded in parallel.
+ */
+static void
+compress_rgtc(struct gl_context *ctx,
+              const GLubyte *ubytes, const GLfloat *floats,
+              GLint width, GLint height, GLint comps,
+              GLubyte *dst, GLint dstRowStride)
+{
+   struct rgtc_image img;
+
+   img.ubytes = ubytes;
+   img.floats = floats;
+   img.width = width;
+   img.height = height;
+   img.comps = comps;
+   img.dst = dst;
+   /* a stride shorter than a row of texels means tightly packed rows */
+   img.dstRowStride = dstRowStride >= width * 2 * comps ?
+      dstRowStride : ((width + 3) & ~3) * 2 * comps;
+   img.quality = ctx->Hint.TextureCompression;
+
+   _mesa_compress_block_rows(compress_rgtc_rows, &img, (height + 3) / 4,
+                             (width + 3) / 4 * comps);
+}
+
+
 GLboolean
 _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 {
-   GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff;
+
    ASSERT(dstFormat == MESA_FORMAT_R_RGTC1_UNORM ||
           dstFormat == MESA_FORMAT_L_LATC1_UNORM);
 
@@ -109,24 +272,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(ctx, tempImage, NULL, srcWidth, srcHeight, 1,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -136,14 +283,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff;
+
    ASSERT(dstFormat == MESA_FORMAT_R_RGTC1_SNORM ||
           dstFormat == MESA_FORMAT_L_LATC1_SNORM);
 
@@ -156,24 +297,8 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(ctx, NULL, tempImage, srcWidth, srcHeight, 1,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -183,14 +308,7 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff;
 
    ASSERT(dstFormat == MESA_FORMAT_RG_RGTC2_UNORM ||
           dstFormat == MESA_FORMAT_LA_LATC2_UNORM);
@@ -204,30 +322,8 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-	 extractsrc_u(srcpixels, (GLubyte *)srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(ctx, tempImage, NULL, srcWidth, srcHeight, 2,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -237,14 +333,7 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff;
 
    ASSERT(dstFormat == MESA_FORMAT_RG_RGTC2_SNORM ||
           dstFormat == MESA_FORMAT_LA_LATC2_SNORM);
@@ -258,31 +347,8 @@ _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j += 4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 extractsrc_s(srcpixels, srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-
-      }
-      blkaddr += dstRowDiff;
-   }
+   compress_rgtc(ctx, NULL, tempImage, srcWidth, srcHeight, 2,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
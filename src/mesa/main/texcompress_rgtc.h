@@ -40,6 +40,10 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS);
 extern GLboolean
 _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS);
 
+extern void
+_mesa_encode_rgtc1_block(GLubyte *blkaddr, GLubyte srccolors[4][4],
+                         GLint numxpixels, GLint numypixels, GLenum quality);
+
 extern compressed_fetch_func
 _mesa_get_compressed_rgtc_func(mesa_format format);
 
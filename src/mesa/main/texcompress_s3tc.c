@@ -41,10 +41,15 @@
 #include "macros.h"
 #include "mtypes.h"
 #include "texcompress.h"
+#include "texcompress_rgtc.h"
 #include "texcompress_s3tc.h"
 #include "texstore.h"
 #include "format_unpack.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 #if defined(_WIN32) || defined(WIN32)
 #define DXTN_LIBNAME "dxtn.dll"
@@ -124,6 +129,590 @@ _mesa_init_texture_s3tc( struct gl_context *ctx )
 #endif
 }
 
+
+/*
+ * Built-in DXTn encoder.
+ *
+ * This is used for GL_FASTEST and when libtxc_dxtn isn't available.  The
+ * fast mode takes the (slightly inset) bounding box of the block's colors
+ * as the endpoints.  Otherwise the endpoints are the extremes along the
+ * colors' principal axis, refined once by least squares.
+ */
+
+
+/** Convert an 8-bit RGB color to RGB565, rounding */
+static GLushort
+pack_565(const GLint c[3])
+{
+   const GLint r = (CLAMP(c[0], 0, 255) * 31 + 127) / 255;
+   const GLint g = (CLAMP(c[1], 0, 255) * 63 + 127) / 255;
+   const GLint b = (CLAMP(c[2], 0, 255) * 31 + 127) / 255;
+
+   return (GLushort) ((r << 11) | (g << 5) | b);
+}
+
+
+/** Expand an RGB565 color to 8 bits per channel, like the decoder does */
+static void
+unpack_565(GLushort v, GLint c[3])
+{
+   const GLint r = v >> 11, g = (v >> 5) & 0x3f, b = v & 0x1f;
+
+   c[0] = (r << 3) | (r >> 2);
+   c[1] = (g << 2) | (g >> 4);
+   c[2] = (b << 3) | (b >> 2);
+}
+
+
+/**
+ * Build the palette of a DXTn color block.
+ * \return number of colors: 4, or 3 for the DXT1 mode with transparency
+ */
+static GLuint
+color_palette(GLushort c0, GLushort c1, GLboolean fourColors,
+              GLint palette[4][3])
+{
+   GLuint i;
+
+   unpack_565(c0, palette[0]);
+   unpack_565(c1, palette[1]);
+
+   for (i = 0; i < 3; i++) {
+      if (fourColors) {
+         palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+         palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+      }
+      else {
+         palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+         palette[3][i] = 0;
+      }
+   }
+
+   return fourColors ? 4 : 3;
+}
+
+
+static void
+write_color_block(GLubyte *blkaddr, GLushort c0, GLushort c1, GLuint bits)
+{
+   blkaddr[0] = c0 & 0xff;
+   blkaddr[1] = c0 >> 8;
+   blkaddr[2] = c1 & 0xff;
+   blkaddr[3] = c1 >> 8;
+   blkaddr[4] = bits & 0xff;
+   blkaddr[5] = (bits >> 8) & 0xff;
+   blkaddr[6] = (bits >> 16) & 0xff;
+   blkaddr[7] = bits >> 24;
+}
+
+
+/**
+ * Encode a color block with the given endpoints, picking the nearest
+ * palette color for each texel.
+ *
+ * \param transparent  mask of texels to encode as transparent, which
+ *                     selects DXT1's three color mode
+ * \param indices  returns the palette index of each texel
+ * \return the total squared error
+ */
+static GLuint
+encode_color_endpoints(GLubyte *blkaddr, GLubyte block[16][4],
+                       GLuint transparent,
+                       const GLint end0[3], const GLint end1[3],
+                       GLubyte indices[16])
+{
+   GLushort c0 = pack_565(end0), c1 = pack_565(end1);
+   GLint palette[4][3];
+   GLuint numColors, bits = 0, error = 0, k;
+
+   /* c0 > c1 selects four colors, c0 <= c1 three and transparency */
+   if (transparent ? c0 > c1 : c0 < c1) {
+      const GLushort tmp = c0;
+      c0 = c1;
+      c1 = tmp;
+   }
+
+   numColors = color_palette(c0, c1, !transparent, palette);
+   if (c0 == c1)
+      numColors = 1;
+
+   for (k = 0; k < 16; k++) {
+      GLuint best = 0, bestError = ~0u, i;
+
+      if (transparent & (1 << k)) {
+         best = 3;
+         bestError = 0;
+      }
+      else {
+         for (i = 0; i < numColors; i++) {
+            const GLint dr = block[k][0] - palette[i][0];
+            const GLint dg = block[k][1] - palette[i][1];
+            const GLint db = block[k][2] - palette[i][2];
+            const GLuint e = dr * dr + dg * dg + db * db;
+
+            if (e < bestError) {
+               best = i;
+               bestError = e;
+            }
+         }
+      }
+
+      indices[k] = best;
+      bits |= best << (2 * k);
+      error += bestError;
+   }
+
+   write_color_block(blkaddr, c0, c1, bits);
+
+   return error;
+}
+
+
+/**
+ * Endpoints for GL_FASTEST: the bounding box of the colors, inset by a
+ * sixteenth of its size so that the extremes don't pull the palette out.
+ */
+static void
+bbox_endpoints(GLubyte block[16][4], GLuint transparent,
+               GLint hi[3], GLint lo[3])
+{
+   GLuint i, k;
+
+   for (i = 0; i < 3; i++) {
+      hi[i] = 0;
+      lo[i] = 255;
+   }
+
+   for (k = 0; k < 16; k++) {
+      if (transparent & (1 << k))
+         continue;
+      for (i = 0; i < 3; i++) {
+         hi[i] = MAX2(hi[i], block[k][i]);
+         lo[i] = MIN2(lo[i], block[k][i]);
+      }
+   }
+
+   for (i = 0; i < 3; i++) {
+      const GLint inset = (hi[i] - lo[i]) >> 4;
+
+      hi[i] -= inset;
+      lo[i] += inset;
+   }
+}
+
+
+/**
+ * Endpoints for GL_NICEST: the colors' extremes along their principal
+ * axis, found by power iteration on the covariance matrix.
+ */
+static void
+pca_endpoints(GLubyte block[16][4], GLuint transparent,
+              GLint hi[3], GLint lo[3])
+{
+   GLfloat mean[3] = { 0.0F, 0.0F, 0.0F }, cov[6] = { 0.0F };
+   GLfloat axis[3], tmin = 0.0F, tmax = 0.0F;
+   GLuint count = 0, i, k;
+
+   for (k = 0; k < 16; k++) {
+      if (transparent & (1 << k))
+         continue;
+      for (i = 0; i < 3; i++)
+         mean[i] += block[k][i];
+      count++;
+   }
+   for (i = 0; i < 3; i++)
+      mean[i] /= count;
+
+   for (k = 0; k < 16; k++) {
+      GLfloat d[3];
+
+      if (transparent & (1 << k))
+         continue;
+      for (i = 0; i < 3; i++)
+         d[i] = block[k][i] - mean[i];
+      cov[0] += d[0] * d[0];
+      cov[1] += d[0] * d[1];
+      cov[2] += d[0] * d[2];
+      cov[3] += d[1] * d[1];
+      cov[4] += d[1] * d[2];
+      cov[5] += d[2] * d[2];
+   }
+
+   /* start from the bounding box diagonal, which is usually close */
+   bbox_endpoints(block, transparent, hi, lo);
+   for (i = 0; i < 3; i++)
+      axis[i] = (GLfloat) (hi[i] - lo[i]) + 1.0F;
+
+   for (k = 0; k < 8; k++) {
+      const GLfloat x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+      const GLfloat y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+      const GLfloat z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+      const GLfloat len = MAX3(FABSF(x), FABSF(y), FABSF(z));
+
+      if (len == 0.0F)
+         return;   /* all colors are equal, keep the bounding box */
+      axis[0] = x / len;
+      axis[1] = y / len;
+      axis[2] = z / len;
+   }
+
+   for (k = 0; k < 16; k++) {
+      GLfloat t = 0.0F;
+
+      if (transparent & (1 << k))
+         continue;
+      for (i = 0; i < 3; i++)
+         t += (block[k][i] - mean[i]) * axis[i];
+      tmin = MIN2(tmin, t);
+      tmax = MAX2(tmax, t);
+   }
+
+   {
+      const GLfloat len2 = axis[0] * axis[0] + axis[1] * axis[1] +
+                           axis[2] * axis[2];
+
+      for (i = 0; i < 3; i++) {
+         hi[i] = IROUND(mean[i] + tmax * axis[i] / len2);
+         lo[i] = IROUND(mean[i] + tmin * axis[i] / len2);
+      }
+   }
+}
+
+
+/**
+ * Least squares fit of the endpoints of a four color block to the texels,
+ * given the palette indices chosen for them.
+ * \return false if the fit is degenerate
+ */
+static GLboolean
+refine_endpoints(GLubyte block[16][4], const GLubyte indices[16],
+                 const GLubyte *blkaddr, GLint end0[3], GLint end1[3])
+{
+   /* weight of color 0 for each index */
+   static const GLfloat weight[4] = { 1.0F, 0.0F, 2.0F / 3.0F, 1.0F / 3.0F };
+   GLfloat aa = 0.0F, ab = 0.0F, bb = 0.0F, det;
+   GLfloat pa[3] = { 0.0F, 0.0F, 0.0F }, pb[3] = { 0.0F, 0.0F, 0.0F };
+   GLuint i, k;
+
+   /* indices refer to the endpoints in the order they were written */
+   if (blkaddr[0] == blkaddr[2] && blkaddr[1] == blkaddr[3])
+      return GL_FALSE;
+
+   for (k = 0; k < 16; k++) {
+      const GLfloat a = weight[indices[k]], b = 1.0F - a;
+
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (i = 0; i < 3; i++) {
+         pa[i] += a * block[k][i];
+         pb[i] += b * block[k][i];
+      }
+   }
+
+   det = aa * bb - ab * ab;
+   if (FABSF(det) < 1e-6F)
+      return GL_FALSE;
+
+   for (i = 0; i < 3; i++) {
+      end0[i] = IROUND((bb * pa[i] - ab * pb[i]) / det);
+      end1[i] = IROUND((aa * pb[i] - ab * pa[i]) / det);
+   }
+
+   return GL_TRUE;
+}
+
+
+#ifdef __SSE2__
+
+/**
+ * SSE2 version of the GL_FASTEST encoding of an opaque color block.  Does
+ * exactly what bbox_endpoints() and encode_color_endpoints() do.
+ */
+static void
+encode_color_block_fast_sse2(GLubyte *blkaddr, GLubyte block[16][4])
+{
+   const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+   const __m128i zero = _mm_setzero_si128();
+   __m128i texels[4], lo, hi, palette[4];
+   GLint end0[3], end1[3], pal[4][3];
+   GLushort c0, c1;
+   GLuint bits = 0, i, k;
+
+   for (k = 0; k < 4; k++)
+      texels[k] = _mm_and_si128(_mm_loadu_si128((const __m128i *) block + k),
+                                rgbMask);
+
+   lo = _mm_min_epu8(_mm_min_epu8(texels[0], texels[1]),
+                     _mm_min_epu8(texels[2], texels[3]));
+   hi = _mm_max_epu8(_mm_max_epu8(texels[0], texels[1]),
+                     _mm_max_epu8(texels[2], texels[3]));
+   lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+   hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+   lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+   hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+
+   {
+      const GLuint l = _mm_cvtsi128_si32(lo), h = _mm_cvtsi128_si32(hi);
+
+      for (i = 0; i < 3; i++) {
+         const GLint lc = (l >> (8 * i)) & 0xff, hc = (h >> (8 * i)) & 0xff;
+         const GLint inset = (hc - lc) >> 4;
+
+         end0[i] = hc - inset;
+         end1[i] = lc + inset;
+      }
+   }
+
+   /* the bounding box corners are ordered, so c0 >= c1 */
+   c0 = pack_565(end0);
+   c1 = pack_565(end1);
+   if (c0 == c1) {
+      write_color_block(blkaddr, c0, c1, 0);
+      return;
+   }
+
+   color_palette(c0, c1, GL_TRUE, pal);
+   for (i = 0; i < 4; i++)
+      palette[i] = _mm_set1_epi32(pal[i][0] | (pal[i][1] << 8) |
+                                  (pal[i][2] << 16));
+
+   for (k = 0; k < 4; k++) {
+      __m128i best = zero, index = zero;
+
+      for (i = 0; i < 4; i++) {
+         /* squared distance of four texels to palette color i */
+         const __m128i d = _mm_or_si128(_mm_subs_epu8(texels[k], palette[i]),
+                                        _mm_subs_epu8(palette[i], texels[k]));
+         const __m128i dlo = _mm_unpacklo_epi8(d, zero);
+         const __m128i dhi = _mm_unpackhi_epi8(d, zero);
+         const __m128 slo = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));
+         const __m128 shi = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+         const __m128i dist = _mm_add_epi32(
+            _mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(3, 1, 3, 1))));
+
+         if (i == 0) {
+            best = dist;
+         }
+         else {
+            const __m128i closer = _mm_cmplt_epi32(dist, best);
+
+            best = _mm_or_si128(_mm_and_si128(closer, dist),
+                                _mm_andnot_si128(closer, best));
+            index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(i)),
+                                 _mm_andnot_si128(closer, index));
+         }
+      }
+
+      /* gather the four 2-bit indices, two from each 64-bit half */
+      index = _mm_or_si128(index, _mm_srli_epi64(index, 30));
+      bits |= ((_mm_cvtsi128_si32(index) & 0xf) |
+               ((_mm_cvtsi128_si32(_mm_srli_si128(index, 8)) & 0xf) << 4))
+              << (8 * k);
+   }
+
+   write_color_block(blkaddr, c0, c1, bits);
+}
+
+#endif
+
+
+/**
+ * Encode the colors of a block of texels.
+ * \param punchThrough  encode texels with alpha < 128 as transparent
+ */
+static void
+encode_color_block(GLubyte *blkaddr, GLubyte block[16][4],
+                   GLboolean punchThrough, GLenum quality)
+{
+   GLuint transparent = 0, error, k;
+   GLubyte indices[16];
+   GLint end0[3], end1[3];
+
+   if (punchThrough) {
+      for (k = 0; k < 16; k++) {
+         if (block[k][3] < 128)
+            transparent |= 1 << k;
+      }
+      if (transparent == 0xffff) {
+         write_color_block(blkaddr, 0, 0, ~0u);
+         return;
+      }
+   }
+
+   if (quality == GL_FASTEST) {
+#ifdef __SSE2__
+      if (!transparent) {
+         encode_color_block_fast_sse2(blkaddr, block);
+         return;
+      }
+#endif
+      bbox_endpoints(block, transparent, end0, end1);
+      encode_color_endpoints(blkaddr, block, transparent, end0, end1, indices);
+      return;
+   }
+
+   pca_endpoints(block, transparent, end0, end1);
+   error = encode_color_endpoints(blkaddr, block, transparent,
+                                  end0, end1, indices);
+
+   if (!transparent && error > 0 &&
+       refine_endpoints(block, indices, blkaddr, end0, end1)) {
+      GLubyte refined[8];
+
+      if (encode_color_endpoints(refined, block, 0, end0, end1,
+                                 indices) < error)
+         memcpy(blkaddr, refined, sizeof(refined));
+   }
+}
+
+
+/** DXT3 alpha: four bits per texel */
+static void
+encode_explicit_alpha_block(GLubyte *blkaddr, GLubyte block[16][4])
+{
+   GLuint k;
+
+   for (k = 0; k < 16; k += 2) {
+      const GLuint a0 = (block[k][3] * 15 + 127) / 255;
+      const GLuint a1 = (block[k + 1][3] * 15 + 127) / 255;
+
+      blkaddr[k / 2] = a0 | (a1 << 4);
+   }
+}
+
+
+/**
+ * Encode an RGB or RGBA ubyte image to DXTn, like tx_compress_dxtn() does.
+ * Partial blocks at the right and bottom edges replicate the last texels.
+ */
+static void
+encode_dxtn(GLint srccomps, GLint width, GLint height,
+            const GLubyte *srcPixData, GLenum destFormat,
+            GLubyte *dest, GLint dstRowStride, GLenum quality)
+{
+   GLint i, j, k;
+
+   for (j = 0; j < height; j += 4) {
+      const GLint numypixels = MIN2(height - j, 4);
+      GLubyte *blkaddr = dest + (j / 4) * dstRowStride;
+
+      for (i = 0; i < width; i += 4) {
+         const GLint numxpixels = MIN2(width - i, 4);
+         GLubyte block[16][4];
+
+         for (k = 0; k < 16; k++) {
+            const GLint x = i + MIN2(k % 4, numxpixels - 1);
+            const GLint y = j + MIN2(k / 4, numypixels - 1);
+            const GLubyte *src = srcPixData + (y * width + x) * srccomps;
+
+            block[k][0] = src[0];
+            block[k][1] = src[1];
+            block[k][2] = src[2];
+            block[k][3] = srccomps == 4 ? src[3] : 255;
+         }
+
+         switch (destFormat) {
+         case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            encode_color_block(blkaddr, block, GL_FALSE, quality);
+            blkaddr += 8;
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            encode_color_block(blkaddr, block, GL_TRUE, quality);
+            blkaddr += 8;
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            encode_explicit_alpha_block(blkaddr, block);
+            encode_color_block(blkaddr + 8, block, GL_FALSE, quality);
+            blkaddr += 16;
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            {
+               GLubyte alpha[4][4];
+
+               for (k = 0; k < 16; k++)
+                  alpha[k / 4][k % 4] = block[k][3];
+               _mesa_encode_rgtc1_block(blkaddr, alpha, 4, 4, quality);
+               encode_color_block(blkaddr + 8, block, GL_FALSE, quality);
+            }
+            blkaddr += 16;
+            break;
+         default:
+            assert(!"bad DXTn format");
+            return;
+         }
+      }
+   }
+}
+
+
+/**
+ * An image being compressed by compress_dxtn_rows().
+ */
+struct dxtn_image
+{
+   const GLubyte *pixels;
+   GLint comps;
+   GLint width, height;
+   GLenum format;
+   GLubyte *dst;
+   GLint dstRowStride;          /**< bytes per row of blocks */
+   GLenum quality;
+};
+
+
+static void
+compress_dxtn_rows(void *data, GLint firstRow, GLint numRows)
+{
+   const struct dxtn_image *img = (const struct dxtn_image *) data;
+   const GLubyte *pixels =
+      img->pixels + firstRow * 4 * img->width * img->comps;
+   GLubyte *dst = img->dst + firstRow * img->dstRowStride;
+   const GLint height = MIN2(numRows * 4, img->height - firstRow * 4);
+
+   /* libtxc_dxtn only has locals, so it's fine to call it from threads */
+   if (ext_tx_compress_dxtn && img->quality != GL_FASTEST) {
+      (*ext_tx_compress_dxtn)(img->comps, img->width, height, pixels,
+                              img->format, dst, img->dstRowStride);
+   }
+   else {
+      encode_dxtn(img->comps, img->width, height, pixels,
+                  img->format, dst, img->dstRowStride, img->quality);
+   }
+}
+
+
+/**
+ * Compress a tightly packed RGB or RGBA ubyte image, with bands of block
+ * rows encoded in parallel.  GL_TEXTURE_COMPRESSION_HINT picks the
+ * encoder: libtxc_dxtn if it's there, unless the hint is GL_FASTEST.
+ */
+static void
+compress_dxtn(struct gl_context *ctx, GLint comps, GLint width, GLint height,
+              const GLubyte *pixels, GLenum format,
+              GLubyte *dst, GLint dstRowStride)
+{
+   const GLint blockSize = (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ||
+                            format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+   struct dxtn_image img;
+
+   img.pixels = pixels;
+   img.comps = comps;
+   img.width = width;
+   img.height = height;
+   img.format = format;
+   img.dst = dst;
+   /* as in libtxc_dxtn, a stride shorter than a row means tightly packed */
+   img.dstRowStride = dstRowStride >= width * blockSize / 4 ?
+      dstRowStride : (width + 3) / 4 * blockSize;
+   img.quality = ctx->Hint.TextureCompression;
+
+   _mesa_compress_block_rows(compress_dxtn_rows, &img, (height + 3) / 4,
+                             (width + 3) / 4);
+}
+
+
 /**
  * Store user's image in rgb_dxt1 format.
  */
@@ -161,14 +750,8 @@ _mesa_texstore_rgb_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(3, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgb_dxt1");
-   }
+   compress_dxtn(ctx, 3, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGB_S3TC_DXT1_EXT, dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -213,14 +796,8 @@ _mesa_texstore_rgba_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgba_dxt1");
-   }
+   compress_dxtn(ctx, 4, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, dst, dstRowStride);
 
    free((void*) tempImage);
 
@@ -264,14 +841,8 @@ _mesa_texstore_rgba_dxt3(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgba_dxt3");
-   }
+   compress_dxtn(ctx, 4, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -315,14 +886,8 @@ _mesa_texstore_rgba_dxt5(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgba_dxt5");
-   }
+   compress_dxtn(ctx, 4, srcWidth, srcHeight, pixels,
+                 GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, dst, dstRowStride);
 
    free((void *) tempImage);
 
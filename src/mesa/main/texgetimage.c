@@ -40,6 +40,7 @@
 #include "mtypes.h"
 #include "pack.h"
 #include "pbo.h"
+#include "streaming-load-memcpy.h"
 #include "texcompress.h"
 #include "texgetimage.h"
 #include "teximage.h"
@@ -594,13 +595,14 @@ get_tex_memcpy(struct gl_context *ctx, GLenum format, GLenum type,
                                   GL_MAP_READ_BIT, &src, &srcRowStride);
 
       if (src) {
+         /* the texture may be mapped uncached or write-combined */
          if (bytesPerRow == dstRowStride && bytesPerRow == srcRowStride) {
-            memcpy(dst, src, bytesPerRow * texImage->Height);
+            _mesa_memcpy_from_wc(dst, src, bytesPerRow * texImage->Height);
          }
          else {
             GLuint row;
             for (row = 0; row < texImage->Height; row++) {
-               memcpy(dst, src, bytesPerRow);
+               _mesa_memcpy_from_wc(dst, src, bytesPerRow);
                dst += dstRowStride;
                src += srcRowStride;
             }
@@ -721,13 +723,13 @@ _mesa_get_compressed_teximage(struct gl_context *ctx,
                                                      texImage->Width,
                                                      texImage->Height,
                                                      texImage->Depth);
-         memcpy(img, src, size);
+         _mesa_memcpy_from_wc(img, src, size);
       }
       else {
          GLuint bw, bh;
          _mesa_get_format_block_size(texImage->TexFormat, &bw, &bh);
          for (i = 0; i < (texImage->Height + bh - 1) / bh; i++) {
-            memcpy((GLubyte *)img + i * row_stride,
+            _mesa_memcpy_from_wc((GLubyte *)img + i * row_stride,
                    (GLubyte *)src + i * srcRowStride,
                    row_stride);
          }
@@ -736,15 +736,15 @@ _mesa_get_current_tex_object(struct gl_context *ctx, GLenum target)
       case GL_TEXTURE_1D:
          return texUnit->CurrentTex[TEXTURE_1D_INDEX];
       case GL_PROXY_TEXTURE_1D:
-         return ctx->Texture.ProxyTex[TEXTURE_1D_INDEX];
+         return _mesa_get_proxy_tex_object(ctx, TEXTURE_1D_INDEX);
       case GL_TEXTURE_2D:
          return texUnit->CurrentTex[TEXTURE_2D_INDEX];
       case GL_PROXY_TEXTURE_2D:
-         return ctx->Texture.ProxyTex[TEXTURE_2D_INDEX];
+         return _mesa_get_proxy_tex_object(ctx, TEXTURE_2D_INDEX);
       case GL_TEXTURE_3D:
          return texUnit->CurrentTex[TEXTURE_3D_INDEX];
       case GL_PROXY_TEXTURE_3D:
-         return ctx->Texture.ProxyTex[TEXTURE_3D_INDEX];
+         return _mesa_get_proxy_tex_object(ctx, TEXTURE_3D_INDEX);
       case GL_TEXTURE_CUBE_MAP_POSITIVE_X_ARB:
       case GL_TEXTURE_CUBE_MAP_NEGATIVE_X_ARB:
       case GL_TEXTURE_CUBE_MAP_POSITIVE_Y_ARB:
@@ -756,27 +756,32 @@ _mesa_get_current_tex_object(struct gl_context *ctx, GLenum target)
                 ? texUnit->CurrentTex[TEXTURE_CUBE_INDEX] : NULL;
       case GL_PROXY_TEXTURE_CUBE_MAP_ARB:
          return ctx->Extensions.ARB_texture_cube_map
-                ? ctx->Texture.ProxyTex[TEXTURE_CUBE_INDEX] : NULL;
+                ? _mesa_get_proxy_tex_object(ctx, TEXTURE_CUBE_INDEX) : NULL;
       case GL_TEXTURE_CUBE_MAP_ARRAY:
          return ctx->Extensions.ARB_texture_cube_map_array
                 ? texUnit->CurrentTex[TEXTURE_CUBE_ARRAY_INDEX] : NULL;
       case GL_PROXY_TEXTURE_CUBE_MAP_ARRAY:
          return ctx->Extensions.ARB_texture_cube_map_array
-                ? ctx->Texture.ProxyTex[TEXTURE_CUBE_ARRAY_INDEX] : NULL;
+                ? _mesa_get_proxy_tex_object(ctx, TEXTURE_CUBE_ARRAY_INDEX)
+                : NULL;
       case GL_TEXTURE_RECTANGLE_NV:
          return ctx->Extensions.NV_texture_rectangle
                 ? texUnit->CurrentTex[TEXTURE_RECT_INDEX] : NULL;
       case GL_PROXY_TEXTURE_RECTANGLE_NV:
          return ctx->Extensions.NV_texture_rectangle
-                ? ctx->Texture.ProxyTex[TEXTURE_RECT_INDEX] : NULL;
+                ? _mesa_get_proxy_tex_object(ctx, TEXTURE_RECT_INDEX) : NULL;
       case GL_TEXTURE_1D_ARRAY_EXT:
          return arrayTex ? texUnit->CurrentTex[TEXTURE_1D_ARRAY_INDEX] : NULL;
       case GL_PROXY_TEXTURE_1D_ARRAY_EXT:
-         return arrayTex ? ctx->Texture.ProxyTex[TEXTURE_1D_ARRAY_INDEX] : NULL;
+         return arrayTex
+                ? _mesa_get_proxy_tex_object(ctx, TEXTURE_1D_ARRAY_INDEX)
+                : NULL;
       case GL_TEXTURE_2D_ARRAY_EXT:
          return arrayTex ? texUnit->CurrentTex[TEXTURE_2D_ARRAY_INDEX] : NULL;
       case GL_PROXY_TEXTURE_2D_ARRAY_EXT:
-         return arrayTex ? ctx->Texture.ProxyTex[TEXTURE_2D_ARRAY_INDEX] : NULL;
+         return arrayTex
+                ? _mesa_get_proxy_tex_object(ctx, TEXTURE_2D_ARRAY_INDEX)
+                : NULL;
       case GL_TEXTURE_BUFFER:
          return ctx->API == API_OPENGL_CORE &&
                 ctx->Extensions.ARB_texture_buffer_object ?
@@ -789,13 +794,16 @@ _mesa_get_current_tex_object(struct gl_context *ctx, GLenum target)
             ? texUnit->CurrentTex[TEXTURE_2D_MULTISAMPLE_INDEX] : NULL;
       case GL_PROXY_TEXTURE_2D_MULTISAMPLE:
          return ctx->Extensions.ARB_texture_multisample
-            ? ctx->Texture.ProxyTex[TEXTURE_2D_MULTISAMPLE_INDEX] : NULL;
+            ? _mesa_get_proxy_tex_object(ctx, TEXTURE_2D_MULTISAMPLE_INDEX)
+            : NULL;
       case GL_TEXTURE_2D_MULTISAMPLE_ARRAY:
          return ctx->Extensions.ARB_texture_multisample
             ? texUnit->CurrentTex[TEXTURE_2D_MULTISAMPLE_ARRAY_INDEX] : NULL;
       case GL_PROXY_TEXTURE_2D_MULTISAMPLE_ARRAY:
          return ctx->Extensions.ARB_texture_multisample
-            ? ctx->Texture.ProxyTex[TEXTURE_2D_MULTISAMPLE_ARRAY_INDEX] : NULL;
+            ? _mesa_get_proxy_tex_object(ctx,
+                                         TEXTURE_2D_MULTISAMPLE_ARRAY_INDEX)
+            : NULL;
       default:
          _mesa_problem(NULL, "bad target in _mesa_get_current_tex_object()");
          return NULL;
@@ -869,8 +877,9 @@ _mesa_get_tex_image(struct gl_context *ctx, struct gl_texture_object *texObj,
 static struct gl_texture_image *
 get_proxy_tex_image(struct gl_context *ctx, GLenum target, GLint level)
 {
+   struct gl_texture_object *proxy;
    struct gl_texture_image *texImage;
-   GLuint texIndex;
+   gl_texture_index texIndex;
 
    if (level < 0)
       return NULL;
@@ -930,16 +939,20 @@ get_proxy_tex_image(struct gl_context *ctx, GLenum target, GLint level)
       return NULL;
    }
 
-   texImage = ctx->Texture.ProxyTex[texIndex]->Image[0][level];
+   proxy = _mesa_get_proxy_tex_object(ctx, texIndex);
+   if (!proxy)
+      return NULL;
+
+   texImage = proxy->Image[0][level];
    if (!texImage) {
       texImage = ctx->Driver.NewTextureImage(ctx);
       if (!texImage) {
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "proxy texture allocation");
          return NULL;
       }
-      ctx->Texture.ProxyTex[texIndex]->Image[0][level] = texImage;
+      proxy->Image[0][level] = texImage;
       /* Set the 'back' pointer */
-      texImage->TexObject = ctx->Texture.ProxyTex[texIndex];
+      texImage->TexObject = proxy;
    }
    return texImage;
 }
@@ -3166,7 +3179,8 @@ teximage(struct gl_context *ctx, GLboolean compressed, GLuint dims,
    }
 
    texObj = _mesa_get_current_tex_object(ctx, target);
-   assert(texObj);
+   if (!texObj)
+      return; /* out of memory allocating the proxy, error was recorded */
 
    if (compressed) {
       /* For glCompressedTexImage() the driver has no choice about the
@@ -4259,6 +4273,9 @@ texbufferrange(struct gl_context *ctx, GLenum target, GLenum internalFormat,
    _mesa_lock_texture(ctx, texObj);
    {
       _mesa_reference_buffer_object(ctx, &texObj->BufferObject, bufObj);
+      /* Shader image stores may write to the buffer. */
+      if (bufObj)
+         bufObj->GPUWritable = GL_TRUE;
       texObj->BufferObjectFormat = internalFormat;
       texObj->_BufferObjectFormat = format;
       texObj->BufferOffset = offset;
@@ -4417,6 +4434,8 @@ teximagemultisample(GLuint dims, GLenum target, GLsizei samples,
    }
 
    texObj = _mesa_get_current_tex_object(ctx, target);
+   if (!texObj && _mesa_is_proxy_texture(target))
+      return; /* out of memory allocating the proxy, error was recorded */
 
    if (immutable && (!texObj || (texObj->Name == 0))) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
@@ -1358,6 +1358,8 @@ _mesa_GetTexLevelParameteriv( GLenum target, GLint level,
    }
 
    texObj = _mesa_get_current_tex_object(ctx, target);
+   if (!texObj)
+      return; /* out of memory allocating the proxy, error was recorded */
 
    if (target == GL_TEXTURE_BUFFER)
       get_tex_level_parameter_buffer(ctx, texObj, pname, params);
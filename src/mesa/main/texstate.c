@@ -682,17 +682,15 @@ _mesa_update_texture( struct gl_context *ctx, GLuint new_state )
 /**********************************************************************/
 
 /**
- * Allocate the proxy textures for the given context.
- * 
- * \param ctx the context to allocate proxies for.
- * 
- * \return GL_TRUE on success, or GL_FALSE on failure
- * 
- * If run out of memory part way through the allocations, clean up and return
- * GL_FALSE.
+ * Return the context's proxy texture object for a texture target index,
+ * creating it on first use.  Most applications never use proxy textures
+ * so they're not allocated at context creation time.
+ *
+ * \return the proxy texture object, or NULL if out of memory (in which
+ *         case GL_OUT_OF_MEMORY has been recorded).
  */
-static GLboolean
-alloc_proxy_textures( struct gl_context *ctx )
+struct gl_texture_object *
+_mesa_get_proxy_tex_object(struct gl_context *ctx, gl_texture_index index)
 {
    /* NOTE: these values must be in the same order as the TEXTURE_x_INDEX
     * values!
@@ -711,25 +709,23 @@ alloc_proxy_textures( struct gl_context *ctx )
       GL_TEXTURE_2D,
       GL_TEXTURE_1D,
    };
-   GLint tgt;
 
    STATIC_ASSERT(Elements(targets) == NUM_TEXTURE_TARGETS);
    assert(targets[TEXTURE_2D_INDEX] == GL_TEXTURE_2D);
    assert(targets[TEXTURE_CUBE_INDEX] == GL_TEXTURE_CUBE_MAP);
-
-   for (tgt = 0; tgt < NUM_TEXTURE_TARGETS; tgt++) {
-      if (!(ctx->Texture.ProxyTex[tgt]
-            = ctx->Driver.NewTextureObject(ctx, 0, targets[tgt]))) {
-         /* out of memory, free what we did allocate */
-         while (--tgt >= 0) {
-            ctx->Driver.DeleteTexture(ctx, ctx->Texture.ProxyTex[tgt]);
-         }
-         return GL_FALSE;
+   assert(index < NUM_TEXTURE_TARGETS);
+
+   if (!ctx->Texture.ProxyTex[index]) {
+      ctx->Texture.ProxyTex[index] =
+         ctx->Driver.NewTextureObject(ctx, 0, targets[index]);
+      if (!ctx->Texture.ProxyTex[index]) {
+         _mesa_error(ctx, GL_OUT_OF_MEMORY, "proxy texture allocation");
+         return NULL;
       }
+      assert(ctx->Texture.ProxyTex[index]->RefCount == 1); /* sanity check */
    }
 
-   assert(ctx->Texture.ProxyTex[0]->RefCount == 1); /* sanity check */
-   return GL_TRUE;
+   return ctx->Texture.ProxyTex[index];
 }
 
 
@@ -814,9 +810,7 @@ _mesa_init_texture(struct gl_context *ctx)
    assert(ctx->Shared->DefaultTex[TEXTURE_1D_INDEX]->RefCount
           >= MAX_COMBINED_TEXTURE_IMAGE_UNITS + 1);
 
-   /* Allocate proxy textures */
-   if (!alloc_proxy_textures( ctx ))
-      return GL_FALSE;
+   /* Proxy textures are allocated by _mesa_get_proxy_tex_object() */
 
    /* GL_ARB_texture_buffer_object */
    _mesa_reference_buffer_object(ctx, &ctx->Texture.BufferObject,
@@ -845,8 +839,10 @@ _mesa_free_texture_data(struct gl_context *ctx)
    }
 
    /* Free proxy texture objects */
-   for (tgt = 0; tgt < NUM_TEXTURE_TARGETS; tgt++)
-      ctx->Driver.DeleteTexture(ctx, ctx->Texture.ProxyTex[tgt]);
+   for (tgt = 0; tgt < NUM_TEXTURE_TARGETS; tgt++) {
+      if (ctx->Texture.ProxyTex[tgt])
+         ctx->Driver.DeleteTexture(ctx, ctx->Texture.ProxyTex[tgt]);
+   }
 
    /* GL_ARB_texture_buffer_object */
    _mesa_reference_buffer_object(ctx, &ctx->Texture.BufferObject, NULL);
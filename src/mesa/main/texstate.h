@@ -54,6 +54,9 @@ _mesa_copy_texture_state( const struct gl_context *src, struct gl_context *dst )
 extern void
 _mesa_print_texunit_state( struct gl_context *ctx, GLuint unit );
 
+extern struct gl_texture_object *
+_mesa_get_proxy_tex_object(struct gl_context *ctx, gl_texture_index index);
+
 
 
 /**
@@ -318,6 +318,8 @@ tex_storage_error_check(struct gl_context *ctx, GLuint dims, GLenum target,
 
    /* non-default texture object check */
    texObj = _mesa_get_current_tex_object(ctx, target);
+   if (!texObj && _mesa_is_proxy_texture(target))
+      return GL_TRUE; /* out of memory allocating the proxy */
    if (!_mesa_is_proxy_texture(target) && (!texObj || (texObj->Name == 0))) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
                   "glTexStorage%uD(texture object 0)", dims);
@@ -366,7 +368,8 @@ texstorage(GLuint dims, GLenum target, GLsizei levels, GLenum internalformat,
    }
 
    texObj = _mesa_get_current_tex_object(ctx, target);
-   assert(texObj);
+   if (!texObj)
+      return; /* out of memory allocating the proxy, error was recorded */
 
    texFormat = _mesa_choose_texture_format(ctx, texObj, target, 0,
                                            internalformat, GL_NONE, GL_NONE);
@@ -422,116 +422,6 @@ _mesa_make_temp_float_image(struct gl_context *ctx, GLuint dims,
 }
 
 
-/**
- * Make temporary image with uint pixel values.  Used for unsigned
- * integer-valued textures.
- */
-static GLuint *
-make_temp_uint_image(struct gl_context *ctx, GLuint dims,
-                     GLenum logicalBaseFormat,
-                     GLenum textureBaseFormat,
-                     GLint srcWidth, GLint srcHeight, GLint srcDepth,
-                     GLenum srcFormat, GLenum srcType,
-                     const GLvoid *srcAddr,
-                     const struct gl_pixelstore_attrib *srcPacking)
-{
-   GLuint *tempImage;
-   const GLint components = _mesa_components_in_format(logicalBaseFormat);
-   const GLint srcStride =
-      _mesa_image_row_stride(srcPacking, srcWidth, srcFormat, srcType);
-   GLuint *dst;
-   GLint img, row;
-
-   ASSERT(dims >= 1 && dims <= 3);
-
-   ASSERT(logicalBaseFormat == GL_RGBA ||
-          logicalBaseFormat == GL_RGB ||
-          logicalBaseFormat == GL_RG ||
-          logicalBaseFormat == GL_RED ||
-          logicalBaseFormat == GL_LUMINANCE_ALPHA ||
-          logicalBaseFormat == GL_LUMINANCE ||
-          logicalBaseFormat == GL_INTENSITY ||
-          logicalBaseFormat == GL_ALPHA);
-
-   ASSERT(textureBaseFormat == GL_RGBA ||
-          textureBaseFormat == GL_RGB ||
-          textureBaseFormat == GL_RG ||
-          textureBaseFormat == GL_RED ||
-          textureBaseFormat == GL_LUMINANCE_ALPHA ||
-          textureBaseFormat == GL_LUMINANCE ||
-          textureBaseFormat == GL_INTENSITY ||
-          textureBaseFormat == GL_ALPHA);
-
-   tempImage = malloc(srcWidth * srcHeight * srcDepth
-                                 * components * sizeof(GLuint));
-   if (!tempImage)
-      return NULL;
-
-   dst = tempImage;
-   for (img = 0; img < srcDepth; img++) {
-      const GLubyte *src
-	 = (const GLubyte *) _mesa_image_address(dims, srcPacking, srcAddr,
-						 srcWidth, srcHeight,
-						 srcFormat, srcType,
-						 img, 0, 0);
-      for (row = 0; row < srcHeight; row++) {
-	 _mesa_unpack_color_span_uint(ctx, srcWidth, logicalBaseFormat,
-                                      dst, srcFormat, srcType, src,
-                                      srcPacking);
-	 dst += srcWidth * components;
-	 src += srcStride;
-      }
-   }
-
-   if (logicalBaseFormat != textureBaseFormat) {
-      /* more work */
-      GLint texComponents = _mesa_components_in_format(textureBaseFormat);
-      GLint logComponents = _mesa_components_in_format(logicalBaseFormat);
-      GLuint *newImage;
-      GLint i, n;
-      GLubyte map[6];
-
-      /* we only promote up to RGB, RGBA and LUMINANCE_ALPHA formats for now */
-      ASSERT(textureBaseFormat == GL_RGB || textureBaseFormat == GL_RGBA ||
-             textureBaseFormat == GL_LUMINANCE_ALPHA);
-
-      /* The actual texture format should have at least as many components
-       * as the logical texture format.
-       */
-      ASSERT(texComponents >= logComponents);
-
-      newImage = malloc(srcWidth * srcHeight * srcDepth
-                                   * texComponents * sizeof(GLuint));
-      if (!newImage) {
-         free(tempImage);
-         return NULL;
-      }
-
-      compute_component_mapping(logicalBaseFormat, textureBaseFormat, map);
-
-      n = srcWidth * srcHeight * srcDepth;
-      for (i = 0; i < n; i++) {
-         GLint k;
-         for (k = 0; k < texComponents; k++) {
-            GLint j = map[k];
-            if (j == ZERO)
-               newImage[i * texComponents + k] = 0;
-            else if (j == ONE)
-               newImage[i * texComponents + k] = 1;
-            else
-               newImage[i * texComponents + k] = tempImage[i * logComponents + j];
-         }
-      }
-
-      free(tempImage);
-      tempImage = newImage;
-   }
-
-   return tempImage;
-}
-
-
-
 /**
  * Make a temporary (color) texture image with GLubyte components.
  * Apply all needed pixel unpacking and pixel transfer operations.
@@ -662,6 +552,239 @@ _mesa_make_temp_ubyte_image(struct gl_context *ctx, GLuint dims,
 }
 
 
+/**
+ * Texstore functions consume the unpacked source image a row at a time, so
+ * rather than building a temporary copy of the whole image as the
+ * _mesa_make_temp_*_image() functions do, unpack it in batches of rows
+ * which fit in the cache.  Peak memory use is independent of the image size
+ * and each batch is still cache-hot when it gets packed into the texture.
+ */
+#define TEXSTORE_BATCH_BYTES (64 * 1024)
+
+struct texstore_unpacker
+{
+   struct gl_context *ctx;
+   GLuint dims;
+   GLenum type;                 /**< GL_FLOAT, GL_UNSIGNED_INT or _BYTE */
+   GLenum logicalBaseFormat;
+   GLenum textureBaseFormat;
+   GLint srcWidth, srcHeight;
+   GLenum srcFormat, srcType;
+   const GLvoid *srcAddr;
+   const struct gl_pixelstore_attrib *srcPacking;
+   GLbitfield transferOps;
+   GLint srcStride;
+   GLint logComponents, texComponents;
+   GLubyte map[6];
+
+   GLubyte *logRows;            /**< rows in logicalBaseFormat */
+   GLubyte *texRows;            /**< rows in textureBaseFormat */
+   GLint texRowBytes;
+   GLint maxRows;               /**< rows per batch */
+
+   GLint img, firstRow, numRows; /**< the batch currently unpacked */
+};
+
+
+/**
+ * Set up the unpacking of a source image to rows of GLfloat, GLuint or
+ * GLubyte components in textureBaseFormat.  See _mesa_make_temp_float_image
+ * for the parameters.  transferOps don't apply to GL_UNSIGNED_INT.
+ *
+ * \return GL_FALSE if out of memory
+ */
+static GLboolean
+texstore_unpack_init(struct texstore_unpacker *u, GLenum type,
+                     struct gl_context *ctx, GLuint dims,
+                     GLenum logicalBaseFormat,
+                     GLenum textureBaseFormat,
+                     GLint srcWidth, GLint srcHeight, GLint srcDepth,
+                     GLenum srcFormat, GLenum srcType,
+                     const GLvoid *srcAddr,
+                     const struct gl_pixelstore_attrib *srcPacking,
+                     GLbitfield transferOps)
+{
+   const GLint typeSize = type == GL_UNSIGNED_BYTE ? 1 : 4;
+
+   ASSERT(dims >= 1 && dims <= 3);
+   ASSERT(type == GL_FLOAT || type == GL_UNSIGNED_INT ||
+          type == GL_UNSIGNED_BYTE);
+   (void) srcDepth;
+
+   memset(u, 0, sizeof(*u));
+   u->ctx = ctx;
+   u->dims = dims;
+   u->type = type;
+   u->logicalBaseFormat = logicalBaseFormat;
+   u->textureBaseFormat = textureBaseFormat;
+   u->srcWidth = srcWidth;
+   u->srcHeight = srcHeight;
+   u->srcFormat = srcFormat;
+   u->srcType = srcType;
+   u->srcAddr = srcAddr;
+   u->srcPacking = srcPacking;
+   u->transferOps = transferOps;
+   u->srcStride =
+      _mesa_image_row_stride(srcPacking, srcWidth, srcFormat, srcType);
+   u->logComponents = _mesa_components_in_format(logicalBaseFormat);
+   u->texComponents = _mesa_components_in_format(textureBaseFormat);
+   u->texRowBytes = srcWidth * u->texComponents * typeSize;
+   u->maxRows = CLAMP(TEXSTORE_BATCH_BYTES / MAX2(u->texRowBytes, 1),
+                      1, MAX2(srcHeight, 1));
+   u->img = -1;
+
+   u->texRows = malloc(u->maxRows * u->texRowBytes);
+   if (!u->texRows)
+      return GL_FALSE;
+
+   if (logicalBaseFormat != textureBaseFormat) {
+      /* we only promote up to RGB, RGBA and LUMINANCE_ALPHA formats for now */
+      ASSERT(textureBaseFormat == GL_RGB || textureBaseFormat == GL_RGBA ||
+             textureBaseFormat == GL_LUMINANCE_ALPHA);
+
+      /* The actual texture format should have at least as many components
+       * as the logical texture format.
+       */
+      ASSERT(u->texComponents >= u->logComponents);
+
+      compute_component_mapping(logicalBaseFormat, textureBaseFormat, u->map);
+
+      u->logRows = malloc(u->maxRows * srcWidth * u->logComponents * typeSize);
+      if (!u->logRows) {
+         free(u->texRows);
+         return GL_FALSE;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+
+static void
+texstore_unpack_finish(struct texstore_unpacker *u)
+{
+   free(u->logRows);
+   free(u->texRows);
+}
+
+
+/**
+ * Promote n pixels from logicalBaseFormat to textureBaseFormat.
+ */
+#define REMAP_COMPONENTS(TYPE, ONE_VAL)                                 \
+   do {                                                                 \
+      const TYPE *src = (const TYPE *) u->logRows;                      \
+      TYPE *dst = (TYPE *) u->texRows;                                  \
+      for (i = 0; i < n; i++) {                                         \
+         for (k = 0; k < texComponents; k++) {                          \
+            const GLint j = u->map[k];                                  \
+            if (j == ZERO)                                              \
+               dst[k] = 0;                                              \
+            else if (j == ONE)                                          \
+               dst[k] = ONE_VAL;                                        \
+            else                                                        \
+               dst[k] = src[j];                                         \
+         }                                                              \
+         src += logComponents;                                          \
+         dst += texComponents;                                          \
+      }                                                                 \
+   } while (0)
+
+static void
+texstore_unpack_batch(struct texstore_unpacker *u, GLint img, GLint firstRow)
+{
+   const GLint logComponents = u->logComponents;
+   const GLint texComponents = u->texComponents;
+   const GLint logRowBytes = u->texRowBytes / texComponents * logComponents;
+   GLubyte *dst = u->logRows ? u->logRows : u->texRows;
+   const GLubyte *src;
+   GLint row, i, k, n;
+
+   u->img = img;
+   u->firstRow = firstRow;
+   u->numRows = MIN2(u->maxRows, u->srcHeight - firstRow);
+
+   src = (const GLubyte *) _mesa_image_address(u->dims, u->srcPacking,
+                                               u->srcAddr,
+                                               u->srcWidth, u->srcHeight,
+                                               u->srcFormat, u->srcType,
+                                               img, firstRow, 0);
+
+   for (row = 0; row < u->numRows; row++) {
+      switch (u->type) {
+      case GL_FLOAT:
+         _mesa_unpack_color_span_float(u->ctx, u->srcWidth,
+                                       u->logicalBaseFormat, (GLfloat *) dst,
+                                       u->srcFormat, u->srcType, src,
+                                       u->srcPacking, u->transferOps);
+         break;
+      case GL_UNSIGNED_INT:
+         _mesa_unpack_color_span_uint(u->ctx, u->srcWidth,
+                                      u->logicalBaseFormat, (GLuint *) dst,
+                                      u->srcFormat, u->srcType, src,
+                                      u->srcPacking);
+         break;
+      default:
+         _mesa_unpack_color_span_ubyte(u->ctx, u->srcWidth,
+                                       u->logicalBaseFormat, dst,
+                                       u->srcFormat, u->srcType, src,
+                                       u->srcPacking, u->transferOps);
+         break;
+      }
+      dst += logRowBytes;
+      src += u->srcStride;
+   }
+
+   if (!u->logRows)
+      return;
+
+   n = u->numRows * u->srcWidth;
+   switch (u->type) {
+   case GL_FLOAT:
+      REMAP_COMPONENTS(GLfloat, 1.0F);
+      break;
+   case GL_UNSIGNED_INT:
+      REMAP_COMPONENTS(GLuint, 1);
+      break;
+   default:
+      REMAP_COMPONENTS(GLubyte, 255);
+      break;
+   }
+}
+
+#undef REMAP_COMPONENTS
+
+
+/**
+ * Return the unpacked source rows starting at the given row of the given
+ * image.  Rows are expected to be requested in order.
+ *
+ * \param numRows  returns the number of consecutive rows available
+ */
+static const void *
+texstore_unpack_rows(struct texstore_unpacker *u, GLint img, GLint row,
+                     GLint *numRows)
+{
+   if (img != u->img || row < u->firstRow ||
+       row >= u->firstRow + u->numRows)
+      texstore_unpack_batch(u, img, row);
+
+   *numRows = u->firstRow + u->numRows - row;
+   return u->texRows + (row - u->firstRow) * u->texRowBytes;
+}
+
+
+/**
+ * Return a single unpacked source row.
+ */
+static const void *
+texstore_unpack_row(struct texstore_unpacker *u, GLint img, GLint row)
+{
+   GLint numRows;
+   return texstore_unpack_rows(u, img, row, &numRows);
+}
+
+
 /**
  * Copy GLubyte pixels from <src> to <dst> with swizzling.
  * \param dst  destination pixels
@@ -976,26 +1099,27 @@ static GLboolean
 store_ubyte_texture(TEXSTORE_PARAMS)
 {
    const GLint srcRowStride = srcWidth * 4 * sizeof(GLubyte);
-   GLubyte *tempImage, *src;
-   GLint img;
-
-   tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                           baseInternalFormat,
-                                           GL_RGBA,
-                                           srcWidth, srcHeight, srcDepth,
-                                           srcFormat, srcType, srcAddr,
-                                           srcPacking);
-   if (!tempImage)
+   struct texstore_unpacker unpack;
+   const GLubyte *src;
+   GLint img, row, numRows;
+
+   if (!texstore_unpack_init(&unpack, GL_UNSIGNED_BYTE, ctx, dims,
+                             baseInternalFormat, GL_RGBA,
+                             srcWidth, srcHeight, srcDepth,
+                             srcFormat, srcType, srcAddr, srcPacking,
+                             ctx->_ImageTransferState))
       return GL_FALSE;
 
-   src = tempImage;
    for (img = 0; img < srcDepth; img++) {
-      _mesa_pack_ubyte_rgba_rect(dstFormat, srcWidth, srcHeight,
-                                 src, srcRowStride,
-                                 dstSlices[img], dstRowStride);
-      src += srcHeight * srcRowStride;
+      for (row = 0; row < srcHeight; row += numRows) {
+         src = texstore_unpack_rows(&unpack, img, row, &numRows);
+         _mesa_pack_ubyte_rgba_rect(dstFormat, srcWidth, numRows,
+                                    src, srcRowStride,
+                                    dstSlices[img] + row * dstRowStride,
+                                    dstRowStride);
+      }
    }
-   free(tempImage);
+   texstore_unpack_finish(&unpack);
 
    return GL_TRUE;
 }
@@ -1533,22 +1657,20 @@ _mesa_texstore_argb2101010(TEXSTORE_PARAMS)
       /* general path */
       /* Hardcode GL_RGBA as the base format, which forces alpha to 1.0
        * if the internal format is RGB. */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 GL_RGBA,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, GL_RGBA, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          if (baseInternalFormat == GL_RGBA || baseInternalFormat == GL_RGB) {
             for (row = 0; row < srcHeight; row++) {
                GLuint *dstUI = (GLuint *) dstRow;
+               src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
                for (col = 0; col < srcWidth; col++) {
                   GLushort a,r,g,b;
 
@@ -1565,7 +1687,7 @@ _mesa_texstore_argb2101010(TEXSTORE_PARAMS)
             ASSERT(0);
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1584,20 +1706,19 @@ _mesa_texstore_unorm44(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLubyte *tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking);
-      const GLubyte *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLubyte *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_BYTE, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLubyte *dstUS = (GLubyte *) dstRow;
+            src = (const GLubyte *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                /* src[0] is luminance, src[1] is alpha */
                dstUS[col] = PACK_COLOR_44( src[1],
@@ -1607,7 +1728,7 @@ _mesa_texstore_unorm44(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1673,20 +1794,19 @@ _mesa_texstore_unorm88(TEXSTORE_PARAMS)
    }   
    else {
       /* general path */
-      const GLubyte *tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking);
-      const GLubyte *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLubyte *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_BYTE, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLushort *dstUS = (GLushort *) dstRow;
+            src = (const GLubyte *) texstore_unpack_row(&unpack, img, row);
             if (dstFormat == MESA_FORMAT_L8A8_UNORM ||
 		dstFormat == MESA_FORMAT_R8G8_UNORM) {
                for (col = 0; col < srcWidth; col++) {
@@ -1707,7 +1827,7 @@ _mesa_texstore_unorm88(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1729,21 +1849,19 @@ _mesa_texstore_unorm1616(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstUI = (GLuint *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             if (dstFormat == MESA_FORMAT_L16A16_UNORM ||
 		dstFormat == MESA_FORMAT_R16G16_UNORM) {
                for (col = 0; col < srcWidth; col++) {
@@ -1768,7 +1886,7 @@ _mesa_texstore_unorm1616(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1788,21 +1906,19 @@ _mesa_texstore_unorm16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLushort *dstUS = (GLushort *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
 	    for (col = 0; col < srcWidth; col++) {
 	       GLushort r;
 
@@ -1813,7 +1929,7 @@ _mesa_texstore_unorm16(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1830,23 +1946,21 @@ _mesa_texstore_rgba_16(TEXSTORE_PARAMS)
       /* general path */
       /* Hardcode GL_RGBA as the base format, which forces alpha to 1.0
        * if the internal format is RGB. */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 GL_RGBA,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
 
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, GL_RGBA, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
 
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLushort *dstUS = (GLushort *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                GLushort r, g, b, a;
 
@@ -1863,7 +1977,7 @@ _mesa_texstore_rgba_16(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1880,27 +1994,25 @@ _mesa_texstore_signed_rgba_16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       const GLuint comps = _mesa_get_format_bytes(dstFormat) / 2;
       GLint img, row, col;
 
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
 
-      /* Note: tempImage is always float[4] / RGBA.  We convert to 1, 2,
-       * 3 or 4 components/pixel here.
+      /* Note: the unpacked rows are always float[4] / RGBA.  We convert
+       * to 1, 2, 3 or 4 components/pixel here.
        */
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLshort *dstRowS = (GLshort *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             if (dstFormat == MESA_FORMAT_RGBA_SNORM16) {
                for (col = 0; col < srcWidth; col++) {
                   GLuint c;
@@ -1941,7 +2053,7 @@ _mesa_texstore_signed_rgba_16(TEXSTORE_PARAMS)
             }
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -1990,27 +2102,25 @@ _mesa_texstore_unorm8(TEXSTORE_PARAMS)
    }   
    else {
       /* general path */
-      const GLubyte *tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking);
-      const GLubyte *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLubyte *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_BYTE, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            src = (const GLubyte *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                dstRow[col] = src[col];
             }
             dstRow += dstRowStride;
-            src += srcWidth;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2104,36 +2214,25 @@ _mesa_texstore_dudv8(TEXSTORE_PARAMS)
       const GLint components = _mesa_components_in_format(baseInternalFormat);
       const GLint srcStride = _mesa_image_row_stride(srcPacking, srcWidth,
                                                      srcFormat, srcType);
-      GLbyte *tempImage, *dst, *src;
+      GLbyte *dst, *src;
       GLint row;
 
-      tempImage = malloc(srcWidth * srcHeight * srcDepth
-                                          * components * sizeof(GLbyte));
-      if (!tempImage)
-         return GL_FALSE;
+      /* the unpacked texels are the texture's, so unpack in place */
+      ASSERT(components * sizeof(GLbyte) == texelBytes);
 
       src = (GLbyte *) _mesa_image_address(dims, srcPacking, srcAddr,
                                            srcWidth, srcHeight,
                                            srcFormat, srcType,
                                            0, 0, 0);
 
-      dst = tempImage;
+      dst = (GLbyte *) dstSlices[0];
       for (row = 0; row < srcHeight; row++) {
          _mesa_unpack_dudv_span_byte(ctx, srcWidth, baseInternalFormat,
                                      dst, srcFormat, srcType, src,
                                      srcPacking, 0);
-         dst += srcWidth * components;
-         src += srcStride;
-      }
- 
-      src = tempImage;
-      dst = (GLbyte *) dstSlices[0];
-      for (row = 0; row < srcHeight; row++) {
-         memcpy(dst, src, srcWidth * texelBytes);
          dst += dstRowStride;
-         src += srcWidth * texelBytes;
+         src += srcStride;
       }
-      free((void *) tempImage);
    }
    return GL_TRUE;
 }
@@ -2155,28 +2254,25 @@ _mesa_texstore_snorm8(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                dstRow[col] = FLOAT_TO_BYTE_TEX(src[col]);
             }
             dstRow += dstRowStride;
-            src += srcWidth;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2197,21 +2293,19 @@ _mesa_texstore_snorm88(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLushort *dst = (GLushort *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
 
             if (dstFormat == MESA_FORMAT_L8A8_SNORM ||
                 dstFormat == MESA_FORMAT_R8G8_SNORM) {
@@ -2235,7 +2329,7 @@ _mesa_texstore_snorm88(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2254,21 +2348,19 @@ _mesa_texstore_snorm16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLshort *dstUS = (GLshort *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
 	    for (col = 0; col < srcWidth; col++) {
 	       GLushort r;
 
@@ -2279,7 +2371,7 @@ _mesa_texstore_snorm16(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2299,21 +2391,19 @@ _mesa_texstore_snorm1616(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLuint *dst = (GLuint *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
 
             if (dstFormat == MESA_FORMAT_LA_SNORM16 ||
                 dstFormat == MESA_FORMAT_R16G16_SNORM) {
@@ -2339,7 +2429,7 @@ _mesa_texstore_snorm1616(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2359,21 +2449,19 @@ _mesa_texstore_signed_rgbx8888(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *srcRow;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLbyte *dst = dstRow;
+            srcRow = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             if (dstFormat == MESA_FORMAT_X8B8G8R8_SNORM) {
                for (col = 0; col < srcWidth; col++) {
                   dst[3] = FLOAT_TO_BYTE_TEX(srcRow[RCOMP]);
@@ -2397,7 +2485,7 @@ _mesa_texstore_signed_rgbx8888(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2419,21 +2507,19 @@ _mesa_texstore_signed_rgba8888(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *srcRow;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLbyte *dst = dstRow;
+            srcRow = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             if (dstFormat == MESA_FORMAT_A8B8G8R8_SNORM) {
                for (col = 0; col < srcWidth; col++) {
                   dst[3] = FLOAT_TO_BYTE_TEX(srcRow[RCOMP]);
@@ -2457,7 +2543,7 @@ _mesa_texstore_signed_rgba8888(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2720,29 +2806,26 @@ _mesa_texstore_rgba_float32(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *srcRow;
       GLint bytesPerRow;
       GLint img, row;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       bytesPerRow = srcWidth * components * sizeof(GLfloat);
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            srcRow = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             memcpy(dstRow, srcRow, bytesPerRow);
             dstRow += dstRowStride;
-            srcRow += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2785,31 +2868,28 @@ _mesa_texstore_rgba_float16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLhalfARB *dstTexel = (GLhalfARB *) dstRow;
             GLint i;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             for (i = 0; i < srcWidth * components; i++) {
                dstTexel[i] = _mesa_float_to_half(src[i]);
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2849,23 +2929,21 @@ _mesa_texstore_rgba_int8(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-						     baseInternalFormat,
-						     baseFormat,
-						     srcWidth, srcHeight, srcDepth,
-						     srcFormat, srcType,
-						     srcAddr,
-						     srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLbyte *dstTexel = (GLbyte *) dstRow;
             GLint i;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (i = 0; i < srcWidth * components; i++) {
                   dstTexel[i] = (GLbyte) MIN2(src[i], 0x7f);
@@ -2876,11 +2954,10 @@ _mesa_texstore_rgba_int8(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2920,23 +2997,21 @@ _mesa_texstore_rgba_int16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-						     baseInternalFormat,
-						     baseFormat,
-						     srcWidth, srcHeight, srcDepth,
-						     srcFormat, srcType,
-						     srcAddr,
-						     srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLshort *dstTexel = (GLshort *) dstRow;
             GLint i;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (i = 0; i < srcWidth * components; i++) {
                   dstTexel[i] = (GLshort) MIN2(src[i], 0x7fff);
@@ -2947,11 +3022,10 @@ _mesa_texstore_rgba_int16(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -2991,23 +3065,21 @@ _mesa_texstore_rgba_int32(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-						     baseInternalFormat,
-						     baseFormat,
-						     srcWidth, srcHeight, srcDepth,
-						     srcFormat, srcType,
-						     srcAddr,
-						     srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLint *dstTexel = (GLint *) dstRow;
             GLint i;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (i = 0; i < srcWidth * components; i++) {
                   dstTexel[i] = (GLint) MIN2(src[i], 0x7fffffff);
@@ -3018,11 +3090,10 @@ _mesa_texstore_rgba_int32(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3062,20 +3133,21 @@ _mesa_texstore_rgba_uint8(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage =
-         make_temp_uint_image(ctx, dims, baseInternalFormat, baseFormat,
-                              srcWidth, srcHeight, srcDepth,
-                              srcFormat, srcType, srcAddr, srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLubyte *dstTexel = (GLubyte *) dstRow;
             GLint i;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (i = 0; i < srcWidth * components; i++) {
                   dstTexel[i] = (GLubyte) MIN2(src[i], 0xff);
@@ -3086,11 +3158,10 @@ _mesa_texstore_rgba_uint8(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3130,20 +3201,21 @@ _mesa_texstore_rgba_uint16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage =
-         make_temp_uint_image(ctx, dims, baseInternalFormat, baseFormat,
-                              srcWidth, srcHeight, srcDepth,
-                              srcFormat, srcType, srcAddr, srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLushort *dstTexel = (GLushort *) dstRow;
             GLint i;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (i = 0; i < srcWidth * components; i++) {
                   dstTexel[i] = (GLushort) MIN2(src[i], 0xffff);
@@ -3154,11 +3226,10 @@ _mesa_texstore_rgba_uint16(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3198,20 +3269,21 @@ _mesa_texstore_rgba_uint32(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage =
-         make_temp_uint_image(ctx, dims, baseInternalFormat, baseFormat,
-                              srcWidth, srcHeight, srcDepth,
-                              srcFormat, srcType, srcAddr, srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
       GLint img, row;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstTexel = (GLuint *) dstRow;
             GLint i;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (i = 0; i < srcWidth * components; i++) {
                   dstTexel[i] = src[i];
@@ -3222,11 +3294,10 @@ _mesa_texstore_rgba_uint32(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3367,30 +3438,27 @@ _mesa_texstore_rgb9_e5(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *srcRow;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstUI = (GLuint*)dstRow;
+            srcRow = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                dstUI[col] = float3_to_rgb9e5(&srcRow[col * 3]);
             }
             dstRow += dstRowStride;
-            srcRow += srcWidth * 3;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3405,30 +3473,27 @@ _mesa_texstore_r11_g11_b10f(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *srcRow;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstUI = (GLuint*)dstRow;
+            srcRow = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                dstUI[col] = float3_to_r11g11b10f(&srcRow[col * 3]);
             }
             dstRow += dstRowStride;
-            srcRow += srcWidth * 3;
          }
       }
 
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3495,23 +3560,21 @@ _mesa_texstore_argb2101010_uint(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-                                                     baseInternalFormat,
-                                                     baseFormat,
-                                                     srcWidth, srcHeight,
-                                                     srcDepth, srcFormat,
-                                                     srcType, srcAddr,
-                                                     srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row, col;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
 
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstUI = (GLuint *) dstRow;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (col = 0; col < srcWidth; col++) {
                   GLushort a,r,g,b;
@@ -3536,7 +3599,7 @@ _mesa_texstore_argb2101010_uint(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3551,23 +3614,21 @@ _mesa_texstore_abgr2101010_uint(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-                                                     baseInternalFormat,
-                                                     baseFormat,
-                                                     srcWidth, srcHeight,
-                                                     srcDepth, srcFormat,
-                                                     srcType, srcAddr,
-                                                     srcPacking);
-      const GLuint *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLuint *src;
       GLint img, row, col;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_UNSIGNED_INT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
 
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstUI = (GLuint *) dstRow;
+            src = (const GLuint *) texstore_unpack_row(&unpack, img, row);
             if (is_unsigned) {
                for (col = 0; col < srcWidth; col++) {
                   GLushort a,r,g,b;
@@ -3592,7 +3653,7 @@ _mesa_texstore_abgr2101010_uint(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -3607,22 +3668,20 @@ _mesa_texstore_abgr2101010(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct texstore_unpacker unpack;
+      const GLfloat *src;
       GLint img, row, col;
-      if (!tempImage)
+      if (!texstore_unpack_init(&unpack, GL_FLOAT, ctx, dims,
+                                baseInternalFormat, baseFormat, srcWidth,
+                                srcHeight, srcDepth, srcFormat, srcType,
+                                srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
 
          for (row = 0; row < srcHeight; row++) {
             GLuint *dstUI = (GLuint *) dstRow;
+            src = (const GLfloat *) texstore_unpack_row(&unpack, img, row);
             for (col = 0; col < srcWidth; col++) {
                GLushort a,r,g,b;
 
@@ -3636,7 +3695,7 @@ _mesa_texstore_abgr2101010(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      texstore_unpack_finish(&unpack);
    }
    return GL_TRUE;
 }
@@ -365,7 +365,10 @@ _mesa_fetch_state(struct gl_context *ctx, const gl_state_index state[],
          const int idx = (int) state[2];
          switch (state[1]) {
             case STATE_ENV:
-               COPY_4V(value, ctx->FragmentProgram.Parameters[idx]);
+               if (ctx->FragmentProgram.Parameters)
+                  COPY_4V(value, ctx->FragmentProgram.Parameters[idx]);
+               else
+                  ASSIGN_4V(value, 0.0F, 0.0F, 0.0F, 0.0F);
                return;
             case STATE_LOCAL:
                if (!ctx->FragmentProgram.Current->Base.LocalParams) {
@@ -391,7 +394,10 @@ _mesa_fetch_state(struct gl_context *ctx, const gl_state_index state[],
          const int idx = (int) state[2];
          switch (state[1]) {
             case STATE_ENV:
-               COPY_4V(value, ctx->VertexProgram.Parameters[idx]);
+               if (ctx->VertexProgram.Parameters)
+                  COPY_4V(value, ctx->VertexProgram.Parameters[idx]);
+               else
+                  ASSIGN_4V(value, 0.0F, 0.0F, 0.0F, 0.0F);
                return;
             case STATE_LOCAL:
                if (!ctx->VertexProgram.Current->Base.LocalParams) {
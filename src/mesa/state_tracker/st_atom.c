@@ -30,6 +30,7 @@
 #include "main/context.h"
 
 #include "pipe/p_defines.h"
+#include "util/u_math.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
@@ -76,7 +77,29 @@ static const struct st_tracked_state *atoms[] =
 
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   GLuint i, bit;
+
+   STATIC_ASSERT(Elements(atoms) <= 32);
+
+   memset(&st->atom_map, 0, sizeof(st->atom_map));
+
+   /* Build the mapping from each dirty bit to the atoms checking it. */
+   for (i = 0; i < Elements(atoms); i++) {
+      const struct st_tracked_state *atom = atoms[i];
+
+      if (!(atom->dirty.mesa || atom->dirty.st) ||
+	  !atom->update) {
+	 printf("malformed atom %s\n", atom->name);
+	 assert(0);
+      }
+
+      for (bit = 0; bit < 32; bit++) {
+	 if (atom->dirty.mesa & (1u << bit))
+	    st->atom_map.mesa[bit] |= 1u << i;
+	 if (atom->dirty.st & (1u << bit))
+	    st->atom_map.st[bit] |= 1u << i;
+      }
+   }
 }
 
 
@@ -89,18 +112,25 @@ void st_destroy_atoms( struct st_context *st )
 /***********************************************************************
  */
 
-static GLboolean check_state( const struct st_state_flags *a,
-			      const struct st_state_flags *b )
+/**
+ * Return the mask of atoms[] entries which need to be updated for the
+ * given dirty state.
+ */
+static GLuint atoms_for_state( const struct st_context *st,
+			       const struct st_state_flags *state )
 {
-   return ((a->mesa & b->mesa) ||
-	   (a->st & b->st));
-}
+   GLuint mask = 0;
+   unsigned bits;
 
-static void accumulate_state( struct st_state_flags *a,
-			      const struct st_state_flags *b )
-{
-   a->mesa |= b->mesa;
-   a->st |= b->st;
+   bits = state->mesa;
+   while (bits)
+      mask |= st->atom_map.mesa[u_bit_scan(&bits)];
+
+   bits = state->st;
+   while (bits)
+      mask |= st->atom_map.st[u_bit_scan(&bits)];
+
+   return mask;
 }
 
 
@@ -163,7 +193,7 @@ static void check_attrib_edgeflag(struct st_context *st)
 void st_validate_state( struct st_context *st )
 {
    struct st_state_flags *state = &st->dirty;
-   GLuint i;
+   unsigned mask;
 
    /* Get Mesa driver state. */
    st->dirty.st |= st->ctx->NewDriverState;
@@ -183,53 +213,41 @@ void st_validate_state( struct st_context *st )
 
    /*printf("%s %x/%x\n", __FUNCTION__, state->mesa, state->st);*/
 
-#ifdef DEBUG
-   if (1) {
-#else
-   if (0) {
-#endif
-      /* Debug version which enforces various sanity checks on the
-       * state flags which are generated and checked to help ensure
-       * state atoms are ordered correctly in the list.
-       */
-      struct st_state_flags examined, prev;      
-      memset(&examined, 0, sizeof(examined));
-      prev = *state;
-
-      for (i = 0; i < Elements(atoms); i++) {	 
-	 const struct st_tracked_state *atom = atoms[i];
-	 struct st_state_flags generated;
-	 
-	 /*printf("atom %s %x/%x\n", atom->name, atom->dirty.mesa, atom->dirty.st);*/
+   /* Draw loops tend to dirty the same state over and over, so remember
+    * the atoms needed for the last dirty mask.
+    */
+   if (state->mesa != st->atom_map.last_state.mesa ||
+       state->st != st->atom_map.last_state.st) {
+      st->atom_map.last_state = *state;
+      st->atom_map.last_atoms = atoms_for_state(st, state);
+   }
+   mask = st->atom_map.last_atoms;
 
-	 if (!(atom->dirty.mesa || atom->dirty.st) ||
-	     !atom->update) {
-	    printf("malformed atom %s\n", atom->name);
-	    assert(0);
-	 }
+   /* Run the atoms in list order.  An update may dirty more state, which
+    * can only be consumed by atoms later in the list.
+    */
+   while (mask) {
+      const GLuint i = u_bit_scan(&mask);
+      const GLuint later = ~((2u << i) - 1);
+      struct st_state_flags prev = *state;
 
-	 if (check_state(state, &atom->dirty)) {
-	    atoms[i]->update( st );
-	    /*printf("after: %x\n", atom->dirty.mesa);*/
-	 }
+      /*printf("atom %s %x/%x\n", atoms[i]->name, atoms[i]->dirty.mesa, atoms[i]->dirty.st);*/
 
-	 accumulate_state(&examined, &atom->dirty);
+      atoms[i]->update( st );
+
+      if (state->mesa != prev.mesa || state->st != prev.st) {
+	 struct st_state_flags generated;
+	 GLuint affected;
 
-	 /* generated = (prev ^ state)
-	  * if (examined & generated)
-	  *     fail;
-	  */
 	 xor_states(&generated, &prev, state);
-	 assert(!check_state(&examined, &generated));
-	 prev = *state;
-      }
-      /*printf("\n");*/
+	 affected = atoms_for_state(st, &generated);
 
-   }
-   else {
-      for (i = 0; i < Elements(atoms); i++) {	 
-	 if (check_state(state, &atoms[i]->dirty))
-	    atoms[i]->update( st );
+	 /* Enforce that state atoms are ordered correctly in the list:
+	  * generated state must not be examined by this or an earlier atom.
+	  */
+	 assert(!(affected & ~later));
+
+	 mask |= affected & later;
       }
    }
 
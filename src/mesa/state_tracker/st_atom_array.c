@@ -39,6 +39,7 @@
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bufferobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_draw.h"
 #include "st_program.h"
 
@@ -365,7 +366,8 @@ is_interleaved_arrays(const struct st_vertex_program *vp,
  * \param velements  returns vertex element info
  */
 static boolean
-setup_interleaved_attribs(const struct st_vertex_program *vp,
+setup_interleaved_attribs(struct st_context *st,
+                          const struct st_vertex_program *vp,
                           const struct st_vp_variant *vpv,
                           const struct gl_client_array **arrays,
                           struct pipe_vertex_buffer *vbuffer,
@@ -445,6 +447,7 @@ setup_interleaved_attribs(const struct st_vertex_program *vp,
          return FALSE; /* out-of-memory error probably */
       }
 
+      st_sync_pbo_readbacks(st, stobj);
       vbuffer->buffer = stobj->buffer;
       vbuffer->user_buffer = NULL;
       vbuffer->buffer_offset = pointer_to_offset(low_addr);
@@ -497,6 +500,7 @@ setup_non_interleaved_attribs(struct st_context *st,
             return FALSE; /* out-of-memory error probably */
          }
 
+         st_sync_pbo_readbacks(st, stobj);
          vbuffer[attr].buffer = stobj->buffer;
          vbuffer[attr].user_buffer = NULL;
          vbuffer[attr].buffer_offset = pointer_to_offset(array->Ptr);
@@ -563,7 +567,8 @@ static void update_array(struct st_context *st)
     * Setup the vbuffer[] and velements[] arrays.
     */
    if (is_interleaved_arrays(vp, vpv, arrays)) {
-      if (!setup_interleaved_attribs(vp, vpv, arrays, vbuffer, velements)) {
+      if (!setup_interleaved_attribs(st, vp, vpv, arrays, vbuffer,
+                                     velements)) {
          st->vertex_array_out_of_memory = TRUE;
          return;
       }
@@ -47,6 +47,7 @@
 #include "st_atom_constbuf.h"
 #include "st_program.h"
 #include "st_cb_bufferobjects.h"
+#include "st_cb_readpixels.h"
 
 /**
  * Pass the given program parameters to the graphics pipe as a
@@ -194,6 +195,7 @@ static void st_bind_ubos(struct st_context *st,
 
       binding = &st->ctx->UniformBufferBindings[shader->UniformBlocks[i].Binding];
       st_obj = st_buffer_object(binding->BufferObject);
+      st_sync_pbo_readbacks(st, st_obj);
 
       cb.buffer = st_obj->buffer;
 
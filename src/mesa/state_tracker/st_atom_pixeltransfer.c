@@ -93,10 +93,10 @@ load_color_map_texture(struct gl_context *ctx, struct pipe_resource *pt)
    struct st_context *st = st_context(ctx);
    struct pipe_context *pipe = st->pipe;
    struct pipe_transfer *transfer;
-   const GLuint rSize = ctx->PixelMaps.RtoR.Size;
-   const GLuint gSize = ctx->PixelMaps.GtoG.Size;
-   const GLuint bSize = ctx->PixelMaps.BtoB.Size;
-   const GLuint aSize = ctx->PixelMaps.AtoA.Size;
+   const GLuint rSize = ctx->PixelMaps->RtoR.Size;
+   const GLuint gSize = ctx->PixelMaps->GtoG.Size;
+   const GLuint bSize = ctx->PixelMaps->BtoB.Size;
+   const GLuint aSize = ctx->PixelMaps->AtoA.Size;
    const uint texSize = pt->width0;
    uint *dest;
    uint i, j;
@@ -116,10 +116,10 @@ load_color_map_texture(struct gl_context *ctx, struct pipe_resource *pt)
          union util_color uc;
          int k = (i * texSize + j);
          float rgba[4];
-         rgba[0] = ctx->PixelMaps.RtoR.Map[j * rSize / texSize];
-         rgba[1] = ctx->PixelMaps.GtoG.Map[i * gSize / texSize];
-         rgba[2] = ctx->PixelMaps.BtoB.Map[j * bSize / texSize];
-         rgba[3] = ctx->PixelMaps.AtoA.Map[i * aSize / texSize];
+         rgba[0] = ctx->PixelMaps->RtoR.Map[j * rSize / texSize];
+         rgba[1] = ctx->PixelMaps->GtoG.Map[i * gSize / texSize];
+         rgba[2] = ctx->PixelMaps->BtoB.Map[j * bSize / texSize];
+         rgba[3] = ctx->PixelMaps->AtoA.Map[i * aSize / texSize];
          util_pack_color(rgba, pt->format, &uc);
          *(dest + k) = uc.ui;
       }
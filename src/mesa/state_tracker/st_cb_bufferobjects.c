@@ -35,9 +35,11 @@
 #include "main/mtypes.h"
 #include "main/arrayobj.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_debug.h"
 
 #include "pipe/p_context.h"
@@ -77,10 +79,12 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
 
    assert(obj->RefCount == 0);
    _mesa_buffer_unmap_all_mappings(ctx, obj);
+   st_discard_pbo_readbacks(st_obj);
 
    if (st_obj->buffer)
       pipe_resource_reference(&st_obj->buffer, NULL);
 
+   vbo_delete_minmax_cache(obj);
    free(st_obj->Base.Label);
    free(st_obj);
 }
@@ -122,6 +126,8 @@ st_bufferobj_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_sync_pbo_readbacks(st_context(ctx), st_obj);
+
    /* Now that transfers are per-context, we don't have to figure out
     * flushing here.  Usually drivers won't need to flush in this case
     * even if the buffer is currently referenced by hardware - they
@@ -158,6 +164,8 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_sync_pbo_readbacks(st_context(ctx), st_obj);
+
    pipe_buffer_read(st_context(ctx)->pipe, st_obj->buffer,
                     offset, size, data);
 }
@@ -184,6 +192,8 @@ st_bufferobj_data(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    unsigned bind, pipe_usage, pipe_flags = 0;
 
+   st_discard_pbo_readbacks(st_obj);
+
    if (size && data && st_obj->buffer &&
        st_obj->Base.Size == size &&
        st_obj->Base.Usage == usage &&
@@ -351,6 +361,11 @@ st_bufferobj_map_range(struct gl_context *ctx,
    if (access & MESA_MAP_NOWAIT_BIT)
       flags |= PIPE_TRANSFER_DONTBLOCK;
 
+   if (access & GL_MAP_INVALIDATE_BUFFER_BIT)
+      st_discard_pbo_readbacks(st_obj);
+   else
+      st_sync_pbo_readbacks(st_context(ctx), st_obj);
+
    assert(offset >= 0);
    assert(length >= 0);
    assert(offset < obj->Size);
@@ -441,6 +456,9 @@ st_copy_buffer_subdata(struct gl_context *ctx,
    assert(!_mesa_check_disallowed_mapping(src));
    assert(!_mesa_check_disallowed_mapping(dst));
 
+   st_sync_pbo_readbacks(st_context(ctx), srcObj);
+   st_sync_pbo_readbacks(st_context(ctx), dstObj);
+
    u_box_1d(readOffset, size, &box);
 
    pipe->resource_copy_region(pipe, dstObj->buffer, 0, writeOffset, 0, 0,
@@ -461,6 +479,8 @@ st_clear_buffer_subdata(struct gl_context *ctx,
    struct st_buffer_object *buf = st_buffer_object(bufObj);
    static const char zeros[16] = {0};
 
+   st_sync_pbo_readbacks(st_context(ctx), buf);
+
    if (!pipe->clear_buffer) {
       _mesa_buffer_clear_subdata(ctx, offset, size,
                                  clearValue, clearValueSize, bufObj);
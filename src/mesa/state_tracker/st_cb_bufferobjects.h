@@ -34,6 +34,7 @@
 struct dd_function_table;
 struct pipe_resource;
 struct st_context;
+struct st_pbo_readback;
 
 /**
  * State_tracker vertex/pixel buffer object, derived from Mesa's
@@ -44,6 +45,8 @@ struct st_buffer_object
    struct gl_buffer_object Base;
    struct pipe_resource *buffer;     /* GPU storage */
    struct pipe_transfer *transfer[MAP_COUNT];
+   /** glReadPixels into this PBO not yet copied in, see st_cb_readpixels.c */
+   struct st_pbo_readback *readbacks;
 };
 
 
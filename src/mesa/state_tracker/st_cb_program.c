@@ -96,16 +96,19 @@ st_new_program(struct gl_context *ctx, GLenum target, GLuint id)
    switch (target) {
    case GL_VERTEX_PROGRAM_ARB: {
       struct st_vertex_program *prog = ST_CALLOC_STRUCT(st_vertex_program);
+      st_init_variant_table(&prog->variant_table);
       return _mesa_init_vertex_program(ctx, &prog->Base, target, id);
    }
 
    case GL_FRAGMENT_PROGRAM_ARB: {
       struct st_fragment_program *prog = ST_CALLOC_STRUCT(st_fragment_program);
+      st_init_variant_table(&prog->variant_table);
       return _mesa_init_fragment_program(ctx, &prog->Base, target, id);
    }
 
    case MESA_GEOMETRY_PROGRAM: {
       struct st_geometry_program *prog = ST_CALLOC_STRUCT(st_geometry_program);
+      st_init_variant_table(&prog->variant_table);
       return _mesa_init_geometry_program(ctx, &prog->Base, target, id);
    }
 
@@ -129,6 +132,7 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
       {
          struct st_vertex_program *stvp = (struct st_vertex_program *) prog;
          st_release_vp_variants( st, stvp );
+         st_destroy_variant_table(&stvp->variant_table);
          
          if (stvp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stvp->glsl_to_tgsi);
@@ -140,6 +144,7 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
             (struct st_geometry_program *) prog;
 
          st_release_gp_variants(st, stgp);
+         st_destroy_variant_table(&stgp->variant_table);
          
          if (stgp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stgp->glsl_to_tgsi);
@@ -156,6 +161,7 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
             (struct st_fragment_program *) prog;
 
          st_release_fp_variants(st, stfp);
+         st_destroy_variant_table(&stfp->variant_table);
          
          if (stfp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stfp->glsl_to_tgsi);
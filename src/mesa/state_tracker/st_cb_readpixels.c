@@ -31,9 +31,12 @@
 #include "main/readpix.h"
 #include "main/enums.h"
 #include "main/framebuffer.h"
+#include "main/bufferobj.h"
+#include "pipe/p_screen.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 
+#include "st_cb_bufferobjects.h"
 #include "st_cb_fbo.h"
 #include "st_atom.h"
 #include "st_context.h"
@@ -44,6 +47,178 @@
 #include "state_tracker/st_texture.h"
 
 
+/**
+ * A glReadPixels into a PBO which has been blitted into a staging texture
+ * but not yet copied into the buffer.
+ *
+ * Copying it in right away would stall until the GPU has finished
+ * rendering the frame.  Instead, the blit is followed by a fence and the
+ * copy is done by st_finish_pbo_readbacks() when the buffer contents are
+ * next needed, typically when the app maps it some frames later.
+ */
+struct st_pbo_readback
+{
+   struct st_pbo_readback *next;
+   struct pipe_screen *screen;
+   struct pipe_resource *texture;       /**< blit destination */
+   struct pipe_fence_handle *fence;     /**< signalled when blit is done */
+   struct gl_pixelstore_attrib pack;    /**< with BufferObj = NULL */
+   GLintptr offset;                     /**< glReadPixels pixels argument */
+   GLsizei width, height;
+   GLenum format, type;
+};
+
+
+static void
+free_pbo_readback(struct st_pbo_readback *rb)
+{
+   pipe_resource_reference(&rb->texture, NULL);
+   rb->screen->fence_reference(rb->screen, &rb->fence, NULL);
+   free(rb);
+}
+
+
+/**
+ * Copy rows of the mapped blit destination to the PBO image.
+ */
+static void
+copy_rows(const struct gl_pixelstore_attrib *pack, GLvoid *pixels,
+          GLsizei width, GLsizei height, GLenum format, GLenum type,
+          const ubyte *map, unsigned stride, unsigned bytesPerRow)
+{
+   GLuint row;
+
+   for (row = 0; row < (unsigned) height; row++) {
+      GLvoid *dest = _mesa_image_address3d(pack, pixels,
+                                           width, height, format,
+                                           type, 0, row, 0);
+      memcpy(dest, map, bytesPerRow);
+      map += stride;
+   }
+}
+
+
+/**
+ * Queue the copy of the blitted pixels into the PBO.
+ * \return GL_FALSE if it must be done right away.
+ */
+static GLboolean
+queue_pbo_readback(struct st_context *st, struct st_buffer_object *obj,
+                   struct pipe_resource *texture,
+                   const struct gl_pixelstore_attrib *pack, GLvoid *pixels,
+                   GLsizei width, GLsizei height,
+                   GLenum format, GLenum type)
+{
+   struct st_pbo_readback *rb, **tail;
+
+   /* A persistently mapped buffer can be read without us noticing. */
+   if (!obj->buffer ||
+       _mesa_bufferobj_mapped(&obj->Base, MAP_USER) ||
+       (obj->Base.StorageFlags & GL_MAP_PERSISTENT_BIT))
+      return GL_FALSE;
+
+   rb = CALLOC_STRUCT(st_pbo_readback);
+   if (!rb)
+      return GL_FALSE;
+
+   st->pipe->flush(st->pipe, &rb->fence, 0);
+   if (!rb->fence) {
+      free(rb);
+      return GL_FALSE;
+   }
+
+   rb->screen = st->pipe->screen;
+   pipe_resource_reference(&rb->texture, texture);
+   rb->pack = *pack;
+   rb->pack.BufferObj = NULL;
+   rb->offset = (GLintptr) pixels;
+   rb->width = width;
+   rb->height = height;
+   rb->format = format;
+   rb->type = type;
+
+   /* keep them in order, in case they overlap */
+   for (tail = &obj->readbacks; *tail; tail = &(*tail)->next)
+      ;
+   *tail = rb;
+
+   /* The buffer may already be bound as a vertex, uniform or texture
+    * buffer, in which case nothing would revalidate the atoms that sync
+    * it before the next draw.
+    */
+   st->dirty.mesa |= _NEW_TEXTURE;
+   st->dirty.st |= ST_NEW_MESA | ST_NEW_VERTEX_ARRAYS | ST_NEW_UNIFORM_BUFFER;
+   return GL_TRUE;
+}
+
+
+/**
+ * Wait for the glReadPixels blits into the buffer to complete and copy
+ * their results in.
+ */
+void
+st_finish_pbo_readbacks(struct st_context *st, struct st_buffer_object *obj)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct st_pbo_readback *rb = obj->readbacks;
+   struct pipe_transfer *buf_xfer;
+   GLubyte *buf;
+
+   obj->readbacks = NULL;
+
+   buf = pipe_buffer_map(pipe, obj->buffer, PIPE_TRANSFER_WRITE, &buf_xfer);
+
+   while (rb) {
+      struct st_pbo_readback *next = rb->next;
+      struct pipe_transfer *tex_xfer;
+      ubyte *map;
+
+      /* Only wait for the blit, not for anything rendered after it */
+      rb->screen->fence_finish(rb->screen, rb->fence, PIPE_TIMEOUT_INFINITE);
+
+      map = buf ? pipe_transfer_map_3d(pipe, rb->texture, 0,
+                                       PIPE_TRANSFER_READ, 0, 0, 0,
+                                       rb->width, rb->height, 1,
+                                       &tex_xfer) : NULL;
+      if (map) {
+         copy_rows(&rb->pack, ADD_POINTERS(buf, rb->offset),
+                   rb->width, rb->height, rb->format, rb->type,
+                   map, tex_xfer->stride,
+                   rb->width * util_format_get_blocksize(rb->texture->format));
+         pipe_transfer_unmap(pipe, tex_xfer);
+      }
+      else {
+         _mesa_error(st->ctx, GL_OUT_OF_MEMORY, "glReadPixels(PBO)");
+      }
+
+      free_pbo_readback(rb);
+      rb = next;
+   }
+
+   if (buf)
+      pipe_buffer_unmap(pipe, buf_xfer);
+}
+
+
+/**
+ * Drop the pending glReadPixels for a buffer whose contents are being
+ * replaced or deleted.
+ */
+void
+st_discard_pbo_readbacks(struct st_buffer_object *obj)
+{
+   struct st_pbo_readback *rb = obj->readbacks;
+
+   obj->readbacks = NULL;
+
+   while (rb) {
+      struct st_pbo_readback *next = rb->next;
+      free_pbo_readback(rb);
+      rb = next;
+   }
+}
+
+
 /**
  * This uses a blit to copy the read buffer to a texture format which matches
  * the format and type combo and then a fast read-back is done using memcpy.
@@ -55,6 +230,9 @@
  * NOTE: Some drivers use a blit to convert between tiled and linear
  *       texture layouts during texture uploads/downloads, so the blit
  *       we do here should be free in such cases.
+ *
+ * When reading into a PBO, we don't wait for the blit; the copy into the
+ * buffer is queued, see struct st_pbo_readback.
  */
 static void
 st_readpixels(struct gl_context *ctx, GLint x, GLint y,
@@ -192,6 +370,13 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    /* blit */
    st->pipe->blit(st->pipe, &blit);
 
+   if (_mesa_is_bufferobj(pack->BufferObj) &&
+       queue_pbo_readback(st, st_buffer_object(pack->BufferObj), dst,
+                          pack, pixels, width, height, format, type)) {
+      pipe_resource_reference(&dst, NULL);
+      return;
+   }
+
    /* map resources */
    pixels = _mesa_map_pbo_dest(ctx, pack, pixels);
 
@@ -204,18 +389,8 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    }
 
    /* memcpy data into a user buffer */
-   {
-      const uint bytesPerRow = width * util_format_get_blocksize(dst_format);
-      GLuint row;
-
-      for (row = 0; row < (unsigned) height; row++) {
-         GLvoid *dest = _mesa_image_address3d(pack, pixels,
-                                              width, height, format,
-                                              type, 0, row, 0);
-         memcpy(dest, map, bytesPerRow);
-         map += tex_xfer->stride;
-      }
-   }
+   copy_rows(pack, pixels, width, height, format, type, map, tex_xfer->stride,
+             width * util_format_get_blocksize(dst_format));
 
    pipe_transfer_unmap(pipe, tex_xfer);
    _mesa_unmap_pbo_dest(ctx, pack);
@@ -30,8 +30,28 @@
 #define ST_CB_READPIXELS_H
 
 #include "main/glheader.h"
+#include "st_cb_bufferobjects.h"
 
 struct dd_function_table;
+struct st_context;
+
+extern void
+st_finish_pbo_readbacks(struct st_context *st, struct st_buffer_object *obj);
+
+extern void
+st_discard_pbo_readbacks(struct st_buffer_object *obj);
+
+/**
+ * Copy the results of any glReadPixels into the PBO which are still in
+ * flight into it.  Must be called before the buffer's contents are
+ * accessed, by the CPU or the GPU.
+ */
+static INLINE void
+st_sync_pbo_readbacks(struct st_context *st, struct st_buffer_object *obj)
+{
+   if (obj->readbacks)
+      st_finish_pbo_readbacks(st, obj);
+}
 
 extern void
 st_init_readpixels_functions(struct dd_function_table *functions);
@@ -48,6 +48,7 @@
 #include "state_tracker/st_cb_flush.h"
 #include "state_tracker/st_cb_texture.h"
 #include "state_tracker/st_cb_bufferobjects.h"
+#include "state_tracker/st_cb_readpixels.h"
 #include "state_tracker/st_format.h"
 #include "state_tracker/st_texture.h"
 #include "state_tracker/st_gen_mipmap.h"
@@ -1489,6 +1490,8 @@ st_finalize_texture(struct gl_context *ctx,
          return GL_TRUE;
       }
 
+      st_sync_pbo_readbacks(st_context(ctx), st_obj);
+
       if (st_obj->buffer != stObj->pt) {
          pipe_resource_reference(&stObj->pt, st_obj->buffer);
          st_texture_release_all_sampler_views(stObj);
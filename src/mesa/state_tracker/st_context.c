@@ -69,6 +69,7 @@
 #include "st_vdpau.h"
 #include "st_texture.h"
 #include "pipe/p_context.h"
+#include "os/os_thread.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "cso_cache/cso_context.h"
@@ -77,6 +78,92 @@
 DEBUG_GET_ONCE_BOOL_OPTION(mesa_mvp_dp4, "MESA_MVP_DP4", FALSE)
 
 
+/**
+ * CSO state caches shared by the contexts of a screen, for the drivers
+ * with PIPE_CAP_SHARED_STATE_OBJECTS.
+ */
+struct st_cso_shared {
+   struct pipe_screen *screen;
+   struct cso_shared_cache *cache;
+   unsigned refcount;
+   struct st_cso_shared *next;
+};
+
+static struct st_cso_shared *cso_shared_list;
+pipe_static_mutex(cso_shared_mutex);
+
+
+/**
+ * Get a reference to the shared CSO cache of a screen, creating it for
+ * the first context.
+ */
+static struct cso_shared_cache *
+st_get_cso_shared(struct pipe_screen *screen)
+{
+   struct st_cso_shared *entry;
+   struct cso_shared_cache *cache = NULL;
+
+   pipe_mutex_lock(cso_shared_mutex);
+
+   for (entry = cso_shared_list; entry; entry = entry->next) {
+      if (entry->screen == screen)
+         break;
+   }
+
+   if (!entry) {
+      entry = ST_CALLOC_STRUCT(st_cso_shared);
+      if (entry) {
+         entry->screen = screen;
+         entry->cache = cso_shared_cache_create(screen);
+         if (entry->cache) {
+            entry->next = cso_shared_list;
+            cso_shared_list = entry;
+         }
+         else {
+            free(entry);
+            entry = NULL;
+         }
+      }
+   }
+
+   if (entry) {
+      entry->refcount++;
+      cache = entry->cache;
+   }
+
+   pipe_mutex_unlock(cso_shared_mutex);
+
+   return cache;
+}
+
+
+/**
+ * Release a reference to a shared CSO cache, destroying it with the last
+ * context of the screen.
+ */
+static void
+st_put_cso_shared(struct cso_shared_cache *cache)
+{
+   struct st_cso_shared **prev, *entry;
+
+   pipe_mutex_lock(cso_shared_mutex);
+
+   for (prev = &cso_shared_list; (entry = *prev); prev = &entry->next) {
+      if (entry->cache == cache)
+         break;
+   }
+
+   assert(entry);
+   if (entry && --entry->refcount == 0) {
+      *prev = entry->next;
+      cso_shared_cache_destroy(entry->cache);
+      free(entry);
+   }
+
+   pipe_mutex_unlock(cso_shared_mutex);
+}
+
+
 /**
  * Called via ctx->Driver.UpdateState()
  */
@@ -134,8 +221,8 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st->uploader = u_upload_create(st->pipe, 65536, 4, PIPE_BIND_VERTEX_BUFFER);
 
    if (!screen->get_param(screen, PIPE_CAP_USER_INDEX_BUFFERS)) {
-      st->indexbuf_uploader = u_upload_create(st->pipe, 128 * 1024, 4,
-                                              PIPE_BIND_INDEX_BUFFER);
+      st->indexbuf_uploader = u_upload_create_ring(st->pipe, 1024 * 1024, 4,
+                                                   PIPE_BIND_INDEX_BUFFER);
    }
 
    if (!screen->get_param(screen, PIPE_CAP_USER_CONSTANT_BUFFERS)) {
@@ -146,7 +233,9 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
                                               PIPE_BIND_CONSTANT_BUFFER);
    }
 
-   st->cso_context = cso_create_context(pipe);
+   if (screen->get_param(screen, PIPE_CAP_SHARED_STATE_OBJECTS))
+      st->cso_shared = st_get_cso_shared(screen);
+   st->cso_context = cso_create_context_shared(pipe, st->cso_shared);
 
    st_init_atoms( st );
    st_init_bitmap(st);
@@ -300,6 +389,7 @@ void st_destroy_context( struct st_context *st )
 {
    struct pipe_context *pipe = st->pipe;
    struct cso_context *cso = st->cso_context;
+   struct cso_shared_cache *cso_shared = st->cso_shared;
    struct gl_context *ctx = st->ctx;
    GLuint i;
 
@@ -337,6 +427,8 @@ void st_destroy_context( struct st_context *st )
    st = NULL;
 
    cso_destroy_context(cso);
+   if (cso_shared)
+      st_put_cso_shared(cso_shared);
 
    pipe->destroy( pipe );
 
@@ -191,6 +191,8 @@ struct st_context
    struct gen_mipmap_state *gen_mipmap;
 
    struct cso_context *cso_context;
+   /** Cache of the states cso_context shares with the screen's contexts */
+   struct cso_shared_cache *cso_shared;
 
    void *winsys_drawable_handle;
 
@@ -201,6 +203,22 @@ struct st_context
    int32_t read_stamp;
 
    struct st_config_options options;
+
+   /** Maps dirty state to the state atoms to update, see st_atom.c */
+   struct {
+      GLuint mesa[32];     /**< atoms checking each Mesa dirty bit */
+      GLuint st[32];       /**< atoms checking each ST_NEW_x bit */
+      struct st_state_flags last_state;
+      GLuint last_atoms;   /**< atoms to update for last_state */
+   } atom_map;
+
+   /** Shader variant lookup statistics, reported with ST_DEBUG=variants */
+   struct {
+      unsigned lookups;      /**< calls to st_get_*_variant() */
+      unsigned mru_hits;     /**< lookups that hit the last used variant */
+      unsigned key_compares; /**< keys compared in the variant tables */
+      unsigned created;      /**< variants translated */
+   } variant_stats;
 };
 
 
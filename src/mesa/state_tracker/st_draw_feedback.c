@@ -34,6 +34,7 @@
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bufferobjects.h"
+#include "st_cb_readpixels.h"
 #include "st_draw.h"
 #include "st_program.h"
 
@@ -187,6 +188,7 @@ st_feedback_draw_vbo(struct gl_context *ctx,
           */
          struct st_buffer_object *stobj = st_buffer_object(bufobj);
          assert(stobj->buffer);
+         st_sync_pbo_readbacks(st, stobj);
 
          vbuffers[attr].buffer = NULL;
          vbuffers[attr].user_buffer = NULL;
@@ -243,6 +245,7 @@ st_feedback_draw_vbo(struct gl_context *ctx,
       if (bufobj && bufobj->Name) {
          struct st_buffer_object *stobj = st_buffer_object(bufobj);
 
+         st_sync_pbo_readbacks(st, stobj);
          pipe_resource_reference(&ibuffer.buffer, stobj->buffer);
          ibuffer.offset = pointer_to_offset(ib->ptr);
 
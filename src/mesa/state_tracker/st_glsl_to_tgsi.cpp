@@ -69,6 +69,8 @@ extern "C" {
 #include "st_mesa_to_tgsi.h"
 }
 
+#include "st_glsl_to_tgsi_private.h"
+
 #define PROGRAM_IMMEDIATE PROGRAM_FILE_MAX
 #define PROGRAM_ANY_CONST ((1 << PROGRAM_STATE_VAR) |    \
                            (1 << PROGRAM_CONSTANT) |     \
@@ -82,136 +84,6 @@ extern "C" {
  */
 #define MAX_TEMPS         4096
 
-/**
- * Maximum number of arrays
- */
-#define MAX_ARRAYS        256
-
-/* if we support a native gallium TG4 with the ability to take 4 texoffsets then bump this */
-#define MAX_GLSL_TEXTURE_OFFSET 1
-
-class st_src_reg;
-class st_dst_reg;
-
-static int swizzle_for_size(int size);
-
-/**
- * This struct is a corresponding struct to TGSI ureg_src.
- */
-class st_src_reg {
-public:
-   st_src_reg(gl_register_file file, int index, const glsl_type *type)
-   {
-      this->file = file;
-      this->index = index;
-      if (type && (type->is_scalar() || type->is_vector() || type->is_matrix()))
-         this->swizzle = swizzle_for_size(type->vector_elements);
-      else
-         this->swizzle = SWIZZLE_XYZW;
-      this->negate = 0;
-      this->index2D = 0;
-      this->type = type ? type->base_type : GLSL_TYPE_ERROR;
-      this->reladdr = NULL;
-      this->reladdr2 = NULL;
-      this->has_index2 = false;
-   }
-
-   st_src_reg(gl_register_file file, int index, int type)
-   {
-      this->type = type;
-      this->file = file;
-      this->index = index;
-      this->index2D = 0;
-      this->swizzle = SWIZZLE_XYZW;
-      this->negate = 0;
-      this->reladdr = NULL;
-      this->reladdr2 = NULL;
-      this->has_index2 = false;
-   }
-
-   st_src_reg(gl_register_file file, int index, int type, int index2D)
-   {
-      this->type = type;
-      this->file = file;
-      this->index = index;
-      this->index2D = index2D;
-      this->swizzle = SWIZZLE_XYZW;
-      this->negate = 0;
-      this->reladdr = NULL;
-      this->reladdr2 = NULL;
-      this->has_index2 = false;
-   }
-
-   st_src_reg()
-   {
-      this->type = GLSL_TYPE_ERROR;
-      this->file = PROGRAM_UNDEFINED;
-      this->index = 0;
-      this->index2D = 0;
-      this->swizzle = 0;
-      this->negate = 0;
-      this->reladdr = NULL;
-      this->reladdr2 = NULL;
-      this->has_index2 = false;
-   }
-
-   explicit st_src_reg(st_dst_reg reg);
-
-   gl_register_file file; /**< PROGRAM_* from Mesa */
-   int index; /**< temporary index, VERT_ATTRIB_*, VARYING_SLOT_*, etc. */
-   int index2D;
-   GLuint swizzle; /**< SWIZZLE_XYZWONEZERO swizzles from Mesa. */
-   int negate; /**< NEGATE_XYZW mask from mesa */
-   int type; /** GLSL_TYPE_* from GLSL IR (enum glsl_base_type) */
-   /** Register index should be offset by the integer in this reg. */
-   st_src_reg *reladdr;
-   st_src_reg *reladdr2;
-   bool has_index2;
-};
-
-class st_dst_reg {
-public:
-   st_dst_reg(gl_register_file file, int writemask, int type, int index)
-   {
-      this->file = file;
-      this->index = index;
-      this->writemask = writemask;
-      this->cond_mask = COND_TR;
-      this->reladdr = NULL;
-      this->type = type;
-   }
-
-   st_dst_reg(gl_register_file file, int writemask, int type)
-   {
-      this->file = file;
-      this->index = 0;
-      this->writemask = writemask;
-      this->cond_mask = COND_TR;
-      this->reladdr = NULL;
-      this->type = type;
-   }
-
-   st_dst_reg()
-   {
-      this->type = GLSL_TYPE_ERROR;
-      this->file = PROGRAM_UNDEFINED;
-      this->index = 0;
-      this->writemask = 0;
-      this->cond_mask = COND_TR;
-      this->reladdr = NULL;
-   }
-
-   explicit st_dst_reg(st_src_reg reg);
-
-   gl_register_file file; /**< PROGRAM_* from Mesa */
-   int index; /**< temporary index, VERT_ATTRIB_*, VARYING_SLOT_*, etc. */
-   int writemask; /**< Bitfield of WRITEMASK_[XYZW] */
-   GLuint cond_mask:4;
-   int type; /** GLSL_TYPE_* from GLSL IR (enum glsl_base_type) */
-   /** Register index should be offset by the integer in this reg. */
-   st_src_reg *reladdr;
-};
-
 st_src_reg::st_src_reg(st_dst_reg reg)
 {
    this->type = reg.type;
@@ -235,237 +107,6 @@ st_dst_reg::st_dst_reg(st_src_reg reg)
    this->reladdr = reg.reladdr;
 }
 
-class glsl_to_tgsi_instruction : public exec_node {
-public:
-   DECLARE_RALLOC_CXX_OPERATORS(glsl_to_tgsi_instruction)
-
-   unsigned op;
-   st_dst_reg dst;
-   st_src_reg src[3];
-   /** Pointer to the ir source this tree came from for debugging */
-   ir_instruction *ir;
-   GLboolean cond_update;
-   bool saturate;
-   int sampler; /**< sampler index */
-   int tex_target; /**< One of TEXTURE_*_INDEX */
-   GLboolean tex_shadow;
-
-   st_src_reg tex_offsets[MAX_GLSL_TEXTURE_OFFSET];
-   unsigned tex_offset_num_offset;
-   int dead_mask; /**< Used in dead code elimination */
-
-   class function_entry *function; /* Set on TGSI_OPCODE_CAL or TGSI_OPCODE_BGNSUB */
-};
-
-class variable_storage : public exec_node {
-public:
-   variable_storage(ir_variable *var, gl_register_file file, int index)
-      : file(file), index(index), var(var)
-   {
-      /* empty */
-   }
-
-   gl_register_file file;
-   int index;
-   ir_variable *var; /* variable that maps to this, if any */
-};
-
-class immediate_storage : public exec_node {
-public:
-   immediate_storage(gl_constant_value *values, int size, int type)
-   {
-      memcpy(this->values, values, size * sizeof(gl_constant_value));
-      this->size = size;
-      this->type = type;
-   }
-   
-   gl_constant_value values[4];
-   int size; /**< Number of components (1-4) */
-   int type; /**< GL_FLOAT, GL_INT, GL_BOOL, or GL_UNSIGNED_INT */
-};
-
-class function_entry : public exec_node {
-public:
-   ir_function_signature *sig;
-
-   /**
-    * identifier of this function signature used by the program.
-    *
-    * At the point that TGSI instructions for function calls are
-    * generated, we don't know the address of the first instruction of
-    * the function body.  So we make the BranchTarget that is called a
-    * small integer and rewrite them during set_branchtargets().
-    */
-   int sig_id;
-
-   /**
-    * Pointer to first instruction of the function body.
-    *
-    * Set during function body emits after main() is processed.
-    */
-   glsl_to_tgsi_instruction *bgn_inst;
-
-   /**
-    * Index of the first instruction of the function body in actual TGSI.
-    *
-    * Set after conversion from glsl_to_tgsi_instruction to TGSI.
-    */
-   int inst;
-
-   /** Storage for the return value. */
-   st_src_reg return_reg;
-};
-
-struct glsl_to_tgsi_visitor : public ir_visitor {
-public:
-   glsl_to_tgsi_visitor();
-   ~glsl_to_tgsi_visitor();
-
-   function_entry *current_function;
-
-   struct gl_context *ctx;
-   struct gl_program *prog;
-   struct gl_shader_program *shader_program;
-   struct gl_shader_compiler_options *options;
-
-   int next_temp;
-
-   unsigned array_sizes[MAX_ARRAYS];
-   unsigned next_array;
-
-   int num_address_regs;
-   int samplers_used;
-   bool indirect_addr_consts;
-   
-   int glsl_version;
-   bool native_integers;
-   bool have_sqrt;
-
-   variable_storage *find_variable_storage(ir_variable *var);
-
-   int add_constant(gl_register_file file, gl_constant_value values[4],
-                    int size, int datatype, GLuint *swizzle_out);
-
-   function_entry *get_function_signature(ir_function_signature *sig);
-
-   st_src_reg get_temp(const glsl_type *type);
-   void reladdr_to_temp(ir_instruction *ir, st_src_reg *reg, int *num_reladdr);
-
-   st_src_reg st_src_reg_for_float(float val);
-   st_src_reg st_src_reg_for_int(int val);
-   st_src_reg st_src_reg_for_type(int type, int val);
-
-   /**
-    * \name Visit methods
-    *
-    * As typical for the visitor pattern, there must be one \c visit method for
-    * each concrete subclass of \c ir_instruction.  Virtual base classes within
-    * the hierarchy should not have \c visit methods.
-    */
-   /*@{*/
-   virtual void visit(ir_variable *);
-   virtual void visit(ir_loop *);
-   virtual void visit(ir_loop_jump *);
-   virtual void visit(ir_function_signature *);
-   virtual void visit(ir_function *);
-   virtual void visit(ir_expression *);
-   virtual void visit(ir_swizzle *);
-   virtual void visit(ir_dereference_variable  *);
-   virtual void visit(ir_dereference_array *);
-   virtual void visit(ir_dereference_record *);
-   virtual void visit(ir_assignment *);
-   virtual void visit(ir_constant *);
-   virtual void visit(ir_call *);
-   virtual void visit(ir_return *);
-   virtual void visit(ir_discard *);
-   virtual void visit(ir_texture *);
-   virtual void visit(ir_if *);
-   virtual void visit(ir_emit_vertex *);
-   virtual void visit(ir_end_primitive *);
-   /*@}*/
-
-   st_src_reg result;
-
-   /** List of variable_storage */
-   exec_list variables;
-
-   /** List of immediate_storage */
-   exec_list immediates;
-   unsigned num_immediates;
-
-   /** List of function_entry */
-   exec_list function_signatures;
-   int next_signature_id;
-
-   /** List of glsl_to_tgsi_instruction */
-   exec_list instructions;
-
-   glsl_to_tgsi_instruction *emit(ir_instruction *ir, unsigned op);
-
-   glsl_to_tgsi_instruction *emit(ir_instruction *ir, unsigned op,
-        		        st_dst_reg dst, st_src_reg src0);
-
-   glsl_to_tgsi_instruction *emit(ir_instruction *ir, unsigned op,
-        		        st_dst_reg dst, st_src_reg src0, st_src_reg src1);
-
-   glsl_to_tgsi_instruction *emit(ir_instruction *ir, unsigned op,
-        		        st_dst_reg dst,
-        		        st_src_reg src0, st_src_reg src1, st_src_reg src2);
-   
-   unsigned get_opcode(ir_instruction *ir, unsigned op,
-                    st_dst_reg dst,
-                    st_src_reg src0, st_src_reg src1);
-
-   /**
-    * Emit the correct dot-product instruction for the type of arguments
-    */
-   glsl_to_tgsi_instruction *emit_dp(ir_instruction *ir,
-                                     st_dst_reg dst,
-                                     st_src_reg src0,
-                                     st_src_reg src1,
-                                     unsigned elements);
-
-   void emit_scalar(ir_instruction *ir, unsigned op,
-        	    st_dst_reg dst, st_src_reg src0);
-
-   void emit_scalar(ir_instruction *ir, unsigned op,
-        	    st_dst_reg dst, st_src_reg src0, st_src_reg src1);
-
-   void emit_arl(ir_instruction *ir, st_dst_reg dst, st_src_reg src0);
-
-   void emit_scs(ir_instruction *ir, unsigned op,
-        	 st_dst_reg dst, const st_src_reg &src);
-
-   bool try_emit_mad(ir_expression *ir,
-              int mul_operand);
-   bool try_emit_mad_for_and_not(ir_expression *ir,
-              int mul_operand);
-   bool try_emit_sat(ir_expression *ir);
-
-   void emit_swz(ir_expression *ir);
-
-   bool process_move_condition(ir_rvalue *ir);
-
-   void simplify_cmp(void);
-
-   void rename_temp_register(int index, int new_index);
-   int get_first_temp_read(int index);
-   int get_first_temp_write(int index);
-   int get_last_temp_read(int index);
-   int get_last_temp_write(int index);
-
-   void copy_propagate(void);
-   void eliminate_dead_code(void);
-   int eliminate_dead_code_advanced(void);
-   void merge_registers(void);
-   void renumber_registers(void);
-
-   void emit_block_mov(ir_assignment *ir, const struct glsl_type *type,
-                       st_dst_reg *l, st_src_reg *r);
-
-   void *mem_ctx;
-};
-
 static st_src_reg undef_src = st_src_reg(PROGRAM_UNDEFINED, 0, GLSL_TYPE_ERROR);
 
 static st_dst_reg undef_dst = st_dst_reg(PROGRAM_UNDEFINED, SWIZZLE_NOOP, GLSL_TYPE_ERROR);
@@ -487,20 +128,6 @@ fail_link(struct gl_shader_program *prog, const char *fmt, ...)
    prog->LinkStatus = GL_FALSE;
 }
 
-static int
-swizzle_for_size(int size)
-{
-   int size_swizzles[4] = {
-      MAKE_SWIZZLE4(SWIZZLE_X, SWIZZLE_X, SWIZZLE_X, SWIZZLE_X),
-      MAKE_SWIZZLE4(SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Y, SWIZZLE_Y),
-      MAKE_SWIZZLE4(SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Z, SWIZZLE_Z),
-      MAKE_SWIZZLE4(SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Z, SWIZZLE_W),
-   };
-
-   assert((size >= 1) && (size <= 4));
-   return size_swizzles[size - 1];
-}
-
 static bool
 is_tex_instruction(unsigned opcode)
 {
@@ -3264,55 +2891,65 @@ glsl_to_tgsi_visitor::simplify_cmp(void)
    delete [] tempWrites;
 }
 
-/* Replaces all references to a temporary register index with another index. */
+/* Replaces all references to temporary registers according to a remapping
+ * table, where new_index[i] is the new index of temporary i.
+ */
 void
-glsl_to_tgsi_visitor::rename_temp_register(int index, int new_index)
+glsl_to_tgsi_visitor::rename_temp_registers(const int *new_index)
 {
    foreach_list(node, &this->instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
       unsigned j;
       
       for (j=0; j < num_inst_src_regs(inst->op); j++) {
-         if (inst->src[j].file == PROGRAM_TEMPORARY && 
-             inst->src[j].index == index) {
-            inst->src[j].index = new_index;
-         }
+         if (inst->src[j].file == PROGRAM_TEMPORARY)
+            inst->src[j].index = new_index[inst->src[j].index];
       }
 
       for (j=0; j < inst->tex_offset_num_offset; j++) {
-         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY && 
-             inst->tex_offsets[j].index == index) {
-            inst->tex_offsets[j].index = new_index;
-         }
+         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY)
+            inst->tex_offsets[j].index = new_index[inst->tex_offsets[j].index];
       }
       
-      if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == index) {
-         inst->dst.index = new_index;
-      }
+      if (inst->dst.file == PROGRAM_TEMPORARY)
+         inst->dst.index = new_index[inst->dst.index];
    }
 }
 
-int
-glsl_to_tgsi_visitor::get_first_temp_read(int index)
+/*
+ * The functions below compute, in a single walk over the instruction list,
+ * the index of the first/last instruction reading or writing each temporary.
+ * The arrays are indexed by temporary and have next_temp entries; unused
+ * temporaries get -1.
+ *
+ * An access inside a loop is extended to the whole outermost loop: first
+ * accesses are moved to the BGNLOOP and last accesses to the ENDLOOP, since
+ * the value may be live across iterations.
+ */
+
+void
+glsl_to_tgsi_visitor::get_first_temp_read(int *first_reads)
 {
    int depth = 0; /* loop depth */
    int loop_start = -1; /* index of the first active BGNLOOP (if any) */
    unsigned i = 0, j;
+
+   for (j = 0; j < (unsigned) this->next_temp; j++)
+      first_reads[j] = -1;
    
    foreach_list(node, &this->instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
       
       for (j=0; j < num_inst_src_regs(inst->op); j++) {
-         if (inst->src[j].file == PROGRAM_TEMPORARY && 
-             inst->src[j].index == index) {
-            return (depth == 0) ? i : loop_start;
-         }
+         if (inst->src[j].file == PROGRAM_TEMPORARY &&
+             first_reads[inst->src[j].index] == -1)
+            first_reads[inst->src[j].index] = (depth == 0) ? i : loop_start;
       }
       for (j=0; j < inst->tex_offset_num_offset; j++) {
-         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY && 
-             inst->tex_offsets[j].index == index) {
-            return (depth == 0) ? i : loop_start;
-         }
+         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY &&
+             first_reads[inst->tex_offsets[j].index] == -1)
+            first_reads[inst->tex_offsets[j].index] =
+               (depth == 0) ? i : loop_start;
       }
       
       if (inst->op == TGSI_OPCODE_BGNLOOP) {
@@ -3326,100 +2963,212 @@ glsl_to_tgsi_visitor::get_first_temp_read(int index)
       
       i++;
    }
-   
-   return -1;
 }
 
-int
-glsl_to_tgsi_visitor::get_first_temp_write(int index)
+/* Records an access to temporary \p index by instruction \p i at loop depth
+ * \p depth.  Accesses inside a loop are marked with -2 and queued in
+ * \p pending, to be resolved to the index of the ENDLOOP.
+ */
+static inline void
+mark_last_temp_access(int *last, int index, int i, int depth,
+                      int *pending, int *num_pending)
+{
+   if (depth == 0) {
+      last[index] = i;
+   } else if (last[index] != -2) {
+      last[index] = -2;
+      pending[(*num_pending)++] = index;
+   }
+}
+
+static inline void
+resolve_last_temp_accesses(int *last, int i, int *pending, int *num_pending)
+{
+   for (int k = 0; k < *num_pending; k++) {
+      if (last[pending[k]] == -2)
+         last[pending[k]] = i;
+   }
+   *num_pending = 0;
+}
+
+void
+glsl_to_tgsi_visitor::get_last_temp_read_first_temp_write(int *last_reads,
+                                                          int *first_writes)
 {
    int depth = 0; /* loop depth */
    int loop_start = -1; /* index of the first active BGNLOOP (if any) */
+   int *pending = ralloc_array(mem_ctx, int, this->next_temp);
+   int num_pending = 0;
+   unsigned j;
    int i = 0;
+
+   for (j = 0; j < (unsigned) this->next_temp; j++) {
+      last_reads[j] = -1;
+      first_writes[j] = -1;
+   }
    
    foreach_list(node, &this->instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
       
-      if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == index) {
-         return (depth == 0) ? i : loop_start;
+      for (j=0; j < num_inst_src_regs(inst->op); j++) {
+         if (inst->src[j].file == PROGRAM_TEMPORARY)
+            mark_last_temp_access(last_reads, inst->src[j].index, i, depth,
+                                  pending, &num_pending);
+      }
+      for (j=0; j < inst->tex_offset_num_offset; j++) {
+         if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY)
+            mark_last_temp_access(last_reads, inst->tex_offsets[j].index, i,
+                                  depth, pending, &num_pending);
       }
+
+      if (inst->dst.file == PROGRAM_TEMPORARY &&
+          first_writes[inst->dst.index] == -1)
+         first_writes[inst->dst.index] = (depth == 0) ? i : loop_start;
       
       if (inst->op == TGSI_OPCODE_BGNLOOP) {
          if(depth++ == 0)
             loop_start = i;
       } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
-         if (--depth == 0)
+         if (--depth == 0) {
             loop_start = -1;
+            resolve_last_temp_accesses(last_reads, i, pending, &num_pending);
+         }
       }
       assert(depth >= 0);
       
       i++;
    }
-   
-   return -1;
+
+   ralloc_free(pending);
 }
 
-int
-glsl_to_tgsi_visitor::get_last_temp_read(int index)
+void
+glsl_to_tgsi_visitor::get_last_temp_write(int *last_writes)
 {
    int depth = 0; /* loop depth */
-   int last = -1; /* index of last instruction that reads the temporary */
-   unsigned i = 0, j;
+   int *pending = ralloc_array(mem_ctx, int, this->next_temp);
+   int num_pending = 0;
+   int i = 0;
+
+   for (int j = 0; j < this->next_temp; j++)
+      last_writes[j] = -1;
    
    foreach_list(node, &this->instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
       
-      for (j=0; j < num_inst_src_regs(inst->op); j++) {
-         if (inst->src[j].file == PROGRAM_TEMPORARY && 
-             inst->src[j].index == index) {
-            last = (depth == 0) ? i : -2;
-         }
-      }
-      for (j=0; j < inst->tex_offset_num_offset; j++) {
-          if (inst->tex_offsets[j].file == PROGRAM_TEMPORARY &&
-              inst->tex_offsets[j].index == index)
-              last = (depth == 0) ? i : -2;
-      }
+      if (inst->dst.file == PROGRAM_TEMPORARY)
+         mark_last_temp_access(last_writes, inst->dst.index, i, depth,
+                               pending, &num_pending);
       
       if (inst->op == TGSI_OPCODE_BGNLOOP)
          depth++;
       else if (inst->op == TGSI_OPCODE_ENDLOOP)
-         if (--depth == 0 && last == -2)
-            last = i;
+         if (--depth == 0)
+            resolve_last_temp_accesses(last_writes, i, pending, &num_pending);
       assert(depth >= 0);
       
       i++;
    }
-   
-   assert(last >= -1);
-   return last;
+
+   ralloc_free(pending);
 }
 
-int
-glsl_to_tgsi_visitor::get_last_temp_write(int index)
+/**
+ * An entry of the per-channel tables used by copy_propagate() and
+ * eliminate_dead_code_advanced(): the channel slot (4 * temporary index +
+ * channel) and the instruction recorded in it.
+ */
+struct slot_entry {
+   int slot;
+   glsl_to_tgsi_instruction *inst;
+};
+
+/**
+ * A growable list of table entries.
+ *
+ * The passes thread the entries they record on these lists so that they can
+ * find the ones an instruction affects without walking every temporary in
+ * the program.  Entries are not removed when their slot is overwritten; they
+ * are recognized as stale by comparing the recorded instruction with the
+ * table.
+ */
+struct slot_list {
+   slot_entry *entries;
+   unsigned count;
+   unsigned size;
+};
+
+static void
+slot_list_add(void *mem_ctx, slot_list *list, int slot,
+              glsl_to_tgsi_instruction *inst)
 {
-   int depth = 0; /* loop depth */
-   int last = -1; /* index of last instruction that writes to the temporary */
-   int i = 0;
-   
-   foreach_list(node, &this->instructions) {
+   if (list->count == list->size) {
+      list->size = MAX2(16, list->size * 2);
+      list->entries = reralloc(mem_ctx, list->entries, slot_entry, list->size);
+   }
+
+   list->entries[list->count].slot = slot;
+   list->entries[list->count].inst = inst;
+   list->count++;
+}
+
+/* Returns the deepest IF nesting level in the instruction list. */
+static int
+get_max_if_depth(exec_list *instructions)
+{
+   int level = 0, max_level = 0;
+
+   foreach_list(node, instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
-      
-      if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == index)
-         last = (depth == 0) ? i : -2;
-      
-      if (inst->op == TGSI_OPCODE_BGNLOOP)
-         depth++;
-      else if (inst->op == TGSI_OPCODE_ENDLOOP)
-         if (--depth == 0 && last == -2)
-            last = i;
-      assert(depth >= 0);
-      
-      i++;
+
+      if (inst->op == TGSI_OPCODE_IF || inst->op == TGSI_OPCODE_UIF)
+         max_level = MAX2(max_level, ++level);
+      else if (inst->op == TGSI_OPCODE_ENDIF)
+         --level;
    }
-   
-   assert(last >= -1);
-   return last;
+
+   return max_level;
+}
+
+/* Removes all entries recorded on \p lists[0..num_lists-1] from \p table. */
+static void
+clear_slot_lists(glsl_to_tgsi_instruction **table, slot_list *lists,
+                 int num_lists)
+{
+   for (int l = 0; l < num_lists; l++) {
+      for (unsigned k = 0; k < lists[l].count; k++) {
+         if (table[lists[l].entries[k].slot] == lists[l].entries[k].inst)
+            table[lists[l].entries[k].slot] = NULL;
+      }
+      lists[l].count = 0;
+   }
+}
+
+/* Removes from the ACP the copies on \p list whose source is channels
+ * \p writemask of register \p index, and drops stale entries from the list.
+ */
+static void
+acp_kill_copies_from(glsl_to_tgsi_instruction **acp, slot_list *list,
+                     int index, int writemask)
+{
+   unsigned n = 0;
+
+   for (unsigned k = 0; k < list->count; k++) {
+      slot_entry e = list->entries[k];
+
+      if (acp[e.slot] != e.inst)
+         continue;
+
+      if (e.inst->src[0].index == index &&
+          writemask & (1 << GET_SWZ(e.inst->src[0].swizzle, e.slot % 4))) {
+         acp[e.slot] = NULL;
+         continue;
+      }
+
+      list->entries[n++] = e;
+   }
+
+   list->count = n;
 }
 
 /*
@@ -3450,6 +3199,16 @@ glsl_to_tgsi_visitor::copy_propagate(void)
         					    this->next_temp * 4);
    int *acp_level = rzalloc_array(mem_ctx, int, this->next_temp * 4);
    int level = 0;
+   int num_levels = get_max_if_depth(&this->instructions) + 1;
+
+   /* Each ACP entry is recorded on the list for the IF level it was added
+    * at, and on the list for the register it copies from.
+    */
+   void *lists_ctx = ralloc_context(NULL);
+   slot_list *level_copies = rzalloc_array(lists_ctx, slot_list, num_levels);
+   slot_list *temp_copies = rzalloc_array(lists_ctx, slot_list,
+                                          this->next_temp);
+   slot_list output_copies = { NULL, 0, 0 };
 
    foreach_list(node, &this->instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
@@ -3518,7 +3277,7 @@ glsl_to_tgsi_visitor::copy_propagate(void)
       case TGSI_OPCODE_BGNLOOP:
       case TGSI_OPCODE_ENDLOOP:
          /* End of a basic block, clear the ACP entirely. */
-         memset(acp, 0, sizeof(*acp) * this->next_temp * 4);
+         clear_slot_lists(acp, level_copies, num_levels);
          break;
 
       case TGSI_OPCODE_IF:
@@ -3529,17 +3288,10 @@ glsl_to_tgsi_visitor::copy_propagate(void)
       case TGSI_OPCODE_ENDIF:
       case TGSI_OPCODE_ELSE:
          /* Clear all channels written inside the block from the ACP, but
-          * leaving those that were not touched.
+          * leaving those that were not touched.  Entries added at deeper
+          * levels have already been cleared by the inner ENDIFs.
           */
-         for (int r = 0; r < this->next_temp; r++) {
-            for (int c = 0; c < 4; c++) {
-               if (!acp[4 * r + c])
-        	  continue;
-
-               if (acp_level[4 * r + c] >= level)
-        	  acp[4 * r + c] = NULL;
-            }
-         }
+         clear_slot_lists(acp, &level_copies[level], 1);
          if (inst->op == TGSI_OPCODE_ENDIF)
             --level;
          break;
@@ -3552,21 +3304,13 @@ glsl_to_tgsi_visitor::copy_propagate(void)
             /* Any temporary might be written, so no copy propagation
              * across this instruction.
              */
-            memset(acp, 0, sizeof(*acp) * this->next_temp * 4);
+            clear_slot_lists(acp, level_copies, num_levels);
          } else if (inst->dst.file == PROGRAM_OUTPUT &&
         	    inst->dst.reladdr) {
             /* Any output might be written, so no copy propagation
              * from outputs across this instruction.
              */
-            for (int r = 0; r < this->next_temp; r++) {
-               for (int c = 0; c < 4; c++) {
-        	  if (!acp[4 * r + c])
-        	     continue;
-
-        	  if (acp[4 * r + c]->src[0].file == PROGRAM_OUTPUT)
-        	     acp[4 * r + c] = NULL;
-               }
-            }
+            clear_slot_lists(acp, &output_copies, 1);
          } else if (inst->dst.file == PROGRAM_TEMPORARY ||
         	    inst->dst.file == PROGRAM_OUTPUT) {
             /* Clear where it's used as dst. */
@@ -3579,21 +3323,11 @@ glsl_to_tgsi_visitor::copy_propagate(void)
             }
 
             /* Clear where it's used as src. */
-            for (int r = 0; r < this->next_temp; r++) {
-               for (int c = 0; c < 4; c++) {
-        	  if (!acp[4 * r + c])
-        	     continue;
-
-        	  int src_chan = GET_SWZ(acp[4 * r + c]->src[0].swizzle, c);
-
-        	  if (acp[4 * r + c]->src[0].file == inst->dst.file &&
-        	      acp[4 * r + c]->src[0].index == inst->dst.index &&
-        	      inst->dst.writemask & (1 << src_chan))
-        	  {
-        	     acp[4 * r + c] = NULL;
-        	  }
-               }
-            }
+            acp_kill_copies_from(acp,
+                                 inst->dst.file == PROGRAM_TEMPORARY ?
+                                 &temp_copies[inst->dst.index] :
+                                 &output_copies,
+                                 inst->dst.index, inst->dst.writemask);
          }
          break;
       }
@@ -3610,13 +3344,23 @@ glsl_to_tgsi_visitor::copy_propagate(void)
           !inst->src[0].negate) {
          for (int i = 0; i < 4; i++) {
             if (inst->dst.writemask & (1 << i)) {
-               acp[4 * inst->dst.index + i] = inst;
-               acp_level[4 * inst->dst.index + i] = level;
+               int slot = 4 * inst->dst.index + i;
+
+               acp[slot] = inst;
+               acp_level[slot] = level;
+
+               slot_list_add(lists_ctx, &level_copies[level], slot, inst);
+               if (inst->src[0].file == PROGRAM_TEMPORARY)
+                  slot_list_add(lists_ctx, &temp_copies[inst->src[0].index],
+                                slot, inst);
+               else if (inst->src[0].file == PROGRAM_OUTPUT)
+                  slot_list_add(lists_ctx, &output_copies, slot, inst);
             }
          }
       }
    }
 
+   ralloc_free(lists_ctx);
    ralloc_free(acp_level);
    ralloc_free(acp);
 }
@@ -3636,31 +3380,41 @@ glsl_to_tgsi_visitor::copy_propagate(void)
  *
  * 0: TXP TEMP[2], INPUT[4].xyyw, texture[0], 2D;
  * 
+ * Removing an instruction can make the temporaries it read dead in turn, so
+ * this returns the number of instructions removed and should be run until
+ * it returns 0.
+ *
  * FIXME: assumes that all functions are inlined (no support for BGNSUB/ENDSUB)
  * FIXME: doesn't eliminate all dead code inside of loops; it steps around them
  */
-void
+int
 glsl_to_tgsi_visitor::eliminate_dead_code(void)
 {
-   int i;
+   int *last_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *first_writes = ralloc_array(mem_ctx, int, this->next_temp);
+   int removed = 0;
+   int j = 0;
+
+   get_last_temp_read_first_temp_write(last_reads, first_writes);
    
-   for (i=0; i < this->next_temp; i++) {
-      int last_read = get_last_temp_read(i);
-      int j = 0;
-      
-      foreach_list_safe(node, &this->instructions) {
-         glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
+   foreach_list_safe(node, &this->instructions) {
+      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
 
-         if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == i &&
-             j > last_read)
-         {
-            inst->remove();
-            delete inst;
-         }
-         
-         j++;
+      if (inst->dst.file == PROGRAM_TEMPORARY &&
+          j > last_reads[inst->dst.index])
+      {
+         inst->remove();
+         delete inst;
+         removed++;
       }
+      
+      j++;
    }
+
+   ralloc_free(first_writes);
+   ralloc_free(last_reads);
+
+   return removed;
 }
 
 /*
@@ -3684,6 +3438,11 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
    int *write_level = rzalloc_array(mem_ctx, int, this->next_temp * 4);
    int level = 0;
    int removed = 0;
+   int num_levels = get_max_if_depth(&this->instructions) + 1;
+
+   /* Each entry of the write array is recorded on the list for its level. */
+   void *lists_ctx = ralloc_context(NULL);
+   slot_list *level_writes = rzalloc_array(lists_ctx, slot_list, num_levels);
 
    foreach_list(node, &this->instructions) {
       glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
@@ -3704,7 +3463,7 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
           * dead code of this type, so it shouldn't make a difference as long as
           * the dead code elimination pass in the GLSL compiler does its job.
           */
-         memset(writes, 0, sizeof(*writes) * this->next_temp * 4);
+         clear_slot_lists(writes, level_writes, num_levels);
          break;
 
       case TGSI_OPCODE_ENDIF:
@@ -3712,14 +3471,19 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
          /* Promote the recorded level of all channels written inside the
           * preceding if or else block to the level above the if/else block.
           */
-         for (int r = 0; r < this->next_temp; r++) {
-            for (int c = 0; c < 4; c++) {
-               if (!writes[4 * r + c])
-        	         continue;
+         if (level > 0) {
+            slot_list *list = &level_writes[level];
 
-               if (write_level[4 * r + c] == level)
-        	         write_level[4 * r + c] = level-1;
+            for (unsigned k = 0; k < list->count; k++) {
+               slot_entry e = list->entries[k];
+
+               if (writes[e.slot] != e.inst || write_level[e.slot] != level)
+                  continue;
+
+               write_level[e.slot] = level-1;
+               slot_list_add(lists_ctx, &level_writes[level-1], e.slot, e.inst);
             }
+            list->count = 0;
          }
 
          if(inst->op == TGSI_OPCODE_ENDIF)
@@ -3741,7 +3505,7 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
                /* Any temporary might be read, so no dead code elimination 
                 * across this instruction.
                 */
-               memset(writes, 0, sizeof(*writes) * this->next_temp * 4);
+               clear_slot_lists(writes, level_writes, num_levels);
             } else if (inst->src[i].file == PROGRAM_TEMPORARY) {
                /* Clear where it's used as src. */
                int src_chans = 1 << GET_SWZ(inst->src[i].swizzle, 0);
@@ -3761,7 +3525,7 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
                /* Any temporary might be read, so no dead code elimination 
                 * across this instruction.
                 */
-               memset(writes, 0, sizeof(*writes) * this->next_temp * 4);
+               clear_slot_lists(writes, level_writes, num_levels);
             } else if (inst->tex_offsets[i].file == PROGRAM_TEMPORARY) {
                /* Clear where it's used as src. */
                int src_chans = 1 << GET_SWZ(inst->tex_offsets[i].swizzle, 0);
@@ -3796,6 +3560,8 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
                }
                writes[4 * inst->dst.index + c] = inst;
                write_level[4 * inst->dst.index + c] = level;
+               slot_list_add(lists_ctx, &level_writes[level],
+                             4 * inst->dst.index + c, inst);
             }
          }
       }
@@ -3826,6 +3592,7 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
          inst->dst.writemask &= ~(inst->dead_mask);
    }
 
+   ralloc_free(lists_ctx);
    ralloc_free(write_level);
    ralloc_free(writes);
    
@@ -3834,55 +3601,85 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
 
 /* Merges temporary registers together where possible to reduce the number of 
  * registers needed to run a program.
+ *
+ * This is a linear scan allocation over the live ranges of the temporaries:
+ * walking the instructions in order, each temporary takes over the register
+ * of one whose last read is at or before its first write, if there is one.
  * 
  * Produces optimal code only after copy propagation and dead code elimination 
  * have been run. */
 void
 glsl_to_tgsi_visitor::merge_registers(void)
 {
-   int *last_reads = rzalloc_array(mem_ctx, int, this->next_temp);
-   int *first_writes = rzalloc_array(mem_ctx, int, this->next_temp);
-   int i, j;
-   
-   /* Read the indices of the last read and first write to each temp register
-    * into an array so that we don't have to traverse the instruction list as 
-    * much. */
-   for (i=0; i < this->next_temp; i++) {
-      last_reads[i] = get_last_temp_read(i);
-      first_writes[i] = get_first_temp_write(i);
+   void *tmp_ctx = ralloc_context(NULL);
+   int *last_reads = ralloc_array(tmp_ctx, int, this->next_temp);
+   int *first_writes = ralloc_array(tmp_ctx, int, this->next_temp);
+   int *new_index = ralloc_array(tmp_ctx, int, this->next_temp);
+   int *next_start = ralloc_array(tmp_ctx, int, this->next_temp);
+   int *next_end = ralloc_array(tmp_ctx, int, this->next_temp);
+   int *free_regs = ralloc_array(tmp_ctx, int, this->next_temp);
+   int num_free = 0;
+   int num_inst = 0;
+   int i, t;
+
+   get_last_temp_read_first_temp_write(last_reads, first_writes);
+
+   foreach_list(node, &this->instructions)
+      num_inst++;
+
+   /* Bucket the live ranges by the instruction they start and end at.  The
+    * buckets are filled in reverse so that they are in increasing register
+    * order, which keeps the result deterministic.
+    */
+   int *start_head = ralloc_array(tmp_ctx, int, num_inst);
+   int *end_head = ralloc_array(tmp_ctx, int, num_inst);
+   for (i = 0; i < num_inst; i++) {
+      start_head[i] = -1;
+      end_head[i] = -1;
    }
-   
-   /* Start looking for registers with non-overlapping usages that can be 
-    * merged together. */
-   for (i=0; i < this->next_temp; i++) {
+
+   for (t = this->next_temp - 1; t >= 0; t--) {
+      new_index[t] = t;
+
       /* Don't touch unused registers. */
-      if (last_reads[i] < 0 || first_writes[i] < 0) continue;
-      
-      for (j=0; j < this->next_temp; j++) {
-         /* Don't touch unused registers. */
-         if (last_reads[j] < 0 || first_writes[j] < 0) continue;
-         
-         /* We can merge the two registers if the first write to j is after or 
-          * in the same instruction as the last read from i.  Note that the 
-          * register at index i will always be used earlier or at the same time 
-          * as the register at index j. */
-         if (first_writes[i] <= first_writes[j] && 
-             last_reads[i] <= first_writes[j])
-         {
-            rename_temp_register(j, i); /* Replace all references to j with i.*/
-            
-            /* Update the first_writes and last_reads arrays with the new 
-             * values for the merged register index, and mark the newly unused 
-             * register index as such. */
-            last_reads[i] = last_reads[j];
-            first_writes[j] = -1;
-            last_reads[j] = -1;
-         }
+      if (last_reads[t] < 0 || first_writes[t] < 0)
+         continue;
+
+      /* A read before the first write sees an undefined value, so the live
+       * range only needs to start at the first write.
+       */
+      last_reads[t] = MAX2(last_reads[t], first_writes[t]);
+
+      next_start[t] = start_head[first_writes[t]];
+      start_head[first_writes[t]] = t;
+      next_end[t] = end_head[last_reads[t]];
+      end_head[last_reads[t]] = t;
+   }
+
+   for (i = 0; i < num_inst; i++) {
+      /* Registers whose last read is this instruction can be written by it. */
+      for (t = end_head[i]; t != -1; t = next_end[t]) {
+         if (first_writes[t] < i)
+            free_regs[num_free++] = new_index[t];
+      }
+
+      for (t = start_head[i]; t != -1; t = next_start[t]) {
+         if (num_free > 0)
+            new_index[t] = free_regs[--num_free];
+      }
+
+      /* Live ranges that start and end here are only freed once they have
+       * been assigned a register.
+       */
+      for (t = end_head[i]; t != -1; t = next_end[t]) {
+         if (first_writes[t] == i)
+            free_regs[num_free++] = new_index[t];
       }
    }
-   
-   ralloc_free(last_reads);
-   ralloc_free(first_writes);
+
+   rename_temp_registers(new_index);
+
+   ralloc_free(tmp_ctx);
 }
 
 /* Reassign indices to temporary registers by reusing unused indices created 
@@ -3890,17 +3687,25 @@ glsl_to_tgsi_visitor::merge_registers(void)
 void
 glsl_to_tgsi_visitor::renumber_registers(void)
 {
+   int *first_reads = ralloc_array(mem_ctx, int, this->next_temp);
+   int *new_index = ralloc_array(mem_ctx, int, this->next_temp);
    int i = 0;
-   int new_index = 0;
+   int new_next_temp = 0;
+
+   get_first_temp_read(first_reads);
    
    for (i=0; i < this->next_temp; i++) {
-      if (get_first_temp_read(i) < 0) continue;
-      if (i != new_index)
-         rename_temp_register(i, new_index);
-      new_index++;
+      if (first_reads[i] < 0)
+         new_index[i] = i;
+      else
+         new_index[i] = new_next_temp++;
    }
-   
-   this->next_temp = new_index;
+
+   rename_temp_registers(new_index);
+   this->next_temp = new_next_temp;
+
+   ralloc_free(new_index);
+   ralloc_free(first_reads);
 }
 
 /**
@@ -5176,14 +4981,17 @@ get_mesa_program(struct gl_context *ctx,
 #if 0
    /* Print out some information (for debugging purposes) used by the 
     * optimization passes. */
+   int *fr = ralloc_array(v->mem_ctx, int, v->next_temp);
+   int *fw = ralloc_array(v->mem_ctx, int, v->next_temp);
+   int *lr = ralloc_array(v->mem_ctx, int, v->next_temp);
+   int *lw = ralloc_array(v->mem_ctx, int, v->next_temp);
+   v->get_first_temp_read(fr);
+   v->get_last_temp_read_first_temp_write(lr, fw);
+   v->get_last_temp_write(lw);
    for (i=0; i < v->next_temp; i++) {
-      int fr = v->get_first_temp_read(i);
-      int fw = v->get_first_temp_write(i);
-      int lr = v->get_last_temp_read(i);
-      int lw = v->get_last_temp_write(i);
-      
-      printf("Temp %d: FR=%3d FW=%3d LR=%3d LW=%3d\n", i, fr, fw, lr, lw);
-      assert(fw <= fr);
+      printf("Temp %d: FR=%3d FW=%3d LR=%3d LW=%3d\n", i, fr[i], fw[i], lr[i],
+             lw[i]);
+      assert(fw[i] <= fr[i]);
    }
 #endif
 
@@ -5192,7 +5000,7 @@ get_mesa_program(struct gl_context *ctx,
    v->copy_propagate();
    while (v->eliminate_dead_code_advanced());
 
-   v->eliminate_dead_code();
+   while (v->eliminate_dead_code());
    v->merge_registers();
    v->renumber_registers();
    
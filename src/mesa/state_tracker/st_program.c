@@ -52,9 +52,151 @@
 #include "st_program.h"
 #include "st_mesa_to_tgsi.h"
 #include "cso_cache/cso_context.h"
+#include "cso_cache/cso_hash.h"
+#include "util/u_hash.h"
 
 
 
+/**
+ * Initialize the variant table of a new program.
+ */
+void
+st_init_variant_table(struct st_variant_table *table)
+{
+   memset(table, 0, sizeof(*table));
+   pipe_mutex_init(table->mutex);
+}
+
+
+/**
+ * Free the variant table of a program being deleted, whose variants have
+ * been released.
+ */
+void
+st_destroy_variant_table(struct st_variant_table *table)
+{
+   assert(!table->hash);
+   pipe_mutex_destroy(table->mutex);
+}
+
+
+/**
+ * Look up a variant by key in a program's variant table.
+ * The table's mutex must be held.
+ *
+ * \param hash_key  returns the hash of the key, for insert_variant(), if
+ *                  the variant isn't found
+ */
+static void *
+lookup_variant(struct st_context *st, struct st_variant_table *table,
+               const void *key, unsigned key_size, unsigned *hash_key)
+{
+   struct cso_hash_iter iter;
+
+   st->variant_stats.lookups++;
+
+   /* State changes usually keep selecting the same variant, so check the
+    * last one before hashing the key.
+    */
+   if (table->last && memcmp(table->last, key, key_size) == 0) {
+      st->variant_stats.mru_hits++;
+      return table->last;
+   }
+
+   *hash_key = util_hash_crc32(key, key_size);
+   if (!table->hash)
+      return NULL;
+
+   iter = cso_hash_find(table->hash, *hash_key);
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == *hash_key) {
+      void *variant = cso_hash_iter_data(iter);
+
+      st->variant_stats.key_compares++;
+      if (memcmp(variant, key, key_size) == 0) {
+         table->last = variant;
+         return variant;
+      }
+      iter = cso_hash_iter_next(iter);
+   }
+
+   return NULL;
+}
+
+
+/**
+ * Add a newly translated variant to a program's variant table.
+ * The table's mutex must be held.
+ */
+static void
+insert_variant(struct st_context *st, struct st_variant_table *table,
+               void *variant, unsigned hash_key, const char *kind)
+{
+   if (!table->hash) {
+      table->hash = cso_hash_create();
+      if (!table->hash)
+         return;
+   }
+
+   cso_hash_insert(table->hash, hash_key, variant);
+   table->last = variant;
+   table->count++;
+
+   st->variant_stats.created++;
+   ST_DBG(DEBUG_VARIANTS,
+          "st: new %s variant, %u in program; %u variants created, "
+          "%u lookups, %u last-used hits, %u key compares\n",
+          kind, table->count, st->variant_stats.created,
+          st->variant_stats.lookups, st->variant_stats.mru_hits,
+          st->variant_stats.key_compares);
+}
+
+
+/**
+ * Remove a variant from a program's variant table.  The variant itself is
+ * not freed.  The table's mutex must be held.
+ */
+static void
+remove_variant(struct st_variant_table *table, void *variant,
+               unsigned key_size)
+{
+   struct cso_hash_iter iter;
+   unsigned hash_key;
+
+   if (table->last == variant)
+      table->last = NULL;
+
+   if (!table->hash)
+      return;
+
+   hash_key = util_hash_crc32(variant, key_size);
+   iter = cso_hash_find(table->hash, hash_key);
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
+      if (cso_hash_iter_data(iter) == variant) {
+         cso_hash_erase(table->hash, iter);
+         table->count--;
+         return;
+      }
+      iter = cso_hash_iter_next(iter);
+   }
+}
+
+
+/**
+ * Empty a program's variant table, when all its variants are freed.
+ */
+static void
+clear_variant_table(struct st_variant_table *table)
+{
+   if (table->hash)
+      cso_hash_delete(table->hash);
+   table->hash = NULL;
+   table->last = NULL;
+   table->count = 0;
+}
+
+
 /**
  * Delete a vertex program variant.  Note the caller must unlink
  * the variant from the linked list.
@@ -85,6 +227,8 @@ st_release_vp_variants( struct st_context *st,
 {
    struct st_vp_variant *vpv;
 
+   pipe_mutex_lock(stvp->variant_table.mutex);
+
    for (vpv = stvp->variants; vpv; ) {
       struct st_vp_variant *next = vpv->next;
       delete_vp_variant(st, vpv);
@@ -92,6 +236,9 @@ st_release_vp_variants( struct st_context *st,
    }
 
    stvp->variants = NULL;
+   clear_variant_table(&stvp->variant_table);
+
+   pipe_mutex_unlock(stvp->variant_table.mutex);
 }
 
 
@@ -121,6 +268,8 @@ st_release_fp_variants(struct st_context *st, struct st_fragment_program *stfp)
 {
    struct st_fp_variant *fpv;
 
+   pipe_mutex_lock(stfp->variant_table.mutex);
+
    for (fpv = stfp->variants; fpv; ) {
       struct st_fp_variant *next = fpv->next;
       delete_fp_variant(st, fpv);
@@ -128,6 +277,9 @@ st_release_fp_variants(struct st_context *st, struct st_fragment_program *stfp)
    }
 
    stfp->variants = NULL;
+   clear_variant_table(&stfp->variant_table);
+
+   pipe_mutex_unlock(stfp->variant_table.mutex);
 }
 
 
@@ -153,6 +305,8 @@ st_release_gp_variants(struct st_context *st, struct st_geometry_program *stgp)
 {
    struct st_gp_variant *gpv;
 
+   pipe_mutex_lock(stgp->variant_table.mutex);
+
    for (gpv = stgp->variants; gpv; ) {
       struct st_gp_variant *next = gpv->next;
       delete_gp_variant(st, gpv);
@@ -160,6 +314,9 @@ st_release_gp_variants(struct st_context *st, struct st_geometry_program *stgp)
    }
 
    stgp->variants = NULL;
+   clear_variant_table(&stgp->variant_table);
+
+   pipe_mutex_unlock(stgp->variant_table.mutex);
 }
 
 
@@ -417,21 +574,24 @@ st_get_vp_variant(struct st_context *st,
                   const struct st_vp_variant_key *key)
 {
    struct st_vp_variant *vpv;
+   unsigned hash_key;
 
    /* Search for existing variant */
-   for (vpv = stvp->variants; vpv; vpv = vpv->next) {
-      if (memcmp(&vpv->key, key, sizeof(*key)) == 0) {
-         break;
-      }
-   }
+   pipe_mutex_lock(stvp->variant_table.mutex);
+   vpv = lookup_variant(st, &stvp->variant_table, key, sizeof(*key),
+                        &hash_key);
+   pipe_mutex_unlock(stvp->variant_table.mutex);
 
    if (!vpv) {
       /* create now */
       vpv = st_translate_vertex_program(st, stvp, key);
       if (vpv) {
          /* insert into list */
+         pipe_mutex_lock(stvp->variant_table.mutex);
          vpv->next = stvp->variants;
          stvp->variants = vpv;
+         insert_variant(st, &stvp->variant_table, vpv, hash_key, "vertex");
+         pipe_mutex_unlock(stvp->variant_table.mutex);
       }
    }
 
@@ -806,21 +966,24 @@ st_get_fp_variant(struct st_context *st,
                   const struct st_fp_variant_key *key)
 {
    struct st_fp_variant *fpv;
+   unsigned hash_key;
 
    /* Search for existing variant */
-   for (fpv = stfp->variants; fpv; fpv = fpv->next) {
-      if (memcmp(&fpv->key, key, sizeof(*key)) == 0) {
-         break;
-      }
-   }
+   pipe_mutex_lock(stfp->variant_table.mutex);
+   fpv = lookup_variant(st, &stfp->variant_table, key, sizeof(*key),
+                        &hash_key);
+   pipe_mutex_unlock(stfp->variant_table.mutex);
 
    if (!fpv) {
       /* create new */
       fpv = st_translate_fragment_program(st, stfp, key);
       if (fpv) {
          /* insert into list */
+         pipe_mutex_lock(stfp->variant_table.mutex);
          fpv->next = stfp->variants;
          stfp->variants = fpv;
+         insert_variant(st, &stfp->variant_table, fpv, hash_key, "fragment");
+         pipe_mutex_unlock(stfp->variant_table.mutex);
       }
    }
 
@@ -1174,21 +1337,24 @@ st_get_gp_variant(struct st_context *st,
                   const struct st_gp_variant_key *key)
 {
    struct st_gp_variant *gpv;
+   unsigned hash_key;
 
    /* Search for existing variant */
-   for (gpv = stgp->variants; gpv; gpv = gpv->next) {
-      if (memcmp(&gpv->key, key, sizeof(*key)) == 0) {
-         break;
-      }
-   }
+   pipe_mutex_lock(stgp->variant_table.mutex);
+   gpv = lookup_variant(st, &stgp->variant_table, key, sizeof(*key),
+                        &hash_key);
+   pipe_mutex_unlock(stgp->variant_table.mutex);
 
    if (!gpv) {
       /* create new */
       gpv = st_translate_geometry_program(st, stgp, key);
       if (gpv) {
          /* insert into list */
+         pipe_mutex_lock(stgp->variant_table.mutex);
          gpv->next = stgp->variants;
          stgp->variants = gpv;
+         insert_variant(st, &stgp->variant_table, gpv, hash_key, "geometry");
+         pipe_mutex_unlock(stgp->variant_table.mutex);
       }
    }
 
@@ -1257,11 +1423,13 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
          struct st_vertex_program *stvp = (struct st_vertex_program *) program;
          struct st_vp_variant *vpv, **prevPtr = &stvp->variants;
 
+         pipe_mutex_lock(stvp->variant_table.mutex);
          for (vpv = stvp->variants; vpv; ) {
             struct st_vp_variant *next = vpv->next;
             if (vpv->key.st == st) {
                /* unlink from list */
                *prevPtr = next;
+               remove_variant(&stvp->variant_table, vpv, sizeof(vpv->key));
                /* destroy this variant */
                delete_vp_variant(st, vpv);
             }
@@ -1270,6 +1438,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             }
             vpv = next;
          }
+         pipe_mutex_unlock(stvp->variant_table.mutex);
       }
       break;
    case GL_FRAGMENT_PROGRAM_ARB:
@@ -1278,11 +1447,13 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             (struct st_fragment_program *) program;
          struct st_fp_variant *fpv, **prevPtr = &stfp->variants;
 
+         pipe_mutex_lock(stfp->variant_table.mutex);
          for (fpv = stfp->variants; fpv; ) {
             struct st_fp_variant *next = fpv->next;
             if (fpv->key.st == st) {
                /* unlink from list */
                *prevPtr = next;
+               remove_variant(&stfp->variant_table, fpv, sizeof(fpv->key));
                /* destroy this variant */
                delete_fp_variant(st, fpv);
             }
@@ -1291,6 +1462,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             }
             fpv = next;
          }
+         pipe_mutex_unlock(stfp->variant_table.mutex);
       }
       break;
    case MESA_GEOMETRY_PROGRAM:
@@ -1299,11 +1471,13 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             (struct st_geometry_program *) program;
          struct st_gp_variant *gpv, **prevPtr = &stgp->variants;
 
+         pipe_mutex_lock(stgp->variant_table.mutex);
          for (gpv = stgp->variants; gpv; ) {
             struct st_gp_variant *next = gpv->next;
             if (gpv->key.st == st) {
                /* unlink from list */
                *prevPtr = next;
+               remove_variant(&stgp->variant_table, gpv, sizeof(gpv->key));
                /* destroy this variant */
                delete_gp_variant(st, gpv);
             }
@@ -1312,6 +1486,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
             }
             gpv = next;
          }
+         pipe_mutex_unlock(stgp->variant_table.mutex);
       }
       break;
    default:
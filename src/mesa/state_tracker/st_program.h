@@ -37,10 +37,31 @@
 #include "main/mtypes.h"
 #include "program/program.h"
 #include "pipe/p_state.h"
+#include "os/os_thread.h"
 #include "st_context.h"
 #include "st_glsl_to_tgsi.h"
 
 
+struct cso_hash;
+
+
+/**
+ * Hash table of the translated variants of a program.
+ *
+ * All variant types begin with their key, so the table hashes the key and
+ * compares it against the start of each variant.  The variants themselves
+ * are owned by the program's linked list.  Programs are shared between
+ * contexts, so the mutex guards the table and the list.
+ */
+struct st_variant_table
+{
+   pipe_mutex mutex;
+   struct cso_hash *hash;   /**< variants, indexed by a hash of their key */
+   void *last;              /**< most recently used variant */
+   unsigned count;          /**< number of variants in the table */
+};
+
+
 /** Fragment program variant key */
 struct st_fp_variant_key
 {
@@ -66,7 +87,9 @@ struct st_fp_variant_key
  */
 struct st_fp_variant
 {
-   /** Parameters which generated this version of fragment program */
+   /** Parameters which generated this version of fragment program.
+    * Must be first, see st_variant_table.
+    */
    struct st_fp_variant_key key;
 
    struct pipe_shader_state tgsi;
@@ -92,6 +115,7 @@ struct st_fragment_program
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
    struct st_fp_variant *variants;
+   struct st_variant_table variant_table;
 };
 
 
@@ -114,7 +138,7 @@ struct st_vp_variant_key
 struct st_vp_variant
 {
    /* Parameters which generated this translated version of a vertex
-    * shader:
+    * shader.  Must be first, see st_variant_table.
     */
    struct st_vp_variant_key key;
 
@@ -161,6 +185,7 @@ struct st_vertex_program
    /** List of translated variants of this vertex program.
     */
    struct st_vp_variant *variants;
+   struct st_variant_table variant_table;
 };
 
 
@@ -178,7 +203,9 @@ struct st_gp_variant_key
  */
 struct st_gp_variant
 {
-   /* Parameters which generated this translated version of a vertex */
+   /* Parameters which generated this translated version of a vertex.
+    * Must be first, see st_variant_table.
+    */
    struct st_gp_variant_key key;
 
    void *driver_shader;
@@ -214,6 +241,7 @@ struct st_geometry_program
    struct pipe_shader_state tgsi;
 
    struct st_gp_variant *variants;
+   struct st_variant_table variant_table;
 };
 
 
@@ -295,6 +323,12 @@ st_prepare_fragment_program(struct gl_context *ctx,
                             struct st_fragment_program *stfp);
 
 
+extern void
+st_init_variant_table(struct st_variant_table *table);
+
+extern void
+st_destroy_variant_table(struct st_variant_table *table);
+
 extern void
 st_release_vp_variants( struct st_context *st,
                         struct st_vertex_program *stvp );
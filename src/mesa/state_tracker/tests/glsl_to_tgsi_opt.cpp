@@ -0,0 +1,480 @@
+/*
+ * Copyright © 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file glsl_to_tgsi_opt.cpp
+ *
+ * Checks the temporary register passes of glsl_to_tgsi: copy propagation,
+ * both dead code passes and register merging.  Programs are built directly
+ * in the visitor, run through the passes in the same order as
+ * get_mesa_program(), and interpreted before and after to check that the
+ * outputs don't change.  DISABLED_Timing runs the passes on large programs;
+ * run it with --gtest_also_run_disabled_tests.
+ */
+
+#include <gtest/gtest.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "../st_glsl_to_tgsi_private.h"
+
+extern "C" {
+#include "main/macros.h"
+#include "tgsi/tgsi_info.h"
+}
+
+#define NUM_INPUTS 4
+#define NUM_OUTPUTS 4
+
+static const st_src_reg undef_src(PROGRAM_UNDEFINED, 0, GLSL_TYPE_ERROR);
+static const st_dst_reg undef_dst(PROGRAM_UNDEFINED, SWIZZLE_NOOP,
+                                  GLSL_TYPE_ERROR);
+
+static unsigned
+num_inst_src_regs(unsigned opcode)
+{
+   const tgsi_opcode_info *info = tgsi_get_opcode_info(opcode);
+   return info->is_tex ? info->num_src - 1 : info->num_src;
+}
+
+class glsl_to_tgsi_opt : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   st_src_reg src(gl_register_file file, int index, unsigned swizzle);
+   void mov(st_dst_reg dst, st_src_reg src0);
+   void optimize();
+   void run(float out[NUM_OUTPUTS][4]);
+   unsigned count();
+
+   /* Random programs. */
+   unsigned rand(unsigned n);
+   st_src_reg random_src(gl_register_file file, int index);
+   void generate(unsigned num_insts, int num_temps);
+
+   glsl_to_tgsi_visitor *v;
+   unsigned seed;
+};
+
+void
+glsl_to_tgsi_opt::SetUp()
+{
+   v = new glsl_to_tgsi_visitor();
+   seed = 1;
+}
+
+void
+glsl_to_tgsi_opt::TearDown()
+{
+   delete v;
+}
+
+st_src_reg
+glsl_to_tgsi_opt::src(gl_register_file file, int index, unsigned swizzle)
+{
+   st_src_reg reg(file, index, GLSL_TYPE_FLOAT);
+   reg.swizzle = swizzle;
+   return reg;
+}
+
+void
+glsl_to_tgsi_opt::mov(st_dst_reg dst, st_src_reg src0)
+{
+   v->emit(NULL, TGSI_OPCODE_MOV, dst, src0);
+}
+
+/**
+ * The optimization sequence of get_mesa_program().
+ */
+void
+glsl_to_tgsi_opt::optimize()
+{
+   v->copy_propagate();
+   while (v->eliminate_dead_code_advanced());
+   while (v->eliminate_dead_code());
+   v->merge_registers();
+   v->renumber_registers();
+}
+
+/**
+ * Interpret the program with fixed inputs.  Loops run twice.
+ */
+void
+glsl_to_tgsi_opt::run(float out[NUM_OUTPUTS][4])
+{
+   std::vector<glsl_to_tgsi_instruction *> prog;
+   std::map<unsigned, unsigned> match, iterations;
+   std::vector<unsigned> stack;
+   float in[NUM_INPUTS][4];
+
+   foreach_list(node, &v->instructions) {
+      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
+
+      switch (inst->op) {
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_BGNLOOP:
+         stack.push_back(prog.size());
+         break;
+      case TGSI_OPCODE_ELSE:
+         match[stack.back()] = prog.size();
+         stack.back() = prog.size();
+         break;
+      case TGSI_OPCODE_ENDIF:
+      case TGSI_OPCODE_ENDLOOP:
+         match[stack.back()] = prog.size();
+         match[prog.size()] = stack.back();
+         stack.pop_back();
+         break;
+      }
+      prog.push_back(inst);
+   }
+
+   std::vector<float> temps(v->next_temp * 4 + 4, 1234.0f);
+   for (int i = 0; i < NUM_INPUTS; i++)
+      for (int c = 0; c < 4; c++)
+         in[i][c] = (float) ((i * 7 + c * 3) % 5) - 2.0f;
+   for (int i = 0; i < NUM_OUTPUTS; i++)
+      for (int c = 0; c < 4; c++)
+         out[i][c] = 999.0f;
+
+   for (unsigned pc = 0; pc < prog.size(); pc++) {
+      glsl_to_tgsi_instruction *inst = prog[pc];
+      float s[3][4], r[4];
+
+      for (unsigned k = 0; k < num_inst_src_regs(inst->op); k++) {
+         for (int c = 0; c < 4; c++) {
+            int swz = GET_SWZ(inst->src[k].swizzle, c);
+            float val;
+
+            switch (inst->src[k].file) {
+            case PROGRAM_TEMPORARY:
+               val = temps[inst->src[k].index * 4 + swz];
+               break;
+            case PROGRAM_INPUT:
+               val = in[inst->src[k].index][swz];
+               break;
+            case PROGRAM_OUTPUT:
+               val = out[inst->src[k].index][swz];
+               break;
+            default:
+               ADD_FAILURE() << "unexpected register file";
+               return;
+            }
+            s[k][c] = inst->src[k].negate & (1 << c) ? -val : val;
+         }
+      }
+
+      switch (inst->op) {
+      case TGSI_OPCODE_IF:
+         if (s[0][0] == 0.0f)
+            pc = match[pc];
+         continue;
+      case TGSI_OPCODE_ELSE:
+         pc = match[pc];
+         continue;
+      case TGSI_OPCODE_ENDIF:
+         continue;
+      case TGSI_OPCODE_BGNLOOP:
+         iterations[pc] = 0;
+         continue;
+      case TGSI_OPCODE_ENDLOOP:
+         if (++iterations[match[pc]] < 2)
+            pc = match[pc];
+         continue;
+      case TGSI_OPCODE_MOV:
+         for (int c = 0; c < 4; c++)
+            r[c] = s[0][c];
+         break;
+      case TGSI_OPCODE_ADD:
+         for (int c = 0; c < 4; c++)
+            r[c] = s[0][c] + s[1][c];
+         break;
+      case TGSI_OPCODE_MUL:
+         for (int c = 0; c < 4; c++)
+            r[c] = s[0][c] * s[1][c];
+         break;
+      case TGSI_OPCODE_MAD:
+         for (int c = 0; c < 4; c++)
+            r[c] = s[0][c] * s[1][c] + s[2][c];
+         break;
+      default:
+         ADD_FAILURE() << "unexpected opcode " << inst->op;
+         return;
+      }
+
+      for (int c = 0; c < 4; c++) {
+         if (inst->saturate)
+            r[c] = CLAMP(r[c], 0.0f, 1.0f);
+         if (!(inst->dst.writemask & (1 << c)))
+            continue;
+         if (inst->dst.file == PROGRAM_TEMPORARY)
+            temps[inst->dst.index * 4 + c] = r[c];
+         else
+            out[inst->dst.index][c] = r[c];
+      }
+   }
+}
+
+unsigned
+glsl_to_tgsi_opt::count()
+{
+   unsigned n = 0;
+
+   foreach_list(node, &v->instructions)
+      n++;
+   return n;
+}
+
+unsigned
+glsl_to_tgsi_opt::rand(unsigned n)
+{
+   seed = seed * 1103515245 + 12345;
+   return (seed >> 16) % n;
+}
+
+st_src_reg
+glsl_to_tgsi_opt::random_src(gl_register_file file, int index)
+{
+   st_src_reg reg = src(file, index,
+                        rand(8) == 0 ? SWIZZLE_XYZW :
+                        MAKE_SWIZZLE4(rand(4), rand(4), rand(4), rand(4)));
+   if (rand(10) == 0)
+      reg.negate = NEGATE_XYZW;
+   return reg;
+}
+
+/**
+ * Generate a program of MOV/ADD/MUL/MAD with nested IF/ELSE and loops,
+ * partial writes and reads of outputs.  Temporaries are only read after
+ * being written on every path.
+ */
+void
+glsl_to_tgsi_opt::generate(unsigned num_insts, int num_temps)
+{
+   enum { BLOCK_IF, BLOCK_ELSE, BLOCK_LOOP };
+   std::vector<int> defined;
+   std::vector<size_t> scope;
+   std::vector<int> blocks;
+
+   for (int t = 1; t < 4 && t < num_temps; t++) {
+      mov(st_dst_reg(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, t),
+          random_src(PROGRAM_INPUT, rand(NUM_INPUTS)));
+      defined.push_back(t);
+   }
+   for (int o = 0; o < NUM_OUTPUTS; o++) {
+      mov(st_dst_reg(PROGRAM_OUTPUT, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, o),
+          random_src(PROGRAM_INPUT, rand(NUM_INPUTS)));
+   }
+
+   for (unsigned i = 0; i < num_insts; i++) {
+      unsigned k = rand(100);
+
+      if (k < 5 && blocks.size() < 4) {
+         v->emit(NULL, TGSI_OPCODE_IF, undef_dst,
+                 random_src(PROGRAM_TEMPORARY, defined[rand(defined.size())]));
+         scope.push_back(defined.size());
+         blocks.push_back(BLOCK_IF);
+      } else if (k < 8 && !blocks.empty() && blocks.back() == BLOCK_IF) {
+         v->emit(NULL, TGSI_OPCODE_ELSE);
+         defined.resize(scope.back());
+         blocks.back() = BLOCK_ELSE;
+      } else if (k < 12 && !blocks.empty() && blocks.back() != BLOCK_LOOP) {
+         v->emit(NULL, TGSI_OPCODE_ENDIF);
+         defined.resize(scope.back());
+         scope.pop_back();
+         blocks.pop_back();
+      } else if (k < 14 && blocks.size() < 4) {
+         v->emit(NULL, TGSI_OPCODE_BGNLOOP);
+         scope.push_back(defined.size());
+         blocks.push_back(BLOCK_LOOP);
+      } else if (k < 16 && !blocks.empty() && blocks.back() == BLOCK_LOOP) {
+         v->emit(NULL, TGSI_OPCODE_ENDLOOP);
+         defined.resize(scope.back());
+         scope.pop_back();
+         blocks.pop_back();
+      } else {
+         static const unsigned ops[] = {
+            TGSI_OPCODE_MOV, TGSI_OPCODE_MOV, TGSI_OPCODE_MOV,
+            TGSI_OPCODE_ADD, TGSI_OPCODE_MUL, TGSI_OPCODE_MAD
+         };
+         unsigned op = ops[rand(Elements(ops))];
+         st_src_reg s[3] = { undef_src, undef_src, undef_src };
+         st_dst_reg dst;
+
+         for (unsigned j = 0; j < num_inst_src_regs(op); j++) {
+            unsigned f = rand(10);
+            if (f < 6)
+               s[j] = random_src(PROGRAM_TEMPORARY,
+                                 defined[rand(defined.size())]);
+            else if (f < 8)
+               s[j] = random_src(PROGRAM_INPUT, rand(NUM_INPUTS));
+            else
+               s[j] = random_src(PROGRAM_OUTPUT, rand(NUM_OUTPUTS));
+         }
+
+         if (rand(6) == 0) {
+            dst = st_dst_reg(PROGRAM_OUTPUT, 1 + rand(15), GLSL_TYPE_FLOAT,
+                             rand(NUM_OUTPUTS));
+         } else if (rand(3) == 0) {
+            dst = st_dst_reg(PROGRAM_TEMPORARY, 1 + rand(15), GLSL_TYPE_FLOAT,
+                             defined[rand(defined.size())]);
+         } else {
+            int t = 1 + rand(num_temps - 1);
+            dst = st_dst_reg(PROGRAM_TEMPORARY, WRITEMASK_XYZW,
+                             GLSL_TYPE_FLOAT, t);
+            if (std::find(defined.begin(), defined.end(), t) == defined.end())
+               defined.push_back(t);
+         }
+
+         glsl_to_tgsi_instruction *inst =
+            v->emit(NULL, op, dst, s[0], s[1], s[2]);
+         inst->saturate = rand(20) == 0;
+      }
+   }
+
+   while (!blocks.empty()) {
+      v->emit(NULL, blocks.back() == BLOCK_LOOP ? TGSI_OPCODE_ENDLOOP :
+                                                  TGSI_OPCODE_ENDIF);
+      blocks.pop_back();
+   }
+   v->next_temp = num_temps;
+}
+
+/**
+ * Removing an instruction can make the temporaries it read dead, whatever
+ * their numbering.
+ */
+TEST_F(glsl_to_tgsi_opt, dead_chain)
+{
+   st_dst_reg t1(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 1);
+   st_dst_reg t2(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 2);
+   st_dst_reg t3(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 3);
+
+   v->emit(NULL, TGSI_OPCODE_ADD, t1, src(PROGRAM_INPUT, 0, SWIZZLE_XYZW),
+           src(PROGRAM_INPUT, 1, SWIZZLE_XYZW));
+   v->emit(NULL, TGSI_OPCODE_MUL, t2, st_src_reg(t1), st_src_reg(t1));
+   v->emit(NULL, TGSI_OPCODE_ADD, t3, st_src_reg(t2), st_src_reg(t1));
+   mov(st_dst_reg(PROGRAM_OUTPUT, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 0),
+       src(PROGRAM_INPUT, 2, SWIZZLE_XYZW));
+   v->next_temp = 4;
+
+   optimize();
+
+   EXPECT_EQ(1u, count());
+   EXPECT_EQ(0, v->next_temp);
+}
+
+/**
+ * Temporaries with disjoint live ranges share a register, a temporary read
+ * across loop iterations keeps its register for the whole loop.
+ */
+TEST_F(glsl_to_tgsi_opt, merge_registers)
+{
+   st_dst_reg out(PROGRAM_OUTPUT, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 0);
+
+   for (int t = 1; t <= 3; t++) {
+      st_dst_reg temp(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, t);
+      v->emit(NULL, TGSI_OPCODE_ADD, temp,
+              src(PROGRAM_INPUT, t, SWIZZLE_XYZW),
+              src(PROGRAM_OUTPUT, 0, SWIZZLE_XYZW));
+      v->emit(NULL, TGSI_OPCODE_MUL, out, st_src_reg(temp), st_src_reg(temp));
+   }
+   v->next_temp = 4;
+
+   float ref[NUM_OUTPUTS][4], res[NUM_OUTPUTS][4];
+   run(ref);
+   optimize();
+   run(res);
+
+   EXPECT_EQ(6u, count());
+   EXPECT_EQ(1, v->next_temp);
+   EXPECT_EQ(0, memcmp(ref, res, sizeof(ref)));
+
+   /* Now read the first temporary at the top of a loop and write the
+    * second one after it: they must not share a register.
+    */
+   delete v;
+   v = new glsl_to_tgsi_visitor();
+
+   st_dst_reg t1(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 1);
+   st_dst_reg t2(PROGRAM_TEMPORARY, WRITEMASK_XYZW, GLSL_TYPE_FLOAT, 2);
+
+   mov(t1, src(PROGRAM_INPUT, 0, SWIZZLE_XYZW));
+   v->emit(NULL, TGSI_OPCODE_BGNLOOP);
+   v->emit(NULL, TGSI_OPCODE_ADD, out, st_src_reg(t1),
+           src(PROGRAM_OUTPUT, 0, SWIZZLE_XYZW));
+   v->emit(NULL, TGSI_OPCODE_ADD, t2, src(PROGRAM_INPUT, 1, SWIZZLE_XYZW),
+           src(PROGRAM_OUTPUT, 0, SWIZZLE_XYZW));
+   v->emit(NULL, TGSI_OPCODE_MUL, out, st_src_reg(t2), st_src_reg(t2));
+   v->emit(NULL, TGSI_OPCODE_ENDLOOP);
+   v->next_temp = 3;
+
+   run(ref);
+   optimize();
+   run(res);
+
+   EXPECT_EQ(2, v->next_temp);
+   EXPECT_EQ(0, memcmp(ref, res, sizeof(ref)));
+}
+
+/**
+ * The passes must not change the outputs of random programs, or use more
+ * registers than before.
+ */
+TEST_F(glsl_to_tgsi_opt, random_programs)
+{
+   for (unsigned i = 1; i <= 1000; i++) {
+      float ref[NUM_OUTPUTS][4], res[NUM_OUTPUTS][4];
+
+      delete v;
+      v = new glsl_to_tgsi_visitor();
+      seed = i;
+      generate(20 + i % 200, 3 + i % 40);
+
+      int num_temps = v->next_temp;
+      run(ref);
+      optimize();
+      run(res);
+
+      EXPECT_LE(v->next_temp, num_temps) << "seed " << i;
+      EXPECT_EQ(0, memcmp(ref, res, sizeof(ref))) << "seed " << i;
+   }
+}
+
+TEST_F(glsl_to_tgsi_opt, DISABLED_Timing)
+{
+   for (unsigned n = 1000; n <= 64000; n *= 4) {
+      delete v;
+      v = new glsl_to_tgsi_visitor();
+      generate(n, n / 2 + 2);
+
+      clock_t start = clock();
+      optimize();
+      double secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+      printf("%6u instructions: %.3f s\n", n, secs);
+   }
+}
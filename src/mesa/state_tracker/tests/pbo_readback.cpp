@@ -0,0 +1,209 @@
+/*
+ * Copyright © 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file pbo_readback.cpp
+ *
+ * Checks that a glReadPixels into a PBO which is already bound for drawing
+ * is copied in before the next draw reads the buffer, on softpipe.  The
+ * buffer is bound and drawn from first, so the draw doesn't revalidate its
+ * bindings on its own.
+ */
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/fbobject.h"
+#include "main/mtypes.h"
+#include "glapi/glapi.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "state_tracker/st_context.h"
+#include "state_tracker/st_cb_bufferobjects.h"
+}
+
+static const GLfloat clear_color[4] = { 0.0f, 0.2f, 0.6f, 1.0f };
+
+class pbo_readback : public ::testing::Test {
+protected:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   bool read_back();
+   bool pending();
+   void check_contents();
+
+   struct pipe_screen *screen;
+   struct st_context *st;
+   struct gl_context *ctx;
+   GLuint fbo, rbo, buf;
+};
+
+void
+pbo_readback::SetUp()
+{
+   struct pipe_context *pipe;
+   struct gl_config visual;
+   struct st_config_options options;
+   const GLfloat zero[4 * 4] = { 0 };
+
+   screen = softpipe_create_screen(null_sw_create());
+   ASSERT_TRUE(screen != NULL);
+   pipe = screen->context_create(screen, NULL);
+   ASSERT_TRUE(pipe != NULL);
+
+   memset(&visual, 0, sizeof(visual));
+   memset(&options, 0, sizeof(options));
+   st = st_create_context(API_OPENGL_COMPAT, pipe, &visual, NULL, &options);
+   ASSERT_TRUE(st != NULL);
+   ctx = st->ctx;
+
+   /* Readbacks are only queued by the blit path. */
+   st->prefer_blit_based_texture_transfer = GL_TRUE;
+
+   /* Like st_api_make_current() without a drawable. */
+   _mesa_make_current(ctx, _mesa_get_incomplete_framebuffer(),
+                      _mesa_get_incomplete_framebuffer());
+
+   CALL_GenRenderbuffers(ctx->Exec, (1, &rbo));
+   CALL_BindRenderbuffer(ctx->Exec, (GL_RENDERBUFFER, rbo));
+   CALL_RenderbufferStorage(ctx->Exec, (GL_RENDERBUFFER, GL_RGBA8, 4, 4));
+   CALL_GenFramebuffers(ctx->Exec, (1, &fbo));
+   CALL_BindFramebuffer(ctx->Exec, (GL_FRAMEBUFFER, fbo));
+   CALL_FramebufferRenderbuffer(ctx->Exec, (GL_FRAMEBUFFER,
+                                            GL_COLOR_ATTACHMENT0,
+                                            GL_RENDERBUFFER, rbo));
+   ASSERT_EQ((GLenum) GL_FRAMEBUFFER_COMPLETE,
+             CALL_CheckFramebufferStatus(ctx->Exec, (GL_FRAMEBUFFER)));
+   CALL_Viewport(ctx->Exec, (0, 0, 4, 4));
+
+   CALL_ClearColor(ctx->Exec, (clear_color[0], clear_color[1],
+                               clear_color[2], clear_color[3]));
+   CALL_Clear(ctx->Exec, (GL_COLOR_BUFFER_BIT));
+
+   CALL_GenBuffers(ctx->Exec, (1, &buf));
+   CALL_BindBuffer(ctx->Exec, (GL_ARRAY_BUFFER, buf));
+   CALL_BufferData(ctx->Exec, (GL_ARRAY_BUFFER, sizeof(zero), zero,
+                               GL_STREAM_COPY));
+}
+
+void
+pbo_readback::TearDown()
+{
+   if (st) {
+      CALL_DeleteBuffers(ctx->Exec, (1, &buf));
+      CALL_DeleteFramebuffers(ctx->Exec, (1, &fbo));
+      CALL_DeleteRenderbuffers(ctx->Exec, (1, &rbo));
+      _mesa_make_current(NULL, NULL, NULL);
+      st_destroy_context(st);
+      st = NULL;
+   }
+   if (screen) {
+      screen->destroy(screen);
+      screen = NULL;
+   }
+}
+
+/**
+ * Read the 2x2 pixels at the origin into the buffer as floats.
+ * \return whether the copy into the buffer was deferred.
+ */
+bool
+pbo_readback::read_back()
+{
+   CALL_BindBuffer(ctx->Exec, (GL_PIXEL_PACK_BUFFER, buf));
+   CALL_ReadPixels(ctx->Exec, (0, 0, 2, 2, GL_RGBA, GL_FLOAT, NULL));
+   CALL_BindBuffer(ctx->Exec, (GL_PIXEL_PACK_BUFFER, 0));
+   EXPECT_EQ((GLenum) GL_NO_ERROR, CALL_GetError(ctx->Exec, ()));
+
+   return pending();
+}
+
+/** Whether a readback into the buffer still has to be copied in. */
+bool
+pbo_readback::pending()
+{
+   struct gl_buffer_object *obj = _mesa_lookup_bufferobj(ctx, buf);
+
+   return st_buffer_object(obj)->readbacks != NULL;
+}
+
+void
+pbo_readback::check_contents()
+{
+   GLfloat data[4 * 4];
+
+   CALL_BindBuffer(ctx->Exec, (GL_COPY_READ_BUFFER, buf));
+   CALL_GetBufferSubData(ctx->Exec, (GL_COPY_READ_BUFFER, 0, sizeof(data),
+                                     data));
+   for (unsigned i = 0; i < 4 * 4; i++)
+      EXPECT_NEAR(clear_color[i % 4], data[i], 1.0 / 255);
+}
+
+TEST_F(pbo_readback, bound_vertex_buffer)
+{
+   CALL_VertexPointer(ctx->Exec, (4, GL_FLOAT, 0, NULL));
+   CALL_EnableClientState(ctx->Exec, (GL_VERTEX_ARRAY));
+   CALL_DrawArrays(ctx->Exec, (GL_POINTS, 0, 4));
+
+   ASSERT_TRUE(read_back());
+
+   CALL_DrawArrays(ctx->Exec, (GL_POINTS, 0, 4));
+   EXPECT_EQ((GLenum) GL_NO_ERROR, CALL_GetError(ctx->Exec, ()));
+   EXPECT_FALSE(pending());
+   check_contents();
+}
+
+TEST_F(pbo_readback, bound_index_buffer)
+{
+   /* Any byte is a valid index. */
+   static const GLfloat verts[256][4] = { { 0 } };
+
+   CALL_BindBuffer(ctx->Exec, (GL_ARRAY_BUFFER, 0));
+   CALL_VertexPointer(ctx->Exec, (4, GL_FLOAT, 0, verts));
+   CALL_EnableClientState(ctx->Exec, (GL_VERTEX_ARRAY));
+   CALL_BindBuffer(ctx->Exec, (GL_ELEMENT_ARRAY_BUFFER, buf));
+   CALL_DrawElements(ctx->Exec, (GL_POINTS, 16, GL_UNSIGNED_BYTE, NULL));
+
+   ASSERT_TRUE(read_back());
+
+   CALL_DrawElements(ctx->Exec, (GL_POINTS, 16, GL_UNSIGNED_BYTE, NULL));
+   EXPECT_EQ((GLenum) GL_NO_ERROR, CALL_GetError(ctx->Exec, ()));
+   EXPECT_FALSE(pending());
+   check_contents();
+}
@@ -159,6 +159,21 @@ vbo_get_minmax_indices(struct gl_context *ctx, const struct _mesa_prim *prim,
                        const struct _mesa_index_buffer *ib,
                        GLuint *min_index, GLuint *max_index, GLuint nr_prims);
 
+GLboolean
+vbo_find_minmax_cache(struct gl_buffer_object *bufObj,
+                      GLenum type, GLintptr offset, GLuint count,
+                      GLboolean restart, GLuint restart_index,
+                      GLuint *min_index, GLuint *max_index);
+
+void
+vbo_minmax_cache_store(struct gl_buffer_object *bufObj,
+                       GLenum type, GLintptr offset, GLuint count,
+                       GLboolean restart, GLuint restart_index,
+                       GLuint min_index, GLuint max_index);
+
+void
+vbo_delete_minmax_cache(struct gl_buffer_object *bufObj);
+
 void vbo_use_buffer_objects(struct gl_context *ctx);
 
 void vbo_always_unmap_buffers(struct gl_context *ctx);
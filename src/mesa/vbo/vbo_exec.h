@@ -50,6 +50,12 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #define VBO_VERT_BUFFER_SIZE (1024*64)	/* bytes */
 
+/**
+ * Number of VBO_VERT_BUFFER_SIZE segments in the persistently mapped
+ * vertex ring buffer, see vbo_exec_vtx_map().
+ */
+#define VBO_RING_SEGMENTS 4
+
 
 /** Current vertex program mode */
 enum vp_mode {
@@ -94,6 +100,9 @@ struct vbo_exec_context
       GLfloat *buffer_map;
       GLfloat *buffer_ptr;              /* cursor, points into buffer */
       GLuint   buffer_used;             /* in bytes */
+      GLuint   buffer_end;              /* in bytes, end of usable space */
+      GLboolean ring;                   /* persistently mapped ring buffer? */
+      struct gl_sync_object *ring_fence[VBO_RING_SEGMENTS];
       GLfloat vertex[VBO_ATTRIB_MAX*4]; /* current vertex */
 
       GLuint vert_count;
@@ -159,6 +168,7 @@ void vbo_exec_vtx_destroy( struct vbo_exec_context *exec );
 
 void vbo_exec_vtx_flush( struct vbo_exec_context *exec, GLboolean unmap );
 void vbo_exec_vtx_map( struct vbo_exec_context *exec );
+void vbo_exec_vtx_release_ring( struct vbo_exec_context *exec );
 
 
 void vbo_exec_vtx_wrap( struct vbo_exec_context *exec );
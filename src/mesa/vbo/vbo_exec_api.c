@@ -279,7 +279,7 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
     */
    exec->vtx.attrsz[attr] = newSize;
    exec->vtx.vertex_size += newSize - oldSize;
-   exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+   exec->vtx.max_vert = ((exec->vtx.buffer_end - exec->vtx.buffer_used) / 
                          (exec->vtx.vertex_size * sizeof(GLfloat)));
    exec->vtx.vert_count = 0;
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
@@ -1039,6 +1039,7 @@ void vbo_exec_vtx_init( struct vbo_exec_context *exec )
    ASSERT(!exec->vtx.buffer_map);
    exec->vtx.buffer_map = _mesa_align_malloc(VBO_VERT_BUFFER_SIZE, 64);
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
+   exec->vtx.buffer_end = VBO_VERT_BUFFER_SIZE;
 
    vbo_exec_vtxfmt_init( exec );
    _mesa_noop_vtxfmt_init(&exec->vtxfmt_noop);
@@ -1121,6 +1122,7 @@ void vbo_exec_vtx_destroy( struct vbo_exec_context *exec )
    if (_mesa_bufferobj_mapped(exec->vtx.bufferobj, MAP_INTERNAL)) {
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj, MAP_INTERNAL);
    }
+   vbo_exec_vtx_release_ring(exec);
    _mesa_reference_buffer_object(ctx, &exec->vtx.bufferobj, NULL);
 }
 
@@ -33,9 +33,11 @@
 #include "main/dispatch.h"
 #include "main/varray.h"
 #include "main/bufferobj.h"
+#include "main/cpuinfo.h"
 #include "main/enums.h"
 #include "main/macros.h"
 #include "main/transformfeedback.h"
+#include "main/sse_minmax.h"
 
 #include "vbo_context.h"
 
@@ -100,6 +102,12 @@ vbo_get_minmax_index(struct gl_context *ctx,
    indices = (char *) ib->ptr + prim->start * index_size;
    if (_mesa_is_bufferobj(ib->obj)) {
       GLsizeiptr size = MIN2(count * index_size, ib->obj->Size);
+
+      if (vbo_find_minmax_cache(ib->obj, ib->type, (GLintptr) indices, count,
+                                restart, restartIndex,
+                                min_index, max_index))
+         return;
+
       indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
                                            GL_MAP_READ_BIT, ib->obj,
                                            MAP_INTERNAL);
@@ -110,6 +118,13 @@ vbo_get_minmax_index(struct gl_context *ctx,
       const GLuint *ui_indices = (const GLuint *)indices;
       GLuint max_ui = 0;
       GLuint min_ui = ~0U;
+#ifdef USE_SSE41
+      if (_mesa_cpu_has_sse4_1) {
+         _mesa_uint_array_min_max(ui_indices, count, restart, restartIndex,
+                                  &min_ui, &max_ui);
+      }
+      else
+#endif
       if (restart) {
          for (i = 0; i < count; i++) {
             if (ui_indices[i] != restartIndex) {
@@ -132,6 +147,13 @@ vbo_get_minmax_index(struct gl_context *ctx,
       const GLushort *us_indices = (const GLushort *)indices;
       GLuint max_us = 0;
       GLuint min_us = ~0U;
+#ifdef USE_SSE41
+      if (_mesa_cpu_has_sse4_1) {
+         _mesa_ushort_array_min_max(us_indices, count, restart,
+                                    restartIndex, &min_us, &max_us);
+      }
+      else
+#endif
       if (restart) {
          for (i = 0; i < count; i++) {
             if (us_indices[i] != restartIndex) {
@@ -178,6 +200,10 @@ vbo_get_minmax_index(struct gl_context *ctx,
    }
 
    if (_mesa_is_bufferobj(ib->obj)) {
+      vbo_minmax_cache_store(ib->obj, ib->type,
+                             (GLintptr) ib->ptr + prim->start * index_size,
+                             count, restart, restartIndex,
+                             *min_index, *max_index);
       ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
    }
 }
@@ -220,10 +220,14 @@ vbo_exec_bind_arrays( struct gl_context *ctx )
 
          if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
             /* a real buffer obj: Ptr is an offset, not a pointer*/
-            assert(exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Pointer);
+            const struct gl_buffer_mapping *mapping =
+               &exec->vtx.bufferobj->Mappings[MAP_INTERNAL];
+
+            assert(mapping->Pointer);
             assert(offset >= 0);
-            arrays[attr].Ptr = (GLubyte *)
-               exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Offset + offset;
+            arrays[attr].Ptr = (GLubyte *) mapping->Offset +
+               ((GLubyte *) exec->vtx.buffer_map -
+                (GLubyte *) mapping->Pointer) + offset;
          }
          else {
             /* Ptr into ordinary app memory */
@@ -260,7 +264,21 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
 {
    if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
       struct gl_context *ctx = exec->ctx;
-      
+
+      if (exec->vtx.ring) {
+         /* The ring buffer stays mapped; it's coherent, so there's
+          * nothing to flush either.
+          */
+         exec->vtx.buffer_used += (exec->vtx.buffer_ptr -
+                                   exec->vtx.buffer_map) * sizeof(float);
+         assert(exec->vtx.buffer_used <= exec->vtx.buffer_end);
+
+         exec->vtx.buffer_map = NULL;
+         exec->vtx.buffer_ptr = NULL;
+         exec->vtx.max_vert = 0;
+         return;
+      }
+
       if (ctx->Driver.FlushMappedBufferRange) {
          GLintptr offset = exec->vtx.buffer_used -
                            exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Offset;
@@ -276,7 +294,7 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
       exec->vtx.buffer_used += (exec->vtx.buffer_ptr -
                                 exec->vtx.buffer_map) * sizeof(float);
 
-      assert(exec->vtx.buffer_used <= VBO_VERT_BUFFER_SIZE);
+      assert(exec->vtx.buffer_used <= exec->vtx.buffer_end);
       assert(exec->vtx.buffer_ptr != NULL);
       
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj, MAP_INTERNAL);
@@ -287,6 +305,137 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
 }
 
 
+/**
+ * Put a fence after the draws which used the given ring buffer segment.
+ */
+static GLboolean
+vbo_exec_ring_fence( struct vbo_exec_context *exec, GLuint segment )
+{
+   struct gl_context *ctx = exec->ctx;
+   struct gl_sync_object *fence;
+
+   assert(!exec->vtx.ring_fence[segment]);
+
+   fence = ctx->Driver.NewSyncObject(ctx, GL_SYNC_FENCE);
+   if (!fence)
+      return GL_FALSE;
+
+   fence->Type = GL_SYNC_FENCE;
+   fence->Name = 1;
+   fence->RefCount = 1;
+   fence->DeletePending = GL_FALSE;
+   fence->SyncCondition = GL_SYNC_GPU_COMMANDS_COMPLETE;
+   fence->Flags = 0;
+   fence->StatusFlag = 0;
+   ctx->Driver.FenceSync(ctx, fence, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+   exec->vtx.ring_fence[segment] = fence;
+   return GL_TRUE;
+}
+
+
+/**
+ * Has the GPU finished with the given ring buffer segment?  Doesn't wait.
+ */
+static GLboolean
+vbo_exec_ring_segment_idle( struct vbo_exec_context *exec, GLuint segment )
+{
+   struct gl_context *ctx = exec->ctx;
+   struct gl_sync_object *fence = exec->vtx.ring_fence[segment];
+
+   if (fence) {
+      ctx->Driver.CheckSync(ctx, fence);
+      if (!fence->StatusFlag)
+         return GL_FALSE;
+
+      ctx->Driver.DeleteSyncObject(ctx, fence);
+      exec->vtx.ring_fence[segment] = NULL;
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Free the ring buffer fences.
+ */
+void
+vbo_exec_vtx_release_ring( struct vbo_exec_context *exec )
+{
+   struct gl_context *ctx = exec->ctx;
+   GLuint i;
+
+   for (i = 0; i < VBO_RING_SEGMENTS; i++) {
+      if (exec->vtx.ring_fence[i]) {
+         ctx->Driver.DeleteSyncObject(ctx, exec->vtx.ring_fence[i]);
+         exec->vtx.ring_fence[i] = NULL;
+      }
+   }
+}
+
+
+/**
+ * Map the vertex buffer as a ring buffer of VBO_RING_SEGMENTS segments.
+ *
+ * The buffer is mapped persistently once, and each batch of vertices is
+ * written straight after the previous one.  When a segment is full, it
+ * gets a fence and we move on to the next one.  If the GPU is still
+ * reading that one, we orphan the whole buffer rather than wait.
+ */
+static void
+vbo_exec_vtx_map_ring( struct vbo_exec_context *exec )
+{
+   struct gl_context *ctx = exec->ctx;
+   struct gl_buffer_object *obj = exec->vtx.bufferobj;
+   const GLbitfield flags = GL_MAP_WRITE_BIT |
+                            GL_MAP_PERSISTENT_BIT |
+                            GL_MAP_COHERENT_BIT;
+   const GLsizeiptr size = VBO_VERT_BUFFER_SIZE * VBO_RING_SEGMENTS;
+   GLboolean orphan = !exec->vtx.ring;
+
+   if (exec->vtx.ring && exec->vtx.buffer_end < exec->vtx.buffer_used + 1024) {
+      /* Move on to the next segment */
+      const GLuint segment = exec->vtx.buffer_end / VBO_VERT_BUFFER_SIZE - 1;
+      const GLuint next = (segment + 1) % VBO_RING_SEGMENTS;
+
+      if (!vbo_exec_ring_fence(exec, segment) ||
+          !vbo_exec_ring_segment_idle(exec, next))
+         orphan = GL_TRUE;
+
+      exec->vtx.buffer_used = next * VBO_VERT_BUFFER_SIZE;
+      exec->vtx.buffer_end = exec->vtx.buffer_used + VBO_VERT_BUFFER_SIZE;
+   }
+
+   if (orphan) {
+      if (_mesa_bufferobj_mapped(obj, MAP_INTERNAL))
+         ctx->Driver.UnmapBuffer(ctx, obj, MAP_INTERNAL);
+      vbo_exec_vtx_release_ring(exec);
+
+      exec->vtx.ring = GL_FALSE;
+      exec->vtx.buffer_used = 0;
+      exec->vtx.buffer_end = VBO_VERT_BUFFER_SIZE;
+
+      if (!ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB, size, NULL,
+                                  GL_STREAM_DRAW_ARB, flags, obj)) {
+         _mesa_error(ctx, GL_OUT_OF_MEMORY, "VBO allocation");
+         return;
+      }
+      exec->vtx.ring = GL_TRUE;
+   }
+
+   /* Someone else (vbo_split_copy, for one) may have unmapped it */
+   if (!_mesa_bufferobj_mapped(obj, MAP_INTERNAL) &&
+       !ctx->Driver.MapBufferRange(ctx, 0, size,
+                                   flags | GL_MAP_UNSYNCHRONIZED_BIT,
+                                   obj, MAP_INTERNAL))
+      return;
+
+   exec->vtx.buffer_map = (GLfloat *)
+      ((GLubyte *) obj->Mappings[MAP_INTERNAL].Pointer +
+       exec->vtx.buffer_used);
+}
+
+
 /**
  * Map the vertex buffer to begin storing glVertex, glColor, etc data.
  */
@@ -307,7 +456,10 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
    assert(!exec->vtx.buffer_map);
    assert(!exec->vtx.buffer_ptr);
 
-   if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
+   if (ctx->Extensions.ARB_buffer_storage) {
+      vbo_exec_vtx_map_ring(exec);
+   }
+   else if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
       /* The VBO exists and there's room for more */
       if (exec->vtx.bufferobj->Size > 0) {
          exec->vtx.buffer_map =
@@ -325,7 +477,7 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
       }
    }
    
-   if (!exec->vtx.buffer_map) {
+   if (!exec->vtx.buffer_map && !exec->vtx.ring) {
       /* Need to allocate a new VBO */
       exec->vtx.buffer_used = 0;
 
@@ -434,7 +586,7 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
    if (keepUnmapped || exec->vtx.vertex_size == 0)
       exec->vtx.max_vert = 0;
    else
-      exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+      exec->vtx.max_vert = ((exec->vtx.buffer_end - exec->vtx.buffer_used) / 
                             (exec->vtx.vertex_size * sizeof(GLfloat)));
 
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
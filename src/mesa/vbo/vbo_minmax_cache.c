@@ -0,0 +1,227 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file vbo_minmax_cache.c
+ * Memoize the index range of glDrawElements calls from buffer objects.
+ *
+ * Drivers which need index bounds call vbo_get_minmax_indices() for draws
+ * without an explicit range, which maps the index buffer and scans it.
+ * Static meshes are drawn with the same (offset, count, type) over and over,
+ * so remember the result per buffer object until its contents change.
+ */
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/hash_table.h"
+#include "main/imports.h"
+#include "main/mtypes.h"
+#include "ralloc.h"
+#include "vbo.h"
+
+
+/** Evict everything once a buffer holds this many ranges. */
+#define MAX_ENTRIES 128
+
+/**
+ * Stop using the cache on a buffer after this many indices were scanned
+ * without a hit rate of at least 50%.
+ */
+#define MISS_INDICES_THRESHOLD 500000
+
+
+struct minmax_cache_key {
+   GLintptr offset;
+   GLuint count;
+   GLenum type;
+   GLuint restart;
+   GLuint restart_index;
+};
+
+
+struct minmax_cache_entry {
+   struct minmax_cache_key key;
+   GLuint min;
+   GLuint max;
+};
+
+
+static bool
+minmax_cache_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct minmax_cache_key)) == 0;
+}
+
+
+static void
+init_key(struct minmax_cache_key *key, GLenum type, GLintptr offset,
+         GLuint count, GLboolean restart, GLuint restart_index)
+{
+   memset(key, 0, sizeof(*key));
+   key->offset = offset;
+   key->count = count;
+   key->type = type;
+   key->restart = restart;
+   key->restart_index = restart ? restart_index : 0;
+}
+
+
+/**
+ * Can the index range of this buffer be cached?  Not if the GPU may write
+ * to it behind our back, or the application may through a persistent
+ * mapping.
+ */
+static GLboolean
+use_minmax_cache(const struct gl_buffer_object *bufObj)
+{
+   const GLbitfield persistent_write =
+      GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT;
+
+   if (bufObj->GPUWritable)
+      return GL_FALSE;
+
+   if (bufObj->Mappings[MAP_USER].Pointer &&
+       (bufObj->Mappings[MAP_USER].AccessFlags & persistent_write) ==
+       persistent_write)
+      return GL_FALSE;
+
+   if (bufObj->MinMaxCacheMissIndices > MISS_INDICES_THRESHOLD &&
+       bufObj->MinMaxCacheHitIndices < bufObj->MinMaxCacheMissIndices)
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
+static void
+free_minmax_cache(struct gl_buffer_object *bufObj)
+{
+   /* The entries are ralloc'ed children of the table. */
+   _mesa_hash_table_destroy(bufObj->MinMaxCache, NULL);
+   bufObj->MinMaxCache = NULL;
+}
+
+
+/**
+ * Look up the index range for the given draw in the buffer's cache.
+ *
+ * \return GL_TRUE on a hit, with the range in *min_index and *max_index
+ */
+GLboolean
+vbo_find_minmax_cache(struct gl_buffer_object *bufObj,
+                      GLenum type, GLintptr offset, GLuint count,
+                      GLboolean restart, GLuint restart_index,
+                      GLuint *min_index, GLuint *max_index)
+{
+   struct minmax_cache_key key;
+   struct hash_entry *result = NULL;
+   uint32_t hash;
+
+   if (!use_minmax_cache(bufObj))
+      return GL_FALSE;
+
+   init_key(&key, type, offset, count, restart, restart_index);
+   hash = _mesa_hash_data(&key, sizeof(key));
+
+   mtx_lock(&bufObj->MinMaxCacheMutex);
+
+   if (bufObj->MinMaxCacheDirty) {
+      /* The buffer contents changed since the cache was filled. */
+      if (bufObj->MinMaxCache)
+         free_minmax_cache(bufObj);
+      bufObj->MinMaxCacheDirty = GL_FALSE;
+   }
+
+   if (bufObj->MinMaxCache)
+      result = _mesa_hash_table_search(bufObj->MinMaxCache, hash, &key);
+
+   if (result) {
+      const struct minmax_cache_entry *entry = result->data;
+      *min_index = entry->min;
+      *max_index = entry->max;
+      bufObj->MinMaxCacheHitIndices += count;
+   }
+   else {
+      bufObj->MinMaxCacheMissIndices += count;
+   }
+
+   mtx_unlock(&bufObj->MinMaxCacheMutex);
+
+   return result != NULL;
+}
+
+
+/**
+ * Remember the index range computed for a draw after a cache miss.
+ */
+void
+vbo_minmax_cache_store(struct gl_buffer_object *bufObj,
+                       GLenum type, GLintptr offset, GLuint count,
+                       GLboolean restart, GLuint restart_index,
+                       GLuint min_index, GLuint max_index)
+{
+   struct minmax_cache_entry *entry;
+   uint32_t hash;
+
+   if (!use_minmax_cache(bufObj))
+      return;
+
+   mtx_lock(&bufObj->MinMaxCacheMutex);
+
+   if (bufObj->MinMaxCache &&
+       bufObj->MinMaxCache->entries >= MAX_ENTRIES)
+      free_minmax_cache(bufObj);
+
+   if (!bufObj->MinMaxCache) {
+      bufObj->MinMaxCache = _mesa_hash_table_create(NULL,
+                                                    minmax_cache_key_equal);
+      if (!bufObj->MinMaxCache)
+         goto out;
+   }
+
+   entry = ralloc(bufObj->MinMaxCache, struct minmax_cache_entry);
+   if (!entry)
+      goto out;
+
+   init_key(&entry->key, type, offset, count, restart, restart_index);
+   entry->min = min_index;
+   entry->max = max_index;
+   hash = _mesa_hash_data(&entry->key, sizeof(entry->key));
+
+   _mesa_hash_table_insert(bufObj->MinMaxCache, hash, &entry->key, entry);
+
+out:
+   mtx_unlock(&bufObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Free a buffer object's index range cache.  Called when the buffer object
+ * is deleted.
+ */
+void
+vbo_delete_minmax_cache(struct gl_buffer_object *bufObj)
+{
+   if (bufObj->MinMaxCache)
+      free_minmax_cache(bufObj);
+}
@@ -83,6 +83,11 @@ struct vbo_save_vertex_list {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+
+   /* Set for lists made by vbo_merge_vertex_lists(), which own their
+    * prim array (prim_store is NULL) and vertex store.
+    */
+   struct _mesa_index_buffer *ib;
 };
 
 /* These buffers should be a reasonable size to support upload to
@@ -103,6 +108,9 @@ struct vbo_save_vertex_list {
 
 #define VBO_SAVE_FALLBACK    0x10000000
 
+/* An interesting VBO number/name to help with debugging */
+#define VBO_BUF_ID  12345
+
 /* Storage to be shared among several vertex_lists.
  */
 struct vbo_save_vertex_store {
@@ -173,6 +181,12 @@ void vbo_loopback_vertex_list( struct gl_context *ctx,
 			       GLuint wrap_count,
 			       GLuint vertex_size);
 
+/* save_merge.c:
+ */
+GLbitfield64 vbo_save_attribs_written( const void *data );
+GLuint vbo_merge_vertex_lists( struct gl_context *ctx, void *data,
+                               void **lists, GLuint count );
+
 /* Callbacks:
  */
 void vbo_save_EndList( struct gl_context *ctx );
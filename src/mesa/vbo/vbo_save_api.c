@@ -88,10 +88,6 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 #endif
 
 
-/* An interesting VBO number/name to help with debugging */
-#define VBO_BUF_ID  12345
-
-
 /*
  * NOTE: Old 'parity' issue is gone, but copying can still be
  * wrong-footed on replay.
@@ -396,6 +392,7 @@ _save_compile_vertex_list(struct gl_context *ctx)
    node->prim_count = save->prim_count;
    node->vertex_store = save->vertex_store;
    node->prim_store = save->prim_store;
+   node->ib = NULL;
 
    node->vertex_store->refcount++;
    node->prim_store->refcount++;
@@ -1516,8 +1513,18 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->vertex_store->refcount == 0)
       free_vertex_store(ctx, node->vertex_store);
 
-   if (--node->prim_store->refcount == 0)
-      free(node->prim_store);
+   if (node->prim_store) {
+      if (--node->prim_store->refcount == 0)
+         free(node->prim_store);
+   }
+   else {
+      free(node->prim);
+   }
+
+   if (node->ib) {
+      _mesa_reference_buffer_object(ctx, &node->ib->obj, NULL);
+      free(node->ib);
+   }
 
    free(node->current_data);
    node->current_data = NULL;
@@ -1533,6 +1540,8 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data)
 
    printf("VBO-VERTEX-LIST, %u vertices %d primitives, %d vertsize\n",
           node->count, node->prim_count, node->vertex_size);
+   if (node->ib)
+      printf("   merged, %u indices\n", node->ib->count);
 
    for (i = 0; i < node->prim_count; i++) {
       struct _mesa_prim *prim = &node->prim[i];
@@ -1588,6 +1597,9 @@ vbo_save_api_init(struct vbo_save_context *save)
                                vbo_save_playback_vertex_list,
                                vbo_destroy_vertex_list,
                                vbo_print_vertex_list);
+   _mesa_dlist_set_opcode_optimizer(ctx, save->opcode_vertex_list,
+                                    vbo_save_attribs_written,
+                                    vbo_merge_vertex_lists);
 
    ctx->Driver.NotifySaveBegin = vbo_save_NotifyBegin;
 
@@ -34,6 +34,7 @@
 #include "main/macros.h"
 #include "main/light.h"
 #include "main/state.h"
+#include "main/varray.h"
 
 #include "vbo_context.h"
 
@@ -217,6 +218,57 @@ static void vbo_bind_vertex_list(struct gl_context *ctx,
 }
 
 
+/**
+ * Loopback for a merged vertex list: expand the indexed vertices back into
+ * a plain vertex array first.
+ */
+static void
+loopback_indexed_vertex_list(struct gl_context *ctx,
+                             const struct vbo_save_vertex_list *list,
+                             const GLfloat *buffer)
+{
+   const struct _mesa_index_buffer *ib = list->ib;
+   const GLuint vertex_size = list->vertex_size;
+   const void *indices;
+   struct _mesa_prim *prims;
+   GLfloat *verts;
+   GLuint i;
+
+   indices = ctx->Driver.MapBufferRange(ctx, 0, ib->obj->Size,
+                                        GL_MAP_READ_BIT, ib->obj,
+                                        MAP_INTERNAL);
+   verts = malloc(ib->count * vertex_size * sizeof(GLfloat));
+   prims = malloc(list->prim_count * sizeof(struct _mesa_prim));
+
+   if (indices && verts && prims) {
+      for (i = 0; i < ib->count; i++) {
+         const GLuint index = ib->type == GL_UNSIGNED_SHORT ?
+            ((const GLushort *) indices)[i] : ((const GLuint *) indices)[i];
+
+         memcpy(verts + i * vertex_size, buffer + index * vertex_size,
+                vertex_size * sizeof(GLfloat));
+      }
+
+      /* the prims' index ranges are now vertex ranges */
+      for (i = 0; i < list->prim_count; i++) {
+         prims[i] = list->prim[i];
+         prims[i].indexed = 0;
+      }
+
+      vbo_loopback_vertex_list(ctx, verts, list->attrsz, prims,
+                               list->prim_count, 0, vertex_size);
+   }
+   else {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glCallList");
+   }
+
+   free(verts);
+   free(prims);
+   if (indices)
+      ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
+}
+
+
 static void
 vbo_save_loopback_vertex_list(struct gl_context *ctx,
                               const struct vbo_save_vertex_list *list)
@@ -228,19 +280,38 @@ vbo_save_loopback_vertex_list(struct gl_context *ctx,
 				 list->vertex_store->bufferobj,
                                  MAP_INTERNAL);
 
-   vbo_loopback_vertex_list(ctx,
-                            (const GLfloat *)(buffer + list->buffer_offset),
-                            list->attrsz,
-                            list->prim,
-                            list->prim_count,
-                            list->wrap_count,
-                            list->vertex_size);
+   if (list->ib)
+      loopback_indexed_vertex_list(ctx, list,
+                                   (const GLfloat *) (buffer +
+                                                      list->buffer_offset));
+   else
+      vbo_loopback_vertex_list(ctx,
+                               (const GLfloat *)(buffer + list->buffer_offset),
+                               list->attrsz,
+                               list->prim,
+                               list->prim_count,
+                               list->wrap_count,
+                               list->vertex_size);
 
    ctx->Driver.UnmapBuffer(ctx, list->vertex_store->bufferobj,
                            MAP_INTERNAL);
 }
 
 
+/**
+ * Could the indices of a merged vertex list hit the primitive restart
+ * index?  The list was compiled from glBegin/glEnd, which primitive
+ * restart doesn't apply to, but drivers apply it to every indexed draw.
+ */
+static GLboolean
+merged_list_hits_restart(const struct gl_context *ctx,
+                         const struct vbo_save_vertex_list *node)
+{
+   return node->ib && ctx->Array._PrimitiveRestart &&
+          _mesa_primitive_restart_index(ctx, node->ib->type) < node->count;
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * This is called from the display list code when executing
@@ -278,7 +349,8 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
                      "draw operation inside glBegin/End");
          goto end;
       }
-      else if (save->replay_flags) {
+      else if (save->replay_flags ||
+               merged_list_hits_restart(ctx, node)) {
 	 /* Various degnerate cases: translate into immediate mode
 	  * calls rather than trying to execute in place.
 	  */
@@ -311,7 +383,7 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
          vbo_context(ctx)->draw_prims(ctx, 
                                       node->prim,
                                       node->prim_count,
-                                      NULL,
+                                      node->ib,
                                       GL_TRUE,
                                       0,    /* Node is a VBO, so this is ok */
                                       node->count - 1,
@@ -0,0 +1,372 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Display list optimizer hooks for vertex lists (see optimize_list() in
+ * main/dlist.c).
+ *
+ * A display list with many glBegin/glEnd blocks separated by nothing but
+ * redundant state changes compiles to a row of vertex lists, each drawn
+ * separately.  Once the optimizer has dropped the redundant state changes
+ * we merge such rows into a single vertex list: the vertices are
+ * deduplicated into a buffer of their own, an index buffer is built for
+ * the primitives, and the whole lot is drawn with one indexed draw_prims()
+ * call.  If primitive restart is enabled with an index the merged list
+ * uses, it is replayed through the loopback path instead.
+ */
+
+
+#include "main/glheader.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+
+#include "vbo_context.h"
+
+
+/** Limit on the size of a merged vertex list, to bound temporary memory */
+#define MAX_MERGED_VERTS (1 << 20)
+
+
+/**
+ * Which current vertex attributes can replaying the vertex list change?
+ * This includes the loopback path, which updates them even for
+ * no_current_update lists.
+ */
+GLbitfield64
+vbo_save_attribs_written(const void *data)
+{
+   const struct vbo_save_vertex_list *node =
+      (const struct vbo_save_vertex_list *) data;
+   GLbitfield64 attribs = 0x0;
+   GLuint i;
+
+   for (i = VBO_ATTRIB_POS + 1; i <= VBO_ATTRIB_GENERIC15; i++) {
+      if (node->attrsz[i])
+         attribs |= VERT_BIT(i - VBO_ATTRIB_POS);
+   }
+
+   return attribs;
+}
+
+
+/**
+ * Can the vertex list be merged with others at all?  It must consist of
+ * complete primitives which don't depend on the current attributes.
+ */
+static GLboolean
+can_merge(const struct vbo_save_vertex_list *node)
+{
+   GLuint i;
+
+   if (node->ib || node->count == 0 || node->prim_count == 0 ||
+       node->wrap_count || node->dangling_attr_ref ||
+       (node->current_size && !node->current_data))
+      return GL_FALSE;
+
+   for (i = 0; i < node->prim_count; i++) {
+      if (!node->prim[i].begin || !node->prim[i].end)
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Do the two vertex lists have the same vertex layout, and the same
+ * effect on the current attributes?
+ */
+static GLboolean
+same_format(const struct vbo_save_vertex_list *a,
+            const struct vbo_save_vertex_list *b)
+{
+   GLuint i;
+
+   if (a->vertex_size != b->vertex_size ||
+       a->current_size != b->current_size ||
+       a->prim[0].no_current_update != b->prim[0].no_current_update)
+      return GL_FALSE;
+
+   for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+      if (a->attrsz[i] != b->attrsz[i] ||
+          (a->attrsz[i] && a->attrtype[i] != b->attrtype[i]))
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
+static GLuint
+hash_vertex(const GLfloat *v, GLuint size)
+{
+   const GLuint *u = (const GLuint *) v;
+   GLuint hash = 2166136261u;
+   GLuint i;
+
+   for (i = 0; i < size; i++)
+      hash = (hash ^ u[i]) * 16777619u;
+
+   return hash;
+}
+
+
+/**
+ * Remove duplicate vertices from verts[], compacting it.
+ * \param remap  returns the new index of each vertex
+ * \return number of distinct vertices, or 0 if out of memory
+ */
+static GLuint
+dedup_vertices(GLfloat *verts, GLuint count, GLuint vertex_size,
+               GLuint *remap)
+{
+   const GLuint bytes = vertex_size * sizeof(GLfloat);
+   GLuint table_size = 1, mask, unique = 0, i;
+   GLuint *table;
+
+   while (table_size < 2 * count)
+      table_size *= 2;
+   mask = table_size - 1;
+
+   table = malloc(table_size * sizeof(GLuint));
+   if (!table)
+      return 0;
+   memset(table, 0xff, table_size * sizeof(GLuint));
+
+   for (i = 0; i < count; i++) {
+      const GLfloat *v = verts + i * vertex_size;
+      GLuint h = hash_vertex(v, vertex_size) & mask;
+
+      while (table[h] != ~0u &&
+             memcmp(verts + table[h] * vertex_size, v, bytes) != 0)
+         h = (h + 1) & mask;
+
+      if (table[h] == ~0u) {
+         if (unique != i)
+            memcpy(verts + unique * vertex_size, v, bytes);
+         table[h] = unique++;
+      }
+
+      remap[i] = table[h];
+   }
+
+   free(table);
+   return unique;
+}
+
+
+/**
+ * Create a buffer object holding the given data, for internal use.
+ */
+static struct gl_buffer_object *
+create_static_buffer(struct gl_context *ctx, GLenum target,
+                     GLsizeiptr size, const void *data)
+{
+   struct gl_buffer_object *obj =
+      ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID, target);
+
+   if (obj &&
+       !ctx->Driver.BufferData(ctx, target, size, data, GL_STATIC_DRAW_ARB,
+                               GL_MAP_READ_BIT, obj)) {
+      _mesa_reference_buffer_object(ctx, &obj, NULL);
+   }
+
+   return obj;
+}
+
+
+/**
+ * Merge hook for vertex lists, see _mesa_dlist_set_opcode_optimizer().
+ *
+ * Merges the longest run at the start of lists[] which have the same
+ * vertex layout into a new indexed vertex list at data.
+ *
+ * \return number of vertex lists merged, 0 if none
+ */
+GLuint
+vbo_merge_vertex_lists(struct gl_context *ctx, void *data,
+                       void **lists, GLuint count)
+{
+   struct vbo_save_vertex_list *merged =
+      (struct vbo_save_vertex_list *) data;
+   struct vbo_save_vertex_list *first =
+      (struct vbo_save_vertex_list *) lists[0];
+   struct vbo_save_vertex_list *last;
+   struct vbo_save_vertex_store *store = NULL;
+   struct _mesa_index_buffer *ib = NULL;
+   struct _mesa_prim *prims = NULL;
+   GLfloat *verts = NULL;
+   GLuint *remap = NULL, *indices = NULL;
+   GLuint num_lists, num_verts, num_prims, num_indices, num_unique;
+   GLuint vertex_size, index_size, base, i, j, k;
+
+   if (!can_merge(first))
+      return 0;
+
+   num_verts = first->count;
+   num_prims = first->prim_count;
+   for (num_lists = 1; num_lists < count; num_lists++) {
+      const struct vbo_save_vertex_list *node =
+         (const struct vbo_save_vertex_list *) lists[num_lists];
+
+      if (!can_merge(node) || !same_format(first, node) ||
+          num_verts + node->count > MAX_MERGED_VERTS)
+         break;
+
+      num_verts += node->count;
+      num_prims += node->prim_count;
+   }
+
+   if (num_lists < 2)
+      return 0;
+
+   last = (struct vbo_save_vertex_list *) lists[num_lists - 1];
+   vertex_size = first->vertex_size;
+
+   verts = malloc(num_verts * vertex_size * sizeof(GLfloat));
+   remap = malloc(num_verts * sizeof(GLuint));
+   indices = malloc(num_verts * sizeof(GLuint));
+   prims = malloc(num_prims * sizeof(struct _mesa_prim));
+   store = CALLOC_STRUCT(vbo_save_vertex_store);
+   ib = CALLOC_STRUCT(_mesa_index_buffer);
+   if (!verts || !remap || !indices || !prims || !store || !ib)
+      goto fail;
+
+   /* Read back all the vertices and find the distinct ones */
+   base = 0;
+   for (i = 0; i < num_lists; i++) {
+      const struct vbo_save_vertex_list *node =
+         (const struct vbo_save_vertex_list *) lists[i];
+
+      ctx->Driver.GetBufferSubData(ctx, node->buffer_offset,
+                                   node->count * vertex_size * sizeof(GLfloat),
+                                   verts + base * vertex_size,
+                                   node->vertex_store->bufferobj);
+      base += node->count;
+   }
+
+   num_unique = dedup_vertices(verts, num_verts, vertex_size, remap);
+   if (!num_unique)
+      goto fail;
+
+   /* Index the primitives, merging the ones which can be */
+   base = 0;
+   num_prims = 0;
+   num_indices = 0;
+   for (i = 0; i < num_lists; i++) {
+      const struct vbo_save_vertex_list *node =
+         (const struct vbo_save_vertex_list *) lists[i];
+
+      for (j = 0; j < node->prim_count; j++) {
+         const struct _mesa_prim *src = &node->prim[j];
+         struct _mesa_prim *prim = &prims[num_prims];
+
+         *prim = *src;
+         prim->indexed = 1;
+         prim->start = num_indices;
+         for (k = 0; k < src->count; k++)
+            indices[num_indices++] = remap[base + src->start + k];
+
+         if (num_prims && vbo_can_merge_prims(prim - 1, prim))
+            vbo_merge_prims(prim - 1, prim);
+         else
+            num_prims++;
+      }
+
+      base += node->count;
+   }
+
+   /* Keep clear of the fixed primitive restart index, 0xffff, see
+    * merged_list_hits_restart().
+    */
+   if (num_unique <= 0xffff) {
+      GLushort *us = (GLushort *) indices;
+
+      /* in place, front to back */
+      for (k = 0; k < num_indices; k++)
+         us[k] = (GLushort) indices[k];
+      ib->type = GL_UNSIGNED_SHORT;
+      index_size = sizeof(GLushort);
+   }
+   else {
+      ib->type = GL_UNSIGNED_INT;
+      index_size = sizeof(GLuint);
+   }
+
+   /* Upload both, they stay resident until the list is deleted */
+   store->bufferobj =
+      create_static_buffer(ctx, GL_ARRAY_BUFFER_ARB,
+                           num_unique * vertex_size * sizeof(GLfloat), verts);
+   ib->obj =
+      create_static_buffer(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                           num_indices * index_size, indices);
+   if (!store->bufferobj || !ib->obj)
+      goto fail;
+
+   store->used = num_unique * vertex_size;
+   store->refcount = 1;
+   ib->count = num_indices;
+   ib->ptr = NULL;
+
+   memset(merged, 0, sizeof(*merged));
+   memcpy(merged->attrsz, first->attrsz, sizeof(merged->attrsz));
+   memcpy(merged->attrtype, first->attrtype, sizeof(merged->attrtype));
+   merged->vertex_size = vertex_size;
+   merged->buffer_offset = 0;
+   merged->count = num_unique;
+   merged->prim = prims;
+   merged->prim_count = num_prims;
+   merged->vertex_store = store;
+   merged->prim_store = NULL;
+   merged->ib = ib;
+
+   /* The current values come from the last list */
+   merged->current_size = last->current_size;
+   merged->current_data = last->current_data;
+   last->current_data = NULL;
+
+   free(verts);
+   free(remap);
+   free(indices);
+   return num_lists;
+
+fail:
+   if (store && store->bufferobj)
+      _mesa_reference_buffer_object(ctx, &store->bufferobj, NULL);
+   if (ib && ib->obj)
+      _mesa_reference_buffer_object(ctx, &ib->obj, NULL);
+   free(store);
+   free(ib);
+   free(prims);
+   free(verts);
+   free(remap);
+   free(indices);
+   return 0;
+}